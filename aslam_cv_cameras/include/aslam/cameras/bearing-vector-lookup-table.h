@@ -0,0 +1,71 @@
+#ifndef ASLAM_CAMERAS_BEARING_VECTOR_LOOKUP_TABLE_H_
+#define ASLAM_CAMERAS_BEARING_VECTOR_LOOKUP_TABLE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+// Forward declarations.
+class Camera;
+
+/// \class BearingVectorLookupTable
+/// \brief Dense grid of precomputed back-projections of a camera. Bearing vectors of keypoints
+///        between the grid nodes are bilinearly interpolated. The table stores a snapshot of the
+///        camera parameters it was built from so that stale tables can be detected.
+class BearingVectorLookupTable {
+ public:
+  ASLAM_POINTER_TYPEDEFS(BearingVectorLookupTable);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(BearingVectorLookupTable);
+
+  /// \brief Back-projects all grid nodes of the camera.
+  /// @param[in] camera  The camera to tabulate.
+  /// @param[in] step_px Distance between two grid nodes in pixels, e.g. 0.5 for a node every
+  ///                    half pixel. The grid covers the whole image.
+  BearingVectorLookupTable(const Camera& camera, double step_px);
+
+  /// \brief Interpolates the bearing vector of a keypoint.
+  /// @param[in]  keypoint     Keypoint in image coordinates.
+  /// @param[out] out_point_3d Interpolated bearing vector, same convention as
+  ///                          Camera::backProject3.
+  /// @return False if the keypoint is outside the image or next to a grid node that could not
+  ///         be back-projected. The bearing vector is not set in this case.
+  bool interpolate(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+                   Eigen::Vector3d* out_point_3d) const;
+
+  /// \brief Was the table built from the current parameters of the given camera?
+  bool isUpToDate(const Camera& camera) const;
+
+  double getStepPx() const { return step_px_; }
+  int getNumNodesU() const { return num_nodes_u_; }
+  int getNumNodesV() const { return num_nodes_v_; }
+
+  /// \brief Returns the memory used by the grid in bytes.
+  size_t getMemoryBytes() const;
+
+ private:
+  const double step_px_;
+  const double inverse_step_px_;
+  const uint32_t image_width_;
+  const uint32_t image_height_;
+  int num_nodes_u_;
+  int num_nodes_v_;
+
+  /// Bearing vectors of the grid nodes in row-major order.
+  Eigen::Matrix3Xf bearing_vectors_;
+  /// Was the back-projection of the grid node successful?
+  std::vector<unsigned char> is_node_valid_;
+
+  /// Snapshot of the camera parameters the table was built from.
+  Eigen::VectorXd intrinsics_;
+  Eigen::VectorXd distortion_parameters_;
+  int distortion_type_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_BEARING_VECTOR_LOOKUP_TABLE_H_
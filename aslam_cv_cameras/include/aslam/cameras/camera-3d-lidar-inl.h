@@ -1,6 +1,7 @@
 #ifndef ASLAM_CAMERAS_CAMERA_3D_LIDAR_INL_H_
 #define ASLAM_CAMERAS_CAMERA_3D_LIDAR_INL_H_
 
+#include <cmath>
 #include <memory>
 
 namespace aslam {
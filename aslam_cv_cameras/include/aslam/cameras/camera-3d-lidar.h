@@ -78,6 +78,58 @@ class Camera3DLidar : public aslam::Cloneable<Camera, Camera3DLidar> {
       const Eigen::Ref<const Eigen::Vector2d>& keypoint,
       Eigen::Vector3d* out_point_3d) const;
 
+  // Get the double version of project3Vectorized(..) from base into scope.
+  using Camera::project3Vectorized;
+
+  /// \brief Single precision version of project3Vectorized(..) that runs the templated
+  ///        project3Functional(..) in float.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Dense range image of a scan, imageHeight() x imageWidth().
+  typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      RangeImage;
+  /// \brief Index of the point stored in each pixel of a RangeImage.
+  typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      IndexImage;
+  /// \brief Value of the IndexImage pixels without a return.
+  static constexpr int kNoReturnIndex = -1;
+
+  /// \brief Projects a whole scan into a dense range image. Each point is
+  ///        assigned to the pixel closest to its keypoint, i.e. pixel
+  ///        (row, col) holds the returns around the beam direction of keypoint
+  ///        (col, row), including the half pixel beyond the image border. If
+  ///        several points fall into the same pixel, the nearest one is kept.
+  ///        The angles are computed with the vectorized approximate arc
+  ///        tangent of vectorized::projectLidar(..), which deviates from
+  ///        project3(..) by at most 1.2e-5 rad.
+  /// @param[in]  points_3d       The scan in the sensor frame.
+  /// @param[in]  num_threads     Number of threads, including the calling
+  ///                             thread. The others are taken from a thread
+  ///                             pool shared by all scan projections. The
+  ///                             image is split into bands of columns, one
+  ///                             per thread, and the points are bucketed by
+  ///                             band.
+  /// @param[out] out_range_image Range of the nearest point per pixel [m],
+  ///                             0 for pixels without a return.
+  /// @param[out] out_index_image Optional: column in points_3d of the nearest
+  ///                             point per pixel, kNoReturnIndex for pixels
+  ///                             without a return.
+  void projectScanToRangeImage(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      const size_t num_threads, RangeImage* out_range_image,
+      IndexImage* out_index_image) const;
+
+  /// \brief Returns the flat parameter set used by the vectorized kernels.
+  vectorized::LidarProjectionParameters getVectorizedProjectionParameters()
+      const;
+
   /// \brief Checks the success of a projection operation and returns the result
   /// in a
   ///        ProjectionResult object.
@@ -116,6 +116,62 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   virtual bool backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
                             Eigen::Vector3d* out_point_3d) const;
 
+  /// \brief Projects a matrix of euclidean points to 2d image measurements
+  ///        using the SIMD kernels of the best instruction set supported by the
+  ///        CPU. The results are identical to calling project3(..) per point.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Same as project3Vectorized(..) but uses the kernels of the given
+  ///        instruction set, which must be supported by the CPU.
+  void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      vectorized::InstructionSet instruction_set,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Single precision version of project3Vectorized(..) using the float kernels.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Single precision version of project3Vectorized(..) using the float kernels of
+  ///        the given instruction set, which must be supported by the CPU.
+  void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      vectorized::InstructionSet instruction_set,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Returns the flat parameter set used by the vectorized kernels.
+  vectorized::ProjectionParameters getVectorizedProjectionParameters() const;
+
+  /// \brief Compute the 3d bearing vectors in euclidean coordinates given a list of keypoints
+  ///        in image coordinates. The undistortion runs on all keypoints in parallel, see
+  ///        Distortion::undistortVectorized.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Bearing vectors in euclidean coordinates.
+  /// @param[out] out_success   Were the back-projections successful? Keypoints for which the
+  ///                           undistortion did not converge are reported as failed.
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      Eigen::Matrix3Xd* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Single precision version of backProject3Vectorized(..). The undistortion runs
+  ///        in the float kernels.
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+      Eigen::Matrix3Xf* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
   /// \brief Checks the success of a projection operation and returns the result in a
   ///        ProjectionResult object.
   /// @param[in] keypoint Keypoint in image coordinates.
@@ -265,6 +321,31 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   bool isValidImpl() const override;
   void setRandomImpl() override;
   bool isEqualImpl(const Sensor& other, const bool verbose) const override;
+
+  void project3VectorizedWithJacobiansImpl(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const override;
+
+  /// \brief Implementation of backProject3Vectorized(..) for double and float keypoints.
+  template <typename ScalarType>
+  void backProject3VectorizedImpl(
+      const Eigen::Ref<const Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>>& keypoints,
+      Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief project3VectorizedWithJacobiansImpl(..) with a statically bound distortion.
+  template <typename DistortionType>
+  void project3VectorizedWithJacobiansTyped(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const;
 };
 
 }  // namespace aslam
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,7 @@
 
 #include <aslam/cameras/distortion-null.h>
 #include <aslam/cameras/distortion.h>
+#include <aslam/cameras/vectorized-projection.h>
 #include <aslam/common/macros.h>
 #include <aslam/common/sensor.h>
 #include <aslam/common/types.h>
@@ -25,6 +27,7 @@
 namespace aslam {
 
 // Forward declarations
+class BearingVectorLookupTable;
 class MappedUndistorter;
 
 /// \struct ProjectionResult
@@ -194,7 +197,9 @@ class Camera : public Sensor {
         is_compressed_(other.is_compressed_),
         intrinsics_(other.intrinsics_),
         camera_type_(other.camera_type_),
-        distortion_(nullptr) {
+        distortion_(nullptr),
+        bearing_lookup_table_step_px_(other.bearing_lookup_table_step_px_),
+        bearing_lookup_table_(std::atomic_load(&other.bearing_lookup_table_)) {
     CHECK(other.distortion_);
     distortion_.reset(other.distortion_->clone());
   };
@@ -291,6 +296,43 @@ class Camera : public Sensor {
       Eigen::Matrix2Xd* out_keypoints,
       std::vector<ProjectionResult>* out_results) const;
 
+  /// \brief Single precision version of project3Vectorized(..) for throughput-bound
+  ///        callers that can live with float accuracy, e.g. keypoint prediction and
+  ///        visibility culling.
+  ///
+  /// This vanilla version converts the points and calls the double version. Camera
+  /// implementers are encouraged to override for efficiency.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Projects a matrix of euclidean points and computes the Jacobians of all
+  ///        projections in one pass. The Jacobians of point i are stored in the
+  ///        contiguous blocks starting at column i*3 (point), i*getParameterSize()
+  ///        (intrinsics) and i*getDistortion().getParameterSize() (distortion) and
+  ///        match the ones of \ref project3Functional.
+  /// @param[in]  points_3d                The points in euclidean coordinates.
+  /// @param[out] out_keypoints            The keypoints in image coordinates.
+  /// @param[out] out_results              Contains information about the success of the
+  ///                                      projections.
+  /// @param[out] out_jacobians_point      2x3N Jacobians wrt. the euclidean points.
+  /// @param[out] out_jacobians_intrinsics 2xKN Jacobians wrt. the intrinsics.
+  ///                                        nullptr: calculation is skipped.
+  /// @param[out] out_jacobians_distortion 2xDN Jacobians wrt. the distortion parameters.
+  ///                                        nullptr: calculation is skipped.
+  void project3VectorizedWithJacobians(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const;
+
   /// \brief Compute the 3d bearing vector in euclidean coordinates given a
   /// keypoint in
   ///        image coordinates. Uses the projection (& distortion) models.
@@ -319,6 +361,58 @@ class Camera : public Sensor {
       const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
       Eigen::Matrix3Xd* out_points_3d,
       std::vector<unsigned char>* out_success) const;
+
+  /// \brief Single precision version of backProject3Vectorized(..).
+  ///
+  /// This vanilla version converts the keypoints and calls the double version. Camera
+  /// implementers are encouraged to override for efficiency.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Bearing vectors in euclidean coordinates.
+  /// @param[out] out_success   Were the projections successful?
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+      Eigen::Matrix3Xf* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+  /// @}
+
+  //////////////////////////////////////////////////////////////
+  /// \name Methods to back-project keypoints using a lookup table
+  /// @{
+
+  /// \brief Approximates backProject3(..) by bilinear interpolation in a dense
+  ///        table of precomputed bearing vectors. The table is built on first
+  ///        use and rebuilt whenever the intrinsics or the distortion change.
+  ///        Keypoints outside of the image or next to a table node that can not
+  ///        be back-projected fall back to backProject3(..).
+  /// @param[in]  keypoint     Keypoint in image coordinates.
+  /// @param[out] out_point_3d Bearing vector in euclidean coordinates.
+  /// @return Was the projection successful?
+  bool backProject3Cached(
+      const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+      Eigen::Vector3d* out_point_3d) const;
+
+  /// \brief Batch version of backProject3Cached(..).
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Bearing vectors in euclidean coordinates.
+  /// @param[out] out_success   Were the projections successful?
+  void backProject3CachedVectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      Eigen::Matrix3Xd* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Sets the distance between two nodes of the lookup table in pixels.
+  ///        Smaller steps are more accurate but need more memory (about 13
+  ///        bytes per node). Invalidates the current table.
+  void setBearingLookupTableStep(double step_px);
+  double getBearingLookupTableStep() const {
+    return bearing_lookup_table_step_px_;
+  }
+
+  /// \brief Returns the lookup table and builds it if needed. Thread-safe.
+  std::shared_ptr<const BearingVectorLookupTable> getBearingLookupTable() const;
+
+  /// \brief Drops the lookup table; it is rebuilt on the next use.
+  void invalidateBearingLookupTable() const;
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -551,6 +645,7 @@ class Camera : public Sensor {
 
   /// Returns a pointer to the underlying distortion object.
   aslam::Distortion* getDistortionMutable() {
+    invalidateBearingLookupTable();
     return CHECK_NOTNULL(distortion_.get());
   };
 
@@ -559,9 +654,18 @@ class Camera : public Sensor {
     return *CHECK_NOTNULL(distortion_.get());
   };
 
+  /// Returns the underlying distortion object cast to its concrete type. The caller has to
+  /// make sure the type matches, e.g. by switching on Distortion::getType().
+  template <typename DistortionType>
+  const DistortionType& getDistortionTyped() const {
+    DCHECK(dynamic_cast<const DistortionType*>(distortion_.get()) != nullptr);
+    return static_cast<const DistortionType&>(*distortion_);
+  }
+
   /// Set the distortion model.
   void setDistortion(aslam::Distortion::UniquePtr& distortion) {
     distortion_ = std::move(distortion);
+    invalidateBearingLookupTable();
   };
 
   /// Is a distortion model set for this camera.
@@ -573,6 +677,7 @@ class Camera : public Sensor {
   /// Remove the distortion model from this camera.
   void removeDistortion() {
     distortion_.reset(new NullDistortion);
+    invalidateBearingLookupTable();
   };
   /// @}
 
@@ -587,6 +692,7 @@ class Camera : public Sensor {
 
   /// Get the intrinsic parameters.
   inline double* getParametersMutable() {
+    invalidateBearingLookupTable();
     return &intrinsics_.coeffRef(0, 0);
   };
 
@@ -595,6 +701,7 @@ class Camera : public Sensor {
   void setParameters(const Eigen::VectorXd& params) {
     CHECK_EQ(getParameterSize(), params.size());
     intrinsics_ = params;
+    invalidateBearingLookupTable();
   }
 
   /// Function to check whether the given intrinsic parameters are valid for
@@ -662,6 +769,34 @@ class Camera : public Sensor {
   void saveToYamlNodeImpl(YAML::Node*) const override;
 
  protected:
+  /// \brief Implementation of project3VectorizedWithJacobians(..). The outputs are already
+  ///        sized and the optional Jacobians are nullptr if not requested. This vanilla
+  ///        version repeatedly calls project3Functional(..). Camera implementers are
+  ///        encouraged to override for efficiency.
+  virtual void project3VectorizedWithJacobiansImpl(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const;
+
+  /// \brief Runs the SIMD projection kernels described by the parameters and
+  ///        converts the results to the format of project3Vectorized(..).
+  ///        Used by the camera models that provide vectorized kernels.
+  static void project3VectorizedUsingKernels(
+      const vectorized::ProjectionParameters& parameters,
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      vectorized::InstructionSet instruction_set,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results);
+  static void project3VectorizedUsingKernels(
+      const vectorized::ProjectionParameters& parameters,
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      vectorized::InstructionSet instruction_set,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results);
+
   /// The delay per scanline for a rolling shutter camera in nanoseconds.
   uint64_t line_delay_nanoseconds_;
   /// The width of the image.
@@ -681,6 +816,15 @@ class Camera : public Sensor {
 
   /// \brief The distortion for this camera.
   aslam::Distortion::UniquePtr distortion_;
+
+ private:
+  /// Distance between two nodes of the bearing vector lookup table in pixels.
+  double bearing_lookup_table_step_px_;
+  /// The lazily built bearing vector lookup table. Only accessed through
+  /// std::atomic_load/std::atomic_store.
+  mutable std::shared_ptr<const BearingVectorLookupTable> bearing_lookup_table_;
+  /// Serializes building the lookup table.
+  mutable std::mutex bearing_lookup_table_mutex_;
 };
 }  // namespace aslam
 #include "camera-inl.h"
@@ -1,11 +1,15 @@
 #ifndef ASLAM_EQUIDISTANT_DISTORTION_H_
 #define ASLAM_EQUIDISTANT_DISTORTION_H_
 
+#include <memory>
+#include <mutex>
+
 #include <Eigen/Core>
 #include <glog/logging.h>
 
 #include <aslam/common/crtp-clone.h>
 #include <aslam/cameras/distortion.h>
+#include <aslam/cameras/equidistant-inverse-polynomial.h>
 #include <aslam/common/macros.h>
 
 namespace aslam {
@@ -16,7 +20,9 @@ namespace aslam {
 ///        Fish-Eye Lenses" by Juho Kannala and Sami S. Brandt for further information.
 ///        The ordering of the parameter vector is: k1 k2 k3 k4
 ///        NOTE: The inverse transformation (undistort) in this case is not available in
-///        closed form and so it is computed iteratively!
+///        closed form. It is evaluated with a fitted inverse polynomial (see
+///        \ref EquidistantInversePolynomial) for the internal parameters and computed
+///        iteratively otherwise!
 class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDistortion> {
  public:
   /** \brief Number of parameters used for this distortion model. */
@@ -38,7 +44,9 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
 
  public:
   /// Copy constructor for clone operation.
-  EquidistantDistortion(const EquidistantDistortion&) = default;
+  EquidistantDistortion(const EquidistantDistortion& other)
+      : Base(other),
+        inverse_polynomial_(std::atomic_load(&other.inverse_polynomial_)) {}
   void operator=(const EquidistantDistortion&) = delete;
 
   /// @}
@@ -98,6 +106,10 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const;
 
+  /// \brief Returns the inverse polynomial fitted to the current parameters and refits it if
+  ///        the parameters changed since the last call. Thread-safe.
+  std::shared_ptr<const EquidistantInversePolynomial> getInversePolynomial() const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -149,6 +161,15 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
 
   /// @}
 
+ private:
+  /// \brief Gauss-Newton inversion of the distortion, used for external coefficients and
+  ///        points outside of the range of the inverse polynomial.
+  void undistortIteratively(const Eigen::VectorXd& dist_coeffs, Eigen::Vector2d* point) const;
+
+  /// Inverse polynomial of the internal parameters, built on first use.
+  mutable std::shared_ptr<const EquidistantInversePolynomial> inverse_polynomial_;
+  /// Serializes the fits of the inverse polynomial.
+  mutable std::mutex inverse_polynomial_mutex_;
 };
 
 } // namespace aslam
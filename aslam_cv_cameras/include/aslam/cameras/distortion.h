@@ -1,6 +1,8 @@
 #ifndef ASLAM_CAMERAS_DISTORTION_H_
 #define ASLAM_CAMERAS_DISTORTION_H_
 
+#include <vector>
+
 #include <aslam/common/macros.h>
 #include <Eigen/Dense>
 #include <gflags/gflags.h>
@@ -135,6 +137,21 @@ class Distortion {
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const = 0;
 
+  /// \brief Apply undistortion to a batch of points. The iteratively inverted models update
+  ///        all points in parallel SIMD lanes and stop iterating on a point once it converged.
+  /// @param[in,out] points        The distorted points. After the function, these points are in
+  ///                              the normalized image plane.
+  /// @param[out]    out_converged Optional: Did the undistortion of the point converge?
+  ///                              Closed-form models always converge.
+  /// @return Number of points that did not converge within the max. number of iterations.
+  int undistortVectorized(Eigen::Matrix2Xd* points,
+                          std::vector<unsigned char>* out_converged) const;
+
+  /// \brief Single precision version of undistortVectorized(..). The iteratively inverted
+  ///        models run the float kernels which process twice as many points per instruction.
+  int undistortVectorized(Eigen::Matrix2Xf* points,
+                          std::vector<unsigned char>* out_converged) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -0,0 +1,95 @@
+#ifndef ASLAM_CAMERAS_EQUIDISTANT_INVERSE_POLYNOMIAL_H_
+#define ASLAM_CAMERAS_EQUIDISTANT_INVERSE_POLYNOMIAL_H_
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+/// \class EquidistantInversePolynomial
+/// \brief Fit of the inverse of the equidistant distortion
+///          theta_d = theta * (1 + k1 * theta^2 + k2 * theta^4 + k3 * theta^6 + k4 * theta^8)
+///        as a piecewise cubic polynomial theta(theta_d). Each segment is the Hermite
+///        interpolant of the exact inverse and its slope at the segment ends. The fit covers the
+///        incidence angles between the optical axis and the first angle at which the distortion
+///        stops being monotonic (at most 90 degrees, i.e. the full field of view of the model).
+///        If the distortion folds over, the range is shrunk until the validated error is within
+///        tolerance, since the slope of the inverse diverges towards the fold. A couple of
+///        Newton steps on the 1d distortion polish the polynomial estimate to machine precision.
+class EquidistantInversePolynomial {
+ public:
+  ASLAM_POINTER_TYPEDEFS(EquidistantInversePolynomial);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(EquidistantInversePolynomial);
+
+  /// Number of polynomial segments over the fitted range.
+  static constexpr int kNumSegments = 64;
+  /// Number of Newton steps applied to the polynomial estimate.
+  static constexpr int kNumRefinementSteps = 2;
+
+  /// \brief Fits the inverse polynomial and evaluates its residuals. If the distortion can not
+  ///        be fitted, the object is not valid and invert(..) always fails.
+  /// @param[in] distortion_coefficients Coefficients k1, k2, k3, k4 of the distortion.
+  explicit EquidistantInversePolynomial(const Eigen::VectorXd& distortion_coefficients);
+
+  /// \brief Could the inverse be fitted within tolerance over a non-empty range?
+  bool isValid() const { return is_valid_; }
+
+  /// \brief Computes the incidence angle of a distorted radius.
+  /// @param[in]  theta_d   Distorted radius in the normalized image plane.
+  /// @param[out] out_theta Incidence angle, refined with kNumRefinementSteps Newton steps.
+  /// @return False if theta_d lies outside of the fitted range or the fit is not valid.
+  ///         out_theta is not set then.
+  bool invert(double theta_d, double* out_theta) const;
+
+  /// \brief Was the polynomial fitted for these distortion coefficients? Compares the four
+  ///        coefficients as a fixed-size vector, as this runs on every undistortion.
+  inline bool isFitFor(const Eigen::VectorXd& distortion_coefficients) const {
+    return distortion_coefficients.size() == 4 &&
+           Eigen::Map<const Eigen::Vector4d>(distortion_coefficients.data()) ==
+               distortion_coefficients_;
+  }
+
+  /// \brief Max. distorted radius (and the corresponding angle) covered by the fit.
+  double getMaxThetaD() const { return max_theta_d_; }
+  double getMaxTheta() const { return max_theta_; }
+
+  /// \brief Max. error of the plain polynomial in theta [rad] over the fitted range.
+  double getMaxFitError() const { return max_fit_error_; }
+  /// \brief Max. error of invert(..), i.e. after the Newton refinement, in theta [rad] over the
+  ///        fitted range.
+  double getMaxRefinedError() const { return max_refined_error_; }
+
+ private:
+  /// Fits the polynomial to the range [0, max_theta] and computes its max. errors.
+  void fitAndValidate(double max_theta);
+  /// invert(..) without the validity check, used while fitting.
+  bool invertWithinRange(double theta_d, double* out_theta) const;
+  /// Evaluates the plain polynomial without refinement.
+  double evaluatePolynomial(double theta_d) const;
+  /// Inverts the distortion by bisection. Only used to fit the polynomial.
+  double invertByBisection(double theta_d) const;
+  /// Evaluates the distortion theta -> theta_d and its derivative.
+  double distortTheta(double theta, double* out_derivative) const;
+
+  /// The coefficients the fit belongs to.
+  const Eigen::Vector4d distortion_coefficients_;
+  double max_theta_;
+  double max_theta_d_;
+  /// Width of a segment in theta_d.
+  double segment_width_;
+  double inverse_segment_width_;
+  /// Exact inverse theta and slope d(theta)/d(theta_d) * segment_width_ at the segment ends.
+  std::vector<double> node_thetas_;
+  std::vector<double> node_slopes_;
+
+  double max_fit_error_;
+  double max_refined_error_;
+  bool is_valid_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_EQUIDISTANT_INVERSE_POLYNOMIAL_H_
@@ -2,10 +2,14 @@
 #define ASLAM_NCAMERA_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <Eigen/Core>
+
+#include <aslam/cameras/camera.h>
 #include <aslam/common/macros.h>
 #include <aslam/common/pose-types.h>
 #include <aslam/common/sensor.h>
@@ -15,12 +19,22 @@
 namespace sm {
 class PropertyTree;
 }
-namespace aslam {
-class Camera;
-}
 
 namespace aslam {
 
+/// \struct CameraProjections
+/// \brief Projections of a set of body frame points into one camera of a rig, see
+///        NCamera::projectToAllCameras.
+struct CameraProjections {
+  /// Keypoints of all points. Only meaningful where the projection result is not
+  /// POINT_BEHIND_CAMERA or PROJECTION_INVALID.
+  Eigen::Matrix2Xd keypoints;
+  /// Projection result of each point.
+  std::vector<ProjectionResult> projection_results;
+  /// Indices of the points visible in the camera in increasing order.
+  std::vector<int> visible_indices;
+};
+
 /// \class NCameras
 /// \brief A class representing a calibrated multi-camera system
 ///
@@ -171,6 +185,23 @@ class NCamera : public Sensor {
   /// NCamera and all contained cameras.
   aslam::NCamera::Ptr cloneRigWithoutDistortion() const;
 
+  /// \brief Projects a set of points given in the body frame into all cameras of the rig.
+  ///        The points are transformed into each camera frame with a single matrix product.
+  ///        A conservative cone around the optical axis, enclosing the field of view of the
+  ///        camera, culls the points that cannot be visible before the full projection with
+  ///        distortion runs on the remaining ones. Culled points are reported as
+  ///        POINT_BEHIND_CAMERA if they lie behind the camera plane and
+  ///        KEYPOINT_OUTSIDE_IMAGE_BOX otherwise, their keypoints are set to zero.
+  ///        The visibility of all points is the same as the one of Camera::project3.
+  /// @param[in]  points_B    Points in the body frame.
+  /// @param[in]  num_threads Number of threads the cameras are distributed on, including the
+  ///                         calling thread. The others are taken from a thread pool shared
+  ///                         by all rig projections. 0 uses one thread per hardware core.
+  /// @param[out] projections The projections into camera i are stored at index i.
+  void projectToAllCameras(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_B, size_t num_threads,
+      std::vector<CameraProjections>* projections) const;
+
  private:
   bool isValidImpl() const override;
 
@@ -184,6 +215,29 @@ class NCamera : public Sensor {
   /// Internal consistency checks and initialization.
   void initInternal();
 
+  /// Projects the points into camera i, see projectToAllCameras(..).
+  void projectToCamera(
+      size_t camera_index, const Eigen::Ref<const Eigen::Matrix3Xd>& points_B,
+      CameraProjections* projections) const;
+
+  /// Cosine of the half opening angle of the cone that culls the points of camera i in
+  /// projectToCamera(..). Computed on first use and again once the camera changed.
+  double getFieldOfViewCosine(size_t camera_index) const;
+
+  /// Field of view bound of a camera and the camera state it was computed for.
+  struct FieldOfViewBound {
+    bool isComputedFor(const Camera& other_camera) const;
+
+    const Camera* camera = nullptr;
+    Camera::Type camera_type = Camera::Type::kPinhole;
+    uint32_t image_width = 0u;
+    uint32_t image_height = 0u;
+    Eigen::VectorXd intrinsics;
+    Distortion::Type distortion_type = Distortion::Type::kNoDistortion;
+    Eigen::VectorXd distortion_parameters;
+    double cosine = -1.0;
+  };
+
   /// The mounting transformations.
   TransformationVector T_C_B_;
 
@@ -198,6 +252,10 @@ class NCamera : public Sensor {
   /// on this camera.
   TransformationCovariance T_G_B_fixed_localization_covariance_;
   bool has_T_G_B_fixed_localization_covariance_;
+
+  /// Field of view bounds of the cameras, indexed like cameras_.
+  mutable std::vector<FieldOfViewBound> field_of_view_bounds_;
+  mutable std::mutex field_of_view_bounds_mutex_;
 };
 
 }  // namespace aslam
@@ -0,0 +1,592 @@
+#ifndef ASLAM_CAMERAS_SIMD_BATCH_H_
+#define ASLAM_CAMERAS_SIMD_BATCH_H_
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Thin wrappers around the SIMD registers used by the vectorized camera
+// kernels. All batches expose the same interface so that the kernels can be
+// written once as templates and instantiated per instruction set. Every
+// translation unit is only allowed to instantiate the batch types matching its
+// own compile flags, e.g. Avx2Batch is only available if the translation unit is
+// compiled with -mavx2.
+//
+// NOTE: This header must stay free of any non-SIMD dependencies so that it can
+// be included from translation units compiled with different target flags
+// without violating the one definition rule.
+namespace aslam {
+namespace simd {
+
+/// \brief Fallback batch holding one value. Used on platforms without SIMD
+///        support and for testing the templated kernels.
+template <typename ScalarType>
+class BasicScalarBatch {
+ public:
+  typedef ScalarType Scalar;
+  static constexpr int kSize = 1;
+
+  class Mask {
+   public:
+    Mask() = default;
+    explicit Mask(bool value) : value_(value) {}
+    Mask operator&(const Mask& other) const {
+      return Mask(value_ && other.value_);
+    }
+    Mask operator|(const Mask& other) const {
+      return Mask(value_ || other.value_);
+    }
+    Mask operator!() const {
+      return Mask(!value_);
+    }
+    bool value() const {
+      return value_;
+    }
+
+   private:
+    bool value_;
+  };
+
+  BasicScalarBatch() = default;
+  explicit BasicScalarBatch(double value)
+      : value_(static_cast<Scalar>(value)) {}
+
+  static BasicScalarBatch load(const Scalar* data) {
+    return BasicScalarBatch(*data);
+  }
+  void store(Scalar* data) const {
+    *data = value_;
+  }
+
+  BasicScalarBatch operator+(const BasicScalarBatch& rhs) const {
+    return BasicScalarBatch(value_ + rhs.value_);
+  }
+  BasicScalarBatch operator-(const BasicScalarBatch& rhs) const {
+    return BasicScalarBatch(value_ - rhs.value_);
+  }
+  BasicScalarBatch operator*(const BasicScalarBatch& rhs) const {
+    return BasicScalarBatch(value_ * rhs.value_);
+  }
+  BasicScalarBatch operator/(const BasicScalarBatch& rhs) const {
+    return BasicScalarBatch(value_ / rhs.value_);
+  }
+  BasicScalarBatch operator-() const {
+    return BasicScalarBatch(-value_);
+  }
+
+  Mask operator<(const BasicScalarBatch& rhs) const {
+    return Mask(value_ < rhs.value_);
+  }
+  Mask operator<=(const BasicScalarBatch& rhs) const {
+    return Mask(value_ <= rhs.value_);
+  }
+  Mask operator>(const BasicScalarBatch& rhs) const {
+    return Mask(value_ > rhs.value_);
+  }
+  Mask operator>=(const BasicScalarBatch& rhs) const {
+    return Mask(value_ >= rhs.value_);
+  }
+
+  friend BasicScalarBatch sqrt(const BasicScalarBatch& x) {
+    return BasicScalarBatch(std::sqrt(x.value_));
+  }
+  friend BasicScalarBatch abs(const BasicScalarBatch& x) {
+    return BasicScalarBatch(std::fabs(x.value_));
+  }
+  /// Returns a where the mask is set and b otherwise.
+  friend BasicScalarBatch select(
+      const Mask& mask, const BasicScalarBatch& a, const BasicScalarBatch& b) {
+    return mask.value() ? a : b;
+  }
+  /// Returns x with the sign of y.
+  friend BasicScalarBatch copysign(
+      const BasicScalarBatch& x, const BasicScalarBatch& y) {
+    return BasicScalarBatch(std::copysign(x.value_, y.value_));
+  }
+  friend bool any(const Mask& mask) {
+    return mask.value();
+  }
+  friend bool all(const Mask& mask) {
+    return mask.value();
+  }
+
+ private:
+  Scalar value_;
+};
+
+typedef BasicScalarBatch<double> ScalarBatch;
+typedef BasicScalarBatch<float> ScalarFloatBatch;
+
+#if defined(__SSE2__)
+/// \brief Batch of two doubles in an SSE2 register.
+class Sse2Batch {
+ public:
+  typedef double Scalar;
+  static constexpr int kSize = 2;
+
+  class Mask {
+   public:
+    Mask() = default;
+    explicit Mask(__m128d value) : value_(value) {}
+    Mask operator&(const Mask& other) const {
+      return Mask(_mm_and_pd(value_, other.value_));
+    }
+    Mask operator|(const Mask& other) const {
+      return Mask(_mm_or_pd(value_, other.value_));
+    }
+    Mask operator!() const {
+      return Mask(_mm_xor_pd(value_, _mm_castsi128_pd(_mm_set1_epi32(-1))));
+    }
+    __m128d value() const {
+      return value_;
+    }
+
+   private:
+    __m128d value_;
+  };
+
+  Sse2Batch() = default;
+  explicit Sse2Batch(double value) : value_(_mm_set1_pd(value)) {}
+  explicit Sse2Batch(__m128d value) : value_(value) {}
+
+  /// Data must be aligned to 16 bytes.
+  static Sse2Batch load(const double* data) {
+    return Sse2Batch(_mm_load_pd(data));
+  }
+  /// Data must be aligned to 16 bytes.
+  void store(double* data) const {
+    _mm_store_pd(data, value_);
+  }
+
+  Sse2Batch operator+(const Sse2Batch& rhs) const {
+    return Sse2Batch(_mm_add_pd(value_, rhs.value_));
+  }
+  Sse2Batch operator-(const Sse2Batch& rhs) const {
+    return Sse2Batch(_mm_sub_pd(value_, rhs.value_));
+  }
+  Sse2Batch operator*(const Sse2Batch& rhs) const {
+    return Sse2Batch(_mm_mul_pd(value_, rhs.value_));
+  }
+  Sse2Batch operator/(const Sse2Batch& rhs) const {
+    return Sse2Batch(_mm_div_pd(value_, rhs.value_));
+  }
+  Sse2Batch operator-() const {
+    return Sse2Batch(_mm_xor_pd(value_, _mm_set1_pd(-0.0)));
+  }
+
+  Mask operator<(const Sse2Batch& rhs) const {
+    return Mask(_mm_cmplt_pd(value_, rhs.value_));
+  }
+  Mask operator<=(const Sse2Batch& rhs) const {
+    return Mask(_mm_cmple_pd(value_, rhs.value_));
+  }
+  Mask operator>(const Sse2Batch& rhs) const {
+    return Mask(_mm_cmpgt_pd(value_, rhs.value_));
+  }
+  Mask operator>=(const Sse2Batch& rhs) const {
+    return Mask(_mm_cmpge_pd(value_, rhs.value_));
+  }
+
+  friend Sse2Batch sqrt(const Sse2Batch& x) {
+    return Sse2Batch(_mm_sqrt_pd(x.value_));
+  }
+  friend Sse2Batch abs(const Sse2Batch& x) {
+    return Sse2Batch(_mm_andnot_pd(_mm_set1_pd(-0.0), x.value_));
+  }
+  friend Sse2Batch select(
+      const Mask& mask, const Sse2Batch& a, const Sse2Batch& b) {
+    return Sse2Batch(_mm_or_pd(
+        _mm_and_pd(mask.value(), a.value_),
+        _mm_andnot_pd(mask.value(), b.value_)));
+  }
+  friend Sse2Batch copysign(const Sse2Batch& x, const Sse2Batch& y) {
+    const __m128d sign_mask = _mm_set1_pd(-0.0);
+    return Sse2Batch(_mm_or_pd(
+        _mm_andnot_pd(sign_mask, x.value_), _mm_and_pd(sign_mask, y.value_)));
+  }
+  friend bool any(const Mask& mask) {
+    return _mm_movemask_pd(mask.value()) != 0;
+  }
+  friend bool all(const Mask& mask) {
+    return _mm_movemask_pd(mask.value()) == 0x3;
+  }
+
+ private:
+  __m128d value_;
+};
+/// \brief Batch of four floats in an SSE2 register.
+class Sse2FloatBatch {
+ public:
+  typedef float Scalar;
+  static constexpr int kSize = 4;
+
+  class Mask {
+   public:
+    Mask() = default;
+    explicit Mask(__m128 value) : value_(value) {}
+    Mask operator&(const Mask& other) const {
+      return Mask(_mm_and_ps(value_, other.value_));
+    }
+    Mask operator|(const Mask& other) const {
+      return Mask(_mm_or_ps(value_, other.value_));
+    }
+    Mask operator!() const {
+      return Mask(_mm_xor_ps(value_, _mm_castsi128_ps(_mm_set1_epi32(-1))));
+    }
+    __m128 value() const {
+      return value_;
+    }
+
+   private:
+    __m128 value_;
+  };
+
+  Sse2FloatBatch() = default;
+  explicit Sse2FloatBatch(double value)
+      : value_(_mm_set1_ps(static_cast<float>(value))) {}
+  explicit Sse2FloatBatch(__m128 value) : value_(value) {}
+
+  /// Data must be aligned to 16 bytes.
+  static Sse2FloatBatch load(const float* data) {
+    return Sse2FloatBatch(_mm_load_ps(data));
+  }
+  /// Data must be aligned to 16 bytes.
+  void store(float* data) const {
+    _mm_store_ps(data, value_);
+  }
+
+  Sse2FloatBatch operator+(const Sse2FloatBatch& rhs) const {
+    return Sse2FloatBatch(_mm_add_ps(value_, rhs.value_));
+  }
+  Sse2FloatBatch operator-(const Sse2FloatBatch& rhs) const {
+    return Sse2FloatBatch(_mm_sub_ps(value_, rhs.value_));
+  }
+  Sse2FloatBatch operator*(const Sse2FloatBatch& rhs) const {
+    return Sse2FloatBatch(_mm_mul_ps(value_, rhs.value_));
+  }
+  Sse2FloatBatch operator/(const Sse2FloatBatch& rhs) const {
+    return Sse2FloatBatch(_mm_div_ps(value_, rhs.value_));
+  }
+  Sse2FloatBatch operator-() const {
+    return Sse2FloatBatch(_mm_xor_ps(value_, _mm_set1_ps(-0.0f)));
+  }
+
+  Mask operator<(const Sse2FloatBatch& rhs) const {
+    return Mask(_mm_cmplt_ps(value_, rhs.value_));
+  }
+  Mask operator<=(const Sse2FloatBatch& rhs) const {
+    return Mask(_mm_cmple_ps(value_, rhs.value_));
+  }
+  Mask operator>(const Sse2FloatBatch& rhs) const {
+    return Mask(_mm_cmpgt_ps(value_, rhs.value_));
+  }
+  Mask operator>=(const Sse2FloatBatch& rhs) const {
+    return Mask(_mm_cmpge_ps(value_, rhs.value_));
+  }
+
+  friend Sse2FloatBatch sqrt(const Sse2FloatBatch& x) {
+    return Sse2FloatBatch(_mm_sqrt_ps(x.value_));
+  }
+  friend Sse2FloatBatch abs(const Sse2FloatBatch& x) {
+    return Sse2FloatBatch(_mm_andnot_ps(_mm_set1_ps(-0.0f), x.value_));
+  }
+  friend Sse2FloatBatch select(
+      const Mask& mask, const Sse2FloatBatch& a, const Sse2FloatBatch& b) {
+    return Sse2FloatBatch(_mm_or_ps(
+        _mm_and_ps(mask.value(), a.value_),
+        _mm_andnot_ps(mask.value(), b.value_)));
+  }
+  friend Sse2FloatBatch copysign(
+      const Sse2FloatBatch& x, const Sse2FloatBatch& y) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    return Sse2FloatBatch(_mm_or_ps(
+        _mm_andnot_ps(sign_mask, x.value_), _mm_and_ps(sign_mask, y.value_)));
+  }
+  friend bool any(const Mask& mask) {
+    return _mm_movemask_ps(mask.value()) != 0;
+  }
+  friend bool all(const Mask& mask) {
+    return _mm_movemask_ps(mask.value()) == 0xf;
+  }
+
+ private:
+  __m128 value_;
+};
+#endif  // __SSE2__
+
+#if defined(__AVX2__)
+/// \brief Batch of four doubles in an AVX register.
+class Avx2Batch {
+ public:
+  typedef double Scalar;
+  static constexpr int kSize = 4;
+
+  class Mask {
+   public:
+    Mask() = default;
+    explicit Mask(__m256d value) : value_(value) {}
+    Mask operator&(const Mask& other) const {
+      return Mask(_mm256_and_pd(value_, other.value_));
+    }
+    Mask operator|(const Mask& other) const {
+      return Mask(_mm256_or_pd(value_, other.value_));
+    }
+    Mask operator!() const {
+      return Mask(_mm256_xor_pd(
+          value_, _mm256_castsi256_pd(_mm256_set1_epi32(-1))));
+    }
+    __m256d value() const {
+      return value_;
+    }
+
+   private:
+    __m256d value_;
+  };
+
+  Avx2Batch() = default;
+  explicit Avx2Batch(double value) : value_(_mm256_set1_pd(value)) {}
+  explicit Avx2Batch(__m256d value) : value_(value) {}
+
+  /// Data must be aligned to 32 bytes.
+  static Avx2Batch load(const double* data) {
+    return Avx2Batch(_mm256_load_pd(data));
+  }
+  /// Data must be aligned to 32 bytes.
+  void store(double* data) const {
+    _mm256_store_pd(data, value_);
+  }
+
+  Avx2Batch operator+(const Avx2Batch& rhs) const {
+    return Avx2Batch(_mm256_add_pd(value_, rhs.value_));
+  }
+  Avx2Batch operator-(const Avx2Batch& rhs) const {
+    return Avx2Batch(_mm256_sub_pd(value_, rhs.value_));
+  }
+  Avx2Batch operator*(const Avx2Batch& rhs) const {
+    return Avx2Batch(_mm256_mul_pd(value_, rhs.value_));
+  }
+  Avx2Batch operator/(const Avx2Batch& rhs) const {
+    return Avx2Batch(_mm256_div_pd(value_, rhs.value_));
+  }
+  Avx2Batch operator-() const {
+    return Avx2Batch(_mm256_xor_pd(value_, _mm256_set1_pd(-0.0)));
+  }
+
+  Mask operator<(const Avx2Batch& rhs) const {
+    return Mask(_mm256_cmp_pd(value_, rhs.value_, _CMP_LT_OQ));
+  }
+  Mask operator<=(const Avx2Batch& rhs) const {
+    return Mask(_mm256_cmp_pd(value_, rhs.value_, _CMP_LE_OQ));
+  }
+  Mask operator>(const Avx2Batch& rhs) const {
+    return Mask(_mm256_cmp_pd(value_, rhs.value_, _CMP_GT_OQ));
+  }
+  Mask operator>=(const Avx2Batch& rhs) const {
+    return Mask(_mm256_cmp_pd(value_, rhs.value_, _CMP_GE_OQ));
+  }
+
+  friend Avx2Batch sqrt(const Avx2Batch& x) {
+    return Avx2Batch(_mm256_sqrt_pd(x.value_));
+  }
+  friend Avx2Batch abs(const Avx2Batch& x) {
+    return Avx2Batch(_mm256_andnot_pd(_mm256_set1_pd(-0.0), x.value_));
+  }
+  friend Avx2Batch select(
+      const Mask& mask, const Avx2Batch& a, const Avx2Batch& b) {
+    return Avx2Batch(_mm256_blendv_pd(b.value_, a.value_, mask.value()));
+  }
+  friend Avx2Batch copysign(const Avx2Batch& x, const Avx2Batch& y) {
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    return Avx2Batch(_mm256_or_pd(
+        _mm256_andnot_pd(sign_mask, x.value_),
+        _mm256_and_pd(sign_mask, y.value_)));
+  }
+  friend bool any(const Mask& mask) {
+    return _mm256_movemask_pd(mask.value()) != 0;
+  }
+  friend bool all(const Mask& mask) {
+    return _mm256_movemask_pd(mask.value()) == 0xf;
+  }
+
+ private:
+  __m256d value_;
+};
+/// \brief Batch of eight floats in an AVX register.
+class Avx2FloatBatch {
+ public:
+  typedef float Scalar;
+  static constexpr int kSize = 8;
+
+  class Mask {
+   public:
+    Mask() = default;
+    explicit Mask(__m256 value) : value_(value) {}
+    Mask operator&(const Mask& other) const {
+      return Mask(_mm256_and_ps(value_, other.value_));
+    }
+    Mask operator|(const Mask& other) const {
+      return Mask(_mm256_or_ps(value_, other.value_));
+    }
+    Mask operator!() const {
+      return Mask(_mm256_xor_ps(
+          value_, _mm256_castsi256_ps(_mm256_set1_epi32(-1))));
+    }
+    __m256 value() const {
+      return value_;
+    }
+
+   private:
+    __m256 value_;
+  };
+
+  Avx2FloatBatch() = default;
+  explicit Avx2FloatBatch(double value)
+      : value_(_mm256_set1_ps(static_cast<float>(value))) {}
+  explicit Avx2FloatBatch(__m256 value) : value_(value) {}
+
+  /// Data must be aligned to 32 bytes.
+  static Avx2FloatBatch load(const float* data) {
+    return Avx2FloatBatch(_mm256_load_ps(data));
+  }
+  /// Data must be aligned to 32 bytes.
+  void store(float* data) const {
+    _mm256_store_ps(data, value_);
+  }
+
+  Avx2FloatBatch operator+(const Avx2FloatBatch& rhs) const {
+    return Avx2FloatBatch(_mm256_add_ps(value_, rhs.value_));
+  }
+  Avx2FloatBatch operator-(const Avx2FloatBatch& rhs) const {
+    return Avx2FloatBatch(_mm256_sub_ps(value_, rhs.value_));
+  }
+  Avx2FloatBatch operator*(const Avx2FloatBatch& rhs) const {
+    return Avx2FloatBatch(_mm256_mul_ps(value_, rhs.value_));
+  }
+  Avx2FloatBatch operator/(const Avx2FloatBatch& rhs) const {
+    return Avx2FloatBatch(_mm256_div_ps(value_, rhs.value_));
+  }
+  Avx2FloatBatch operator-() const {
+    return Avx2FloatBatch(_mm256_xor_ps(value_, _mm256_set1_ps(-0.0f)));
+  }
+
+  Mask operator<(const Avx2FloatBatch& rhs) const {
+    return Mask(_mm256_cmp_ps(value_, rhs.value_, _CMP_LT_OQ));
+  }
+  Mask operator<=(const Avx2FloatBatch& rhs) const {
+    return Mask(_mm256_cmp_ps(value_, rhs.value_, _CMP_LE_OQ));
+  }
+  Mask operator>(const Avx2FloatBatch& rhs) const {
+    return Mask(_mm256_cmp_ps(value_, rhs.value_, _CMP_GT_OQ));
+  }
+  Mask operator>=(const Avx2FloatBatch& rhs) const {
+    return Mask(_mm256_cmp_ps(value_, rhs.value_, _CMP_GE_OQ));
+  }
+
+  friend Avx2FloatBatch sqrt(const Avx2FloatBatch& x) {
+    return Avx2FloatBatch(_mm256_sqrt_ps(x.value_));
+  }
+  friend Avx2FloatBatch abs(const Avx2FloatBatch& x) {
+    return Avx2FloatBatch(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.value_));
+  }
+  friend Avx2FloatBatch select(
+      const Mask& mask, const Avx2FloatBatch& a, const Avx2FloatBatch& b) {
+    return Avx2FloatBatch(_mm256_blendv_ps(b.value_, a.value_, mask.value()));
+  }
+  friend Avx2FloatBatch copysign(
+      const Avx2FloatBatch& x, const Avx2FloatBatch& y) {
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    return Avx2FloatBatch(_mm256_or_ps(
+        _mm256_andnot_ps(sign_mask, x.value_),
+        _mm256_and_ps(sign_mask, y.value_)));
+  }
+  friend bool any(const Mask& mask) {
+    return _mm256_movemask_ps(mask.value()) != 0;
+  }
+  friend bool all(const Mask& mask) {
+    return _mm256_movemask_ps(mask.value()) == 0xff;
+  }
+
+ private:
+  __m256 value_;
+};
+#endif  // __AVX2__
+
+/// \brief Arc tangent evaluated lane-wise. Uses the range reduction and the
+///        rational approximation of the Cephes math library which is accurate
+///        to about one ulp over the full double range.
+template <typename Batch>
+inline Batch atan(const Batch& x) {
+  // tan(3 * pi / 8)
+  const Batch kT3P8(2.41421356237309504880);
+  const Batch kMoreBits(6.123233995736765886130e-17);
+  const Batch kZero(0.0);
+  const Batch kOne(1.0);
+
+  const Batch abs_x = abs(x);
+
+  // Range reduction to |x| <= 0.66.
+  const typename Batch::Mask is_large = abs_x > kT3P8;
+  const typename Batch::Mask is_medium = (abs_x > Batch(0.66)) & !is_large;
+  Batch reduced = select(
+      is_large, -(kOne / abs_x),
+      select(is_medium, (abs_x - kOne) / (abs_x + kOne), abs_x));
+  const Batch offset = select(
+      is_large, Batch(M_PI_2), select(is_medium, Batch(M_PI_4), kZero));
+  const Batch correction = select(
+      is_large, kMoreBits,
+      select(is_medium, Batch(0.5) * kMoreBits, kZero));
+
+  const Batch z = reduced * reduced;
+  const Batch p =
+      (((Batch(-8.750608600031904122785e-1) * z +
+         Batch(-1.615753718733365076637e1)) * z +
+        Batch(-7.500855792314704667340e1)) * z +
+       Batch(-1.228866684490136173410e2)) * z +
+      Batch(-6.485021904942025371773e1);
+  const Batch q =
+      ((((z + Batch(2.485846490142306297962e1)) * z +
+         Batch(1.650270098316988542046e2)) * z +
+        Batch(4.328810604912902668951e2)) * z +
+       Batch(4.853903996359136964868e2)) * z +
+      Batch(1.945506571482613964425e2);
+  const Batch result =
+      offset + (reduced * (z * p / q) + reduced + correction);
+  return copysign(result, x);
+}
+
+/// \brief Approximate two-argument arc tangent evaluated lane-wise. Reduces the
+///        angle to the first octant and evaluates the polynomial approximation
+///        4.4.49 of Abramowitz and Stegun, which has a max. error of 1.2e-5
+///        rad. Returns 0 for x = y = 0.
+template <typename Batch>
+inline Batch atan2Approximate(const Batch& y, const Batch& x) {
+  const Batch kZero(0.0);
+  const Batch abs_x = abs(x);
+  const Batch abs_y = abs(y);
+  const typename Batch::Mask is_steep = abs_y > abs_x;
+  const Batch numerator = select(is_steep, abs_x, abs_y);
+  const Batch denominator = select(is_steep, abs_y, abs_x);
+  // The ratio of the zero lanes is NaN and replaced by the select.
+  const Batch ratio =
+      select(denominator > kZero, numerator / denominator, kZero);
+
+  const Batch ratio2 = ratio * ratio;
+  Batch angle =
+      ((((Batch(0.0208351) * ratio2 + Batch(-0.0851330)) * ratio2 +
+         Batch(0.1801410)) * ratio2 +
+        Batch(-0.3302995)) * ratio2 +
+       Batch(0.9998660)) * ratio;
+  angle = select(is_steep, Batch(M_PI_2) - angle, angle);
+  angle = select(x < kZero, Batch(M_PI) - angle, angle);
+  return copysign(angle, y);
+}
+
+}  // namespace simd
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_SIMD_BATCH_H_
@@ -0,0 +1,645 @@
+#ifndef ASLAM_CAMERAS_VECTORIZED_PROJECTION_KERNELS_H_
+#define ASLAM_CAMERAS_VECTORIZED_PROJECTION_KERNELS_H_
+
+#include <cmath>
+#include <cstdint>
+
+#include <aslam/cameras/simd-batch.h>
+#include <aslam/cameras/vectorized-projection.h>
+
+// Projection and distortion kernels written once against the batch interface of
+// simd-batch.h. The kernels compute in the scalar type of the batch, i.e. the
+// float batches process twice as many points per instruction. This header is
+// only meant to be included by the translation units that instantiate the
+// kernels for one instruction set.
+namespace aslam {
+namespace vectorized {
+namespace internal {
+
+// Must match the order of ProjectionResult::Status.
+constexpr double kStatusKeypointVisible = 0.0;
+constexpr double kStatusKeypointOutsideImageBox = 1.0;
+constexpr double kStatusPointBehindCamera = 2.0;
+constexpr double kStatusProjectionInvalid = 3.0;
+
+// Number of points that are transposed to structure-of-arrays layout at once.
+constexpr int kBlockSize = 64;
+
+// Distortion functors. See the Distortion::distortUsingExternalCoefficients
+// implementations for the scalar reference of each model.
+template <typename Batch>
+struct NullDistortionKernel {
+  explicit NullDistortionKernel(const ProjectionParameters& /*parameters*/) {}
+  inline void distort(Batch* /*x*/, Batch* /*y*/) const {}
+};
+
+template <typename Batch>
+struct RadTanDistortionKernel {
+  explicit RadTanDistortionKernel(const ProjectionParameters& parameters)
+      : k1(parameters.distortion[0]),
+        k2(parameters.distortion[1]),
+        p1(parameters.distortion[2]),
+        p2(parameters.distortion[3]) {}
+
+  inline void distort(Batch* x, Batch* y) const {
+    const Batch kTwo(2.0);
+    const Batch mx2_u = *x * *x;
+    const Batch my2_u = *y * *y;
+    const Batch mxy_u = *x * *y;
+    const Batch rho2_u = mx2_u + my2_u;
+    const Batch rad_dist_u = k1 * rho2_u + k2 * rho2_u * rho2_u;
+    const Batch x_distorted = *x + *x * rad_dist_u + kTwo * p1 * mxy_u +
+                              p2 * (rho2_u + kTwo * mx2_u);
+    *y = *y + *y * rad_dist_u + kTwo * p2 * mxy_u +
+         p1 * (rho2_u + kTwo * my2_u);
+    *x = x_distorted;
+  }
+
+  // Distorts the point and returns the Jacobian of the distortion wrt. the
+  // undistorted point.
+  inline void distortWithJacobian(
+      Batch* x, Batch* y, Batch* j00, Batch* j01, Batch* j10,
+      Batch* j11) const {
+    const Batch kOne(1.0);
+    const Batch kTwo(2.0);
+    const Batch kFour(4.0);
+    const Batch kSix(6.0);
+    const Batch mx2_u = *x * *x;
+    const Batch my2_u = *y * *y;
+    const Batch mxy_u = *x * *y;
+    const Batch rho2_u = mx2_u + my2_u;
+    const Batch rad_dist_u = k1 * rho2_u + k2 * rho2_u * rho2_u;
+    *j00 = kOne + rad_dist_u + kTwo * k1 * mx2_u + kFour * k2 * rho2_u * mx2_u +
+           kTwo * p1 * *y + kSix * p2 * *x;
+    *j01 = kTwo * k1 * mxy_u + kFour * k2 * rho2_u * mxy_u + kTwo * p1 * *x +
+           kTwo * p2 * *y;
+    *j10 = *j01;
+    *j11 = kOne + rad_dist_u + kTwo * k1 * my2_u + kFour * k2 * rho2_u * my2_u +
+           kTwo * p2 * *x + kSix * p1 * *y;
+    distort(x, y);
+  }
+
+  // Points closer to the image center than this are not undistorted. The
+  // undistortion is never skipped for this model.
+  static constexpr double kUndistortionSkipRadius2 = 0.0;
+
+  const Batch k1;
+  const Batch k2;
+  const Batch p1;
+  const Batch p2;
+};
+
+template <typename Batch>
+struct EquidistantDistortionKernel {
+  explicit EquidistantDistortionKernel(const ProjectionParameters& parameters)
+      : k1(parameters.distortion[0]),
+        k2(parameters.distortion[1]),
+        k3(parameters.distortion[2]),
+        k4(parameters.distortion[3]) {}
+
+  inline void distort(Batch* x, Batch* y) const {
+    const Batch kOne(1.0);
+    const Batch r = sqrt(*x * *x + *y * *y);
+    const Batch theta = simd::atan(r);
+    const Batch theta2 = theta * theta;
+    const Batch theta4 = theta2 * theta2;
+    const Batch theta6 = theta2 * theta4;
+    const Batch theta8 = theta4 * theta4;
+    const Batch thetad =
+        theta * (kOne + k1 * theta2 + k2 * theta4 + k3 * theta6 + k4 * theta8);
+    // Points close to the image center remain unchanged.
+    const Batch scaling = select(r > Batch(1e-8), thetad / r, kOne);
+    *x = *x * scaling;
+    *y = *y * scaling;
+  }
+
+  // Distorts the point and returns the Jacobian of the distortion wrt. the
+  // undistorted point. The Jacobian is the identity close to the image center.
+  inline void distortWithJacobian(
+      Batch* x, Batch* y, Batch* j00, Batch* j01, Batch* j10,
+      Batch* j11) const {
+    const Batch kOne(1.0);
+    const Batch r2 = *x * *x + *y * *y;
+    const Batch r = sqrt(r2);
+    const Batch theta = simd::atan(r);
+    const Batch theta2 = theta * theta;
+    const Batch theta4 = theta2 * theta2;
+    const Batch theta6 = theta2 * theta4;
+    const Batch theta8 = theta4 * theta4;
+    const Batch thetad =
+        theta * (kOne + k1 * theta2 + k2 * theta4 + k3 * theta6 + k4 * theta8);
+    // d(thetad) / d(theta)
+    const Batch dthetad_dtheta =
+        kOne + Batch(3.0) * k1 * theta2 + Batch(5.0) * k2 * theta4 +
+        Batch(7.0) * k3 * theta6 + Batch(9.0) * k4 * theta8;
+
+    const typename Batch::Mask is_not_centered = r > Batch(1e-8);
+    const Batch scaling = select(is_not_centered, thetad / r, kOne);
+    // d(scaling) / dr divided by r.
+    const Batch dscaling_dr_by_r = select(
+        is_not_centered,
+        (dthetad_dtheta / (kOne + r2) - scaling) / r2, Batch(0.0));
+
+    *j00 = scaling + dscaling_dr_by_r * *x * *x;
+    *j01 = dscaling_dr_by_r * *x * *y;
+    *j10 = *j01;
+    *j11 = scaling + dscaling_dr_by_r * *y * *y;
+    *x = *x * scaling;
+    *y = *y * scaling;
+  }
+
+  // Points closer to the image center than this remain unchanged by the
+  // undistortion.
+  static constexpr double kUndistortionSkipRadius2 = 1e-6;
+
+  const Batch k1;
+  const Batch k2;
+  const Batch k3;
+  const Batch k4;
+};
+
+template <typename Batch>
+struct FisheyeDistortionKernel {
+  explicit FisheyeDistortionKernel(const ProjectionParameters& parameters)
+      : w(parameters.distortion[0]),
+        is_w_zero(parameters.distortion[0] * parameters.distortion[0] < 1e-5),
+        mul2tanwby2(2.0 * std::tan(parameters.distortion[0] / 2.0)),
+        mul2tanwby2byw(
+            is_w_zero ? 1.0 : 2.0 * std::tan(parameters.distortion[0] / 2.0) /
+                                  parameters.distortion[0]) {}
+
+  inline void distort(Batch* x, Batch* y) const {
+    if (is_w_zero) {
+      // Limit w->0.
+      return;
+    }
+    const Batch r_u2 = *x * *x + *y * *y;
+    const Batch r_u = sqrt(r_u2);
+    // Limit r_u->0 is handled by the blend.
+    const Batch r_rd = select(
+        r_u2 < Batch(1e-5), mul2tanwby2byw,
+        simd::atan(r_u * mul2tanwby2) / (r_u * w));
+    *x = *x * r_rd;
+    *y = *y * r_rd;
+  }
+
+  const Batch w;
+  const bool is_w_zero;
+  const Batch mul2tanwby2;
+  const Batch mul2tanwby2byw;
+};
+
+// Camera functors. See PinholeCamera::project3Functional and
+// UnifiedProjectionCamera::project3Functional for the scalar reference.
+template <typename Batch, typename DistortionKernel>
+struct PinholeProjectionKernel {
+  explicit PinholeProjectionKernel(const ProjectionParameters& parameters)
+      : distortion(parameters),
+        fu(parameters.fu),
+        fv(parameters.fv),
+        cu(parameters.cu),
+        cv(parameters.cv),
+        width(parameters.image_width),
+        height(parameters.image_height),
+        minimum_depth(parameters.minimum_depth) {}
+
+  inline void project(
+      const Batch& x, const Batch& y, const Batch& z, Batch* u, Batch* v,
+      Batch* status) const {
+    const Batch kZero(0.0);
+    const Batch rz = Batch(1.0) / z;
+    Batch kx = x * rz;
+    Batch ky = y * rz;
+    distortion.distort(&kx, &ky);
+    *u = fu * kx + cu;
+    *v = fv * ky + cv;
+
+    const typename Batch::Mask is_visible =
+        (*u >= kZero) & (*v >= kZero) & (*u < width) & (*v < height);
+    const typename Batch::Mask is_in_front = z > minimum_depth;
+    *status = select(
+        is_in_front,
+        select(
+            is_visible, Batch(kStatusKeypointVisible),
+            Batch(kStatusKeypointOutsideImageBox)),
+        select(
+            z < kZero, Batch(kStatusPointBehindCamera),
+            Batch(kStatusProjectionInvalid)));
+  }
+
+  const DistortionKernel distortion;
+  const Batch fu;
+  const Batch fv;
+  const Batch cu;
+  const Batch cv;
+  const Batch width;
+  const Batch height;
+  const Batch minimum_depth;
+};
+
+template <typename Batch, typename DistortionKernel>
+struct UnifiedProjectionKernel {
+  explicit UnifiedProjectionKernel(const ProjectionParameters& parameters)
+      : distortion(parameters),
+        xi(parameters.xi),
+        fov_parameter(
+            parameters.xi <= 1.0 ? parameters.xi : 1.0 / parameters.xi),
+        fu(parameters.fu),
+        fv(parameters.fv),
+        cu(parameters.cu),
+        cv(parameters.cv),
+        width(parameters.image_width),
+        height(parameters.image_height),
+        minimum_depth2(parameters.minimum_depth * parameters.minimum_depth) {}
+
+  inline void project(
+      const Batch& x, const Batch& y, const Batch& z, Batch* u, Batch* v,
+      Batch* status) const {
+    const Batch kZero(0.0);
+    const Batch d2 = x * x + y * y + z * z;
+    const Batch d = sqrt(d2);
+    const Batch rz = Batch(1.0) / (z + xi * d);
+    Batch kx = x * rz;
+    Batch ky = y * rz;
+    distortion.distort(&kx, &ky);
+    const typename Batch::Mask is_valid_projection = z > -(fov_parameter * d);
+    *u = select(is_valid_projection, fu * kx + cu, kZero);
+    *v = select(is_valid_projection, fv * ky + cv, kZero);
+
+    const typename Batch::Mask is_visible =
+        (*u >= kZero) & (*v >= kZero) & (*u < width) & (*v < height);
+    const typename Batch::Mask is_outside_min_depth = d2 > minimum_depth2;
+    *status = select(
+        is_valid_projection & is_outside_min_depth,
+        select(
+            is_visible, Batch(kStatusKeypointVisible),
+            Batch(kStatusKeypointOutsideImageBox)),
+        Batch(kStatusProjectionInvalid));
+  }
+
+  const DistortionKernel distortion;
+  const Batch xi;
+  const Batch fov_parameter;
+  const Batch fu;
+  const Batch fv;
+  const Batch cu;
+  const Batch cv;
+  const Batch width;
+  const Batch height;
+  const Batch minimum_depth2;
+};
+
+// Transposes blocks of points to structure-of-arrays layout, runs the
+// projection kernel on full batches and writes the interleaved keypoints back.
+// The last block is padded with points on the optical axis.
+template <typename Batch, typename ProjectionKernel>
+void project3Blocks(
+    const ProjectionParameters& parameters,
+    const typename Batch::Scalar* points_3d, const int points_stride,
+    const int num_points, typename Batch::Scalar* out_keypoints,
+    uint8_t* out_status) {
+  typedef typename Batch::Scalar Scalar;
+  static_assert(
+      kBlockSize % Batch::kSize == 0,
+      "The block size must be a multiple of the batch size.");
+  const ProjectionKernel kernel(parameters);
+
+  alignas(32) Scalar x[kBlockSize];
+  alignas(32) Scalar y[kBlockSize];
+  alignas(32) Scalar z[kBlockSize];
+  alignas(32) Scalar u[kBlockSize];
+  alignas(32) Scalar v[kBlockSize];
+  alignas(32) Scalar status[kBlockSize];
+
+  for (int block_start = 0; block_start < num_points;
+       block_start += kBlockSize) {
+    const int num_block_points = num_points - block_start < kBlockSize
+                                     ? num_points - block_start
+                                     : kBlockSize;
+    const int num_batched_points =
+        ((num_block_points + Batch::kSize - 1) / Batch::kSize) * Batch::kSize;
+
+    const Scalar* point = points_3d + block_start * points_stride;
+    for (int i = 0; i < num_block_points; ++i, point += points_stride) {
+      x[i] = point[0];
+      y[i] = point[1];
+      z[i] = point[2];
+    }
+    for (int i = num_block_points; i < num_batched_points; ++i) {
+      x[i] = Scalar(0);
+      y[i] = Scalar(0);
+      z[i] = Scalar(1);
+    }
+
+    for (int i = 0; i < num_batched_points; i += Batch::kSize) {
+      Batch batch_u, batch_v, batch_status;
+      kernel.project(
+          Batch::load(x + i), Batch::load(y + i), Batch::load(z + i), &batch_u,
+          &batch_v, &batch_status);
+      batch_u.store(u + i);
+      batch_v.store(v + i);
+      batch_status.store(status + i);
+    }
+
+    Scalar* keypoint = out_keypoints + 2 * block_start;
+    uint8_t* point_status = out_status + block_start;
+    for (int i = 0; i < num_block_points; ++i, keypoint += 2) {
+      keypoint[0] = u[i];
+      keypoint[1] = v[i];
+      point_status[i] = static_cast<uint8_t>(status[i]);
+    }
+  }
+}
+
+template <typename Batch, template <typename, typename> class CameraKernel>
+void project3WithDistortion(
+    const ProjectionParameters& parameters,
+    const typename Batch::Scalar* points_3d, const int points_stride,
+    const int num_points, typename Batch::Scalar* out_keypoints,
+    uint8_t* out_status) {
+  typedef ProjectionParameters::DistortionModel DistortionModel;
+  switch (parameters.distortion_model) {
+    case DistortionModel::kNoDistortion:
+      project3Blocks<Batch, CameraKernel<Batch, NullDistortionKernel<Batch>>>(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+    case DistortionModel::kRadTan:
+      project3Blocks<Batch, CameraKernel<Batch, RadTanDistortionKernel<Batch>>>(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+    case DistortionModel::kEquidistant:
+      project3Blocks<
+          Batch, CameraKernel<Batch, EquidistantDistortionKernel<Batch>>>(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+    case DistortionModel::kFisheye:
+      project3Blocks<
+          Batch, CameraKernel<Batch, FisheyeDistortionKernel<Batch>>>(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+  }
+}
+
+template <typename Batch>
+void project3Batched(
+    const ProjectionParameters& parameters,
+    const typename Batch::Scalar* points_3d, const int points_stride,
+    const int num_points, typename Batch::Scalar* out_keypoints,
+    uint8_t* out_status) {
+  typedef ProjectionParameters::CameraModel CameraModel;
+  switch (parameters.camera_model) {
+    case CameraModel::kPinhole:
+      project3WithDistortion<Batch, PinholeProjectionKernel>(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+    case CameraModel::kUnifiedProjection:
+      project3WithDistortion<Batch, UnifiedProjectionKernel>(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+  }
+}
+
+// Gauss-Newton inversion of the distortion, see
+// RadTanDistortion::undistortUsingExternalCoefficients for the scalar
+// reference. All lanes of a batch iterate together; lanes that converged are
+// masked out and keep their value while the others continue.
+template <typename Batch, typename DistortionKernel>
+int undistortBlocks(
+    const ProjectionParameters& parameters, const int max_iterations,
+    const double tolerance, const int num_points,
+    typename Batch::Scalar* points_2d, uint8_t* out_converged) {
+  typedef typename Batch::Scalar Scalar;
+  static_assert(
+      kBlockSize % Batch::kSize == 0,
+      "The block size must be a multiple of the batch size.");
+  const DistortionKernel kernel(parameters);
+  const Batch kTolerance(tolerance);
+  const Batch kSkipRadius2(DistortionKernel::kUndistortionSkipRadius2);
+
+  alignas(32) Scalar x[kBlockSize];
+  alignas(32) Scalar y[kBlockSize];
+  alignas(32) Scalar converged[kBlockSize];
+
+  int num_not_converged = 0;
+  for (int block_start = 0; block_start < num_points;
+       block_start += kBlockSize) {
+    const int num_block_points = num_points - block_start < kBlockSize
+                                     ? num_points - block_start
+                                     : kBlockSize;
+    const int num_batched_points =
+        ((num_block_points + Batch::kSize - 1) / Batch::kSize) * Batch::kSize;
+
+    Scalar* point = points_2d + 2 * block_start;
+    for (int i = 0; i < num_block_points; ++i, point += 2) {
+      x[i] = point[0];
+      y[i] = point[1];
+    }
+    // Pad with the image center which is skipped right away for models with a
+    // skip radius and converges in the first iteration otherwise.
+    for (int i = num_block_points; i < num_batched_points; ++i) {
+      x[i] = Scalar(0);
+      y[i] = Scalar(0);
+    }
+
+    for (int i = 0; i < num_batched_points; i += Batch::kSize) {
+      const Batch target_x = Batch::load(x + i);
+      const Batch target_y = Batch::load(y + i);
+      Batch estimate_x = target_x;
+      Batch estimate_y = target_y;
+      typename Batch::Mask is_converged =
+          (target_x * target_x + target_y * target_y) < kSkipRadius2;
+
+      for (int iteration = 0;
+           iteration < max_iterations && !all(is_converged); ++iteration) {
+        Batch distorted_x = estimate_x;
+        Batch distorted_y = estimate_y;
+        Batch j00, j01, j10, j11;
+        kernel.distortWithJacobian(
+            &distorted_x, &distorted_y, &j00, &j01, &j10, &j11);
+        const Batch error_x = target_x - distorted_x;
+        const Batch error_y = target_y - distorted_y;
+
+        // Solve the 2x2 normal equations, i.e. apply the inverse Jacobian.
+        const Batch inverse_determinant =
+            Batch(1.0) / (j00 * j11 - j01 * j10);
+        const Batch delta_x =
+            (j11 * error_x - j01 * error_y) * inverse_determinant;
+        const Batch delta_y =
+            (j00 * error_y - j10 * error_x) * inverse_determinant;
+        estimate_x = select(is_converged, estimate_x, estimate_x + delta_x);
+        estimate_y = select(is_converged, estimate_y, estimate_y + delta_y);
+        is_converged = is_converged |
+            ((error_x * error_x + error_y * error_y) <= kTolerance);
+      }
+
+      estimate_x.store(x + i);
+      estimate_y.store(y + i);
+      select(is_converged, Batch(1.0), Batch(0.0)).store(converged + i);
+    }
+
+    point = points_2d + 2 * block_start;
+    for (int i = 0; i < num_block_points; ++i, point += 2) {
+      point[0] = x[i];
+      point[1] = y[i];
+      const bool is_point_converged = converged[i] != Scalar(0);
+      num_not_converged += is_point_converged ? 0 : 1;
+      if (out_converged != nullptr) {
+        out_converged[block_start + i] = is_point_converged ? 1u : 0u;
+      }
+    }
+  }
+  return num_not_converged;
+}
+
+template <typename Batch>
+int undistortBatched(
+    const ProjectionParameters& parameters, const int max_iterations,
+    const double tolerance, const int num_points,
+    typename Batch::Scalar* points_2d, uint8_t* out_converged) {
+  typedef ProjectionParameters::DistortionModel DistortionModel;
+  switch (parameters.distortion_model) {
+    case DistortionModel::kRadTan:
+      return undistortBlocks<Batch, RadTanDistortionKernel<Batch>>(
+          parameters, max_iterations, tolerance, num_points, points_2d,
+          out_converged);
+    case DistortionModel::kEquidistant:
+      return undistortBlocks<Batch, EquidistantDistortionKernel<Batch>>(
+          parameters, max_iterations, tolerance, num_points, points_2d,
+          out_converged);
+    case DistortionModel::kNoDistortion:
+    case DistortionModel::kFisheye:
+      // Handled by the dispatcher.
+      break;
+  }
+  return -1;
+}
+
+// Spherical projection of Camera3DLidar. See
+// Camera3DLidar::project3Functional for the scalar reference; the elevation
+// asin(y / range) is computed as atan2(y, sqrt(x^2 + z^2)) so that a single
+// approximate arc tangent serves both angles.
+template <typename Batch>
+struct LidarProjectionKernel {
+  explicit LidarProjectionKernel(const LidarProjectionParameters& parameters)
+      : inverse_horizontal_resolution(1.0 / parameters.horizontal_resolution),
+        inverse_vertical_resolution(1.0 / parameters.vertical_resolution),
+        horizontal_center(parameters.horizontal_center),
+        vertical_center(parameters.vertical_center),
+        image_width(parameters.image_width),
+        image_height(parameters.image_height),
+        minimum_squared_range(parameters.minimum_squared_range) {}
+
+  inline void project(
+      const Batch& x, const Batch& y, const Batch& z, Batch* u, Batch* v,
+      Batch* range, Batch* status) const {
+    const Batch kZero(0.0);
+    const Batch horizontal_range2 = x * x + z * z;
+    const Batch range2 = horizontal_range2 + y * y;
+    *range = sqrt(range2);
+
+    const Batch azimuth_u =
+        (simd::atan2Approximate(x, z) + horizontal_center) *
+        inverse_horizontal_resolution;
+    *u = select(azimuth_u < kZero, azimuth_u + image_width, azimuth_u);
+    *v = (simd::atan2Approximate(y, sqrt(horizontal_range2)) +
+          vertical_center) *
+         inverse_vertical_resolution;
+
+    const typename Batch::Mask is_visible = (*u >= kZero) & (*u < image_width) &
+                                            (*v >= kZero) &
+                                            (*v < image_height);
+    const typename Batch::Mask is_outside_min_range =
+        range2 > minimum_squared_range;
+    *status = select(
+        is_outside_min_range,
+        select(
+            is_visible, Batch(kStatusKeypointVisible),
+            Batch(kStatusKeypointOutsideImageBox)),
+        Batch(kStatusProjectionInvalid));
+  }
+
+  Batch inverse_horizontal_resolution;
+  Batch inverse_vertical_resolution;
+  Batch horizontal_center;
+  Batch vertical_center;
+  Batch image_width;
+  Batch image_height;
+  Batch minimum_squared_range;
+};
+
+// Same block scheme as project3Blocks(..) with the range as an additional
+// output.
+template <typename Batch>
+void projectLidarBlocks(
+    const LidarProjectionParameters& parameters,
+    const typename Batch::Scalar* points_3d, const int points_stride,
+    const int num_points, typename Batch::Scalar* out_keypoints,
+    typename Batch::Scalar* out_ranges, uint8_t* out_status) {
+  typedef typename Batch::Scalar Scalar;
+  static_assert(
+      kBlockSize % Batch::kSize == 0,
+      "The block size must be a multiple of the batch size.");
+  const LidarProjectionKernel<Batch> kernel(parameters);
+
+  alignas(32) Scalar x[kBlockSize];
+  alignas(32) Scalar y[kBlockSize];
+  alignas(32) Scalar z[kBlockSize];
+  alignas(32) Scalar u[kBlockSize];
+  alignas(32) Scalar v[kBlockSize];
+  alignas(32) Scalar range[kBlockSize];
+  alignas(32) Scalar status[kBlockSize];
+
+  for (int block_start = 0; block_start < num_points;
+       block_start += kBlockSize) {
+    const int num_block_points = num_points - block_start < kBlockSize
+                                     ? num_points - block_start
+                                     : kBlockSize;
+    const int num_batched_points =
+        ((num_block_points + Batch::kSize - 1) / Batch::kSize) * Batch::kSize;
+
+    const Scalar* point = points_3d + block_start * points_stride;
+    for (int i = 0; i < num_block_points; ++i, point += points_stride) {
+      x[i] = point[0];
+      y[i] = point[1];
+      z[i] = point[2];
+    }
+    for (int i = num_block_points; i < num_batched_points; ++i) {
+      x[i] = Scalar(0);
+      y[i] = Scalar(0);
+      z[i] = Scalar(1);
+    }
+
+    for (int i = 0; i < num_batched_points; i += Batch::kSize) {
+      Batch batch_u, batch_v, batch_range, batch_status;
+      kernel.project(
+          Batch::load(x + i), Batch::load(y + i), Batch::load(z + i), &batch_u,
+          &batch_v, &batch_range, &batch_status);
+      batch_u.store(u + i);
+      batch_v.store(v + i);
+      batch_range.store(range + i);
+      batch_status.store(status + i);
+    }
+
+    Scalar* keypoint = out_keypoints + 2 * block_start;
+    Scalar* point_range = out_ranges + block_start;
+    uint8_t* point_status = out_status + block_start;
+    for (int i = 0; i < num_block_points; ++i, keypoint += 2) {
+      keypoint[0] = u[i];
+      keypoint[1] = v[i];
+      point_range[i] = range[i];
+      point_status[i] = static_cast<uint8_t>(status[i]);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace vectorized
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_VECTORIZED_PROJECTION_KERNELS_H_
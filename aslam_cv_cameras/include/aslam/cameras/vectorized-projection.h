@@ -0,0 +1,215 @@
+#ifndef ASLAM_CAMERAS_VECTORIZED_PROJECTION_H_
+#define ASLAM_CAMERAS_VECTORIZED_PROJECTION_H_
+
+#include <cstdint>
+#include <string>
+
+namespace aslam {
+class Distortion;
+
+namespace vectorized {
+
+/// The instruction sets for which the vectorized kernels are compiled. The
+/// best supported one is selected at runtime.
+enum class InstructionSet : uint8_t {
+  kScalar = 0,
+  kSse2 = 1,
+  kAvx2 = 2
+};
+
+/// \brief Returns the best instruction set supported by both the binary and the
+///        CPU the program is running on. The CPU is only queried once.
+InstructionSet getBestSupportedInstructionSet();
+
+/// \brief Checks whether the given instruction set can be used on this machine.
+bool isInstructionSetSupported(InstructionSet instruction_set);
+
+std::string instructionSetToString(InstructionSet instruction_set);
+
+/// \brief Flat copy of all camera and distortion parameters needed to run the
+///        vectorized projection kernels. The kernels can not access the camera
+///        objects directly as they are compiled with different target flags.
+struct ProjectionParameters {
+  enum class CameraModel : uint8_t { kPinhole = 0, kUnifiedProjection = 1 };
+  enum class DistortionModel : uint8_t {
+    kNoDistortion = 0,
+    kEquidistant = 1,
+    kFisheye = 2,
+    kRadTan = 3
+  };
+  static constexpr int kMaxNumDistortionParameters = 4;
+
+  CameraModel camera_model = CameraModel::kPinhole;
+  DistortionModel distortion_model = DistortionModel::kNoDistortion;
+
+  /// Mirror parameter, only used by the unified projection model.
+  double xi = 0.0;
+  double fu = 0.0;
+  double fv = 0.0;
+  double cu = 0.0;
+  double cv = 0.0;
+  double image_width = 0.0;
+  double image_height = 0.0;
+  /// Minimal depth (pinhole) or minimal distance (unified projection) for a
+  /// valid projection.
+  double minimum_depth = 0.0;
+  double distortion[kMaxNumDistortionParameters] = {0.0, 0.0, 0.0, 0.0};
+
+  /// Copies the type and coefficients of the given distortion model.
+  void setDistortion(const aslam::Distortion& distortion);
+};
+
+/// \brief Projects a set of euclidean points to keypoints using the camera
+///        model described by the parameters. The results are identical to
+///        Camera::project3 up to floating point rounding.
+/// @param[in]  parameters      Camera and distortion parameters.
+/// @param[in]  points_3d       Points as xyz triplets; point i starts at
+///                             points_3d[i * points_stride].
+/// @param[in]  points_stride   Number of scalars between consecutive points.
+/// @param[in]  num_points      Number of points to project.
+/// @param[in]  instruction_set Instruction set to use. Must be supported.
+/// @param[out] out_keypoints   Keypoints as uv pairs; size 2 * num_points.
+/// @param[out] out_status      Projection status per point, the values
+///                             correspond to ProjectionResult::Status.
+void project3(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    double* out_keypoints, uint8_t* out_status);
+
+/// \brief Single precision version of project3(..). The float kernels process
+///        twice as many points per instruction; the keypoints are accurate to
+///        about 1e-4 pixels for typical image sizes.
+void project3(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    float* out_keypoints, uint8_t* out_status);
+
+/// \brief Undistorts a set of points in the normalized image plane with the
+///        Gauss-Newton scheme of Distortion::undistort. All lanes of a batch
+///        iterate in parallel and lanes that converged are masked out. Only
+///        the iterative distortion models (RadTan, Equidistant) are supported.
+/// @param[in]     parameters      Only the distortion fields are used.
+/// @param[in]     max_iterations  Maximal number of Gauss-Newton iterations.
+/// @param[in]     tolerance       Convergence threshold on the squared error.
+/// @param[in]     num_points      Number of points to undistort.
+/// @param[in]     instruction_set Instruction set to use. Must be supported.
+/// @param[in,out] points_2d       Points as xy pairs; size 2 * num_points.
+/// @param[out]    out_converged   Optional: 1 if the point converged, 0
+///                                otherwise; size num_points.
+/// @return Number of points that did not converge.
+int undistort(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, InstructionSet instruction_set,
+    double* points_2d, uint8_t* out_converged);
+
+/// \brief Single precision version of undistort(..). The tolerance must not be
+///        below the float resolution of the squared error, i.e. about 1e-12 for
+///        points in the normalized image plane.
+int undistort(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, InstructionSet instruction_set,
+    float* points_2d, uint8_t* out_converged);
+
+/// \brief Parameters of the spherical projection of Camera3DLidar.
+struct LidarProjectionParameters {
+  double horizontal_resolution = 0.0;
+  double vertical_resolution = 0.0;
+  double horizontal_center = 0.0;
+  double vertical_center = 0.0;
+  double image_width = 0.0;
+  double image_height = 0.0;
+  /// Minimal squared distance for a valid projection.
+  double minimum_squared_range = 0.0;
+};
+
+/// \brief Projects a set of euclidean points with the lidar model of
+///        Camera3DLidar and computes their range. The angles are evaluated
+///        with an approximate arc tangent, the keypoints deviate from
+///        Camera3DLidar::project3 by at most 1.2e-5 rad divided by the angular
+///        resolution.
+/// @param[in]  parameters      Lidar parameters.
+/// @param[in]  points_3d       Points as xyz triplets; point i starts at
+///                             points_3d[i * points_stride].
+/// @param[in]  points_stride   Number of scalars between consecutive points.
+/// @param[in]  num_points      Number of points to project.
+/// @param[in]  instruction_set Instruction set to use. Must be supported.
+/// @param[out] out_keypoints   Keypoints as uv pairs; size 2 * num_points.
+/// @param[out] out_ranges      Distance of the points to the sensor; size
+///                             num_points.
+/// @param[out] out_status      Projection status per point, the values
+///                             correspond to ProjectionResult::Status.
+void projectLidar(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    double* out_keypoints, double* out_ranges, uint8_t* out_status);
+
+namespace internal {
+// Kernels per instruction set. Use project3(..) and undistort(..) instead,
+// which check the instruction set support and dispatch to these functions.
+void project3Scalar(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    uint8_t* out_status);
+void project3Sse2(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    uint8_t* out_status);
+void project3Avx2(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    uint8_t* out_status);
+void project3Scalar(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, float* out_keypoints,
+    uint8_t* out_status);
+void project3Sse2(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, float* out_keypoints,
+    uint8_t* out_status);
+void project3Avx2(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, float* out_keypoints,
+    uint8_t* out_status);
+
+int undistortScalar(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, double* points_2d,
+    uint8_t* out_converged);
+int undistortSse2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, double* points_2d,
+    uint8_t* out_converged);
+int undistortAvx2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, double* points_2d,
+    uint8_t* out_converged);
+int undistortScalar(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, float* points_2d,
+    uint8_t* out_converged);
+int undistortSse2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, float* points_2d,
+    uint8_t* out_converged);
+int undistortAvx2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, float* points_2d,
+    uint8_t* out_converged);
+void projectLidarScalar(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    double* out_ranges, uint8_t* out_status);
+void projectLidarSse2(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    double* out_ranges, uint8_t* out_status);
+void projectLidarAvx2(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    double* out_ranges, uint8_t* out_status);
+}  // namespace internal
+
+}  // namespace vectorized
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_VECTORIZED_PROJECTION_H_
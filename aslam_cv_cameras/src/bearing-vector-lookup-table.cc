@@ -0,0 +1,96 @@
+#include "aslam/cameras/bearing-vector-lookup-table.h"
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include <aslam/cameras/camera.h>
+
+namespace aslam {
+
+BearingVectorLookupTable::BearingVectorLookupTable(const Camera& camera, double step_px)
+    : step_px_(step_px),
+      inverse_step_px_(1.0 / step_px),
+      image_width_(camera.imageWidth()),
+      image_height_(camera.imageHeight()),
+      intrinsics_(camera.getParameters()),
+      distortion_parameters_(camera.getDistortion().getParameters()),
+      distortion_type_(static_cast<int>(camera.getDistortion().getType())) {
+  CHECK_GT(step_px_, 0.0);
+  CHECK_GT(image_width_, 0u);
+  CHECK_GT(image_height_, 0u);
+
+  // The last node lies on (or beyond) the image border such that every keypoint inside the
+  // image is surrounded by four nodes.
+  num_nodes_u_ = static_cast<int>(std::ceil(image_width_ * inverse_step_px_)) + 1;
+  num_nodes_v_ = static_cast<int>(std::ceil(image_height_ * inverse_step_px_)) + 1;
+  const int num_nodes = num_nodes_u_ * num_nodes_v_;
+
+  Eigen::Matrix2Xd nodes(2, num_nodes);
+  for (int v = 0; v < num_nodes_v_; ++v) {
+    for (int u = 0; u < num_nodes_u_; ++u) {
+      nodes.col(v * num_nodes_u_ + u) << u * step_px_, v * step_px_;
+    }
+  }
+
+  Eigen::Matrix3Xd bearing_vectors;
+  camera.backProject3Vectorized(nodes, &bearing_vectors, &is_node_valid_);
+  CHECK_EQ(is_node_valid_.size(), static_cast<size_t>(num_nodes));
+  bearing_vectors_ = bearing_vectors.cast<float>();
+
+  VLOG(3) << "Built bearing vector lookup table with " << num_nodes_u_ << "x" << num_nodes_v_
+          << " nodes (" << getMemoryBytes() / 1024 << " kB).";
+}
+
+bool BearingVectorLookupTable::interpolate(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+                                           Eigen::Vector3d* out_point_3d) const {
+  CHECK_NOTNULL(out_point_3d);
+  if (!(keypoint[0] >= 0.0 && keypoint[1] >= 0.0 &&
+        keypoint[0] < static_cast<double>(image_width_) &&
+        keypoint[1] < static_cast<double>(image_height_))) {
+    return false;
+  }
+
+  const double u = keypoint[0] * inverse_step_px_;
+  const double v = keypoint[1] * inverse_step_px_;
+  const int u0 = static_cast<int>(u);
+  const int v0 = static_cast<int>(v);
+  DCHECK_LT(u0 + 1, num_nodes_u_);
+  DCHECK_LT(v0 + 1, num_nodes_v_);
+
+  const int index_00 = v0 * num_nodes_u_ + u0;
+  const int index_01 = index_00 + 1;
+  const int index_10 = index_00 + num_nodes_u_;
+  const int index_11 = index_10 + 1;
+  if (!is_node_valid_[index_00] || !is_node_valid_[index_01] ||
+      !is_node_valid_[index_10] || !is_node_valid_[index_11]) {
+    return false;
+  }
+
+  const double alpha_u = u - u0;
+  const double alpha_v = v - v0;
+  *out_point_3d =
+      (1.0 - alpha_v) * ((1.0 - alpha_u) * bearing_vectors_.col(index_00).cast<double>() +
+                         alpha_u * bearing_vectors_.col(index_01).cast<double>()) +
+      alpha_v * ((1.0 - alpha_u) * bearing_vectors_.col(index_10).cast<double>() +
+                 alpha_u * bearing_vectors_.col(index_11).cast<double>());
+  return true;
+}
+
+bool BearingVectorLookupTable::isUpToDate(const Camera& camera) const {
+  const Eigen::VectorXd& intrinsics = camera.getParameters();
+  const Eigen::VectorXd& distortion_parameters = camera.getDistortion().getParameters();
+  return image_width_ == camera.imageWidth() &&
+         image_height_ == camera.imageHeight() &&
+         intrinsics_.size() == intrinsics.size() && intrinsics_ == intrinsics &&
+         distortion_type_ == static_cast<int>(camera.getDistortion().getType()) &&
+         distortion_parameters_.size() == distortion_parameters.size() &&
+         distortion_parameters_ == distortion_parameters;
+}
+
+size_t BearingVectorLookupTable::getMemoryBytes() const {
+  return bearing_vectors_.size() * sizeof(float) +
+         is_node_valid_.size() * sizeof(unsigned char);
+}
+
+}  // namespace aslam
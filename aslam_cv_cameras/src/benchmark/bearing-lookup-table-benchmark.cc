@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/bearing-vector-lookup-table.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+
+DEFINE_int32(
+    lookup_table_benchmark_num_keypoints, 100000,
+    "Number of keypoints back-projected per benchmark iteration.");
+DEFINE_int32(
+    lookup_table_benchmark_num_iterations, 20,
+    "Number of benchmark iterations per camera and table step.");
+
+namespace aslam {
+namespace {
+double secondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void benchmarkLookupTable(const Camera::Ptr& camera, const std::string& name) {
+  CHECK(camera);
+  const int num_keypoints = FLAGS_lookup_table_benchmark_num_keypoints;
+  const int num_iterations = FLAGS_lookup_table_benchmark_num_iterations;
+  Eigen::Matrix2Xd keypoints(2, num_keypoints);
+  for (int i = 0; i < num_keypoints; ++i) {
+    keypoints.col(i) = camera->createRandomKeypoint();
+  }
+
+  Eigen::Matrix3Xd exact_points;
+  std::vector<unsigned char> exact_success;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < num_iterations; ++i) {
+    camera->backProject3Vectorized(keypoints, &exact_points, &exact_success);
+  }
+  const double exact_keypoints_per_second =
+      num_keypoints * num_iterations / secondsSince(start);
+  LOG(INFO) << name << " exact: " << exact_keypoints_per_second / 1e6
+            << " Mkeypoints/s";
+
+  const double kStepsPx[] = {0.25, 0.5, 1.0, 2.0, 4.0};
+  for (const double step_px : kStepsPx) {
+    camera->setBearingLookupTableStep(step_px);
+    start = std::chrono::steady_clock::now();
+    const std::shared_ptr<const BearingVectorLookupTable> lookup_table =
+        camera->getBearingLookupTable();
+    const double build_seconds = secondsSince(start);
+
+    Eigen::Matrix3Xd cached_points;
+    std::vector<unsigned char> cached_success;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_iterations; ++i) {
+      camera->backProject3CachedVectorized(
+          keypoints, &cached_points, &cached_success);
+    }
+    const double cached_keypoints_per_second =
+        num_keypoints * num_iterations / secondsSince(start);
+
+    double max_angle = 0.0;
+    double sum_angle = 0.0;
+    int num_compared = 0;
+    for (int i = 0; i < num_keypoints; ++i) {
+      if (!exact_success[i] || !cached_success[i]) {
+        continue;
+      }
+      const double angle = std::acos(std::min(
+          1.0, exact_points.col(i).normalized().dot(
+                   cached_points.col(i).normalized())));
+      max_angle = std::max(max_angle, angle);
+      sum_angle += angle;
+      ++num_compared;
+    }
+
+    LOG(INFO) << name << " step " << step_px << " px: "
+              << lookup_table->getMemoryBytes() / 1024 << " kB, build "
+              << build_seconds * 1e3 << " ms, "
+              << cached_keypoints_per_second / 1e6 << " Mkeypoints/s (speedup "
+              << cached_keypoints_per_second / exact_keypoints_per_second
+              << "x), mean/max angular error "
+              << sum_angle / std::max(num_compared, 1) << "/" << max_angle
+              << " rad";
+  }
+}
+}  // namespace
+
+TEST(BearingLookupTableBenchmark, PinholeCamera) {
+  benchmarkLookupTable(
+      PinholeCamera::createTestCamera<RadTanDistortion>(),
+      "PinholeCamera RadTanDistortion");
+  benchmarkLookupTable(
+      PinholeCamera::createTestCamera<EquidistantDistortion>(),
+      "PinholeCamera EquidistantDistortion");
+}
+
+TEST(BearingLookupTableBenchmark, UnifiedProjectionCamera) {
+  benchmarkLookupTable(
+      UnifiedProjectionCamera::createTestCamera<FisheyeDistortion>(),
+      "UnifiedProjectionCamera FisheyeDistortion");
+  benchmarkLookupTable(
+      UnifiedProjectionCamera::createTestCamera<RadTanDistortion>(),
+      "UnifiedProjectionCamera RadTanDistortion");
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,248 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-3d-lidar.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/cameras/vectorized-projection.h>
+#include <aslam/common/entrypoint.h>
+
+DEFINE_int32(
+    projection_benchmark_num_points, 100000,
+    "Number of points projected per benchmark iteration.");
+DEFINE_int32(
+    projection_benchmark_num_iterations, 50,
+    "Number of benchmark iterations per camera and method.");
+
+namespace aslam {
+namespace {
+template <typename Function>
+double measurePointsPerSecond(const int num_points, const Function& function) {
+  // Warm up the caches once.
+  function();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_projection_benchmark_num_iterations; ++i) {
+    function();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  return static_cast<double>(num_points) *
+         FLAGS_projection_benchmark_num_iterations / seconds;
+}
+
+template <typename CameraType>
+void benchmarkProjection(
+    const typename CameraType::Ptr& camera, const std::string& name) {
+  CHECK(camera);
+  const int num_points = FLAGS_projection_benchmark_num_points;
+  Eigen::Matrix3Xd points(3, num_points);
+  for (int i = 0; i < num_points; ++i) {
+    points.col(i) = camera->createRandomVisiblePoint(1.0 + i % 50);
+  }
+
+  const Eigen::Matrix3Xf points_float = points.cast<float>();
+
+  Eigen::Matrix2Xd keypoints;
+  Eigen::Matrix2Xf keypoints_float;
+  std::vector<ProjectionResult> results;
+  const double baseline_points_per_second =
+      measurePointsPerSecond(num_points, [&]() {
+        // Explicitly call the per-point loop of the base class.
+        camera->Camera::project3Vectorized(points, &keypoints, &results);
+      });
+  LOG(INFO) << name << " loop: " << baseline_points_per_second / 1e6
+            << " Mpoints/s";
+
+  const vectorized::InstructionSet kInstructionSets[] = {
+      vectorized::InstructionSet::kScalar, vectorized::InstructionSet::kSse2,
+      vectorized::InstructionSet::kAvx2};
+  for (const vectorized::InstructionSet instruction_set : kInstructionSets) {
+    if (!vectorized::isInstructionSetSupported(instruction_set)) {
+      continue;
+    }
+    const double points_per_second =
+        measurePointsPerSecond(num_points, [&]() {
+          camera->project3Vectorized(
+              points, instruction_set, &keypoints, &results);
+        });
+    LOG(INFO) << name << " "
+              << vectorized::instructionSetToString(instruction_set) << ": "
+              << points_per_second / 1e6 << " Mpoints/s (speedup "
+              << points_per_second / baseline_points_per_second << "x)";
+
+    const double float_points_per_second =
+        measurePointsPerSecond(num_points, [&]() {
+          camera->project3Vectorized(
+              points_float, instruction_set, &keypoints_float, &results);
+        });
+    LOG(INFO) << name << " "
+              << vectorized::instructionSetToString(instruction_set)
+              << " float: " << float_points_per_second / 1e6
+              << " Mpoints/s (speedup "
+              << float_points_per_second / baseline_points_per_second << "x)";
+  }
+}
+
+template <typename CameraType>
+void benchmarkProjectionWithJacobians(
+    const typename CameraType::Ptr& camera, const std::string& name) {
+  CHECK(camera);
+  const int num_points = FLAGS_projection_benchmark_num_points;
+  Eigen::Matrix3Xd points(3, num_points);
+  for (int i = 0; i < num_points; ++i) {
+    points.col(i) = camera->createRandomVisiblePoint(1.0 + i % 50);
+  }
+
+  Eigen::Matrix2Xd keypoints(2, num_points);
+  std::vector<ProjectionResult> results(num_points);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobians_point(2, 3 * num_points);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobians_intrinsics;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobians_distortion;
+  const double baseline_points_per_second =
+      measurePointsPerSecond(num_points, [&]() {
+        Eigen::Vector2d keypoint;
+        Eigen::Matrix<double, 2, 3> jacobian_point;
+        Eigen::Matrix<double, 2, Eigen::Dynamic> jacobian_intrinsics;
+        Eigen::Matrix<double, 2, Eigen::Dynamic> jacobian_distortion;
+        for (int i = 0; i < num_points; ++i) {
+          results[i] = camera->project3Functional(
+              points.col(i), nullptr, nullptr, &keypoint, &jacobian_point,
+              &jacobian_intrinsics, &jacobian_distortion);
+          keypoints.col(i) = keypoint;
+          jacobians_point.block<2, 3>(0, 3 * i) = jacobian_point;
+        }
+      });
+  LOG(INFO) << name << " project3Functional loop: "
+            << baseline_points_per_second / 1e6 << " Mpoints/s";
+
+  const double points_per_second = measurePointsPerSecond(num_points, [&]() {
+    camera->project3VectorizedWithJacobians(
+        points, &keypoints, &results, &jacobians_point, &jacobians_intrinsics,
+        &jacobians_distortion);
+  });
+  LOG(INFO) << name << " project3VectorizedWithJacobians: "
+            << points_per_second / 1e6 << " Mpoints/s (speedup "
+            << points_per_second / baseline_points_per_second << "x)";
+}
+
+template <typename CameraType>
+void benchmarkAllDistortions(const std::string& camera_name) {
+  benchmarkProjection<CameraType>(
+      CameraType::template createTestCamera<NullDistortion>(),
+      camera_name + " NullDistortion");
+  benchmarkProjection<CameraType>(
+      CameraType::template createTestCamera<RadTanDistortion>(),
+      camera_name + " RadTanDistortion");
+  benchmarkProjection<CameraType>(
+      CameraType::template createTestCamera<EquidistantDistortion>(),
+      camera_name + " EquidistantDistortion");
+  benchmarkProjection<CameraType>(
+      CameraType::template createTestCamera<FisheyeDistortion>(),
+      camera_name + " FisheyeDistortion");
+}
+
+template <typename CameraType>
+void benchmarkJacobiansAllDistortions(const std::string& camera_name) {
+  benchmarkProjectionWithJacobians<CameraType>(
+      CameraType::template createTestCamera<NullDistortion>(),
+      camera_name + " NullDistortion");
+  benchmarkProjectionWithJacobians<CameraType>(
+      CameraType::template createTestCamera<RadTanDistortion>(),
+      camera_name + " RadTanDistortion");
+  benchmarkProjectionWithJacobians<CameraType>(
+      CameraType::template createTestCamera<EquidistantDistortion>(),
+      camera_name + " EquidistantDistortion");
+  benchmarkProjectionWithJacobians<CameraType>(
+      CameraType::template createTestCamera<FisheyeDistortion>(),
+      camera_name + " FisheyeDistortion");
+}
+
+void benchmarkLidarRangeImage() {
+  const Camera3DLidar::Ptr camera = Camera3DLidar::createTestCamera();
+  const int num_points = FLAGS_projection_benchmark_num_points;
+  Eigen::Matrix3Xd points(3, num_points);
+  for (int i = 0; i < num_points; ++i) {
+    points.col(i) = camera->createRandomVisiblePoint(1.0 + i % 50);
+  }
+
+  // Reference: per-point projection and z-buffering on one thread.
+  Camera3DLidar::RangeImage range_image;
+  Camera3DLidar::IndexImage index_image;
+  const double baseline_points_per_second =
+      measurePointsPerSecond(num_points, [&]() {
+        range_image.setZero(camera->imageHeight(), camera->imageWidth());
+        index_image.setConstant(
+            camera->imageHeight(), camera->imageWidth(),
+            Camera3DLidar::kNoReturnIndex);
+        Eigen::Vector2d keypoint;
+        for (int i = 0; i < num_points; ++i) {
+          if (!camera->project3(points.col(i), &keypoint)) {
+            continue;
+          }
+          const int row = static_cast<int>(keypoint(1) + 0.5);
+          const int column =
+              static_cast<int>(keypoint(0) + 0.5) % camera->imageWidth();
+          if (row >= range_image.rows()) {
+            continue;
+          }
+          const float range = points.col(i).norm();
+          if (index_image(row, column) == Camera3DLidar::kNoReturnIndex ||
+              range < range_image(row, column)) {
+            index_image(row, column) = i;
+            range_image(row, column) = range;
+          }
+        }
+      });
+  LOG(INFO) << "Camera3DLidar range image loop: "
+            << baseline_points_per_second / 1e6 << " Mpoints/s";
+
+  for (const size_t num_threads : {1u, 2u, 4u}) {
+    const double points_per_second =
+        measurePointsPerSecond(num_points, [&]() {
+          camera->projectScanToRangeImage(
+              points, num_threads, &range_image, &index_image);
+        });
+    LOG(INFO) << "Camera3DLidar range image " << num_threads
+              << " thread(s): " << points_per_second / 1e6
+              << " Mpoints/s (speedup "
+              << points_per_second / baseline_points_per_second << "x)";
+  }
+}
+}  // namespace
+
+TEST(ProjectionBenchmark, PinholeCamera) {
+  benchmarkAllDistortions<PinholeCamera>("PinholeCamera");
+}
+
+TEST(ProjectionBenchmark, UnifiedProjectionCamera) {
+  benchmarkAllDistortions<UnifiedProjectionCamera>("UnifiedProjectionCamera");
+}
+
+TEST(ProjectionBenchmark, PinholeCameraWithJacobians) {
+  benchmarkJacobiansAllDistortions<PinholeCamera>("PinholeCamera");
+}
+
+TEST(ProjectionBenchmark, UnifiedProjectionCameraWithJacobians) {
+  benchmarkJacobiansAllDistortions<UnifiedProjectionCamera>(
+      "UnifiedProjectionCamera");
+}
+
+TEST(ProjectionBenchmark, Camera3DLidarRangeImage) {
+  benchmarkLidarRangeImage();
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -1,14 +1,56 @@
 #include "aslam/cameras/camera-3d-lidar.h"
 
+#include <algorithm>
+#include <cmath>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/common/thread-pool.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
 
 namespace aslam {
+namespace {
+// Workers shared by all scan projections. Recreated if a projection asks for a
+// different number of threads.
+std::shared_ptr<ThreadPool> getScanProjectionThreadPool(
+    const size_t num_workers) {
+  static std::mutex mutex;
+  static std::shared_ptr<ThreadPool> thread_pool;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!thread_pool || thread_pool->numThreads() != num_workers) {
+    thread_pool = std::make_shared<ThreadPool>(num_workers);
+  }
+  return thread_pool;
+}
+
+// Runs function(thread_index) for num_threads thread indices. The calling
+// thread runs the first index, the others run on the shared thread pool.
+template <typename Function>
+void runOnThreads(const size_t num_threads, const Function& function) {
+  if (num_threads == 1u) {
+    function(0u);
+    return;
+  }
+  const std::shared_ptr<ThreadPool> thread_pool =
+      getScanProjectionThreadPool(num_threads - 1u);
+  std::vector<std::future<void>> workers_done;
+  workers_done.reserve(num_threads - 1u);
+  for (size_t thread_index = 1u; thread_index < num_threads; ++thread_index) {
+    workers_done.emplace_back(thread_pool->enqueue(function, thread_index));
+  }
+  function(0u);
+  for (std::future<void>& worker_done : workers_done) {
+    worker_done.wait();
+  }
+}
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const Camera3DLidar& camera) {
   camera.printParameters(out, std::string(""));
   return out;
@@ -39,6 +81,180 @@ bool Camera3DLidar::backProject3(
   return true;
 }
 
+void Camera3DLidar::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  const int num_points = points_3d.cols();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+
+  const Eigen::VectorXd& intrinsics = getParameters();
+  const Eigen::VectorXd dummy_distortion_coefficients;
+  Eigen::Vector3f point_3d;
+  Eigen::Vector2f keypoint;
+  for (int i = 0; i < num_points; ++i) {
+    point_3d = points_3d.col(i);
+    (*out_results)[i] = project3Functional<float, NullDistortion>(
+        point_3d, intrinsics, dummy_distortion_coefficients, &keypoint);
+    out_keypoints->col(i) = keypoint;
+  }
+}
+
+constexpr int Camera3DLidar::kNoReturnIndex;
+
+void Camera3DLidar::projectScanToRangeImage(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const size_t num_threads, RangeImage* out_range_image,
+    IndexImage* out_index_image) const {
+  CHECK_NOTNULL(out_range_image);
+  CHECK_GT(num_threads, 0u);
+  const int num_points = points_3d.cols();
+  const int width = static_cast<int>(imageWidth());
+  const int height = static_cast<int>(imageHeight());
+
+  IndexImage local_index_image;
+  IndexImage* index_image =
+      out_index_image != nullptr ? out_index_image : &local_index_image;
+  out_range_image->setZero(height, width);
+  index_image->setConstant(height, width, kNoReturnIndex);
+
+  // Keypoints of the last column that round up to the image width belong to
+  // the first column if the image covers the full circle.
+  const bool is_wrapping_around =
+      std::abs(width * horizontalResolution() - 2.0 * M_PI) <
+      horizontalResolution();
+
+  // Pixel and range of every point. Points outside of the image get the
+  // column kNoReturnIndex.
+  std::vector<int> point_columns(num_points);
+  std::vector<int> point_rows(num_points);
+  std::vector<float> point_ranges(num_points);
+
+  // The z-buffering threads own bands of columns. The points are bucketed by
+  // band, such that every thread only visits the points of its own band.
+  const int num_bands = static_cast<int>(num_threads);
+  std::vector<int> column_bands(width);
+  for (int band = 0; band < num_bands; ++band) {
+    const int begin_column = static_cast<int>(width * band / num_threads);
+    const int end_column = static_cast<int>(width * (band + 1) / num_threads);
+    std::fill(column_bands.begin() + begin_column,
+              column_bands.begin() + end_column, band);
+  }
+  // Number of points per band in the chunk of points of each thread, indexed
+  // by thread_index * num_bands + band.
+  std::vector<int> chunk_band_counts(num_threads * num_bands, 0);
+
+  const vectorized::LidarProjectionParameters parameters =
+      getVectorizedProjectionParameters();
+  const vectorized::InstructionSet instruction_set =
+      vectorized::getBestSupportedInstructionSet();
+  const int num_points_per_thread =
+      (num_points + static_cast<int>(num_threads) - 1) /
+      static_cast<int>(num_threads);
+  auto get_chunk = [&](const size_t thread_index, int* start, int* end) {
+    *start = std::min(
+        static_cast<int>(thread_index) * num_points_per_thread, num_points);
+    *end = std::min(*start + num_points_per_thread, num_points);
+  };
+  runOnThreads(num_threads, [&](const size_t thread_index) {
+    int start, end;
+    get_chunk(thread_index, &start, &end);
+    if (start == end) {
+      return;
+    }
+    Eigen::Matrix2Xd keypoints(2, end - start);
+    Eigen::VectorXd ranges(end - start);
+    std::vector<uint8_t> status(end - start);
+    vectorized::projectLidar(
+        parameters, points_3d.col(start).data(), points_3d.outerStride(),
+        end - start, instruction_set, keypoints.data(), ranges.data(),
+        status.data());
+
+    int* band_counts = chunk_band_counts.data() + thread_index * num_bands;
+    for (int i = 0; i < end - start; ++i) {
+      int column = kNoReturnIndex;
+      int row = kNoReturnIndex;
+      if (status[i] != static_cast<uint8_t>(
+                           ProjectionResult::Status::PROJECTION_INVALID)) {
+        column = static_cast<int>(std::floor(keypoints(0, i) + 0.5));
+        row = static_cast<int>(std::floor(keypoints(1, i) + 0.5));
+        if (column == width && is_wrapping_around) {
+          column = 0;
+        }
+        if (column < 0 || column >= width || row < 0 || row >= height) {
+          column = kNoReturnIndex;
+        } else {
+          ++band_counts[column_bands[column]];
+        }
+      }
+      point_columns[start + i] = column;
+      point_rows[start + i] = row;
+      point_ranges[start + i] = static_cast<float>(ranges(i));
+    }
+  });
+
+  // Offsets of the buckets, ordered by band and then by chunk. Each band
+  // therefore lists its points in increasing order.
+  std::vector<int> chunk_band_offsets(num_threads * num_bands);
+  std::vector<int> band_begin(num_bands + 1);
+  int offset = 0;
+  for (int band = 0; band < num_bands; ++band) {
+    band_begin[band] = offset;
+    for (size_t thread_index = 0u; thread_index < num_threads;
+         ++thread_index) {
+      chunk_band_offsets[thread_index * num_bands + band] = offset;
+      offset += chunk_band_counts[thread_index * num_bands + band];
+    }
+  }
+  band_begin[num_bands] = offset;
+
+  std::vector<int> bucketed_points(offset);
+  runOnThreads(num_threads, [&](const size_t thread_index) {
+    int start, end;
+    get_chunk(thread_index, &start, &end);
+    int* band_offsets = chunk_band_offsets.data() + thread_index * num_bands;
+    for (int i = start; i < end; ++i) {
+      if (point_columns[i] != kNoReturnIndex) {
+        bucketed_points[band_offsets[column_bands[point_columns[i]]]++] = i;
+      }
+    }
+  });
+
+  // Z-buffering. Each thread owns a band of columns and only writes to its
+  // own pixels. The points are visited in order and ties keep the first
+  // point, so the result does not depend on the number of threads.
+  runOnThreads(num_threads, [&](const size_t thread_index) {
+    for (int bucket_index = band_begin[thread_index];
+         bucket_index < band_begin[thread_index + 1u]; ++bucket_index) {
+      const int i = bucketed_points[bucket_index];
+      const int row = point_rows[i];
+      const int column = point_columns[i];
+      int& pixel_index = (*index_image)(row, column);
+      float& pixel_range = (*out_range_image)(row, column);
+      if (pixel_index == kNoReturnIndex || point_ranges[i] < pixel_range) {
+        pixel_index = i;
+        pixel_range = point_ranges[i];
+      }
+    }
+  });
+}
+
+vectorized::LidarProjectionParameters
+Camera3DLidar::getVectorizedProjectionParameters() const {
+  vectorized::LidarProjectionParameters parameters;
+  parameters.horizontal_resolution = horizontalResolution();
+  parameters.vertical_resolution = verticalResolution();
+  parameters.horizontal_center = horizontalCenter();
+  parameters.vertical_center = verticalCenter();
+  parameters.image_width = imageWidth();
+  parameters.image_height = imageHeight();
+  parameters.minimum_squared_range = kSquaredMinimumDepth;
+  return parameters;
+}
+
 const ProjectionResult Camera3DLidar::project3Functional(
     const Eigen::Ref<const Eigen::Vector3d>& point_3d,
     const Eigen::VectorXd* intrinsics_external,
@@ -4,6 +4,9 @@
 #include <aslam/cameras/camera-pinhole.h>
 
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-radtan.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
@@ -163,6 +166,198 @@ const ProjectionResult PinholeCamera::project3Functional(
   return evaluateProjectionResult(*out_keypoint, point_3d);
 }
 
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3Vectorized(
+      points_3d, vectorized::getBestSupportedInstructionSet(), out_keypoints,
+      out_results);
+}
+
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3VectorizedUsingKernels(
+      getVectorizedProjectionParameters(), points_3d, instruction_set,
+      out_keypoints, out_results);
+}
+
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3Vectorized(
+      points_3d, vectorized::getBestSupportedInstructionSet(), out_keypoints,
+      out_results);
+}
+
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3VectorizedUsingKernels(
+      getVectorizedProjectionParameters(), points_3d, instruction_set,
+      out_keypoints, out_results);
+}
+
+void PinholeCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  backProject3VectorizedImpl<double>(keypoints, out_points_3d, out_success);
+}
+
+void PinholeCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+    Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  backProject3VectorizedImpl<float>(keypoints, out_points_3d, out_success);
+}
+
+template <typename ScalarType>
+void PinholeCamera::backProject3VectorizedImpl(
+    const Eigen::Ref<const Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>>& keypoints,
+    Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+
+  Eigen::Matrix<ScalarType, 2, Eigen::Dynamic> points_2d(2, keypoints.cols());
+  points_2d.row(0) = (keypoints.row(0).array() - static_cast<ScalarType>(cu())) /
+                     static_cast<ScalarType>(fu());
+  points_2d.row(1) = (keypoints.row(1).array() - static_cast<ScalarType>(cv())) /
+                     static_cast<ScalarType>(fv());
+
+  // Besides a failed undistortion, the back-projection is always valid for
+  // the pinhole model.
+  distortion_->undistortVectorized(&points_2d, out_success);
+
+  out_points_3d->resize(Eigen::NoChange, keypoints.cols());
+  out_points_3d->template topRows<2>() = points_2d;
+  out_points_3d->row(2).setOnes();
+}
+
+vectorized::ProjectionParameters
+PinholeCamera::getVectorizedProjectionParameters() const {
+  vectorized::ProjectionParameters parameters;
+  parameters.camera_model =
+      vectorized::ProjectionParameters::CameraModel::kPinhole;
+  parameters.fu = fu();
+  parameters.fv = fv();
+  parameters.cu = cu();
+  parameters.cv = cv();
+  parameters.image_width = imageWidth();
+  parameters.image_height = imageHeight();
+  parameters.minimum_depth = kMinimumDepth;
+  parameters.setDistortion(*distortion_);
+  return parameters;
+}
+
+void PinholeCamera::project3VectorizedWithJacobiansImpl(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const {
+  switch (distortion_->getType()) {
+    case Distortion::Type::kNoDistortion:
+      project3VectorizedWithJacobiansTyped<NullDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    case Distortion::Type::kRadTan:
+      project3VectorizedWithJacobiansTyped<RadTanDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    case Distortion::Type::kEquidistant:
+      project3VectorizedWithJacobiansTyped<EquidistantDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    case Distortion::Type::kFisheye:
+      project3VectorizedWithJacobiansTyped<FisheyeDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    default:
+      Camera::project3VectorizedWithJacobiansImpl(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+  }
+}
+
+template <typename DistortionType>
+void PinholeCamera::project3VectorizedWithJacobiansTyped(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const {
+  const DistortionType& distortion = getDistortionTyped<DistortionType>();
+  const Eigen::VectorXd& distortion_coefficients = distortion.getParameters();
+  const int num_distortion_parameters = distortion.getParameterSize();
+  const double fu = this->fu();
+  const double fv = this->fv();
+  const double cu = this->cu();
+  const double cv = this->cv();
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix2d J_distortion;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion_parameters(
+      2, num_distortion_parameters);
+  for (int i = 0; i < points_3d.cols(); ++i) {
+    const double x = points_3d(0, i);
+    const double y = points_3d(1, i);
+    const double z = points_3d(2, i);
+
+    const double rz = 1.0 / z;
+    keypoint[0] = x * rz;
+    keypoint[1] = y * rz;
+
+    if (out_jacobians_distortion) {
+      distortion.DistortionType::distortParameterJacobian(
+          &distortion_coefficients, keypoint, &J_distortion_parameters);
+      J_distortion_parameters.row(0) *= fu;
+      J_distortion_parameters.row(1) *= fv;
+      out_jacobians_distortion->middleCols(
+          i * num_distortion_parameters, num_distortion_parameters) =
+          J_distortion_parameters;
+    }
+
+    // The distortion Jacobian is shared by the point and intrinsics Jacobians.
+    J_distortion.setIdentity();
+    distortion.DistortionType::distortUsingExternalCoefficients(
+        &distortion_coefficients, &keypoint, &J_distortion);
+
+    const double rz2 = rz * rz;
+    Eigen::Block<Eigen::Matrix<double, 2, Eigen::Dynamic>, 2, 3> J_point =
+        out_jacobians_point->block<2, 3>(0, 3 * i);
+    J_point(0, 0) = fu * J_distortion(0, 0) * rz;
+    J_point(0, 1) = fu * J_distortion(0, 1) * rz;
+    J_point(0, 2) = -fu * (x * J_distortion(0, 0) + y * J_distortion(0, 1)) * rz2;
+    J_point(1, 0) = fv * J_distortion(1, 0) * rz;
+    J_point(1, 1) = fv * J_distortion(1, 1) * rz;
+    J_point(1, 2) = -fv * (x * J_distortion(1, 0) + y * J_distortion(1, 1)) * rz2;
+
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->block<2, kNumOfParams>(0, kNumOfParams * i) <<
+          keypoint[0], 0.0, 1.0, 0.0,
+          0.0, keypoint[1], 0.0, 1.0;
+    }
+
+    // Normalized image plane to camera plane.
+    out_keypoints->col(i) << fu * keypoint[0] + cu, fv * keypoint[1] + cv;
+    (*out_results)[i] = evaluateProjectionResult(out_keypoints->col(i), points_3d.col(i));
+  }
+}
+
 Eigen::Vector2d PinholeCamera::createRandomKeypoint() const {
   Eigen::Vector2d out;
   out.setRandom();
@@ -4,6 +4,9 @@
 
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-radtan.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
@@ -197,6 +200,106 @@ const ProjectionResult UnifiedProjectionCamera::project3Functional(
   return evaluateProjectionResult(*out_keypoint, point_3d);
 }
 
+void UnifiedProjectionCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3Vectorized(
+      points_3d, vectorized::getBestSupportedInstructionSet(), out_keypoints,
+      out_results);
+}
+
+void UnifiedProjectionCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3VectorizedUsingKernels(
+      getVectorizedProjectionParameters(), points_3d, instruction_set,
+      out_keypoints, out_results);
+}
+
+void UnifiedProjectionCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3Vectorized(
+      points_3d, vectorized::getBestSupportedInstructionSet(), out_keypoints,
+      out_results);
+}
+
+void UnifiedProjectionCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3VectorizedUsingKernels(
+      getVectorizedProjectionParameters(), points_3d, instruction_set,
+      out_keypoints, out_results);
+}
+
+void UnifiedProjectionCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  backProject3VectorizedImpl<double>(keypoints, out_points_3d, out_success);
+}
+
+void UnifiedProjectionCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+    Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  backProject3VectorizedImpl<float>(keypoints, out_points_3d, out_success);
+}
+
+template <typename ScalarType>
+void UnifiedProjectionCamera::backProject3VectorizedImpl(
+    const Eigen::Ref<const Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>>& keypoints,
+    Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  const int num_keypoints = keypoints.cols();
+
+  Eigen::Matrix<ScalarType, 2, Eigen::Dynamic> points_2d(2, num_keypoints);
+  points_2d.row(0) = (keypoints.row(0).array() - static_cast<ScalarType>(cu())) /
+                     static_cast<ScalarType>(fu());
+  points_2d.row(1) = (keypoints.row(1).array() - static_cast<ScalarType>(cv())) /
+                     static_cast<ScalarType>(fv());
+
+  distortion_->undistortVectorized(&points_2d, out_success);
+
+  out_points_3d->resize(Eigen::NoChange, num_keypoints);
+  const ScalarType xi = static_cast<ScalarType>(this->xi());
+  for (int i = 0; i < num_keypoints; ++i) {
+    const ScalarType rho2_d = points_2d.col(i).squaredNorm();
+    const ScalarType tmpD =
+        std::max<ScalarType>(1 + (1 - xi * xi) * rho2_d, ScalarType(0));
+    (*out_points_3d)(0, i) = points_2d(0, i);
+    (*out_points_3d)(1, i) = points_2d(1, i);
+    (*out_points_3d)(2, i) = 1 - xi * (rho2_d + 1) / (xi + std::sqrt(tmpD));
+    (*out_success)[i] =
+        (*out_success)[i] && isUndistortedKeypointValid(rho2_d, xi);
+  }
+}
+
+vectorized::ProjectionParameters
+UnifiedProjectionCamera::getVectorizedProjectionParameters() const {
+  vectorized::ProjectionParameters parameters;
+  parameters.camera_model =
+      vectorized::ProjectionParameters::CameraModel::kUnifiedProjection;
+  parameters.xi = xi();
+  parameters.fu = fu();
+  parameters.fv = fv();
+  parameters.cu = cu();
+  parameters.cv = cv();
+  parameters.image_width = imageWidth();
+  parameters.image_height = imageHeight();
+  parameters.minimum_depth = kMinimumDepth;
+  parameters.setDistortion(*distortion_);
+  return parameters;
+}
+
 inline const ProjectionResult UnifiedProjectionCamera::evaluateProjectionResult(
     const Eigen::Ref<const Eigen::Vector2d>& keypoint,
     const Eigen::Vector3d& point_3d) const {
@@ -233,6 +336,138 @@ bool UnifiedProjectionCamera::isLiftable(const Eigen::Ref<const Eigen::Vector2d>
   return isUndistortedKeypointValid(rho2_d, xi());
 }
 
+void UnifiedProjectionCamera::project3VectorizedWithJacobiansImpl(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const {
+  switch (distortion_->getType()) {
+    case Distortion::Type::kNoDistortion:
+      project3VectorizedWithJacobiansTyped<NullDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    case Distortion::Type::kRadTan:
+      project3VectorizedWithJacobiansTyped<RadTanDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    case Distortion::Type::kEquidistant:
+      project3VectorizedWithJacobiansTyped<EquidistantDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    case Distortion::Type::kFisheye:
+      project3VectorizedWithJacobiansTyped<FisheyeDistortion>(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+      break;
+    default:
+      Camera::project3VectorizedWithJacobiansImpl(
+          points_3d, out_keypoints, out_results, out_jacobians_point,
+          out_jacobians_intrinsics, out_jacobians_distortion);
+  }
+}
+
+template <typename DistortionType>
+void UnifiedProjectionCamera::project3VectorizedWithJacobiansTyped(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const {
+  const DistortionType& distortion = getDistortionTyped<DistortionType>();
+  const Eigen::VectorXd& distortion_coefficients = distortion.getParameters();
+  const int num_distortion_parameters = distortion.getParameterSize();
+  const double xi = this->xi();
+  const double fu = this->fu();
+  const double fv = this->fv();
+  const double cu = this->cu();
+  const double cv = this->cv();
+  const double fov = fov_parameter(xi);
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix2d J_distortion;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion_parameters(
+      2, num_distortion_parameters);
+  for (int i = 0; i < points_3d.cols(); ++i) {
+    const double x = points_3d(0, i);
+    const double y = points_3d(1, i);
+    const double z = points_3d(2, i);
+
+    const double d = points_3d.col(i).norm();
+    const double rz = 1.0 / (z + xi * d);
+
+    // Check if point will lead to a valid projection
+    if (!(z > -(fov * d))) {
+      out_keypoints->col(i).setZero();
+      out_jacobians_point->block<2, 3>(0, 3 * i).setZero();
+      if (out_jacobians_intrinsics) {
+        out_jacobians_intrinsics->block<2, kNumOfParams>(0, kNumOfParams * i).setZero();
+      }
+      if (out_jacobians_distortion) {
+        out_jacobians_distortion->middleCols(
+            i * num_distortion_parameters, num_distortion_parameters).setZero();
+      }
+      (*out_results)[i] = ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+      continue;
+    }
+
+    keypoint[0] = x * rz;
+    keypoint[1] = y * rz;
+
+    if (out_jacobians_distortion) {
+      distortion.DistortionType::distortParameterJacobian(
+          &distortion_coefficients, keypoint, &J_distortion_parameters);
+      J_distortion_parameters.row(0) *= fu;
+      J_distortion_parameters.row(1) *= fv;
+      out_jacobians_distortion->middleCols(
+          i * num_distortion_parameters, num_distortion_parameters) =
+          J_distortion_parameters;
+    }
+
+    // The distortion Jacobian is shared by the point and intrinsics Jacobians.
+    J_distortion.setIdentity();
+    distortion.DistortionType::distortUsingExternalCoefficients(
+        &distortion_coefficients, &keypoint, &J_distortion);
+
+    // Jacobian of the undistorted keypoint wrt. the point.
+    double rz2 = rz * rz / d;
+    const double du_dx = rz2 * (d * z + xi * (y * y + z * z));
+    const double du_dy = -rz2 * xi * x * y;
+    const double dv_dy = rz2 * (d * z + xi * (x * x + z * z));
+    rz2 = rz2 * (-xi * z - d);
+    const double du_dz = x * rz2;
+    const double dv_dz = y * rz2;
+
+    Eigen::Block<Eigen::Matrix<double, 2, Eigen::Dynamic>, 2, 3> J_point =
+        out_jacobians_point->block<2, 3>(0, 3 * i);
+    J_point(0, 0) = fu * (du_dx * J_distortion(0, 0) + du_dy * J_distortion(0, 1));
+    J_point(1, 0) = fv * (du_dx * J_distortion(1, 0) + du_dy * J_distortion(1, 1));
+    J_point(0, 1) = fu * (du_dy * J_distortion(0, 0) + dv_dy * J_distortion(0, 1));
+    J_point(1, 1) = fv * (du_dy * J_distortion(1, 0) + dv_dy * J_distortion(1, 1));
+    J_point(0, 2) = fu * (du_dz * J_distortion(0, 0) + dv_dz * J_distortion(0, 1));
+    J_point(1, 2) = fv * (du_dz * J_distortion(1, 0) + dv_dz * J_distortion(1, 1));
+
+    if (out_jacobians_intrinsics) {
+      const double du_dxi = -x * rz * d * rz;
+      const double dv_dxi = -y * rz * d * rz;
+      out_jacobians_intrinsics->block<2, kNumOfParams>(0, kNumOfParams * i) <<
+          fu * (J_distortion(0, 0) * du_dxi + J_distortion(0, 1) * dv_dxi),
+          keypoint[0], 0.0, 1.0, 0.0,
+          fv * (J_distortion(1, 0) * du_dxi + J_distortion(1, 1) * dv_dxi),
+          0.0, keypoint[1], 0.0, 1.0;
+    }
+
+    // Normalized image plane to camera plane.
+    out_keypoints->col(i) << fu * keypoint[0] + cu, fv * keypoint[1] + cv;
+    (*out_results)[i] = evaluateProjectionResult(out_keypoints->col(i), points_3d.col(i));
+  }
+}
+
 Eigen::Vector2d UnifiedProjectionCamera::createRandomKeypoint() const {
   // This is tricky...The camera model defines a circle on the normalized image
   // plane and the projection equations don't work outside of it.
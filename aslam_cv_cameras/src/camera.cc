@@ -2,6 +2,7 @@
 
 #include <glog/logging.h>
 
+#include <aslam/cameras/bearing-vector-lookup-table.h>
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/distortion-equidistant.h>
 #include <aslam/cameras/distortion-fisheye.h>
@@ -12,6 +13,10 @@
 // TODO(slynen) Enable commented out PropertyTree support
 //#include <sm/PropertyTree.hpp>
 namespace aslam {
+namespace {
+// Distance between two nodes of the bearing vector lookup table in pixels.
+constexpr double kDefaultBearingLookupTableStepPx = 1.0;
+}  // namespace
 
 std::ostream& operator<<(std::ostream& out, const ProjectionResult& state) {
   std::string enum_str;
@@ -48,7 +53,8 @@ Camera::Camera(
       is_compressed_(false),
       intrinsics_(intrinsics),
       camera_type_(camera_type),
-      distortion_(std::move(distortion)) {
+      distortion_(std::move(distortion)),
+      bearing_lookup_table_step_px_(kDefaultBearingLookupTableStepPx) {
   CHECK_NOTNULL(distortion_.get());
 }
 
@@ -62,7 +68,8 @@ Camera::Camera(
       is_compressed_(false),
       intrinsics_(intrinsics),
       camera_type_(camera_type),
-      distortion_(new NullDistortion()) {}
+      distortion_(new NullDistortion()),
+      bearing_lookup_table_step_px_(kDefaultBearingLookupTableStepPx) {}
 
 void Camera::printParameters(std::ostream& out, const std::string& text) const {
   if (text.size() > 0) {
@@ -411,6 +418,139 @@ void Camera::project3Vectorized(
   }
 }
 
+void Camera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  Eigen::Matrix2Xd keypoints;
+  project3Vectorized(
+      Eigen::Matrix3Xd(points_3d.cast<double>()), &keypoints, out_results);
+  *out_keypoints = keypoints.cast<float>();
+}
+
+void Camera::project3VectorizedWithJacobians(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  CHECK_NOTNULL(out_jacobians_point);
+  const int num_points = points_3d.cols();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  out_jacobians_point->resize(Eigen::NoChange, 3 * num_points);
+  if (out_jacobians_intrinsics) {
+    out_jacobians_intrinsics->resize(
+        Eigen::NoChange, getParameterSize() * num_points);
+  }
+  if (out_jacobians_distortion) {
+    out_jacobians_distortion->resize(
+        Eigen::NoChange, getDistortion().getParameterSize() * num_points);
+  }
+  if (num_points == 0) {
+    return;
+  }
+  project3VectorizedWithJacobiansImpl(
+      points_3d, out_keypoints, out_results, out_jacobians_point,
+      out_jacobians_intrinsics, out_jacobians_distortion);
+}
+
+void Camera::project3VectorizedWithJacobiansImpl(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion) const {
+  const int num_intrinsics = getParameterSize();
+  const int num_distortion_parameters = getDistortion().getParameterSize();
+  // Reused between the points to avoid reallocations.
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix<double, 2, 3> jacobian_point;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobian_intrinsics(2, num_intrinsics);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> jacobian_distortion(
+      2, num_distortion_parameters);
+  for (int i = 0; i < points_3d.cols(); ++i) {
+    // Invalid projections do not necessarily set the point Jacobian.
+    jacobian_point.setZero();
+    (*out_results)[i] = project3Functional(
+        points_3d.col(i), nullptr, nullptr, &keypoint, &jacobian_point,
+        out_jacobians_intrinsics ? &jacobian_intrinsics : nullptr,
+        out_jacobians_distortion ? &jacobian_distortion : nullptr);
+    out_keypoints->col(i) = keypoint;
+    out_jacobians_point->block<2, 3>(0, 3 * i) = jacobian_point;
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->middleCols(i * num_intrinsics, num_intrinsics) =
+          jacobian_intrinsics;
+    }
+    if (out_jacobians_distortion) {
+      out_jacobians_distortion->middleCols(
+          i * num_distortion_parameters, num_distortion_parameters) = jacobian_distortion;
+    }
+  }
+}
+
+namespace {
+template <typename ScalarType>
+void project3VectorizedUsingKernelsImpl(
+    const vectorized::ProjectionParameters& parameters,
+    const Eigen::Ref<const Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>* out_keypoints,
+    std::vector<ProjectionResult>* out_results) {
+  static_assert(
+      static_cast<int>(ProjectionResult::Status::KEYPOINT_VISIBLE) == 0 &&
+          static_cast<int>(
+              ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX) == 1 &&
+          static_cast<int>(ProjectionResult::Status::POINT_BEHIND_CAMERA) ==
+              2 &&
+          static_cast<int>(ProjectionResult::Status::PROJECTION_INVALID) == 3,
+      "The status codes of the vectorized kernels must match "
+      "ProjectionResult::Status.");
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  const int num_points = points_3d.cols();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (num_points == 0) {
+    return;
+  }
+
+  std::vector<uint8_t> status(num_points);
+  vectorized::project3(
+      parameters, points_3d.data(), points_3d.outerStride(), num_points,
+      instruction_set, out_keypoints->data(), status.data());
+  for (int i = 0; i < num_points; ++i) {
+    (*out_results)[i] =
+        ProjectionResult(static_cast<ProjectionResult::Status>(status[i]));
+  }
+}
+}  // namespace
+
+void Camera::project3VectorizedUsingKernels(
+    const vectorized::ProjectionParameters& parameters,
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) {
+  project3VectorizedUsingKernelsImpl<double>(
+      parameters, points_3d, instruction_set, out_keypoints, out_results);
+}
+
+void Camera::project3VectorizedUsingKernels(
+    const vectorized::ProjectionParameters& parameters,
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    vectorized::InstructionSet instruction_set,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) {
+  project3VectorizedUsingKernelsImpl<float>(
+      parameters, points_3d, instruction_set, out_keypoints, out_results);
+}
+
 void Camera::backProject3Vectorized(
     const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
     Eigen::Matrix3Xd* out_points_3d,
@@ -426,6 +566,85 @@ void Camera::backProject3Vectorized(
   }
 }
 
+void Camera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+    Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  Eigen::Matrix3Xd points_3d;
+  backProject3Vectorized(
+      Eigen::Matrix2Xd(keypoints.cast<double>()), &points_3d, out_success);
+  *out_points_3d = points_3d.cast<float>();
+}
+
+bool Camera::backProject3Cached(
+    const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+    Eigen::Vector3d* out_point_3d) const {
+  CHECK_NOTNULL(out_point_3d);
+  if (getBearingLookupTable()->interpolate(keypoint, out_point_3d)) {
+    return true;
+  }
+  return backProject3(keypoint, out_point_3d);
+}
+
+void Camera::backProject3CachedVectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  const int num_keypoints = keypoints.cols();
+  out_points_3d->resize(Eigen::NoChange, num_keypoints);
+  out_success->resize(num_keypoints, false);
+
+  const std::shared_ptr<const BearingVectorLookupTable> lookup_table =
+      getBearingLookupTable();
+  Eigen::Vector3d bearing;
+  for (int i = 0; i < num_keypoints; ++i) {
+    if (lookup_table->interpolate(keypoints.col(i), &bearing)) {
+      (*out_success)[i] = true;
+    } else {
+      (*out_success)[i] = backProject3(keypoints.col(i), &bearing);
+    }
+    out_points_3d->col(i) = bearing;
+  }
+}
+
+void Camera::setBearingLookupTableStep(double step_px) {
+  CHECK_GT(step_px, 0.0);
+  std::lock_guard<std::mutex> lock(bearing_lookup_table_mutex_);
+  bearing_lookup_table_step_px_ = step_px;
+  std::atomic_store(
+      &bearing_lookup_table_,
+      std::shared_ptr<const BearingVectorLookupTable>());
+}
+
+std::shared_ptr<const BearingVectorLookupTable>
+Camera::getBearingLookupTable() const {
+  std::shared_ptr<const BearingVectorLookupTable> lookup_table =
+      std::atomic_load(&bearing_lookup_table_);
+  // The parameters can also change through paths that do not invalidate the
+  // table explicitly, e.g. when loading from yaml.
+  if (lookup_table && lookup_table->isUpToDate(*this)) {
+    return lookup_table;
+  }
+
+  std::lock_guard<std::mutex> lock(bearing_lookup_table_mutex_);
+  lookup_table = std::atomic_load(&bearing_lookup_table_);
+  if (!lookup_table || !lookup_table->isUpToDate(*this)) {
+    lookup_table = std::make_shared<const BearingVectorLookupTable>(
+        *this, bearing_lookup_table_step_px_);
+    std::atomic_store(&bearing_lookup_table_, lookup_table);
+  }
+  return lookup_table;
+}
+
+void Camera::invalidateBearingLookupTable() const {
+  std::atomic_store(
+      &bearing_lookup_table_,
+      std::shared_ptr<const BearingVectorLookupTable>());
+}
+
 void Camera::setMask(const cv::Mat& mask) {
   CHECK_EQ(image_height_, static_cast<size_t>(mask.rows));
   CHECK_EQ(image_width_, static_cast<size_t>(mask.cols));
@@ -1,5 +1,7 @@
 #include <aslam/cameras/distortion-equidistant.h>
 
+#include <cmath>
+
 namespace aslam {
 std::ostream& operator<<(std::ostream& out, const EquidistantDistortion& distortion) {
   distortion.printParameters(out, std::string(""));
@@ -146,6 +148,44 @@ void EquidistantDistortion::undistortUsingExternalCoefficients(const Eigen::Vect
   CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
   CHECK_NOTNULL(point);
 
+  // Handle special case around image center.
+  const double theta_d2 = point->squaredNorm();
+  if (theta_d2 < 1e-6)
+    return; // Point remains unchanged.
+
+  // The polynomial is only fitted for the internal parameters, which undistort(..) passes by
+  // reference. Other coefficient vectors are inverted iteratively.
+  if (&dist_coeffs == &distortion_coefficients_) {
+    const double theta_d = std::sqrt(theta_d2);
+    double theta;
+    if (getInversePolynomial()->invert(theta_d, &theta)) {
+      *point *= std::tan(theta) / theta_d;
+      return;
+    }
+  }
+  undistortIteratively(dist_coeffs, point);
+}
+
+std::shared_ptr<const EquidistantInversePolynomial>
+EquidistantDistortion::getInversePolynomial() const {
+  std::shared_ptr<const EquidistantInversePolynomial> inverse_polynomial =
+      std::atomic_load(&inverse_polynomial_);
+  if (inverse_polynomial && inverse_polynomial->isFitFor(distortion_coefficients_)) {
+    return inverse_polynomial;
+  }
+
+  std::lock_guard<std::mutex> lock(inverse_polynomial_mutex_);
+  inverse_polynomial = std::atomic_load(&inverse_polynomial_);
+  if (!inverse_polynomial || !inverse_polynomial->isFitFor(distortion_coefficients_)) {
+    inverse_polynomial.reset(new EquidistantInversePolynomial(distortion_coefficients_));
+    std::atomic_store(&inverse_polynomial_, inverse_polynomial);
+  }
+  return inverse_polynomial;
+}
+
+void EquidistantDistortion::undistortIteratively(const Eigen::VectorXd& dist_coeffs,
+                                                 Eigen::Vector2d* point) const {
+  CHECK_NOTNULL(point);
   const int n = 30;  // Max. number of iterations
 
   Eigen::Vector2d& y = *point;
@@ -153,14 +193,10 @@ void EquidistantDistortion::undistortUsingExternalCoefficients(const Eigen::Vect
   Eigen::Matrix2d F;
   Eigen::Vector2d y_tmp;
 
-  // Handle special case around image center.
-  if (y.squaredNorm() < 1e-6)
-    return; // Point remains unchanged.
-
   int i;
   for (i = 0; i < n; ++i) {
     y_tmp = ybar;
-    distortUsingExternalCoefficients(&dist_coeffs, &y_tmp, &F);
+    EquidistantDistortion::distortUsingExternalCoefficients(&dist_coeffs, &y_tmp, &F);
     Eigen::Vector2d e(y - y_tmp);
     Eigen::Vector2d du = (F.transpose() * F).inverse() * F.transpose() * e;
     ybar += du;
@@ -105,7 +105,7 @@ void RadTanDistortion::undistortUsingExternalCoefficients(const Eigen::VectorXd&
   int i;
   for (i = 0; i < n; ++i) {
     y_tmp = ybar;
-    distortUsingExternalCoefficients(&dist_coeffs, &y_tmp, &F);
+    RadTanDistortion::distortUsingExternalCoefficients(&dist_coeffs, &y_tmp, &F);
     Eigen::Vector2d e(y - y_tmp);
     Eigen::Vector2d du = (F.transpose() * F).inverse() * F.transpose() * e;
     ybar += du;
@@ -1,10 +1,15 @@
 #include "aslam/cameras/distortion.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "aslam/cameras/distortion-equidistant.h"
+#include "aslam/cameras/vectorized-projection.h"
+
 DEFINE_double(acv_inv_distortion_tolerance, 1e-8, "Convergence tolerance for iterated"
               "inverse distortion functions.");
 
@@ -62,6 +67,131 @@ void Distortion::undistort(const Eigen::Vector2d& point,
   undistortUsingExternalCoefficients(distortion_coefficients_, out_point);
 }
 
+namespace {
+// Runs the Gauss-Newton iterations of the iteratively inverted models on all points.
+template <typename ScalarType>
+int undistortIterativelyVectorized(
+    const Distortion& distortion, const double tolerance,
+    Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>* points,
+    std::vector<unsigned char>* out_converged) {
+  CHECK_NOTNULL(points);
+  const int num_points = points->cols();
+  // Same max. number of iterations as the single point versions.
+  const int kMaxIterations = 30;
+  vectorized::ProjectionParameters parameters;
+  parameters.setDistortion(distortion);
+  const int num_not_converged = vectorized::undistort(
+      parameters, kMaxIterations, tolerance, num_points,
+      vectorized::getBestSupportedInstructionSet(), points->data(),
+      out_converged != nullptr ? out_converged->data() : nullptr);
+  LOG_IF(WARNING, num_not_converged > 0)
+      << num_not_converged << " of " << num_points
+      << " points did not converge with max. iterations.";
+  return num_not_converged;
+}
+
+// Inverts the equidistant distortion with the fitted inverse polynomial, like the single point
+// version. Only the points outside of the range of the polynomial are iterated.
+template <typename ScalarType>
+int undistortEquidistantVectorized(
+    const EquidistantDistortion& distortion, const double tolerance,
+    Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>* points,
+    std::vector<unsigned char>* out_converged) {
+  CHECK_NOTNULL(points);
+  const int num_points = points->cols();
+  const EquidistantInversePolynomial::ConstPtr inverse_polynomial =
+      distortion.getInversePolynomial();
+  std::vector<int> remaining_point_indices;
+  for (int i = 0; i < num_points; ++i) {
+    const double theta_d2 = points->col(i).template cast<double>().squaredNorm();
+    // Same special case around the image center as the single point version.
+    if (theta_d2 < 1e-6) {
+      continue;
+    }
+    const double theta_d = std::sqrt(theta_d2);
+    double theta;
+    if (inverse_polynomial->invert(theta_d, &theta)) {
+      points->col(i) *= static_cast<ScalarType>(std::tan(theta) / theta_d);
+    } else {
+      remaining_point_indices.push_back(i);
+    }
+  }
+  if (out_converged != nullptr) {
+    std::fill(out_converged->begin(), out_converged->end(), 1u);
+  }
+  if (remaining_point_indices.empty()) {
+    return 0;
+  }
+
+  const int num_remaining_points = remaining_point_indices.size();
+  Eigen::Matrix<ScalarType, 2, Eigen::Dynamic> remaining_points(2, num_remaining_points);
+  for (int i = 0; i < num_remaining_points; ++i) {
+    remaining_points.col(i) = points->col(remaining_point_indices[i]);
+  }
+  std::vector<unsigned char> remaining_converged(num_remaining_points);
+  const int num_not_converged = undistortIterativelyVectorized(
+      distortion, tolerance, &remaining_points, &remaining_converged);
+  for (int i = 0; i < num_remaining_points; ++i) {
+    points->col(remaining_point_indices[i]) = remaining_points.col(i);
+    if (out_converged != nullptr) {
+      (*out_converged)[remaining_point_indices[i]] = remaining_converged[i];
+    }
+  }
+  return num_not_converged;
+}
+
+template <typename ScalarType>
+int undistortVectorizedImpl(
+    const Distortion& distortion, const double tolerance,
+    Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>* points,
+    std::vector<unsigned char>* out_converged) {
+  CHECK_NOTNULL(points);
+  const int num_points = points->cols();
+  if (out_converged != nullptr) {
+    out_converged->resize(num_points);
+  }
+
+  switch (distortion.getType()) {
+    case Distortion::Type::kEquidistant:
+      return undistortEquidistantVectorized(
+          static_cast<const EquidistantDistortion&>(distortion), tolerance, points,
+          out_converged);
+    case Distortion::Type::kRadTan:
+      return undistortIterativelyVectorized(distortion, tolerance, points, out_converged);
+    default:
+      break;
+  }
+
+  // The remaining models are inverted in closed form.
+  const Eigen::VectorXd& distortion_coefficients = distortion.getParameters();
+  Eigen::Vector2d point;
+  for (int i = 0; i < num_points; ++i) {
+    point = points->col(i).template cast<double>();
+    distortion.undistortUsingExternalCoefficients(distortion_coefficients, &point);
+    points->col(i) = point.cast<ScalarType>();
+  }
+  if (out_converged != nullptr) {
+    std::fill(out_converged->begin(), out_converged->end(), 1u);
+  }
+  return 0;
+}
+}  // namespace
+
+int Distortion::undistortVectorized(Eigen::Matrix2Xd* points,
+                                    std::vector<unsigned char>* out_converged) const {
+  return undistortVectorizedImpl(*this, FLAGS_acv_inv_distortion_tolerance, points,
+                                 out_converged);
+}
+
+int Distortion::undistortVectorized(Eigen::Matrix2Xf* points,
+                                    std::vector<unsigned char>* out_converged) const {
+  // The squared error can not get much below 1e-12 in single precision.
+  const double kMinFloatTolerance = 1e-12;
+  return undistortVectorizedImpl(
+      *this, std::max(FLAGS_acv_inv_distortion_tolerance, kMinFloatTolerance), points,
+      out_converged);
+}
+
 void Distortion::setParameters(const Eigen::VectorXd& dist_coeffs) {
   CHECK(distortionParametersValid(dist_coeffs)) << "Distortion parameters invalid!";
   distortion_coefficients_ = dist_coeffs;
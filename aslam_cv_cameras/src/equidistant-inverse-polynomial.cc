@@ -0,0 +1,182 @@
+#include "aslam/cameras/equidistant-inverse-polynomial.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+// Largest incidence angle covered by the fit. The undistorted radius tan(theta) diverges at
+// 90 degrees.
+constexpr double kMaxIncidenceAngle = M_PI_2 - 1e-3;
+// The distortion is considered non-invertible where its slope drops below this value.
+constexpr double kMinDistortionSlope = 1e-3;
+constexpr int kNumRangeScanSteps = 4096;
+constexpr int kNumBisectionSteps = 60;
+constexpr int kNumValidationSamplesPerSegment = 16;
+// Max. error of invert(..) in theta [rad] over the fitted range.
+constexpr double kMaxRefinedError = 1e-10;
+// The range is shrunk by this factor as long as the fit exceeds kMaxRefinedError.
+constexpr double kRangeShrinkFactor = 0.95;
+constexpr int kMaxNumFits = 100;
+}  // namespace
+
+EquidistantInversePolynomial::EquidistantInversePolynomial(
+    const Eigen::VectorXd& distortion_coefficients)
+    : distortion_coefficients_(distortion_coefficients),
+      max_theta_(0.0),
+      max_theta_d_(0.0),
+      segment_width_(0.0),
+      inverse_segment_width_(0.0),
+      max_fit_error_(0.0),
+      max_refined_error_(0.0),
+      is_valid_(false) {
+  CHECK_EQ(distortion_coefficients.size(), 4);
+
+  // Find the range in which the distortion is strictly increasing and therefore invertible.
+  const double scan_step = kMaxIncidenceAngle / kNumRangeScanSteps;
+  double max_theta = 0.0;
+  double derivative;
+  for (int i = 1; i <= kNumRangeScanSteps; ++i) {
+    const double theta = i * scan_step;
+    distortTheta(theta, &derivative);
+    if (derivative < kMinDistortionSlope) {
+      break;
+    }
+    max_theta = theta;
+  }
+  if (max_theta <= 0.0) {
+    LOG(WARNING) << "The distortion " << distortion_coefficients.transpose()
+                 << " is not invertible around the optical axis.";
+    return;
+  }
+
+  // Close to a fold the slope of the inverse diverges and the cubics cannot follow it. Shrink
+  // the range until the validated error is within the tolerance. Points beyond the range are
+  // inverted iteratively by the caller.
+  int num_fits = 0;
+  for (; num_fits < kMaxNumFits; ++num_fits) {
+    fitAndValidate(max_theta);
+    if (max_refined_error_ <= kMaxRefinedError) {
+      break;
+    }
+    max_theta *= kRangeShrinkFactor;
+  }
+  if (!(max_refined_error_ <= kMaxRefinedError)) {
+    LOG(WARNING) << "Failed to fit the inverse of the distortion "
+                 << distortion_coefficients.transpose() << ", it is inverted iteratively.";
+    return;
+  }
+  is_valid_ = true;
+  VLOG(3) << "Fitted the inverse equidistant distortion up to " << max_theta_
+          << " rad with a max. error of " << max_fit_error_ << " rad (" << max_refined_error_
+          << " rad after refinement) in " << num_fits + 1 << " fits.";
+}
+
+bool EquidistantInversePolynomial::invert(double theta_d, double* out_theta) const {
+  CHECK_NOTNULL(out_theta);
+  if (!is_valid_) {
+    return false;
+  }
+  return invertWithinRange(theta_d, out_theta);
+}
+
+bool EquidistantInversePolynomial::invertWithinRange(double theta_d, double* out_theta) const {
+  DCHECK_NOTNULL(out_theta);
+  if (!(theta_d >= 0.0 && theta_d <= max_theta_d_)) {
+    return false;
+  }
+  double theta = evaluatePolynomial(theta_d);
+  double derivative;
+  for (int i = 0; i < kNumRefinementSteps; ++i) {
+    const double error = distortTheta(theta, &derivative) - theta_d;
+    theta = std::min(std::max(theta - error / derivative, 0.0), max_theta_);
+  }
+  *out_theta = theta;
+  return true;
+}
+
+void EquidistantInversePolynomial::fitAndValidate(double max_theta) {
+  double derivative;
+  max_theta_ = max_theta;
+  max_theta_d_ = distortTheta(max_theta_, &derivative);
+  segment_width_ = max_theta_d_ / kNumSegments;
+  inverse_segment_width_ = 1.0 / segment_width_;
+
+  // The inverse and its slope at the segment ends define the cubic of each segment.
+  node_thetas_.resize(kNumSegments + 1);
+  node_slopes_.resize(kNumSegments + 1);
+  for (int i = 0; i <= kNumSegments; ++i) {
+    const double theta = i == kNumSegments ? max_theta_ : invertByBisection(i * segment_width_);
+    distortTheta(theta, &derivative);
+    node_thetas_[i] = theta;
+    node_slopes_[i] = segment_width_ / derivative;
+  }
+
+  max_fit_error_ = 0.0;
+  max_refined_error_ = 0.0;
+  const int num_validation_samples = kNumSegments * kNumValidationSamplesPerSegment;
+  for (int i = 0; i <= num_validation_samples; ++i) {
+    const double theta = max_theta_ * i / num_validation_samples;
+    const double theta_d = std::min(distortTheta(theta, &derivative), max_theta_d_);
+    double refined_theta;
+    if (!invertWithinRange(theta_d, &refined_theta)) {
+      // Only happens for non-finite coefficients.
+      max_fit_error_ = max_refined_error_ = std::numeric_limits<double>::infinity();
+      return;
+    }
+    max_fit_error_ = std::max(max_fit_error_, std::abs(evaluatePolynomial(theta_d) - theta));
+    max_refined_error_ = std::max(max_refined_error_, std::abs(refined_theta - theta));
+  }
+}
+
+double EquidistantInversePolynomial::evaluatePolynomial(double theta_d) const {
+  DCHECK_GE(theta_d, 0.0);
+  DCHECK_LE(theta_d, max_theta_d_);
+  const double u = theta_d * inverse_segment_width_;
+  const int segment = std::min(static_cast<int>(u), kNumSegments - 1);
+  const double t = u - segment;
+  const double t2 = t * t;
+  const double t3 = t2 * t;
+  // Cubic Hermite basis functions.
+  const double h00 = 2.0 * t3 - 3.0 * t2 + 1.0;
+  const double h10 = t3 - 2.0 * t2 + t;
+  const double h01 = -2.0 * t3 + 3.0 * t2;
+  const double h11 = t3 - t2;
+  return h00 * node_thetas_[segment] + h10 * node_slopes_[segment] +
+         h01 * node_thetas_[segment + 1] + h11 * node_slopes_[segment + 1];
+}
+
+double EquidistantInversePolynomial::invertByBisection(double theta_d) const {
+  double lower = 0.0;
+  double upper = max_theta_;
+  double derivative;
+  for (int i = 0; i < kNumBisectionSteps; ++i) {
+    const double theta = 0.5 * (lower + upper);
+    if (distortTheta(theta, &derivative) < theta_d) {
+      lower = theta;
+    } else {
+      upper = theta;
+    }
+  }
+  return 0.5 * (lower + upper);
+}
+
+double EquidistantInversePolynomial::distortTheta(double theta, double* out_derivative) const {
+  DCHECK_NOTNULL(out_derivative);
+  const double k1 = distortion_coefficients_(0);
+  const double k2 = distortion_coefficients_(1);
+  const double k3 = distortion_coefficients_(2);
+  const double k4 = distortion_coefficients_(3);
+  const double theta2 = theta * theta;
+  const double theta4 = theta2 * theta2;
+  const double theta6 = theta2 * theta4;
+  const double theta8 = theta4 * theta4;
+  *out_derivative = 1.0 + 3.0 * k1 * theta2 + 5.0 * k2 * theta4 + 7.0 * k3 * theta6 +
+                    9.0 * k4 * theta8;
+  return theta * (1.0 + k1 * theta2 + k2 * theta4 + k3 * theta6 + k4 * theta8);
+}
+
+}  // namespace aslam
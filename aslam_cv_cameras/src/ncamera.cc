@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -12,10 +20,82 @@
 #include <aslam/cameras/random-camera-generator.h>
 #include <aslam/common/pose-types.h>
 #include <aslam/common/predicates.h>
+#include <aslam/common/thread-pool.h>
 #include <aslam/common/unique-id.h>
 #include <aslam/common/yaml-serialization.h>
 
 namespace aslam {
+namespace {
+// Number of samples per image border used to bound the field of view of a camera.
+constexpr int kNumFieldOfViewSamplesPerBorder = 32;
+// Angle added to the bounded field of view for numerical safety [rad].
+constexpr double kFieldOfViewMargin = 1e-3;
+
+// Computes the cosine of the half opening angle of a cone around the optical axis that
+// contains the bearing vectors of all pixels. As the angle to the optical axis has no maximum
+// inside of the image, it is bounded by back-projecting samples of the image border. The angle
+// between neighboring samples is added to account for the border in between. Returns -1, i.e.
+// a cone containing all directions, if the bound is not applicable.
+double computeFieldOfViewCosine(const Camera& camera) {
+  // The image of a lidar wraps around, its border does not bound the field of view.
+  if (camera.getType() == Camera::Type::kLidar3D) {
+    return -1.0;
+  }
+  const double width = static_cast<double>(camera.imageWidth());
+  const double height = static_cast<double>(camera.imageHeight());
+  const int num_samples = kNumFieldOfViewSamplesPerBorder;
+  Eigen::Matrix2Xd border_keypoints(2, 4 * num_samples);
+  for (int i = 0; i < num_samples; ++i) {
+    const double fraction = static_cast<double>(i) / num_samples;
+    border_keypoints.col(i) << fraction * width, 0.0;
+    border_keypoints.col(num_samples + i) << width, fraction * height;
+    border_keypoints.col(2 * num_samples + i) << (1.0 - fraction) * width, height;
+    border_keypoints.col(3 * num_samples + i) << 0.0, (1.0 - fraction) * height;
+  }
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  camera.backProject3Vectorized(border_keypoints, &bearings, &success);
+
+  const int num_border_samples = static_cast<int>(border_keypoints.cols());
+  double max_angle = 0.0;
+  double max_sample_spacing = 0.0;
+  for (int i = 0; i < num_border_samples; ++i) {
+    const int next = (i + 1) % num_border_samples;
+    if (!success[i] || bearings.col(i).squaredNorm() == 0.0) {
+      return -1.0;
+    }
+    const Eigen::Vector3d bearing = bearings.col(i).normalized();
+    const Eigen::Vector3d next_bearing = bearings.col(next).normalized();
+    max_angle = std::max(max_angle, std::acos(std::min(std::max(bearing.z(), -1.0), 1.0)));
+    max_sample_spacing = std::max(
+        max_sample_spacing,
+        std::acos(std::min(std::max(bearing.dot(next_bearing), -1.0), 1.0)));
+  }
+  const double cone_angle = max_angle + max_sample_spacing + kFieldOfViewMargin;
+  return cone_angle >= M_PI ? -1.0 : std::cos(cone_angle);
+}
+
+// Workers shared by all rig projections. Recreated if a projection asks for a different number
+// of threads.
+std::shared_ptr<ThreadPool> getProjectionThreadPool(const size_t num_workers) {
+  static std::mutex mutex;
+  static std::shared_ptr<ThreadPool> thread_pool;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!thread_pool || thread_pool->numThreads() != num_workers) {
+    thread_pool = std::make_shared<ThreadPool>(num_workers);
+  }
+  return thread_pool;
+}
+}  // namespace
+
+bool NCamera::FieldOfViewBound::isComputedFor(const Camera& other_camera) const {
+  return camera == &other_camera && camera_type == other_camera.getType() &&
+         image_width == other_camera.imageWidth() &&
+         image_height == other_camera.imageHeight() &&
+         intrinsics == other_camera.getParameters() &&
+         distortion_type == other_camera.getDistortion().getType() &&
+         distortion_parameters == other_camera.getDistortion().getParameters();
+}
 
 /// Methods to clone this instance. All contained camera objects are cloned.
 NCamera* NCamera::clone() const {
@@ -345,6 +425,119 @@ aslam::NCamera::Ptr NCamera::cloneRigWithoutDistortion() const {
   return rig_without_distortion;
 }
 
+void NCamera::projectToAllCameras(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_B, size_t num_threads,
+    std::vector<CameraProjections>* projections) const {
+  CHECK_NOTNULL(projections);
+  const size_t num_cameras = cameras_.size();
+  projections->resize(num_cameras);
+  if (num_threads == 0u) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  num_threads = std::min(num_threads, num_cameras);
+
+  std::atomic<size_t> next_camera_index(0u);
+  auto project_to_cameras = [&]() {
+    for (size_t camera_index = next_camera_index++; camera_index < num_cameras;
+         camera_index = next_camera_index++) {
+      projectToCamera(camera_index, points_B, &(*projections)[camera_index]);
+    }
+  };
+  if (num_threads <= 1u) {
+    project_to_cameras();
+    return;
+  }
+  const std::shared_ptr<ThreadPool> thread_pool = getProjectionThreadPool(num_threads - 1u);
+  std::vector<std::future<void>> workers_done;
+  for (size_t thread_index = 1u; thread_index < num_threads; ++thread_index) {
+    workers_done.emplace_back(thread_pool->enqueue(project_to_cameras));
+  }
+  project_to_cameras();
+  for (std::future<void>& worker_done : workers_done) {
+    worker_done.wait();
+  }
+}
+
+double NCamera::getFieldOfViewCosine(size_t camera_index) const {
+  CHECK_LT(camera_index, cameras_.size());
+  const Camera& camera = *CHECK_NOTNULL(cameras_[camera_index].get());
+  {
+    std::lock_guard<std::mutex> lock(field_of_view_bounds_mutex_);
+    if (camera_index < field_of_view_bounds_.size() &&
+        field_of_view_bounds_[camera_index].isComputedFor(camera)) {
+      return field_of_view_bounds_[camera_index].cosine;
+    }
+  }
+
+  // The cameras are only read here, so computing the bound outside of the lock is safe.
+  FieldOfViewBound bound;
+  bound.camera = &camera;
+  bound.camera_type = camera.getType();
+  bound.image_width = camera.imageWidth();
+  bound.image_height = camera.imageHeight();
+  bound.intrinsics = camera.getParameters();
+  bound.distortion_type = camera.getDistortion().getType();
+  bound.distortion_parameters = camera.getDistortion().getParameters();
+  bound.cosine = computeFieldOfViewCosine(camera);
+
+  std::lock_guard<std::mutex> lock(field_of_view_bounds_mutex_);
+  if (field_of_view_bounds_.size() < cameras_.size()) {
+    field_of_view_bounds_.resize(cameras_.size());
+  }
+  field_of_view_bounds_[camera_index] = bound;
+  return bound.cosine;
+}
+
+void NCamera::projectToCamera(
+    size_t camera_index, const Eigen::Ref<const Eigen::Matrix3Xd>& points_B,
+    CameraProjections* projections) const {
+  CHECK_LT(camera_index, cameras_.size());
+  CHECK_NOTNULL(projections);
+  const Camera& camera = *CHECK_NOTNULL(cameras_[camera_index].get());
+  const Transformation& T_C_B = T_C_B_[camera_index];
+  const int num_points = static_cast<int>(points_B.cols());
+
+  const Eigen::Matrix3Xd points_C =
+      (T_C_B.getRotationMatrix() * points_B).colwise() + T_C_B.getPosition();
+
+  // Cull the points outside of the field of view.
+  const double field_of_view_cosine = getFieldOfViewCosine(camera_index);
+  projections->keypoints.setZero(2, num_points);
+  projections->projection_results.assign(num_points, ProjectionResult());
+  projections->visible_indices.clear();
+  std::vector<int> candidate_indices;
+  candidate_indices.reserve(num_points);
+  for (int i = 0; i < num_points; ++i) {
+    const double z = points_C(2, i);
+    if (z >= field_of_view_cosine * points_C.col(i).norm()) {
+      candidate_indices.push_back(i);
+    } else {
+      projections->projection_results[i] = z > 0.0
+          ? ProjectionResult(ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX)
+          : ProjectionResult(ProjectionResult::Status::POINT_BEHIND_CAMERA);
+    }
+  }
+
+  const int num_candidates = static_cast<int>(candidate_indices.size());
+  Eigen::Matrix3Xd candidate_points_C(3, num_candidates);
+  for (int i = 0; i < num_candidates; ++i) {
+    candidate_points_C.col(i) = points_C.col(candidate_indices[i]);
+  }
+  Eigen::Matrix2Xd candidate_keypoints;
+  std::vector<ProjectionResult> candidate_results;
+  camera.project3Vectorized(candidate_points_C, &candidate_keypoints, &candidate_results);
+  CHECK_EQ(static_cast<int>(candidate_results.size()), num_candidates);
+
+  for (int i = 0; i < num_candidates; ++i) {
+    const int point_index = candidate_indices[i];
+    projections->keypoints.col(point_index) = candidate_keypoints.col(i);
+    projections->projection_results[point_index] = candidate_results[i];
+    if (candidate_results[i].isKeypointVisible()) {
+      projections->visible_indices.push_back(point_index);
+    }
+  }
+}
+
 bool NCamera::isValidImpl() const {
   for (const aslam::Camera::Ptr& camera : cameras_) {
     CHECK(camera);
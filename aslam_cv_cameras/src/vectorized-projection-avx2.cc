@@ -0,0 +1,60 @@
+// This translation unit is compiled with -mavx2 -mfma. Only call into it after
+// checking the CPU support with vectorized::isInstructionSetSupported().
+#include <aslam/cameras/vectorized-projection-kernels.h>
+
+#if !defined(__AVX2__)
+#error "This file must be compiled with AVX2 support."
+#endif
+
+namespace aslam {
+namespace vectorized {
+namespace internal {
+
+void project3Avx2(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    uint8_t* out_status) {
+  project3Batched<simd::Avx2Batch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_status);
+}
+
+void project3Avx2(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, float* out_keypoints,
+    uint8_t* out_status) {
+  project3Batched<simd::Avx2FloatBatch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_status);
+}
+
+int undistortAvx2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, double* points_2d,
+    uint8_t* out_converged) {
+  return undistortBatched<simd::Avx2Batch>(
+      parameters, max_iterations, tolerance, num_points, points_2d,
+      out_converged);
+}
+
+int undistortAvx2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, float* points_2d,
+    uint8_t* out_converged) {
+  return undistortBatched<simd::Avx2FloatBatch>(
+      parameters, max_iterations, tolerance, num_points, points_2d,
+      out_converged);
+}
+
+void projectLidarAvx2(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    double* out_ranges, uint8_t* out_status) {
+  projectLidarBlocks<simd::Avx2Batch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_ranges, out_status);
+}
+
+}  // namespace internal
+}  // namespace vectorized
+}  // namespace aslam
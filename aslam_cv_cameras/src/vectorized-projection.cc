@@ -0,0 +1,390 @@
+#include <aslam/cameras/vectorized-projection.h>
+
+#include <glog/logging.h>
+
+#include <aslam/cameras/distortion.h>
+#include <aslam/cameras/vectorized-projection-kernels.h>
+
+namespace aslam {
+namespace vectorized {
+namespace {
+bool isAvx2SupportedByCpu() {
+#if defined(ASLAM_CAMERAS_WITH_AVX2) && (defined(__GNUC__) || defined(__clang__))
+  static const bool kIsSupported =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return kIsSupported;
+#else
+  return false;
+#endif
+}
+}  // namespace
+
+InstructionSet getBestSupportedInstructionSet() {
+  static const InstructionSet kBestInstructionSet = []() {
+    if (isInstructionSetSupported(InstructionSet::kAvx2)) {
+      return InstructionSet::kAvx2;
+    }
+    if (isInstructionSetSupported(InstructionSet::kSse2)) {
+      return InstructionSet::kSse2;
+    }
+    return InstructionSet::kScalar;
+  }();
+  return kBestInstructionSet;
+}
+
+bool isInstructionSetSupported(InstructionSet instruction_set) {
+  switch (instruction_set) {
+    case InstructionSet::kScalar:
+      return true;
+    case InstructionSet::kSse2:
+#if defined(__SSE2__)
+      return true;
+#else
+      return false;
+#endif
+    case InstructionSet::kAvx2:
+      return isAvx2SupportedByCpu();
+  }
+  return false;
+}
+
+std::string instructionSetToString(InstructionSet instruction_set) {
+  switch (instruction_set) {
+    case InstructionSet::kScalar:
+      return "Scalar";
+    case InstructionSet::kSse2:
+      return "SSE2";
+    case InstructionSet::kAvx2:
+      return "AVX2";
+  }
+  return "Unknown";
+}
+
+void ProjectionParameters::setDistortion(const aslam::Distortion& distortion) {
+  static_assert(
+      static_cast<int>(DistortionModel::kNoDistortion) ==
+              static_cast<int>(aslam::Distortion::Type::kNoDistortion) &&
+          static_cast<int>(DistortionModel::kEquidistant) ==
+              static_cast<int>(aslam::Distortion::Type::kEquidistant) &&
+          static_cast<int>(DistortionModel::kFisheye) ==
+              static_cast<int>(aslam::Distortion::Type::kFisheye) &&
+          static_cast<int>(DistortionModel::kRadTan) ==
+              static_cast<int>(aslam::Distortion::Type::kRadTan),
+      "The distortion models must match aslam::Distortion::Type.");
+  distortion_model = static_cast<DistortionModel>(distortion.getType());
+
+  const Eigen::VectorXd& coefficients = distortion.getParameters();
+  CHECK_LE(coefficients.size(), kMaxNumDistortionParameters);
+  for (int i = 0; i < kMaxNumDistortionParameters; ++i) {
+    this->distortion[i] = i < coefficients.size() ? coefficients(i) : 0.0;
+  }
+}
+
+namespace {
+// Shared by the double and float entry points.
+template <typename Scalar>
+void project3Dispatch(
+    const ProjectionParameters& parameters, const Scalar* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    Scalar* out_keypoints, uint8_t* out_status) {
+  CHECK_GE(num_points, 0);
+  if (num_points == 0) {
+    return;
+  }
+  CHECK_NOTNULL(points_3d);
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_status);
+  CHECK_GE(points_stride, 3);
+  CHECK(isInstructionSetSupported(instruction_set))
+      << "The instruction set " << instructionSetToString(instruction_set)
+      << " is not supported on this machine.";
+
+  switch (instruction_set) {
+    case InstructionSet::kScalar:
+      internal::project3Scalar(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+    case InstructionSet::kSse2:
+      internal::project3Sse2(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+    case InstructionSet::kAvx2:
+      internal::project3Avx2(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_status);
+      break;
+  }
+}
+
+template <typename Scalar>
+int undistortDispatch(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, InstructionSet instruction_set,
+    Scalar* points_2d, uint8_t* out_converged) {
+  typedef ProjectionParameters::DistortionModel DistortionModel;
+  CHECK(
+      parameters.distortion_model == DistortionModel::kRadTan ||
+      parameters.distortion_model == DistortionModel::kEquidistant)
+      << "Only the iteratively inverted distortion models are supported.";
+  CHECK_GT(max_iterations, 0);
+  CHECK_GE(num_points, 0);
+  if (num_points == 0) {
+    return 0;
+  }
+  CHECK_NOTNULL(points_2d);
+  CHECK(isInstructionSetSupported(instruction_set))
+      << "The instruction set " << instructionSetToString(instruction_set)
+      << " is not supported on this machine.";
+
+  switch (instruction_set) {
+    case InstructionSet::kScalar:
+      return internal::undistortScalar(
+          parameters, max_iterations, tolerance, num_points, points_2d,
+          out_converged);
+    case InstructionSet::kSse2:
+      return internal::undistortSse2(
+          parameters, max_iterations, tolerance, num_points, points_2d,
+          out_converged);
+    case InstructionSet::kAvx2:
+      return internal::undistortAvx2(
+          parameters, max_iterations, tolerance, num_points, points_2d,
+          out_converged);
+  }
+  return 0;
+}
+}  // namespace
+
+void project3(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    double* out_keypoints, uint8_t* out_status) {
+  project3Dispatch(
+      parameters, points_3d, points_stride, num_points, instruction_set,
+      out_keypoints, out_status);
+}
+
+void project3(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    float* out_keypoints, uint8_t* out_status) {
+  project3Dispatch(
+      parameters, points_3d, points_stride, num_points, instruction_set,
+      out_keypoints, out_status);
+}
+
+int undistort(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, InstructionSet instruction_set,
+    double* points_2d, uint8_t* out_converged) {
+  return undistortDispatch(
+      parameters, max_iterations, tolerance, num_points, instruction_set,
+      points_2d, out_converged);
+}
+
+int undistort(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, InstructionSet instruction_set,
+    float* points_2d, uint8_t* out_converged) {
+  return undistortDispatch(
+      parameters, max_iterations, tolerance, num_points, instruction_set,
+      points_2d, out_converged);
+}
+
+void projectLidar(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, InstructionSet instruction_set,
+    double* out_keypoints, double* out_ranges, uint8_t* out_status) {
+  CHECK_GE(num_points, 0);
+  if (num_points == 0) {
+    return;
+  }
+  CHECK_NOTNULL(points_3d);
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_ranges);
+  CHECK_NOTNULL(out_status);
+  CHECK_GE(points_stride, 3);
+  CHECK_GT(parameters.horizontal_resolution, 0.0);
+  CHECK_GT(parameters.vertical_resolution, 0.0);
+  CHECK(isInstructionSetSupported(instruction_set))
+      << "The instruction set " << instructionSetToString(instruction_set)
+      << " is not supported on this machine.";
+
+  switch (instruction_set) {
+    case InstructionSet::kScalar:
+      internal::projectLidarScalar(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_ranges, out_status);
+      break;
+    case InstructionSet::kSse2:
+      internal::projectLidarSse2(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_ranges, out_status);
+      break;
+    case InstructionSet::kAvx2:
+      internal::projectLidarAvx2(
+          parameters, points_3d, points_stride, num_points, out_keypoints,
+          out_ranges, out_status);
+      break;
+  }
+}
+
+namespace internal {
+void project3Scalar(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    uint8_t* out_status) {
+  project3Batched<simd::ScalarBatch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_status);
+}
+
+void project3Scalar(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, float* out_keypoints,
+    uint8_t* out_status) {
+  project3Batched<simd::ScalarFloatBatch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_status);
+}
+
+void project3Sse2(
+    const ProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    uint8_t* out_status) {
+#if defined(__SSE2__)
+  project3Batched<simd::Sse2Batch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_status);
+#else
+  LOG(FATAL) << "The library was compiled without SSE2 support.";
+#endif
+}
+
+void project3Sse2(
+    const ProjectionParameters& parameters, const float* points_3d,
+    int points_stride, int num_points, float* out_keypoints,
+    uint8_t* out_status) {
+#if defined(__SSE2__)
+  project3Batched<simd::Sse2FloatBatch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_status);
+#else
+  LOG(FATAL) << "The library was compiled without SSE2 support.";
+#endif
+}
+
+int undistortScalar(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, double* points_2d,
+    uint8_t* out_converged) {
+  return undistortBatched<simd::ScalarBatch>(
+      parameters, max_iterations, tolerance, num_points, points_2d,
+      out_converged);
+}
+
+int undistortScalar(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, float* points_2d,
+    uint8_t* out_converged) {
+  return undistortBatched<simd::ScalarFloatBatch>(
+      parameters, max_iterations, tolerance, num_points, points_2d,
+      out_converged);
+}
+
+int undistortSse2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, double* points_2d,
+    uint8_t* out_converged) {
+#if defined(__SSE2__)
+  return undistortBatched<simd::Sse2Batch>(
+      parameters, max_iterations, tolerance, num_points, points_2d,
+      out_converged);
+#else
+  LOG(FATAL) << "The library was compiled without SSE2 support.";
+  return 0;
+#endif
+}
+
+int undistortSse2(
+    const ProjectionParameters& parameters, int max_iterations,
+    double tolerance, int num_points, float* points_2d,
+    uint8_t* out_converged) {
+#if defined(__SSE2__)
+  return undistortBatched<simd::Sse2FloatBatch>(
+      parameters, max_iterations, tolerance, num_points, points_2d,
+      out_converged);
+#else
+  LOG(FATAL) << "The library was compiled without SSE2 support.";
+  return 0;
+#endif
+}
+
+void projectLidarScalar(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    double* out_ranges, uint8_t* out_status) {
+  projectLidarBlocks<simd::ScalarBatch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_ranges, out_status);
+}
+
+void projectLidarSse2(
+    const LidarProjectionParameters& parameters, const double* points_3d,
+    int points_stride, int num_points, double* out_keypoints,
+    double* out_ranges, uint8_t* out_status) {
+#if defined(__SSE2__)
+  projectLidarBlocks<simd::Sse2Batch>(
+      parameters, points_3d, points_stride, num_points, out_keypoints,
+      out_ranges, out_status);
+#else
+  LOG(FATAL) << "The library was compiled without SSE2 support.";
+#endif
+}
+
+#if !defined(ASLAM_CAMERAS_WITH_AVX2)
+// The AVX2 kernel lives in its own translation unit which is only compiled on
+// x86 targets.
+void project3Avx2(
+    const ProjectionParameters& /*parameters*/, const double* /*points_3d*/,
+    int /*points_stride*/, int /*num_points*/, double* /*out_keypoints*/,
+    uint8_t* /*out_status*/) {
+  LOG(FATAL) << "The library was compiled without AVX2 support.";
+}
+
+void project3Avx2(
+    const ProjectionParameters& /*parameters*/, const float* /*points_3d*/,
+    int /*points_stride*/, int /*num_points*/, float* /*out_keypoints*/,
+    uint8_t* /*out_status*/) {
+  LOG(FATAL) << "The library was compiled without AVX2 support.";
+}
+
+int undistortAvx2(
+    const ProjectionParameters& /*parameters*/, int /*max_iterations*/,
+    double /*tolerance*/, int /*num_points*/, double* /*points_2d*/,
+    uint8_t* /*out_converged*/) {
+  LOG(FATAL) << "The library was compiled without AVX2 support.";
+  return 0;
+}
+
+int undistortAvx2(
+    const ProjectionParameters& /*parameters*/, int /*max_iterations*/,
+    double /*tolerance*/, int /*num_points*/, float* /*points_2d*/,
+    uint8_t* /*out_converged*/) {
+  LOG(FATAL) << "The library was compiled without AVX2 support.";
+  return 0;
+}
+
+void projectLidarAvx2(
+    const LidarProjectionParameters& /*parameters*/,
+    const double* /*points_3d*/, int /*points_stride*/, int /*num_points*/,
+    double* /*out_keypoints*/, double* /*out_ranges*/,
+    uint8_t* /*out_status*/) {
+  LOG(FATAL) << "The library was compiled without AVX2 support.";
+}
+#endif
+}  // namespace internal
+
+}  // namespace vectorized
+}  // namespace aslam
@@ -2,7 +2,9 @@
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <random>
 #include <typeinfo>
+#include <vector>
 
 #include <aslam/cameras/camera-3d-lidar.h>
 #include <aslam/cameras/camera-factory.h>
@@ -179,6 +181,43 @@ TYPED_TEST(TestCameras, CameraTest_isInvertible) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(points1, points3, 1e-6));
 }
 
+TYPED_TEST(TestCameras, SinglePrecisionProjectionMatchesDoublePrecision) {
+  const int N = 1000;
+  Eigen::Matrix3Xf points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) =
+        this->camera_->createRandomVisiblePoint(1.0 + n % 50).template cast<float>();
+  }
+  points.col(0).setZero();
+
+  Eigen::Matrix2Xd expected_keypoints;
+  std::vector<aslam::ProjectionResult> expected_results;
+  this->camera_->project3Vectorized(
+      points.cast<double>(), &expected_keypoints, &expected_results);
+
+  Eigen::Matrix2Xf keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points, &keypoints, &results);
+  ASSERT_EQ(N, keypoints.cols());
+  ASSERT_EQ(static_cast<size_t>(N), results.size());
+  for (int n = 0; n < N; ++n) {
+    // The visibility of keypoints on the image border depends on rounding.
+    const Eigen::Vector2d& keypoint = expected_keypoints.col(n);
+    const double kBorderMarginPx = 1e-2;
+    if (this->camera_->isKeypointVisibleWithMargin(keypoint, -kBorderMarginPx) &&
+        !this->camera_->isKeypointVisibleWithMargin(keypoint, kBorderMarginPx)) {
+      continue;
+    }
+    ASSERT_EQ(
+        expected_results[n].getDetailedStatus(), results[n].getDetailedStatus())
+        << "Point " << n << ": " << points.col(n).transpose();
+    if (expected_results[n].isKeypointVisible()) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+          expected_keypoints.col(n), keypoints.col(n).cast<double>(), 1e-3));
+    }
+  }
+}
+
 TYPED_TEST(TestCameras, TestClone) {
   aslam::Camera::Ptr cam1(this->camera_->clone());
 
@@ -259,4 +298,134 @@ TYPED_TEST(TestCameras, YamlSerialization) {
   EXPECT_TRUE(camera->isEqual(*this->camera_.get(), true));
 }
 
+TEST(TestCamera3DLidar, VectorizedProjectionMatchesProject3) {
+  aslam::Camera3DLidar::Ptr camera = aslam::Camera3DLidar::createTestCamera();
+  const int kNumPoints = 10000;
+  const double width = camera->imageWidth();
+  Eigen::Matrix3Xd points_3d = Eigen::Matrix3Xd::Random(3, kNumPoints) * 50.0;
+  points_3d.col(0).setZero();
+
+  const double kMaxAngularError = 1.2e-5;
+  const aslam::vectorized::InstructionSet kInstructionSets[] = {
+      aslam::vectorized::InstructionSet::kScalar,
+      aslam::vectorized::InstructionSet::kSse2,
+      aslam::vectorized::InstructionSet::kAvx2};
+  for (const aslam::vectorized::InstructionSet instruction_set :
+       kInstructionSets) {
+    if (!aslam::vectorized::isInstructionSetSupported(instruction_set)) {
+      continue;
+    }
+    Eigen::Matrix2Xd keypoints(2, kNumPoints);
+    Eigen::VectorXd ranges(kNumPoints);
+    std::vector<uint8_t> status(kNumPoints);
+    aslam::vectorized::projectLidar(
+        camera->getVectorizedProjectionParameters(), points_3d.data(), 3,
+        kNumPoints, instruction_set, keypoints.data(), ranges.data(),
+        status.data());
+
+    EXPECT_EQ(
+        status[0], static_cast<uint8_t>(
+                       aslam::ProjectionResult::Status::PROJECTION_INVALID));
+    for (int i = 1; i < kNumPoints; ++i) {
+      Eigen::Vector2d expected_keypoint;
+      const aslam::ProjectionResult result =
+          camera->project3(points_3d.col(i), &expected_keypoint);
+      EXPECT_NEAR(ranges(i), points_3d.col(i).norm(), 1e-9);
+
+      // The azimuth wraps around at the image border.
+      const double du = std::abs(keypoints(0, i) - expected_keypoint(0));
+      EXPECT_LT(
+          std::min(du, width - du),
+          kMaxAngularError / camera->horizontalResolution());
+      EXPECT_NEAR(
+          keypoints(1, i), expected_keypoint(1),
+          kMaxAngularError / camera->verticalResolution());
+      if (expected_keypoint(1) > 0.01 &&
+          expected_keypoint(1) < camera->imageHeight() - 0.01) {
+        EXPECT_EQ(status[i], static_cast<uint8_t>(result.getDetailedStatus()))
+            << aslam::vectorized::instructionSetToString(instruction_set);
+      }
+    }
+  }
+}
+
+TEST(TestCamera3DLidar, RangeImageKeepsNearestReturn) {
+  aslam::Camera3DLidar::Ptr camera = aslam::Camera3DLidar::createTestCamera();
+  const int width = camera->imageWidth();
+  const int height = camera->imageHeight();
+
+  // Place up to three returns along the beam of every other pixel.
+  std::mt19937 random_engine(42);
+  std::uniform_real_distribution<float> range_distribution(1.0f, 100.0f);
+  std::vector<Eigen::Vector3d> points;
+  aslam::Camera3DLidar::RangeImage expected_ranges =
+      aslam::Camera3DLidar::RangeImage::Zero(height, width);
+  aslam::Camera3DLidar::IndexImage expected_indices =
+      aslam::Camera3DLidar::IndexImage::Constant(
+          height, width, aslam::Camera3DLidar::kNoReturnIndex);
+  for (int row = 0; row < height; ++row) {
+    for (int column = row % 2; column < width; column += 2) {
+      Eigen::Vector3d bearing;
+      ASSERT_TRUE(
+          camera->backProject3(Eigen::Vector2d(column, row), &bearing));
+      const int num_returns = 1 + (row + column) % 3;
+      for (int i = 0; i < num_returns; ++i) {
+        const float range = range_distribution(random_engine);
+        if (expected_indices(row, column) ==
+                aslam::Camera3DLidar::kNoReturnIndex ||
+            range < expected_ranges(row, column)) {
+          expected_ranges(row, column) = range;
+          expected_indices(row, column) = points.size();
+        }
+        points.emplace_back(bearing.normalized() * range);
+      }
+    }
+  }
+  // Invalid points must not show up in the image.
+  points.emplace_back(Eigen::Vector3d::Zero());
+
+  Eigen::Matrix3Xd points_3d(3, points.size());
+  for (size_t i = 0u; i < points.size(); ++i) {
+    points_3d.col(i) = points[i];
+  }
+
+  for (const size_t num_threads : {1u, 4u}) {
+    aslam::Camera3DLidar::RangeImage range_image;
+    aslam::Camera3DLidar::IndexImage index_image;
+    camera->projectScanToRangeImage(
+        points_3d, num_threads, &range_image, &index_image);
+    ASSERT_EQ(range_image.rows(), height);
+    ASSERT_EQ(range_image.cols(), width);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(range_image, expected_ranges, 1e-4));
+    EXPECT_TRUE(index_image == expected_indices);
+  }
+}
+
+TEST(TestCamera3DLidar, RangeImageIndependentOfThreadCount) {
+  aslam::Camera3DLidar::Ptr camera = aslam::Camera3DLidar::createTestCamera();
+  const int kNumPoints = 100000;
+  Eigen::Matrix3Xd points_3d = Eigen::Matrix3Xd::Random(3, kNumPoints) * 20.0;
+  // Duplicates with the same range compete for the same pixel.
+  points_3d.rightCols(kNumPoints / 2) = points_3d.leftCols(kNumPoints / 2);
+
+  aslam::Camera3DLidar::RangeImage reference_range_image;
+  aslam::Camera3DLidar::IndexImage reference_index_image;
+  camera->projectScanToRangeImage(
+      points_3d, 1u, &reference_range_image, &reference_index_image);
+  EXPECT_LT(reference_index_image.maxCoeff(), kNumPoints / 2);
+  EXPECT_GT(
+      (reference_index_image.array() != aslam::Camera3DLidar::kNoReturnIndex)
+          .count(),
+      0);
+
+  for (const size_t num_threads : {2u, 3u, 8u}) {
+    aslam::Camera3DLidar::RangeImage range_image;
+    aslam::Camera3DLidar::IndexImage index_image;
+    camera->projectScanToRangeImage(
+        points_3d, num_threads, &range_image, &index_image);
+    EXPECT_TRUE(range_image == reference_range_image);
+    EXPECT_TRUE(index_image == reference_index_image);
+  }
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 #include <typeinfo>
 
+#include <aslam/cameras/bearing-vector-lookup-table.h>
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/cameras/camera-pinhole.h>
@@ -310,6 +311,284 @@ TYPED_TEST(TestCameras, CameraTest_isInvertible) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(points1, points3, 1e-2));
 }
 
+TYPED_TEST(TestCameras, VectorizedProjectionMatchesScalarProjection) {
+  // Use a point count that is not a multiple of any batch or block size.
+  const int N = 1003;
+  Eigen::Matrix3Xd points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 50);
+  }
+  // Add points outside the image box, behind the camera and degenerate ones.
+  points.col(0) << 0.0, 0.0, 1.0;
+  points.col(1) << 0.0, 0.0, 0.0;
+  points.col(2) << 0.0, 0.0, -1.0;
+  points.col(3) << -10.0, -10.0, -10.0;
+  points.col(4) << 5000.0, -5.0, 1.0;
+  points.col(5) << 1.0, 1.0, 1e-12;
+  for (int n = 6; n < N; n += 7) {
+    points.col(n) *= -1.0;
+  }
+  for (int n = 9; n < N; n += 11) {
+    points.col(n).head<2>() *= 100.0;
+  }
+
+  Eigen::Matrix2Xd expected_keypoints(2, N);
+  std::vector<aslam::ProjectionResult> expected_results(N);
+  for (int n = 0; n < N; ++n) {
+    Eigen::Vector2d keypoint;
+    expected_results[n] = this->camera_->project3(points.col(n), &keypoint);
+    expected_keypoints.col(n) = keypoint;
+  }
+
+  const aslam::vectorized::InstructionSet kInstructionSets[] = {
+      aslam::vectorized::InstructionSet::kScalar,
+      aslam::vectorized::InstructionSet::kSse2,
+      aslam::vectorized::InstructionSet::kAvx2};
+  for (const aslam::vectorized::InstructionSet instruction_set :
+       kInstructionSets) {
+    if (!aslam::vectorized::isInstructionSetSupported(instruction_set)) {
+      continue;
+    }
+    SCOPED_TRACE(aslam::vectorized::instructionSetToString(instruction_set));
+    Eigen::Matrix2Xd keypoints;
+    std::vector<aslam::ProjectionResult> results;
+    this->camera_->project3Vectorized(
+        points, instruction_set, &keypoints, &results);
+    ASSERT_EQ(N, keypoints.cols());
+    ASSERT_EQ(static_cast<size_t>(N), results.size());
+    for (int n = 0; n < N; ++n) {
+      ASSERT_EQ(
+          expected_results[n].getDetailedStatus(),
+          results[n].getDetailedStatus()) << "Point " << n << ": "
+          << points.col(n).transpose();
+      if (expected_results[n].isKeypointVisible()) {
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+            expected_keypoints.col(n), keypoints.col(n), 1e-8));
+      }
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, SinglePrecisionProjectionMatchesDoublePrecision) {
+  const int N = 1003;
+  Eigen::Matrix3Xd points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 50);
+  }
+  points.col(0) << 0.0, 0.0, 1.0;
+  points.col(1) << 0.0, 0.0, 0.0;
+  points.col(2) << 0.0, 0.0, -1.0;
+  points.col(3) << 5000.0, -5.0, 1.0;
+  for (int n = 6; n < N; n += 7) {
+    points.col(n) *= -1.0;
+  }
+  const Eigen::Matrix3Xf points_float = points.cast<float>();
+
+  Eigen::Matrix2Xd expected_keypoints;
+  std::vector<aslam::ProjectionResult> expected_results;
+  this->camera_->project3Vectorized(
+      points_float.cast<double>(), &expected_keypoints, &expected_results);
+
+  const aslam::vectorized::InstructionSet kInstructionSets[] = {
+      aslam::vectorized::InstructionSet::kScalar,
+      aslam::vectorized::InstructionSet::kSse2,
+      aslam::vectorized::InstructionSet::kAvx2};
+  for (const aslam::vectorized::InstructionSet instruction_set :
+       kInstructionSets) {
+    if (!aslam::vectorized::isInstructionSetSupported(instruction_set)) {
+      continue;
+    }
+    SCOPED_TRACE(aslam::vectorized::instructionSetToString(instruction_set));
+    Eigen::Matrix2Xf keypoints;
+    std::vector<aslam::ProjectionResult> results;
+    this->camera_->project3Vectorized(
+        points_float, instruction_set, &keypoints, &results);
+    ASSERT_EQ(N, keypoints.cols());
+    ASSERT_EQ(static_cast<size_t>(N), results.size());
+    for (int n = 0; n < N; ++n) {
+      // The visibility of keypoints on the image border depends on rounding.
+      const Eigen::Vector2d& keypoint = expected_keypoints.col(n);
+      const double kBorderMarginPx = 1e-2;
+      if (this->camera_->isKeypointVisibleWithMargin(keypoint, -kBorderMarginPx) &&
+          !this->camera_->isKeypointVisibleWithMargin(keypoint, kBorderMarginPx)) {
+        continue;
+      }
+      ASSERT_EQ(
+          expected_results[n].getDetailedStatus(),
+          results[n].getDetailedStatus()) << "Point " << n << ": "
+          << points.col(n).transpose();
+      if (expected_results[n].isKeypointVisible()) {
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+            expected_keypoints.col(n), keypoints.col(n).cast<double>(), 1e-3));
+      }
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, SinglePrecisionBackProjectionMatchesDoublePrecision) {
+  const int N = 1003;
+  Eigen::Matrix2Xf keypoints(2, N);
+  for (int n = 0; n < N; ++n) {
+    keypoints.col(n) = this->camera_->createRandomKeypoint().template cast<float>();
+  }
+
+  Eigen::Matrix3Xd expected_points;
+  std::vector<unsigned char> expected_success;
+  this->camera_->backProject3Vectorized(
+      keypoints.cast<double>(), &expected_points, &expected_success);
+
+  Eigen::Matrix3Xf points;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(keypoints, &points, &success);
+  ASSERT_EQ(N, points.cols());
+  ASSERT_EQ(static_cast<size_t>(N), success.size());
+  for (int n = 0; n < N; ++n) {
+    ASSERT_EQ(expected_success[n], success[n]) << "Keypoint " << n << ": "
+        << keypoints.col(n).transpose();
+    if (!expected_success[n]) {
+      continue;
+    }
+    const double angle = std::acos(std::min(
+        1.0, expected_points.col(n).normalized().dot(
+                 points.col(n).cast<double>().normalized())));
+    EXPECT_LT(angle, 1e-5) << "Keypoint " << n << ": "
+        << keypoints.col(n).transpose();
+  }
+}
+
+TYPED_TEST(TestCameras, VectorizedJacobiansMatchProject3Functional) {
+  const int N = 200;
+  Eigen::Matrix3Xd points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(1.0 + n % 50);
+  }
+  points.col(0) << 0.0, 0.0, -1.0;
+  points.col(1) << 5000.0, -5.0, 1.0;
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_points, J_intrinsics, J_distortion;
+  this->camera_->project3VectorizedWithJacobians(
+      points, &keypoints, &results, &J_points, &J_intrinsics, &J_distortion);
+
+  const int num_intrinsics = this->camera_->getParameterSize();
+  const int num_distortion = this->camera_->getDistortion().getParameterSize();
+  ASSERT_EQ(N, keypoints.cols());
+  ASSERT_EQ(static_cast<size_t>(N), results.size());
+  ASSERT_EQ(3 * N, J_points.cols());
+  ASSERT_EQ(num_intrinsics * N, J_intrinsics.cols());
+  ASSERT_EQ(num_distortion * N, J_distortion.cols());
+
+  for (int n = 0; n < N; ++n) {
+    Eigen::Vector2d expected_keypoint;
+    Eigen::Matrix<double, 2, 3> expected_J_point;
+    Eigen::Matrix<double, 2, Eigen::Dynamic> expected_J_intrinsics, expected_J_distortion;
+    const aslam::ProjectionResult expected_result = this->camera_->project3Functional(
+        points.col(n), nullptr, nullptr, &expected_keypoint, &expected_J_point,
+        &expected_J_intrinsics, &expected_J_distortion);
+    ASSERT_EQ(expected_result.getDetailedStatus(), results[n].getDetailedStatus());
+    if (expected_result.getDetailedStatus() ==
+        aslam::ProjectionResult::Status::PROJECTION_INVALID) {
+      continue;
+    }
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(expected_keypoint, keypoints.col(n), 1e-12));
+    const Eigen::Matrix<double, 2, 3> J_point = J_points.middleCols(3 * n, 3);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(expected_J_point, J_point, 1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        expected_J_intrinsics, J_intrinsics.middleCols(num_intrinsics * n, num_intrinsics),
+        1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        expected_J_distortion, J_distortion.middleCols(num_distortion * n, num_distortion),
+        1e-9));
+  }
+
+  // The optional Jacobians can be skipped.
+  Eigen::Matrix2Xd keypoints_only;
+  this->camera_->project3VectorizedWithJacobians(
+      points, &keypoints_only, &results, &J_points, nullptr, nullptr);
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints, keypoints_only, 1e-12));
+}
+
+TYPED_TEST(TestCameras, BackProject3CachedAccuracy) {
+  // Max. angle between the interpolated and the exact bearing vectors. The
+  // interpolation error grows quadratically with the step of the table.
+  const std::vector<std::pair<double, double>> kStepAndMaxAngle = {
+      {0.5, 2e-5}, {1.0, 1e-4}, {2.0, 4e-4}};
+  const int kNumKeypoints = 1000;
+
+  Eigen::Matrix2Xd keypoints(2, kNumKeypoints);
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    keypoints.col(i) = this->camera_->createRandomKeypoint();
+  }
+  // Keypoints outside of the image fall back to the exact back-projection.
+  keypoints.col(0) << -10.0, 5.0;
+  keypoints.col(1) << this->camera_->imageWidth() + 0.5, 5.0;
+
+  for (const std::pair<double, double>& step_and_max_angle : kStepAndMaxAngle) {
+    this->camera_->setBearingLookupTableStep(step_and_max_angle.first);
+
+    Eigen::Matrix3Xd points_cached;
+    std::vector<unsigned char> success_cached;
+    this->camera_->backProject3CachedVectorized(
+        keypoints, &points_cached, &success_cached);
+    ASSERT_EQ(static_cast<size_t>(kNumKeypoints), success_cached.size());
+
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      Eigen::Vector3d point_exact;
+      const bool success_exact =
+          this->camera_->backProject3(keypoints.col(i), &point_exact);
+      Eigen::Vector3d point_cached;
+      ASSERT_EQ(
+          success_exact,
+          this->camera_->backProject3Cached(keypoints.col(i), &point_cached));
+      ASSERT_EQ(success_exact, static_cast<bool>(success_cached[i]));
+      if (!success_exact) {
+        continue;
+      }
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(point_cached, points_cached.col(i), 1e-12));
+      const double angle = std::acos(std::min(
+          1.0, point_cached.normalized().dot(point_exact.normalized())));
+      EXPECT_LT(angle, step_and_max_angle.second)
+          << "Keypoint: " << keypoints.col(i).transpose()
+          << ", step: " << step_and_max_angle.first;
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, BackProject3CachedInvalidation) {
+  const Eigen::Vector2d keypoint(100.3, 200.7);
+  Eigen::Vector3d point_cached;
+  Eigen::Vector3d point_exact;
+
+  std::shared_ptr<const aslam::BearingVectorLookupTable> lookup_table =
+      this->camera_->getBearingLookupTable();
+  ASSERT_TRUE(lookup_table != nullptr);
+  EXPECT_EQ(lookup_table, this->camera_->getBearingLookupTable());
+
+  // Changing the intrinsics invalidates the table.
+  Eigen::VectorXd intrinsics = this->camera_->getParameters();
+  intrinsics *= 1.1;
+  this->camera_->setParameters(intrinsics);
+  EXPECT_NE(lookup_table, this->camera_->getBearingLookupTable());
+  ASSERT_TRUE(this->camera_->backProject3Cached(keypoint, &point_cached));
+  ASSERT_TRUE(this->camera_->backProject3(keypoint, &point_exact));
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(point_cached, point_exact, 1e-4));
+
+  // So does changing the distortion.
+  lookup_table = this->camera_->getBearingLookupTable();
+  this->camera_->removeDistortion();
+  EXPECT_NE(lookup_table, this->camera_->getBearingLookupTable());
+  ASSERT_TRUE(this->camera_->backProject3Cached(keypoint, &point_cached));
+  ASSERT_TRUE(this->camera_->backProject3(keypoint, &point_exact));
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(point_cached, point_exact, 1e-4));
+
+  // And changing the step.
+  lookup_table = this->camera_->getBearingLookupTable();
+  this->camera_->setBearingLookupTableStep(0.5);
+  lookup_table = this->camera_->getBearingLookupTable();
+  EXPECT_EQ(0.5, lookup_table->getStepPx());
+}
+
 TYPED_TEST(TestCameras, TestClone) {
   aslam::Camera::Ptr cam1(this->camera_->clone());
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
@@ -10,6 +12,7 @@
 #include <aslam/cameras/distortion-null.h>
 #include <aslam/cameras/distortion-radtan.h>
 #include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/vectorized-projection.h>
 #include <aslam/common/numdiff-jacobian-tester.h>
 
 ///////////////////////////////////////////////
@@ -142,6 +145,33 @@ struct Point3dJacobianFunctor : public aslam::common::NumDiffFunctor<2, 2> {
   const Eigen::VectorXd dist_coeffs_;
 };
 
+TYPED_TEST(TestDistortions, UndistortVectorized) {
+  // Use a point count that is not a multiple of any batch or block size.
+  const int kNumPoints = 1003;
+  Eigen::Matrix2Xd keypoints = 5 * Eigen::Matrix2Xd::Random(2, kNumPoints);
+  keypoints.col(0).setZero();
+  keypoints.col(1) << 1e-4, -1e-4;
+
+  Eigen::Matrix2Xd distorted_keypoints(2, kNumPoints);
+  for (int i = 0; i < kNumPoints; ++i) {
+    Eigen::Vector2d keypoint = keypoints.col(i);
+    this->distortion_->distort(&keypoint);
+    distorted_keypoints.col(i) = keypoint;
+  }
+
+  Eigen::Matrix2Xd undistorted_keypoints = distorted_keypoints;
+  std::vector<unsigned char> converged;
+  EXPECT_EQ(0, this->distortion_->undistortVectorized(&undistorted_keypoints, &converged));
+  ASSERT_EQ(static_cast<size_t>(kNumPoints), converged.size());
+  for (int i = 0; i < kNumPoints; ++i) {
+    EXPECT_TRUE(converged[i]);
+    Eigen::Vector2d keypoint = distorted_keypoints.col(i);
+    this->distortion_->undistort(&keypoint);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(undistorted_keypoints.col(i), keypoint, 1e-5));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(undistorted_keypoints.col(i), keypoints.col(i), 1e-5));
+  }
+}
+
 TYPED_TEST(TestDistortions, JacobianWrtKeypoint) {
   Eigen::Vector2d keypoint(0.3, -0.2);
   Eigen::VectorXd dist_coeffs = this->distortion_->getParameters();
@@ -199,6 +229,171 @@ TYPED_TEST(TestDistortionsNotNull, JacobianWrtDistortion) {
 ///////
 // Test parameters
 ///////
+TEST(TestDistortionsVectorized, UndistortReportsNonConvergedPoints) {
+  const aslam::Distortion::Ptr distortions[] = {
+      aslam::RadTanDistortion::createTestDistortion(),
+      aslam::EquidistantDistortion::createTestDistortion()};
+  const aslam::vectorized::InstructionSet kInstructionSets[] = {
+      aslam::vectorized::InstructionSet::kScalar,
+      aslam::vectorized::InstructionSet::kSse2,
+      aslam::vectorized::InstructionSet::kAvx2};
+
+  const int kNumPoints = 101;
+  for (const aslam::Distortion::Ptr& distortion : distortions) {
+    aslam::vectorized::ProjectionParameters parameters;
+    parameters.setDistortion(*distortion);
+
+    Eigen::Matrix2Xd keypoints = 2 * Eigen::Matrix2Xd::Random(2, kNumPoints);
+    for (int i = 0; i < kNumPoints; ++i) {
+      Eigen::Vector2d keypoint = keypoints.col(i);
+      distortion->distort(&keypoint);
+      keypoints.col(i) = keypoint;
+    }
+
+    for (const aslam::vectorized::InstructionSet instruction_set : kInstructionSets) {
+      if (!aslam::vectorized::isInstructionSetSupported(instruction_set)) {
+        continue;
+      }
+      SCOPED_TRACE(aslam::vectorized::instructionSetToString(instruction_set));
+
+      // A single iteration is not enough for the points far from the image center.
+      Eigen::Matrix2Xd single_iteration_keypoints = keypoints;
+      std::vector<uint8_t> converged(kNumPoints);
+      const int num_not_converged = aslam::vectorized::undistort(
+          parameters, 1, FLAGS_acv_inv_distortion_tolerance, kNumPoints, instruction_set,
+          single_iteration_keypoints.data(), converged.data());
+      EXPECT_GT(num_not_converged, 0);
+      EXPECT_EQ(num_not_converged, std::count(converged.begin(), converged.end(), 0u));
+
+      // The converged lanes must not be changed by the additional iterations.
+      Eigen::Matrix2Xd undistorted_keypoints = keypoints;
+      EXPECT_EQ(0, aslam::vectorized::undistort(
+          parameters, 30, FLAGS_acv_inv_distortion_tolerance, kNumPoints, instruction_set,
+          undistorted_keypoints.data(), nullptr));
+      for (int i = 0; i < kNumPoints; ++i) {
+        if (converged[i]) {
+          EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+              single_iteration_keypoints.col(i), undistorted_keypoints.col(i), 1e-12));
+        }
+      }
+    }
+  }
+}
+
+TEST(TestEquidistantInversePolynomial, UndistortionMatchesDistortion) {
+  aslam::EquidistantDistortion::Ptr distortion =
+      aslam::EquidistantDistortion::createTestDistortion();
+  const aslam::EquidistantInversePolynomial::ConstPtr inverse_polynomial =
+      distortion->getInversePolynomial();
+  ASSERT_TRUE(inverse_polynomial);
+  EXPECT_TRUE(inverse_polynomial->isValid());
+  EXPECT_TRUE(inverse_polynomial->isFitFor(distortion->getParameters()));
+  LOG(INFO) << "Max. error of the inverse polynomial: " << inverse_polynomial->getMaxFitError()
+            << " rad, after refinement: " << inverse_polynomial->getMaxRefinedError() << " rad.";
+  EXPECT_LT(inverse_polynomial->getMaxFitError(), 1e-4);
+  EXPECT_LT(inverse_polynomial->getMaxRefinedError(), 1e-12);
+  // The test distortion is monotonic over the whole field of view.
+  EXPECT_GT(inverse_polynomial->getMaxTheta(), 1.5);
+
+  const int kNumPoints = 1000;
+  const Eigen::Matrix2Xd points = 10.0 * Eigen::Matrix2Xd::Random(2, kNumPoints);
+  for (int i = 0; i < kNumPoints; ++i) {
+    Eigen::Vector2d keypoint = points.col(i);
+    distortion->distort(&keypoint);
+    distortion->undistort(&keypoint);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, points.col(i), 1e-9 * points.col(i).norm()));
+  }
+}
+
+TEST(TestEquidistantInversePolynomial, FoldingDistortion) {
+  // The distortion folds over at about 0.93 rad, i.e. the slope of its inverse diverges there.
+  Eigen::VectorXd coefficients(4);
+  coefficients << 0.1, -0.05, 0.0, -0.2;
+  aslam::EquidistantDistortion distortion(coefficients);
+  const aslam::EquidistantInversePolynomial::ConstPtr inverse_polynomial =
+      distortion.getInversePolynomial();
+  ASSERT_TRUE(inverse_polynomial);
+  EXPECT_LT(inverse_polynomial->getMaxRefinedError(), 1e-10);
+  EXPECT_LT(inverse_polynomial->getMaxTheta(), 0.93);
+  EXPECT_GT(inverse_polynomial->getMaxTheta(), 0.5);
+
+  // The distorted radius of the last angle of the range can round to just beyond the fit, where
+  // the point is inverted iteratively, so stop right before it.
+  const int kNumSamples = 10000;
+  Eigen::Matrix2Xd points(2, kNumSamples);
+  Eigen::Matrix2Xd keypoints(2, kNumSamples);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const double theta = inverse_polynomial->getMaxTheta() * i / kNumSamples;
+    const Eigen::Vector2d point = std::tan(theta) * Eigen::Vector2d(0.6, -0.8);
+    Eigen::Vector2d keypoint = point;
+    distortion.distort(&keypoint);
+    keypoints.col(i) = keypoint;
+    distortion.undistort(&keypoint);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, point, 1e-9 * (1.0 + point.norm())))
+        << "theta: " << theta;
+    points.col(i) = point;
+  }
+
+  // The batch version inverts the points within the range with the polynomial as well.
+  std::vector<unsigned char> converged;
+  EXPECT_EQ(0, distortion.undistortVectorized(&keypoints, &converged));
+  for (int i = 0; i < kNumSamples; ++i) {
+    EXPECT_TRUE(converged[i]);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        keypoints.col(i), points.col(i), 1e-9 * (1.0 + points.col(i).norm())));
+  }
+}
+
+TEST(TestEquidistantInversePolynomial, NonInvertibleDistortion) {
+  // The distortion folds over right next to the optical axis, so there is nothing to fit.
+  Eigen::VectorXd coefficients(4);
+  coefficients << -1e7, 0.0, 0.0, 0.0;
+  aslam::EquidistantDistortion distortion(coefficients);
+  const aslam::EquidistantInversePolynomial::ConstPtr inverse_polynomial =
+      distortion.getInversePolynomial();
+  ASSERT_TRUE(inverse_polynomial);
+  EXPECT_FALSE(inverse_polynomial->isValid());
+  double theta;
+  EXPECT_FALSE(inverse_polynomial->invert(0.0, &theta));
+
+  // Undistortion falls back to the iterative inversion instead of failing.
+  Eigen::Vector2d keypoint(0.1, 0.0);
+  Eigen::Matrix2Xd keypoints = keypoint;
+  distortion.undistort(&keypoint);
+  std::vector<unsigned char> converged;
+  distortion.undistortVectorized(&keypoints, &converged);
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints.col(0), keypoint, 1e-6));
+}
+
+TEST(TestEquidistantInversePolynomial, RefitAfterParameterChange) {
+  aslam::EquidistantDistortion::Ptr distortion =
+      aslam::EquidistantDistortion::createTestDistortion();
+  const aslam::EquidistantInversePolynomial::ConstPtr inverse_polynomial =
+      distortion->getInversePolynomial();
+  EXPECT_EQ(inverse_polynomial, distortion->getInversePolynomial());
+
+  distortion->getParametersMutable()[0] = -0.05;
+  const aslam::EquidistantInversePolynomial::ConstPtr refitted_inverse_polynomial =
+      distortion->getInversePolynomial();
+  EXPECT_NE(inverse_polynomial, refitted_inverse_polynomial);
+  EXPECT_TRUE(refitted_inverse_polynomial->isFitFor(distortion->getParameters()));
+
+  const Eigen::Vector2d point(0.7, -0.4);
+  Eigen::Vector2d keypoint = point;
+  distortion->distort(&keypoint);
+  distortion->undistort(&keypoint);
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, point, 1e-12));
+
+  // External coefficients are inverted iteratively.
+  const Eigen::VectorXd external_coefficients =
+      aslam::EquidistantDistortion::createTestDistortion()->getParameters();
+  keypoint = point;
+  distortion->distortUsingExternalCoefficients(&external_coefficients, &keypoint, nullptr);
+  distortion->undistortUsingExternalCoefficients(external_coefficients, &keypoint);
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, point, 1e-6));
+  EXPECT_EQ(refitted_inverse_polynomial, distortion->getInversePolynomial());
+}
+
 TEST(TestParameter, testEquidistantDistortionParameters) {
   Eigen::Vector3d invalid1 = Eigen::Vector3d::Zero();
   EXPECT_FALSE(aslam::EquidistantDistortion::areParametersValid(invalid1));
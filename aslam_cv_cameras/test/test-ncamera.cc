@@ -1,3 +1,5 @@
+#include <vector>
+
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
@@ -99,4 +101,87 @@ TEST(TestNCamera, testCloneRigWithoutDistortion) {
   }
 }
 
+void expectProjectionsMatchProject3(
+    const aslam::NCamera& ncamera, const Eigen::Matrix3Xd& points_B,
+    const std::vector<aslam::CameraProjections>& projections) {
+  const int num_points = static_cast<int>(points_B.cols());
+  ASSERT_EQ(projections.size(), ncamera.getNumCameras());
+  for (size_t camera_idx = 0u; camera_idx < ncamera.getNumCameras(); ++camera_idx) {
+    const aslam::Camera& camera = ncamera.getCamera(camera_idx);
+    const aslam::Transformation& T_C_B = ncamera.get_T_C_B(camera_idx);
+    const aslam::CameraProjections& camera_projections = projections[camera_idx];
+    ASSERT_EQ(camera_projections.keypoints.cols(), num_points);
+    ASSERT_EQ(static_cast<int>(camera_projections.projection_results.size()), num_points);
+
+    std::vector<int> expected_visible_indices;
+    for (int i = 0; i < num_points; ++i) {
+      Eigen::Vector2d keypoint;
+      const aslam::ProjectionResult result =
+          camera.project3(T_C_B.transform(points_B.col(i)), &keypoint);
+      EXPECT_EQ(camera_projections.projection_results[i].isKeypointVisible(),
+                result.isKeypointVisible());
+      if (result.isKeypointVisible()) {
+        expected_visible_indices.push_back(i);
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(camera_projections.keypoints.col(i), keypoint, 1e-8));
+      }
+    }
+    EXPECT_FALSE(expected_visible_indices.empty());
+    EXPECT_EQ(camera_projections.visible_indices, expected_visible_indices);
+  }
+}
+
+TEST(TestNCamera, ProjectToAllCamerasMatchesProject3) {
+  aslam::NCamera::Ptr ncamera = aslam::createSurroundViewTestNCamera();
+  ASSERT_TRUE(ncamera.get() != nullptr);
+
+  // Points all around the rig, including some close to and at the camera centers.
+  constexpr int kNumPoints = 5000;
+  Eigen::Matrix3Xd points_B = 10.0 * Eigen::Matrix3Xd::Random(3, kNumPoints);
+  for (size_t camera_idx = 0u; camera_idx < ncamera->getNumCameras(); ++camera_idx) {
+    points_B.col(camera_idx) = ncamera->get_T_C_B(camera_idx).inverse().getPosition();
+  }
+
+  std::vector<aslam::CameraProjections> projections;
+  ncamera->projectToAllCameras(points_B, 1u, &projections);
+  expectProjectionsMatchProject3(*ncamera, points_B, projections);
+}
+
+TEST(TestNCamera, ProjectToAllCamerasAfterCameraChange) {
+  aslam::NCamera::Ptr ncamera = aslam::createSurroundViewTestNCamera();
+  ASSERT_TRUE(ncamera.get() != nullptr);
+  const Eigen::Matrix3Xd points_B = 10.0 * Eigen::Matrix3Xd::Random(3, 5000);
+
+  std::vector<aslam::CameraProjections> projections;
+  ncamera->projectToAllCameras(points_B, 1u, &projections);
+  expectProjectionsMatchProject3(*ncamera, points_B, projections);
+
+  // Halving the focal lengths widens the field of view, so the culling cone of the first
+  // projection would drop visible points.
+  for (size_t camera_idx = 0u; camera_idx < ncamera->getNumCameras(); ++camera_idx) {
+    double* intrinsics = ncamera->getCameraMutable(camera_idx).getParametersMutable();
+    intrinsics[0] *= 0.5;
+    intrinsics[1] *= 0.5;
+  }
+  ncamera->projectToAllCameras(points_B, 1u, &projections);
+  expectProjectionsMatchProject3(*ncamera, points_B, projections);
+}
+
+TEST(TestNCamera, ProjectToAllCamerasIndependentOfThreadCount) {
+  aslam::NCamera::Ptr ncamera = aslam::createSurroundViewTestNCamera();
+  ASSERT_TRUE(ncamera.get() != nullptr);
+  const Eigen::Matrix3Xd points_B = 10.0 * Eigen::Matrix3Xd::Random(3, 1000);
+
+  std::vector<aslam::CameraProjections> projections_single, projections_multi;
+  ncamera->projectToAllCameras(points_B, 1u, &projections_single);
+  ncamera->projectToAllCameras(points_B, 3u, &projections_multi);
+  ASSERT_EQ(projections_single.size(), projections_multi.size());
+  for (size_t camera_idx = 0u; camera_idx < projections_single.size(); ++camera_idx) {
+    EXPECT_TRUE(EIGEN_MATRIX_EQUAL(
+        projections_single[camera_idx].keypoints, projections_multi[camera_idx].keypoints));
+    EXPECT_EQ(
+        projections_single[camera_idx].visible_indices,
+        projections_multi[camera_idx].visible_indices);
+  }
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
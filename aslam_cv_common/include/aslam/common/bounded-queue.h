@@ -0,0 +1,113 @@
+#ifndef ASLAM_COMMON_BOUNDED_QUEUE_H_
+#define ASLAM_COMMON_BOUNDED_QUEUE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#include <aslam/common/macros.h>
+#include <glog/logging.h>
+
+namespace aslam {
+namespace common {
+
+/// \class BoundedQueue
+/// \brief Blocking FIFO queue with a maximum size for any number of producers and consumers.
+///        push() blocks while the queue is full and pop() blocks while it is empty, while
+///        pushDroppingOldest() never blocks. After shutdown() no values are accepted anymore,
+///        but the remaining ones can still be popped.
+template <typename Type>
+class BoundedQueue {
+ public:
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(BoundedQueue);
+
+  explicit BoundedQueue(size_t max_size) : max_size_(max_size), shutdown_(false) {
+    CHECK_GT(max_size_, 0u);
+  }
+
+  /// Append a value, blocks while the queue is full.
+  /// @return False if the queue is shut down and the value was not added.
+  bool push(Type value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_not_full_.wait(
+        lock, [this]() { return shutdown_ || queue_.size() < max_size_; });
+    if (shutdown_) {
+      return false;
+    }
+    queue_.emplace_back(std::move(value));
+    lock.unlock();
+    condition_not_empty_.notify_one();
+    return true;
+  }
+
+  /// Append a value without blocking. If the queue is full, the oldest value is removed.
+  /// @param[out] dropped_value    Receives the removed value.
+  /// @param[out] is_value_dropped Whether a value was removed.
+  /// @return False if the queue is shut down and the value was not added.
+  bool pushDroppingOldest(Type value, Type* dropped_value, bool* is_value_dropped) {
+    CHECK_NOTNULL(dropped_value);
+    CHECK_NOTNULL(is_value_dropped);
+    *is_value_dropped = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (shutdown_) {
+      return false;
+    }
+    if (queue_.size() >= max_size_) {
+      *dropped_value = std::move(queue_.front());
+      queue_.pop_front();
+      *is_value_dropped = true;
+    }
+    queue_.emplace_back(std::move(value));
+    lock.unlock();
+    condition_not_empty_.notify_one();
+    return true;
+  }
+
+  /// Remove the oldest value, blocks while the queue is empty.
+  /// @return False if the queue is shut down and empty.
+  bool pop(Type* value) {
+    CHECK_NOTNULL(value);
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_not_empty_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return false;
+    }
+    *value = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    condition_not_full_.notify_one();
+    return true;
+  }
+
+  /// Stop accepting values and release all blocked callers.
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+    condition_not_full_.notify_all();
+    condition_not_empty_.notify_all();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+  }
+
+  size_t maxSize() const { return max_size_; }
+
+ private:
+  const size_t max_size_;
+  bool shutdown_;
+  std::deque<Type> queue_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_not_full_;
+  std::condition_variable condition_not_empty_;
+};
+
+}  // namespace common
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_BOUNDED_QUEUE_H_
@@ -1,6 +1,8 @@
 #ifndef ASLAM_CV_COMMON_CHANNEL_DEFINITIONS_H_
 #define ASLAM_CV_COMMON_CHANNEL_DEFINITIONS_H_
 
+#include <vector>
+
 #include <Eigen/Dense>
 #include <aslam/common/channel-declaration.h>
 
@@ -37,4 +39,8 @@ DECLARE_CHANNEL(RAW_IMAGE, cv::Mat)
 
 DECLARE_CHANNEL(CV_MAT, cv::Mat)
 
+/// Image pyramid of the image the keypoints were detected in, in the layout of
+/// cv::buildOpticalFlowPyramid (i.e. each level may be followed by its derivatives).
+DECLARE_CHANNEL(IMAGE_PYRAMID, std::vector<cv::Mat>)
+
 #endif  // ASLAM_CV_COMMON_CHANNEL_DEFINITIONS_H_
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include <glog/logging.h>
 #include <Eigen/Dense>
@@ -156,6 +157,21 @@ bool deSerializeFromBuffer(const char* const buffer, size_t size,
 bool serializeToBuffer(const cv::Mat& matrix,
                        char** buffer, size_t* size);
 
+/// Image lists (e.g. pyramids) are stored as the number of images followed by the size and
+/// serialization of each image. Images that are views into larger images (e.g. padded pyramid
+/// levels) are stored without the surrounding data.
+bool serializeToString(const std::vector<cv::Mat>& images,
+                       std::string* string);
+
+bool deSerializeFromString(const std::string& string,
+                           std::vector<cv::Mat>* images);
+
+bool deSerializeFromBuffer(const char* const buffer, size_t size,
+                           std::vector<cv::Mat>* images);
+
+bool serializeToBuffer(const std::vector<cv::Mat>& images,
+                       char** buffer, size_t* size);
+
 template<typename Scalar>
 bool serializeToString(const Scalar& value, std::string* string) {
   CHECK_NOTNULL(string);
@@ -18,6 +18,7 @@
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <aslam/common/channel-serialization.h>
 #include <aslam/common/crtp-clone.h>
@@ -114,6 +115,8 @@ class Channel : public aslam::Cloneable<ChannelBase, Channel<TYPE>> {
 };
 
 template<> bool Channel<cv::Mat>::operator==(const Channel<cv::Mat>& other);
+template<> bool Channel<std::vector<cv::Mat>>::operator==(
+    const Channel<std::vector<cv::Mat>>& other);
 template<typename TYPE>
 bool Channel<TYPE>::operator==(const Channel<TYPE>& other) {
   return equal_to(other, typename is_not_pointer<TYPE>::type());
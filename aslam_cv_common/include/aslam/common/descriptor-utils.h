@@ -71,32 +71,29 @@ inline void getIndexOfDescriptorClosestToMedian(
   CHECK_GT(descriptor_size_bytes, 0);
   CHECK_NOTNULL(median_descriptor_index);
 
-  std::vector<aslam::common::FeatureDescriptorConstRef> wrapped_descriptors;
   const int num_descriptors = raw_descriptors.cols();
-  wrapped_descriptors.reserve(num_descriptors);
-
-  for (int descriptor_idx = 0; descriptor_idx < num_descriptors;
-       ++descriptor_idx) {
-    wrapped_descriptors.emplace_back(
-        &raw_descriptors.coeffRef(0, descriptor_idx),
-        descriptor_size_bytes);
-  }
-
   Eigen::MatrixXi hamming_distance_matrix =
       Eigen::MatrixXi::Zero(num_descriptors, num_descriptors);
 
+  // The descriptors after the current one are contiguous in memory.
+  std::vector<uint32_t> hamming_distances(num_descriptors);
   for (int descriptor_idx_row = 0; descriptor_idx_row < num_descriptors;
        ++descriptor_idx_row) {
-    const aslam::common::FeatureDescriptorConstRef& row_descriptor =
-        wrapped_descriptors[descriptor_idx_row];
-    for (int descriptor_idx_col = descriptor_idx_row + 1;
-        descriptor_idx_col < num_descriptors; ++descriptor_idx_col) {
-      const aslam::common::FeatureDescriptorConstRef& col_descriptor =
-          wrapped_descriptors[descriptor_idx_col];
-
+    const int num_following_descriptors =
+        num_descriptors - descriptor_idx_row - 1;
+    if (num_following_descriptors == 0) {
+      break;
+    }
+    getHammingDistancesOneToMany(
+        &raw_descriptors.coeffRef(0, descriptor_idx_row),
+        &raw_descriptors.coeffRef(0, descriptor_idx_row + 1),
+        descriptor_size_bytes, num_following_descriptors,
+        hamming_distances.data());
+    for (int following_idx = 0; following_idx < num_following_descriptors;
+         ++following_idx) {
+      const int descriptor_idx_col = descriptor_idx_row + 1 + following_idx;
       const int hamming_distance =
-          aslam::common::GetNumBitsDifferent(row_descriptor, col_descriptor);
-      CHECK_GE(hamming_distance, 0);
+          static_cast<int>(hamming_distances[following_idx]);
 
       hamming_distance_matrix(descriptor_idx_row, descriptor_idx_col) =
           hamming_distance;
@@ -41,6 +41,13 @@
 #ifndef ASLAM_COMMON_HAMMING_H_
 #define ASLAM_COMMON_HAMMING_H_
 
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include <glog/logging.h>
+
 #ifdef __ARM_NEON
 #include <arm_neon.h>
 #else
@@ -50,7 +57,96 @@
 
 namespace aslam {
 namespace common {
-// Faster Hamming distance functor - uses SSE
+/// The implementations of the bit count of A exclusive XOR'ed with B. The fastest one the CPU
+/// supports is selected through CPUID before the first distance is computed. All of them
+/// accept unaligned descriptors of any length.
+enum class HammingKernel {
+  kScalar,
+  kSsse3,
+  /// Nibble lookup table popcount on 256 bit registers.
+  kAvx2,
+  /// Popcount instruction on 512 bit registers, e.g. Ice Lake and Zen 4.
+  kAvx512Vpopcntdq,
+  kNeon
+};
+
+bool isHammingKernelSupported(HammingKernel kernel);
+
+/// The kernel used by Hamming, GetNumBitsDifferent() and the one-to-many distances.
+HammingKernel getHammingKernel();
+
+/// \brief Override the automatic kernel selection, e.g. to compare the kernels.
+/// @return False if the CPU does not support the kernel and the selection was not changed.
+bool setHammingKernel(HammingKernel kernel);
+
+std::string hammingKernelToString(HammingKernel kernel);
+
+namespace internal {
+typedef uint32_t (*PopcntofXORedFunction)(const unsigned char* signature1,
+                                          const unsigned char* signature2,
+                                          int size_bytes);
+/// The one-to-many variant of a kernel. column_indices may be null to compare the query to
+/// num_descriptors consecutive descriptors.
+typedef void (*PopcntsofXORedOneToManyFunction)(const unsigned char* query,
+                                                const unsigned char* descriptors,
+                                                int size_bytes,
+                                                const int* column_indices,
+                                                int num_descriptors,
+                                                uint32_t* distances);
+/// Point to the selected kernel. Start out pointing to functions that select the kernel.
+extern std::atomic<PopcntofXORedFunction> popcnt_of_xored;
+extern std::atomic<PopcntsofXORedOneToManyFunction> popcnts_of_xored_one_to_many;
+}  // namespace internal
+
+/// \brief Compute the Hamming distances of one query descriptor to many descriptors.
+///
+/// The descriptors of size_bytes each are stored one after the other, as the columns of
+/// VisualFrame::DescriptorsT. The query stays in registers for all of them, which is
+/// considerably faster than computing the distances pair by pair.
+/// @param[out] distances Holds num_descriptors distances.
+inline void getHammingDistancesOneToMany(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    int num_descriptors, uint32_t* distances) {
+  internal::popcnts_of_xored_one_to_many.load(std::memory_order_relaxed)(
+      query, descriptors, size_bytes, nullptr, num_descriptors, distances);
+}
+
+/// \brief Compute the Hamming distances of one query descriptor to the descriptors at the given
+///        column indices, e.g. the keypoints of a frame within a search window.
+/// @param[out] distances Holds num_column_indices distances.
+inline void getHammingDistancesOneToMany(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_column_indices, uint32_t* distances) {
+  CHECK_NOTNULL(column_indices);
+  internal::popcnts_of_xored_one_to_many.load(std::memory_order_relaxed)(
+      query, descriptors, size_bytes, column_indices, num_column_indices, distances);
+}
+
+/// The closest and second closest descriptor to a query, e.g. for Lowe's ratio test.
+struct TwoSmallestHammingDistances {
+  static constexpr uint32_t kNoDistance = std::numeric_limits<uint32_t>::max();
+  /// The position of the closest descriptor among the compared ones, the first one on ties.
+  /// -1 if no descriptor was compared.
+  int best_index = -1;
+  uint32_t best_distance = kNoDistance;
+  /// Equal to the best distance if two descriptors are equally close. kNoDistance if fewer than
+  /// two descriptors were compared.
+  uint32_t second_best_distance = kNoDistance;
+};
+
+/// \brief Get the two smallest Hamming distances of one query descriptor to many consecutive
+///        descriptors without storing all distances.
+void getTwoSmallestHammingDistances(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    int num_descriptors, TwoSmallestHammingDistances* result);
+
+/// \brief Get the two smallest Hamming distances of one query descriptor to the descriptors at
+///        the given column indices. The best index is a position in column_indices.
+void getTwoSmallestHammingDistances(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_column_indices, TwoSmallestHammingDistances* result);
+
+// Faster Hamming distance functor - uses the fastest SIMD instructions of the CPU
 // bit count of A exclusive XOR'ed with B.
 class  Hamming {
  public:
@@ -96,18 +192,12 @@ class  Hamming {
   // not.
   typedef int ResultType;
 
+  // The size is in bytes.
   static ResultType evaluate(const unsigned char* a,
                              const unsigned char* b,
                              const int size) {
-#ifdef __ARM_NEON
-    return NEONPopcntofXORed(reinterpret_cast<const uint8x16_t*>(a),
-                             reinterpret_cast<const uint8x16_t*>(b),
-                             size / 16);
-#else
-    return SSSE3PopcntofXORed(reinterpret_cast<const __m128i*>(a),
-                              reinterpret_cast<const __m128i*>(b),
-                              size / 16);
-#endif  // __ARM_NEON
+    return static_cast<ResultType>(
+        internal::popcnt_of_xored.load(std::memory_order_relaxed)(a, b, size));
   }
 
   // This will count the bits in a ^ b.
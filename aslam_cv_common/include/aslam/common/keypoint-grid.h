@@ -0,0 +1,103 @@
+#ifndef ASLAM_COMMON_KEYPOINT_GRID_H_
+#define ASLAM_COMMON_KEYPOINT_GRID_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <aslam/common/macros.h>
+#include <Eigen/Core>
+
+namespace aslam {
+namespace common {
+
+/// \class KeypointGrid
+/// \brief Spatial index over the keypoints of an image that answers rectangle queries by only
+///        visiting the grid cells overlapping the query.
+///
+/// The image is divided into num_cells_x x num_cells_y cells of equal size. The index is
+/// stored flat: the keypoint indices are sorted by cell, with the keypoints of a cell ordered
+/// by index, and an offset array marks the range of every cell. The keypoint coordinates are
+/// copied in the same order, such that a query reads contiguous memory. Keypoints outside of
+/// the image are assigned to the nearest border cell.
+class KeypointGrid {
+ public:
+  ASLAM_POINTER_TYPEDEFS(KeypointGrid);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(KeypointGrid);
+
+  /// \brief Divide the image into cells.
+  /// @param[in] image_width   Width of the image in pixels.
+  /// @param[in] image_height  Height of the image in pixels.
+  /// @param[in] num_cells_x   Number of cells along the image width.
+  /// @param[in] num_cells_y   Number of cells along the image height.
+  KeypointGrid(double image_width, double image_height, size_t num_cells_x,
+               size_t num_cells_y);
+  /// \brief Divide the image into cells with sides of at least the given length. Queries with
+  ///        a half side length of at most the cell size visit at most 3 x 3 cells.
+  KeypointGrid(double image_width, double image_height, double cell_size);
+  ~KeypointGrid() {}
+
+  /// \brief Index all keypoints.
+  void build(const Eigen::Matrix2Xd& keypoints);
+
+  /// \brief Index the keypoints flagged as valid.
+  void build(const Eigen::Matrix2Xd& keypoints, const std::vector<bool>& is_valid);
+
+  /// \brief Get the indexed keypoints with x_min <= x <= x_max and y_min <= y <= y_max.
+  /// @param[out] keypoint_indices  The indices of the keypoints, ordered by cell.
+  void getKeypointsInRectangle(double x_min, double x_max, double y_min, double y_max,
+                               std::vector<int>* keypoint_indices) const;
+
+  /// \brief Get the index of the cell containing the given image point. Cells are numbered
+  ///        row by row, i.e. cell_y * num_cells_x + cell_x.
+  inline size_t getCellIndex(const Eigen::Vector2d& point) const {
+    return getCellY(point(1)) * num_cells_x_ + getCellX(point(0));
+  }
+
+  /// \brief Get the indices of the keypoints in the cell, ordered by index.
+  inline const int* cellBegin(size_t cell_index) const {
+    return keypoint_indices_.data() + cell_begin_[cell_index];
+  }
+  inline const int* cellEnd(size_t cell_index) const {
+    return keypoint_indices_.data() + cell_begin_[cell_index + 1u];
+  }
+  inline size_t getNumKeypointsInCell(size_t cell_index) const {
+    return cell_begin_[cell_index + 1u] - cell_begin_[cell_index];
+  }
+
+  size_t getNumCellsX() const { return num_cells_x_; }
+  size_t getNumCellsY() const { return num_cells_y_; }
+  size_t getNumCells() const { return num_cells_x_ * num_cells_y_; }
+  size_t getNumIndexedKeypoints() const { return keypoint_indices_.size(); }
+
+ private:
+  inline size_t getCellX(double x) const {
+    return toCell(x / cell_width_, num_cells_x_);
+  }
+  inline size_t getCellY(double y) const {
+    return toCell(y / cell_height_, num_cells_y_);
+  }
+  static inline size_t toCell(double scaled_coordinate, size_t num_cells) {
+    if (!(scaled_coordinate >= 0.0)) {
+      return 0u;
+    }
+    const double last_cell = static_cast<double>(num_cells - 1u);
+    return scaled_coordinate >= last_cell ? num_cells - 1u :
+        static_cast<size_t>(scaled_coordinate);
+  }
+
+  const size_t num_cells_x_;
+  const size_t num_cells_y_;
+  const double cell_width_;
+  const double cell_height_;
+
+  /// The keypoints of cell k are keypoint_indices_[cell_begin_[k], cell_begin_[k+1]).
+  std::vector<uint32_t> cell_begin_;
+  std::vector<int> keypoint_indices_;
+  /// The coordinates of the keypoints in the order of keypoint_indices_.
+  Eigen::Matrix2Xd sorted_keypoints_;
+};
+
+}  // namespace common
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_KEYPOINT_GRID_H_
@@ -0,0 +1,83 @@
+#ifndef ASLAM_COMMON_SPSC_QUEUE_H_
+#define ASLAM_COMMON_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+namespace common {
+
+/// \class SpscQueue
+/// \brief Unbounded lock-free FIFO queue for a single producer and a single consumer thread.
+///        The queue is a linked list that always contains a stub node at its front. Only the
+///        producer touches the back and only the consumer touches the front, they communicate
+///        through the release/acquire on the next pointers. Several threads may take turns as
+///        producer (or consumer) if their turns are ordered, e.g. by a mutex.
+template <typename Type>
+class SpscQueue {
+ public:
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(SpscQueue);
+
+  SpscQueue() : back_(new Node), front_(back_), size_(0u) {}
+
+  ~SpscQueue() {
+    while (front_ != nullptr) {
+      Node* next = front_->next.load(std::memory_order_relaxed);
+      delete front_;
+      front_ = next;
+    }
+  }
+
+  /// Append a value. Must only be called by the producer.
+  void push(const Type& value) {
+    Node* node = new Node(value);
+    // Count the value before publishing it. The release store orders the increment before the
+    // decrement of the pop that takes the value, so the size never wraps around.
+    size_.fetch_add(1u, std::memory_order_relaxed);
+    back_->next.store(node, std::memory_order_release);
+    back_ = node;
+  }
+
+  /// Remove the oldest value. Must only be called by the consumer.
+  /// @return False if the queue is empty.
+  bool pop(Type* value) {
+    Node* next = front_->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+    // The next node becomes the new stub node.
+    *value = next->value;
+    next->value = Type();
+    delete front_;
+    front_ = next;
+    size_.fetch_sub(1u, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Number of queued values. Exact only if neither producer nor consumer are active, while a
+  /// push is in progress it may already count the pushed value.
+  size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Node {
+    Node() : value(), next(nullptr) {}
+    explicit Node(const Type& value_) : value(value_), next(nullptr) {}
+    Type value;
+    std::atomic<Node*> next;
+  };
+
+  /// Last node, owned by the producer.
+  Node* back_;
+  /// Stub node, owned by the consumer.
+  Node* front_;
+  std::atomic<size_t> size_;
+};
+
+}  // namespace common
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_SPSC_QUEUE_H_
@@ -82,6 +82,13 @@ class ThreadPool {
       std::numeric_limits<size_t>::max();
 
   size_t numActiveThreads() const;
+
+  /// \brief Pin the worker threads to CPU cores. Worker i is pinned to the core
+  ///        core_ids[i % core_ids.size()]. Only supported on Linux.
+  /// \returns False if the affinity of any worker could not be set.
+  bool pinThreadsToCores(const std::vector<int>& core_ids);
+
+  size_t numThreads() const { return workers_.size(); }
  private:
   // This version is not threadsafe.
   size_t numQueuedTasksImpl() const;
@@ -3,6 +3,8 @@
 
 #include <chrono>
 #include <cstdint>
+#include <limits>
+#include <string>
 
 namespace aslam {
 namespace time {
@@ -51,6 +53,13 @@ inline int64_t nanoSecondsSinceEpoch() {
         (std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
+/// \brief get the time of a monotonic clock in nanoseconds. Only differences of these times
+///        are meaningful, e.g. to measure latencies.
+inline int64_t monotonicNanoSeconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /// \brief convert double seconds to integer nanoseconds since epoch.
 inline int64_t secondsToNanoSeconds(double seconds) {
   return from_seconds(seconds);
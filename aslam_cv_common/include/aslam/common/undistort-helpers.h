@@ -2,7 +2,14 @@
 #define ASLAM_UNDISTORT_HELPERS_H_
 
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include <aslam/common/thread-pool.h>
 #include <Eigen/Dense>
 #include <glog/logging.h>
 #include <opencv2/core/core.hpp>
@@ -154,18 +161,38 @@ Eigen::Matrix3d getOptimalNewCameraMatrix(const DerivedCameraType& input_camera,
   return output_camera_matrix;
 }
 
-/// \brief Calculates the undistortion maps for the given camera geometries.
+namespace internal {
+/// \brief Workers shared by all map builds. Recreated if a build asks for a different number of
+///        threads.
+inline std::shared_ptr<ThreadPool> getUndistortMapThreadPool(const size_t num_workers) {
+  static std::mutex mutex;
+  static std::shared_ptr<ThreadPool> thread_pool;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!thread_pool || thread_pool->numThreads() != num_workers) {
+    thread_pool = std::make_shared<ThreadPool>(num_workers);
+  }
+  return thread_pool;
+}
+}  // namespace internal
+
+/// \brief Calculates the undistortion maps for the given camera geometries. The output image is
+///        split into blocks of rows which are distributed over the threads. Each block is
+///        back-projected and projected with the vectorized camera functions.
 /// @param[in] input_camera Input camera geometry
-/// @param[in] output_camera_matrix Desired output camera matrix (see \ref getOptimalNewCameraMatrix)
-/// @param[in] scale Output image size scaling parameter wrt. to input image size.
+/// @param[in] output_camera Output camera geometry (see \ref getOptimalNewCameraMatrix)
 /// @param[in] map_type Type of the output maps. (cv::CV_32FC1, cv::CV_32FC2 or cv::CV_16SC2)
 ///                     Use cv::CV_16SC2 if you don't know what to choose. (fastest fixed-point)
 /// @param[out] map_u Map that transforms u-coordinates from distorted to undistorted image plane.
 /// @param[out] map_v Map that transforms v-coordinates from distorted to undistorted image plane.
+/// @param[in] num_threads Number of threads used to build the maps, including the calling
+///                        thread. The others are taken from a thread pool shared by all map
+///                        builds. 0 uses one thread per hardware thread. The maps do not depend
+///                        on the number of threads.
 template<typename InputDerivedCameraType, typename OutputDerivedCameraType>
 void buildUndistortMap(const InputDerivedCameraType& input_camera,
                        const OutputDerivedCameraType& output_camera, int map_type,
-                       cv::OutputArray map_u, cv::OutputArray map_v) {
+                       cv::OutputArray map_u, cv::OutputArray map_v,
+                       size_t num_threads = 1u) {
   // Output image size
   cv::Size output_size(output_camera.imageWidth(), output_camera.imageHeight());
 
@@ -179,41 +206,80 @@ void buildUndistortMap(const InputDerivedCameraType& input_camera,
   } else
     map_v.release();
 
-  // Build the maps.
-  for (int i = 0; i < output_size.height; i++) {
-    float* m1f = (float*) (map1.data + map1.step * i);
-    float* m2f = (float*) (map2.data + map2.step * i);
-    short* m1 = (short*) m1f;
-    ushort* m2 = (ushort*) m2f;
+  const int kRowsPerBlock = 16;
+  const int num_blocks = (output_size.height + kRowsPerBlock - 1) / kRowsPerBlock;
+  if (num_threads == 0u) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  num_threads = std::min(num_threads, static_cast<size_t>(std::max(num_blocks, 1)));
+
+  // The blocks are handed out one at a time, as the cost per pixel varies over the image.
+  std::atomic<int> next_block(0);
+  auto build_blocks = [&]() {
+    Eigen::Matrix2Xd keypoints;
+    Eigen::Matrix3Xd points_3d;
+    Eigen::Matrix2Xd keypoints_dist;
+    std::vector<unsigned char> back_projection_success;
+    std::vector<ProjectionResult> projection_results;
+    for (int block = next_block++; block < num_blocks; block = next_block++) {
+      const int row_begin = block * kRowsPerBlock;
+      const int row_end = std::min(row_begin + kRowsPerBlock, output_size.height);
 
-    for (int j = 0; j < output_size.width; j++) {
       // Convert point on normalized image plane to keypoints. (projection and distortion)
-      const Eigen::Vector2d keypoint(j, i);
-      Eigen::Vector2d keypoint_dist;
-      Eigen::Vector3d point_3d;
-      output_camera.backProject3(keypoint, &point_3d);
-      point_3d /= point_3d[2];
-      input_camera.project3(point_3d, &keypoint_dist);
-
-      const double& u = keypoint_dist[0];
-      const double& v = keypoint_dist[1];
-
-      // Store in output format
-      if (map_type == CV_16SC2) {
-        int iu = cv::saturate_cast<int>(u * cv::INTER_TAB_SIZE);
-        int iv = cv::saturate_cast<int>(v * cv::INTER_TAB_SIZE);
-        m1[j * 2] = (short) (iu >> cv::INTER_BITS);
-        m1[j * 2 + 1] = (short) (iv >> cv::INTER_BITS);
-        m2[j] = (ushort) ((iv & (cv::INTER_TAB_SIZE - 1)) * cv::INTER_TAB_SIZE
-            + (iu & (cv::INTER_TAB_SIZE - 1)));
-      } else if (map_type == CV_32FC1) {
-        m1f[j] = (float) u;
-        m2f[j] = (float) v;
-      } else {
-        m1f[j * 2] = (float) u;
-        m1f[j * 2 + 1] = (float) v;
+      keypoints.resize(Eigen::NoChange, (row_end - row_begin) * output_size.width);
+      for (int i = row_begin, k = 0; i < row_end; i++) {
+        for (int j = 0; j < output_size.width; j++, k++) {
+          keypoints(0, k) = j;
+          keypoints(1, k) = i;
+        }
+      }
+      output_camera.backProject3Vectorized(keypoints, &points_3d, &back_projection_success);
+      points_3d.array().rowwise() /= points_3d.row(2).array();
+      input_camera.project3Vectorized(points_3d, &keypoints_dist, &projection_results);
+
+      for (int i = row_begin, k = 0; i < row_end; i++) {
+        float* m1f = (float*) (map1.data + map1.step * i);
+        float* m2f = (float*) (map2.data + map2.step * i);
+        short* m1 = (short*) m1f;
+        ushort* m2 = (ushort*) m2f;
+
+        for (int j = 0; j < output_size.width; j++, k++) {
+          const double u = keypoints_dist(0, k);
+          const double v = keypoints_dist(1, k);
+
+          // Store in output format
+          if (map_type == CV_16SC2) {
+            int iu = cv::saturate_cast<int>(u * cv::INTER_TAB_SIZE);
+            int iv = cv::saturate_cast<int>(v * cv::INTER_TAB_SIZE);
+            m1[j * 2] = (short) (iu >> cv::INTER_BITS);
+            m1[j * 2 + 1] = (short) (iv >> cv::INTER_BITS);
+            m2[j] = (ushort) ((iv & (cv::INTER_TAB_SIZE - 1)) * cv::INTER_TAB_SIZE
+                + (iu & (cv::INTER_TAB_SIZE - 1)));
+          } else if (map_type == CV_32FC1) {
+            m1f[j] = (float) u;
+            m2f[j] = (float) v;
+          } else {
+            m1f[j * 2] = (float) u;
+            m1f[j * 2 + 1] = (float) v;
+          }
+        }
       }
     }
+  };
+
+  if (num_threads == 1u) {
+    build_blocks();
+    return;
+  }
+  const std::shared_ptr<ThreadPool> thread_pool =
+      internal::getUndistortMapThreadPool(num_threads - 1u);
+  std::vector<std::future<void>> workers_done;
+  for (size_t i = 1u; i < num_threads; ++i) {
+    workers_done.emplace_back(thread_pool->enqueue(build_blocks));
+  }
+  build_blocks();
+  for (std::future<void>& worker_done : workers_done) {
+    worker_done.wait();
   }
 }
 
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/hamming.h>
+
+DEFINE_int32(
+    hamming_benchmark_num_descriptors, 4096,
+    "Number of descriptors every query descriptor is compared to.");
+DEFINE_int32(
+    hamming_benchmark_num_iterations, 200,
+    "Number of passes over all descriptors per benchmark configuration.");
+
+namespace aslam {
+namespace common {
+namespace {
+void benchmarkHamming(int descriptor_size_bytes) {
+  typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsType;
+  std::mt19937 random_engine(42);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  DescriptorsType descriptors(descriptor_size_bytes, FLAGS_hamming_benchmark_num_descriptors);
+  for (int col = 0; col < descriptors.cols(); ++col) {
+    for (int row = 0; row < descriptors.rows(); ++row) {
+      descriptors(row, col) = static_cast<unsigned char>(byte_distribution(random_engine));
+    }
+  }
+
+  const HammingKernel initial_kernel = getHammingKernel();
+  for (const HammingKernel kernel :
+       {HammingKernel::kScalar, HammingKernel::kSsse3, HammingKernel::kAvx2,
+        HammingKernel::kAvx512Vpopcntdq, HammingKernel::kNeon}) {
+    if (!isHammingKernelSupported(kernel)) {
+      continue;
+    }
+    ASSERT_TRUE(setHammingKernel(kernel));
+    // Every descriptor is compared to its successor, the distances are summed up such that the
+    // computation cannot be optimized away.
+    int64_t sum_of_distances = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < FLAGS_hamming_benchmark_num_iterations; ++iteration) {
+      for (int col = 0; col + 1 < descriptors.cols(); ++col) {
+        sum_of_distances += Hamming::evaluate(
+            &descriptors.coeffRef(0, col), &descriptors.coeffRef(0, col + 1),
+            descriptor_size_bytes);
+      }
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double num_distances = static_cast<double>(FLAGS_hamming_benchmark_num_iterations) *
+        (descriptors.cols() - 1);
+    LOG(INFO) << descriptor_size_bytes << " bytes, " << hammingKernelToString(kernel) << ": "
+              << seconds / num_distances * 1e9 << " ns per distance (checksum "
+              << sum_of_distances << ")";
+
+    // One query against all descriptors.
+    std::vector<uint32_t> distances(descriptors.cols());
+    int64_t sum_of_distances_one_to_many = 0;
+    const std::chrono::steady_clock::time_point start_one_to_many =
+        std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < FLAGS_hamming_benchmark_num_iterations; ++iteration) {
+      getHammingDistancesOneToMany(
+          &descriptors.coeffRef(0, iteration % descriptors.cols()), descriptors.data(),
+          descriptor_size_bytes, descriptors.cols(), distances.data());
+      for (const uint32_t distance : distances) {
+        sum_of_distances_one_to_many += distance;
+      }
+    }
+    const double seconds_one_to_many = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_one_to_many).count();
+    const double num_distances_one_to_many =
+        static_cast<double>(FLAGS_hamming_benchmark_num_iterations) * descriptors.cols();
+    LOG(INFO) << descriptor_size_bytes << " bytes, " << hammingKernelToString(kernel)
+              << " one-to-many: " << seconds_one_to_many / num_distances_one_to_many * 1e9
+              << " ns per distance (checksum " << sum_of_distances_one_to_many << ")";
+  }
+  EXPECT_TRUE(setHammingKernel(initial_kernel));
+}
+}  // namespace
+
+TEST(HammingBenchmark, Descriptor32Bytes) {
+  benchmarkHamming(32);
+}
+
+TEST(HammingBenchmark, Descriptor48Bytes) {
+  benchmarkHamming(48);
+}
+
+TEST(HammingBenchmark, Descriptor64Bytes) {
+  benchmarkHamming(64);
+}
+
+}  // namespace common
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
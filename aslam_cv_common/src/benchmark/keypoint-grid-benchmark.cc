@@ -0,0 +1,128 @@
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/keypoint-grid.h>
+
+DEFINE_int32(
+    keypoint_grid_benchmark_num_iterations, 100,
+    "Number of builds and passes over all queries per benchmark configuration.");
+
+namespace aslam {
+namespace common {
+namespace {
+constexpr double kImageWidth = 752.0;
+constexpr double kImageHeight = 480.0;
+
+double getSecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Compares the grid to a multimap from the y coordinate to the keypoint index that is searched
+// in a band of rows, as the gyro matcher did before. The queries are squares like the search
+// windows of the matcher.
+void benchmarkKeypointGrid(int num_keypoints, double half_side_length) {
+  std::mt19937 random_engine(42);
+  std::uniform_real_distribution<double> x_distribution(0.0, kImageWidth);
+  std::uniform_real_distribution<double> y_distribution(0.0, kImageHeight);
+  Eigen::Matrix2Xd keypoints(2, num_keypoints);
+  Eigen::Matrix2Xd queries(2, num_keypoints);
+  for (int idx = 0; idx < num_keypoints; ++idx) {
+    keypoints.col(idx) << x_distribution(random_engine), y_distribution(random_engine);
+    queries.col(idx) << x_distribution(random_engine), y_distribution(random_engine);
+  }
+  const int num_iterations = FLAGS_keypoint_grid_benchmark_num_iterations;
+  const double num_queries = static_cast<double>(num_iterations) * num_keypoints;
+
+  // Build.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  KeypointGrid grid(kImageWidth, kImageHeight, half_side_length);
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    grid.build(keypoints);
+  }
+  const double grid_build_seconds = getSecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  std::multimap<int, int> y_coordinate_to_keypoint_index;
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    y_coordinate_to_keypoint_index.clear();
+    for (int idx = 0; idx < num_keypoints; ++idx) {
+      y_coordinate_to_keypoint_index.emplace(static_cast<int>(keypoints(1, idx)), idx);
+    }
+  }
+  const double multimap_build_seconds = getSecondsSince(start);
+
+  // Query. The number of found keypoints is summed up such that the queries cannot be
+  // optimized away.
+  size_t grid_num_found = 0u;
+  std::vector<int> found;
+  start = std::chrono::steady_clock::now();
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    for (int idx = 0; idx < num_keypoints; ++idx) {
+      grid.getKeypointsInRectangle(
+          queries(0, idx) - half_side_length, queries(0, idx) + half_side_length,
+          queries(1, idx) - half_side_length, queries(1, idx) + half_side_length, &found);
+      grid_num_found += found.size();
+    }
+  }
+  const double grid_query_seconds = getSecondsSince(start);
+
+  size_t multimap_num_found = 0u;
+  start = std::chrono::steady_clock::now();
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    for (int idx = 0; idx < num_keypoints; ++idx) {
+      const Eigen::Vector2d query = queries.col(idx);
+      found.clear();
+      const auto it_end = y_coordinate_to_keypoint_index.lower_bound(
+          static_cast<int>(std::floor(query(1) + half_side_length)) + 1);
+      for (auto it = y_coordinate_to_keypoint_index.lower_bound(
+               static_cast<int>(std::floor(query(1) - half_side_length))); it != it_end; ++it) {
+        const Eigen::Vector2d offset = keypoints.col(it->second) - query;
+        if (std::abs(offset(0)) <= half_side_length && std::abs(offset(1)) <= half_side_length) {
+          found.push_back(it->second);
+        }
+      }
+      multimap_num_found += found.size();
+    }
+  }
+  const double multimap_query_seconds = getSecondsSince(start);
+  EXPECT_EQ(multimap_num_found, grid_num_found);
+
+  LOG(INFO) << num_keypoints << " keypoints, half side length " << half_side_length
+            << " px: build "
+            << grid_build_seconds / num_iterations * 1e6 << " us (multimap "
+            << multimap_build_seconds / num_iterations * 1e6 << " us), query "
+            << grid_query_seconds / num_queries * 1e9 << " ns (multimap "
+            << multimap_query_seconds / num_queries * 1e9 << " ns), "
+            << grid_num_found / num_queries << " keypoints per query";
+}
+}  // namespace
+
+TEST(KeypointGridBenchmark, Keypoints500) {
+  benchmarkKeypointGrid(500, 10.0);
+  benchmarkKeypointGrid(500, 25.0);
+}
+
+TEST(KeypointGridBenchmark, Keypoints2000) {
+  benchmarkKeypointGrid(2000, 10.0);
+  benchmarkKeypointGrid(2000, 25.0);
+}
+
+TEST(KeypointGridBenchmark, Keypoints8000) {
+  benchmarkKeypointGrid(8000, 10.0);
+  benchmarkKeypointGrid(8000, 25.0);
+}
+
+}  // namespace common
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
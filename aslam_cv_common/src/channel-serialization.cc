@@ -1,3 +1,7 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include <glog/logging.h>
 #include <aslam/common/channel-serialization.h>
 
@@ -211,5 +215,116 @@ bool serializeToBuffer(const cv::Mat& image, char** buffer, size_t* size) {
   return success;
 }
 
+bool serializeToString(const std::vector<cv::Mat>& images, std::string* string) {
+  CHECK_NOTNULL(string);
+  const uint32_t num_images = static_cast<uint32_t>(images.size());
+  string->assign(reinterpret_cast<const char*>(&num_images), sizeof(num_images));
+  for (const cv::Mat& image : images) {
+    std::string image_string;
+    // Pyramid levels are usually views into padded images, only the view is stored.
+    const bool success =
+        serializeToString(image.isContinuous() ? image : image.clone(), &image_string);
+    if (!success) {
+      return false;
+    }
+    const uint64_t image_size = image_string.size();
+    string->append(reinterpret_cast<const char*>(&image_size), sizeof(image_size));
+    string->append(image_string);
+  }
+  return true;
+}
+
+bool deSerializeFromString(const std::string& string, std::vector<cv::Mat>* images) {
+  CHECK_NOTNULL(images);
+  return deSerializeFromBuffer(string.data(), string.size(), images);
+}
+
+namespace {
+// Checks that the buffer holds exactly one image of a supported type, such that deserializing it
+// cannot fail a CHECK.
+bool isImageBufferValid(const char* const buffer, uint64_t size) {
+  HeaderInformation header;
+  if (size < header.size()) {
+    LOG(ERROR) << "Buffer too small to contain the image header.";
+    return false;
+  }
+  header.deSerializeFromBuffer(buffer, 0);
+  if (header.depth > static_cast<uint32_t>(CV_64F) || header.channels < 1u ||
+      header.channels > static_cast<uint32_t>(CV_CN_MAX)) {
+    LOG(ERROR) << "Unsupported image type with depth " << header.depth << " and "
+               << header.channels << " channels.";
+    return false;
+  }
+  const uint64_t element_size = CV_ELEM_SIZE1(header.depth) * header.channels;
+  const uint64_t matrix_size =
+      static_cast<uint64_t>(header.rows) * header.cols * element_size;
+  if (size - header.size() != matrix_size) {
+    LOG(ERROR) << "The image size does not match its header.";
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+bool deSerializeFromBuffer(const char* const buffer, size_t size,
+                           std::vector<cv::Mat>* images) {
+  CHECK_NOTNULL(buffer);
+  CHECK_NOTNULL(images);
+  uint32_t num_images;
+  if (size < sizeof(num_images)) {
+    LOG(ERROR) << "Buffer too small to contain the number of images.";
+    return false;
+  }
+  memcpy(&num_images, buffer, sizeof(num_images));
+  size_t offset = sizeof(num_images);
+
+  // Every image takes at least its size and its header, which bounds the number of images before
+  // anything is allocated.
+  uint64_t image_size;
+  const size_t min_image_size = sizeof(image_size) + HeaderInformation().size();
+  if (num_images > (size - offset) / min_image_size) {
+    LOG(ERROR) << "Buffer too small to contain " << num_images << " images.";
+    return false;
+  }
+
+  std::vector<cv::Mat> deserialized_images(num_images);
+  for (cv::Mat& image : deserialized_images) {
+    if (size - offset < sizeof(image_size)) {
+      LOG(ERROR) << "Buffer too small to contain the size of the image.";
+      return false;
+    }
+    memcpy(&image_size, buffer + offset, sizeof(image_size));
+    offset += sizeof(image_size);
+    if (size - offset < image_size) {
+      LOG(ERROR) << "Buffer too small to contain the image.";
+      return false;
+    }
+    if (!isImageBufferValid(buffer + offset, image_size) ||
+        !deSerializeFromBuffer(buffer + offset, image_size, &image)) {
+      return false;
+    }
+    offset += image_size;
+  }
+  if (offset != size) {
+    LOG(ERROR) << "Buffer contains " << size - offset << " bytes after the last image.";
+    return false;
+  }
+  images->swap(deserialized_images);
+  return true;
+}
+
+bool serializeToBuffer(const std::vector<cv::Mat>& images, char** buffer, size_t* size) {
+  CHECK_NOTNULL(buffer);
+  CHECK_NOTNULL(size);
+  std::string string;
+  if (!serializeToString(images, &string)) {
+    return false;
+  }
+  *size = string.size();
+  *buffer = new char[*size];
+  memcpy(*buffer, string.data(), *size);
+  return true;
+}
+
 }  // namespace internal
 }  // namespace aslam
@@ -1,5 +1,6 @@
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <aslam/common/channel.h>
 #include <aslam/common/meta.h>
@@ -12,6 +13,25 @@ bool Channel<cv::Mat>::operator==(const Channel<cv::Mat>& other) {
   return cv::countNonZero(value_ != other.value_) == 0;
 }
 
+template<>
+bool Channel<std::vector<cv::Mat>>::operator==(const Channel<std::vector<cv::Mat>>& other) {
+  if (value_.size() != other.value_.size()) {
+    return false;
+  }
+  for (size_t i = 0u; i < value_.size(); ++i) {
+    const cv::Mat& image = value_[i];
+    const cv::Mat& other_image = other.value_[i];
+    if (image.size() != other_image.size() || image.type() != other_image.type()) {
+      return false;
+    }
+    // The images may have several channels, e.g. the derivatives of a pyramid level.
+    if (!image.empty() && cv::norm(image, other_image, cv::NORM_INF) != 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 ChannelGroup cloneChannelGroup(const ChannelGroup& channels) {
   std::lock_guard<std::mutex> lock(channels.m_channels_);
   ChannelGroup cloned_group;
@@ -0,0 +1,532 @@
+#include "aslam/common/hamming.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ASLAM_HAMMING_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif  // defined(__x86_64__) || defined(__i386__)
+
+namespace aslam {
+namespace common {
+
+namespace {
+uint32_t popcntOfXORedScalar(
+    const unsigned char* signature1, const unsigned char* signature2, int size_bytes) {
+  uint32_t result = 0u;
+  int byte_idx = 0;
+  for (; byte_idx + 8 <= size_bytes; byte_idx += 8) {
+    uint64_t word1;
+    uint64_t word2;
+    memcpy(&word1, signature1 + byte_idx, sizeof(word1));
+    memcpy(&word2, signature2 + byte_idx, sizeof(word2));
+    result += __builtin_popcountll(word1 ^ word2);
+  }
+  for (; byte_idx < size_bytes; ++byte_idx) {
+    result += __builtin_popcount(signature1[byte_idx] ^ signature2[byte_idx]);
+  }
+  return result;
+}
+
+inline const unsigned char* getDescriptor(
+    const unsigned char* descriptors, int size_bytes, const int* column_indices, int idx) {
+  const int column = (column_indices == nullptr) ? idx : column_indices[idx];
+  return descriptors + static_cast<ptrdiff_t>(column) * size_bytes;
+}
+
+// One-to-many variant for kernels without a specialization for the descriptor size.
+template <uint32_t (*PopcntOfXORed)(const unsigned char*, const unsigned char*, int)>
+void popcntsOfXORedPairwise(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, uint32_t* distances) {
+  for (int idx = 0; idx < num_descriptors; ++idx) {
+    distances[idx] = PopcntOfXORed(
+        query, getDescriptor(descriptors, size_bytes, column_indices, idx), size_bytes);
+  }
+}
+
+#ifdef ASLAM_HAMMING_X86
+// Nibble lookup table popcount, see http://wm.ite.pl/articles/sse-popcount.html.
+__attribute__((target("ssse3")))
+uint32_t popcntOfXORedSsse3(
+    const unsigned char* signature1, const unsigned char* signature2, int size_bytes) {
+  const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m128i low_nibble_mask = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i accumulator = zero;
+  int byte_idx = 0;
+  for (; byte_idx + 16 <= size_bytes; byte_idx += 16) {
+    const __m128i xored = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(signature1 + byte_idx)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(signature2 + byte_idx)));
+    const __m128i low_nibbles = _mm_and_si128(xored, low_nibble_mask);
+    const __m128i high_nibbles = _mm_and_si128(_mm_srli_epi16(xored, 4), low_nibble_mask);
+    const __m128i counts = _mm_add_epi8(
+        _mm_shuffle_epi8(lookup, low_nibbles), _mm_shuffle_epi8(lookup, high_nibbles));
+    // Sum the byte counts into two 64 bit counters right away, so they cannot overflow.
+    accumulator = _mm_add_epi64(accumulator, _mm_sad_epu8(counts, zero));
+  }
+  const uint32_t result = static_cast<uint32_t>(_mm_cvtsi128_si32(accumulator)) +
+      static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(accumulator, accumulator)));
+  return result + popcntOfXORedScalar(
+      signature1 + byte_idx, signature2 + byte_idx, size_bytes - byte_idx);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i popcntBytesSsse3(const __m128i value) {
+  const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m128i low_nibble_mask = _mm_set1_epi8(0x0f);
+  return _mm_add_epi8(
+      _mm_shuffle_epi8(lookup, _mm_and_si128(value, low_nibble_mask)),
+      _mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(value, 4), low_nibble_mask)));
+}
+
+// The largest descriptors kept in registers by the one-to-many kernels, e.g. FREAK.
+constexpr int kMaxOneToManySizeBytes = 64;
+
+template <uint32_t (*PopcntOfXORed)(const unsigned char*, const unsigned char*, int)>
+inline bool popcntsOfXORedFallback(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, uint32_t* distances) {
+  if (size_bytes % 16 == 0 && size_bytes <= kMaxOneToManySizeBytes) {
+    return false;
+  }
+  popcntsOfXORedPairwise<PopcntOfXORed>(
+      query, descriptors, size_bytes, column_indices, num_descriptors, distances);
+  return true;
+}
+
+__attribute__((target("ssse3")))
+void popcntsOfXORedOneToManySsse3(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, uint32_t* distances) {
+  if (popcntsOfXORedFallback<popcntOfXORedSsse3>(
+      query, descriptors, size_bytes, column_indices, num_descriptors, distances)) {
+    return;
+  }
+  const int num_blocks = size_bytes / 16;
+  __m128i query_blocks[kMaxOneToManySizeBytes / 16];
+  for (int block_idx = 0; block_idx < num_blocks; ++block_idx) {
+    query_blocks[block_idx] =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(query) + block_idx);
+  }
+  const __m128i zero = _mm_setzero_si128();
+  for (int idx = 0; idx < num_descriptors; ++idx) {
+    const __m128i* descriptor = reinterpret_cast<const __m128i*>(
+        getDescriptor(descriptors, size_bytes, column_indices, idx));
+    // At most 4 * 8 bits per byte, the byte counters cannot overflow.
+    __m128i counts = zero;
+    for (int block_idx = 0; block_idx < num_blocks; ++block_idx) {
+      counts = _mm_add_epi8(counts, popcntBytesSsse3(_mm_xor_si128(
+          query_blocks[block_idx], _mm_loadu_si128(descriptor + block_idx))));
+    }
+    const __m128i sums = _mm_sad_epu8(counts, zero);
+    distances[idx] = static_cast<uint32_t>(_mm_cvtsi128_si32(sums)) +
+        static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+  }
+}
+
+__attribute__((target("avx2")))
+uint32_t popcntOfXORedAvx2(
+    const unsigned char* signature1, const unsigned char* signature2, int size_bytes) {
+  const __m256i lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i accumulator = zero;
+  int byte_idx = 0;
+  for (; byte_idx + 32 <= size_bytes; byte_idx += 32) {
+    const __m256i xored = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signature1 + byte_idx)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signature2 + byte_idx)));
+    const __m256i low_nibbles = _mm256_and_si256(xored, low_nibble_mask);
+    const __m256i high_nibbles =
+        _mm256_and_si256(_mm256_srli_epi16(xored, 4), low_nibble_mask);
+    const __m256i counts = _mm256_add_epi8(
+        _mm256_shuffle_epi8(lookup, low_nibbles), _mm256_shuffle_epi8(lookup, high_nibbles));
+    accumulator = _mm256_add_epi64(accumulator, _mm256_sad_epu8(counts, zero));
+  }
+  __m128i accumulator_128 = _mm_add_epi64(
+      _mm256_castsi256_si128(accumulator), _mm256_extracti128_si256(accumulator, 1));
+  if (byte_idx + 16 <= size_bytes) {
+    // E.g. the second half of a 48 byte BRISK descriptor.
+    const __m128i xored = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(signature1 + byte_idx)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(signature2 + byte_idx)));
+    const __m128i low_nibbles = _mm_and_si128(xored, _mm256_castsi256_si128(low_nibble_mask));
+    const __m128i high_nibbles = _mm_and_si128(
+        _mm_srli_epi16(xored, 4), _mm256_castsi256_si128(low_nibble_mask));
+    const __m128i counts = _mm_add_epi8(
+        _mm_shuffle_epi8(_mm256_castsi256_si128(lookup), low_nibbles),
+        _mm_shuffle_epi8(_mm256_castsi256_si128(lookup), high_nibbles));
+    accumulator_128 = _mm_add_epi64(
+        accumulator_128, _mm_sad_epu8(counts, _mm256_castsi256_si128(zero)));
+    byte_idx += 16;
+  }
+  const uint32_t result = static_cast<uint32_t>(_mm_cvtsi128_si32(accumulator_128)) +
+      static_cast<uint32_t>(
+          _mm_cvtsi128_si32(_mm_unpackhi_epi64(accumulator_128, accumulator_128)));
+  return result + popcntOfXORedScalar(
+      signature1 + byte_idx, signature2 + byte_idx, size_bytes - byte_idx);
+}
+
+__attribute__((target("avx2")))
+void popcntsOfXORedOneToManyAvx2(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, uint32_t* distances) {
+  if (popcntsOfXORedFallback<popcntOfXORedAvx2>(
+      query, descriptors, size_bytes, column_indices, num_descriptors, distances)) {
+    return;
+  }
+  const __m256i lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  // A 16 byte remainder, e.g. of a 48 byte BRISK descriptor, is loaded into the lower half of a
+  // 256 bit register with the upper half of the query set to zero, so it does not count.
+  const int num_blocks = (size_bytes + 31) / 32;
+  const bool has_half_block = size_bytes % 32 != 0;
+  __m256i query_blocks[kMaxOneToManySizeBytes / 32];
+  for (int block_idx = 0; block_idx < num_blocks; ++block_idx) {
+    if (has_half_block && block_idx + 1 == num_blocks) {
+      query_blocks[block_idx] = _mm256_inserti128_si256(
+          zero, _mm_loadu_si128(reinterpret_cast<const __m128i*>(query + 32 * block_idx)), 0);
+    } else {
+      query_blocks[block_idx] =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query + 32 * block_idx));
+    }
+  }
+  const int num_full_blocks = has_half_block ? num_blocks - 1 : num_blocks;
+  for (int idx = 0; idx < num_descriptors; ++idx) {
+    const unsigned char* descriptor =
+        getDescriptor(descriptors, size_bytes, column_indices, idx);
+    __m256i counts = zero;
+    for (int block_idx = 0; block_idx < num_full_blocks; ++block_idx) {
+      const __m256i xored = _mm256_xor_si256(
+          query_blocks[block_idx],
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(descriptor + 32 * block_idx)));
+      counts = _mm256_add_epi8(counts, _mm256_add_epi8(
+          _mm256_shuffle_epi8(lookup, _mm256_and_si256(xored, low_nibble_mask)),
+          _mm256_shuffle_epi8(
+              lookup, _mm256_and_si256(_mm256_srli_epi16(xored, 4), low_nibble_mask))));
+    }
+    if (has_half_block) {
+      // The upper half of the descriptor is not loaded, it may lie beyond the last one.
+      const __m256i xored = _mm256_xor_si256(
+          query_blocks[num_full_blocks],
+          _mm256_inserti128_si256(zero, _mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(descriptor + 32 * num_full_blocks)), 0));
+      counts = _mm256_add_epi8(counts, _mm256_add_epi8(
+          _mm256_shuffle_epi8(lookup, _mm256_and_si256(xored, low_nibble_mask)),
+          _mm256_shuffle_epi8(
+              lookup, _mm256_and_si256(_mm256_srli_epi16(xored, 4), low_nibble_mask))));
+    }
+    const __m256i sums = _mm256_sad_epu8(counts, zero);
+    const __m128i sums_128 =
+        _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    distances[idx] = static_cast<uint32_t>(_mm_cvtsi128_si32(sums_128)) +
+        static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums_128, sums_128)));
+  }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vpopcntdq")))
+uint32_t popcntOfXORedAvx512Vpopcntdq(
+    const unsigned char* signature1, const unsigned char* signature2, int size_bytes) {
+  __m512i accumulator = _mm512_setzero_si512();
+  int byte_idx = 0;
+  for (; byte_idx + 64 <= size_bytes; byte_idx += 64) {
+    const __m512i xored = _mm512_xor_si512(
+        _mm512_loadu_si512(signature1 + byte_idx), _mm512_loadu_si512(signature2 + byte_idx));
+    accumulator = _mm512_add_epi64(accumulator, _mm512_popcnt_epi64(xored));
+  }
+  if (byte_idx < size_bytes) {
+    // The masked loads do not touch the bytes beyond the end of the descriptors.
+    const __mmask64 tail_mask = ~0ull >> (64 - (size_bytes - byte_idx));
+    const __m512i xored = _mm512_xor_si512(
+        _mm512_maskz_loadu_epi8(tail_mask, signature1 + byte_idx),
+        _mm512_maskz_loadu_epi8(tail_mask, signature2 + byte_idx));
+    accumulator = _mm512_add_epi64(accumulator, _mm512_popcnt_epi64(xored));
+  }
+  uint64_t __attribute__((aligned(64))) counters[8];
+  _mm512_store_si512(counters, accumulator);
+  uint64_t result = 0u;
+  for (const uint64_t counter : counters) {
+    result += counter;
+  }
+  return static_cast<uint32_t>(result);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vpopcntdq")))
+void popcntsOfXORedOneToManyAvx512Vpopcntdq(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, uint32_t* distances) {
+  if (size_bytes > kMaxOneToManySizeBytes) {
+    popcntsOfXORedPairwise<popcntOfXORedAvx512Vpopcntdq>(
+        query, descriptors, size_bytes, column_indices, num_descriptors, distances);
+    return;
+  }
+  // Any descriptor of up to 64 bytes fits into one register. The masked loads do not touch the
+  // bytes beyond the descriptors.
+  const __mmask64 mask = (size_bytes == 64) ? ~0ull : ((1ull << size_bytes) - 1ull);
+  const __m512i query_block = _mm512_maskz_loadu_epi8(mask, query);
+  uint64_t __attribute__((aligned(64))) counters[8];
+  for (int idx = 0; idx < num_descriptors; ++idx) {
+    const __m512i xored = _mm512_xor_si512(query_block, _mm512_maskz_loadu_epi8(
+        mask, getDescriptor(descriptors, size_bytes, column_indices, idx)));
+    _mm512_store_si512(counters, _mm512_popcnt_epi64(xored));
+    uint64_t distance = 0u;
+    for (const uint64_t counter : counters) {
+      distance += counter;
+    }
+    distances[idx] = static_cast<uint32_t>(distance);
+  }
+}
+
+struct CpuFeatures {
+  bool ssse3 = false;
+  bool avx2 = false;
+  bool avx512_vpopcntdq = false;
+};
+
+CpuFeatures detectCpuFeatures() {
+  CpuFeatures features;
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(1u, &eax, &ebx, &ecx, &edx) == 0) {
+    return features;
+  }
+  features.ssse3 = (ecx & bit_SSSE3) != 0u;
+
+  // The OS has to save the AVX (and AVX-512) registers on context switches.
+  uint64_t xcr0 = 0u;
+  if ((ecx & bit_OSXSAVE) != 0u) {
+    uint32_t xcr0_low, xcr0_high;
+    __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+    xcr0 = (static_cast<uint64_t>(xcr0_high) << 32) | xcr0_low;
+  }
+  constexpr uint64_t kXcr0AvxState = 0x6u;
+  constexpr uint64_t kXcr0Avx512State = 0xe6u;
+  const bool os_saves_avx = (xcr0 & kXcr0AvxState) == kXcr0AvxState;
+  const bool os_saves_avx512 = (xcr0 & kXcr0Avx512State) == kXcr0Avx512State;
+
+  if (__get_cpuid_max(0u, nullptr) < 7u) {
+    return features;
+  }
+  __cpuid_count(7u, 0u, eax, ebx, ecx, edx);
+  constexpr unsigned int kCpuid7EbxAvx2 = 1u << 5;
+  constexpr unsigned int kCpuid7EbxAvx512F = 1u << 16;
+  constexpr unsigned int kCpuid7EbxAvx512Bw = 1u << 30;
+  constexpr unsigned int kCpuid7EcxAvx512Vpopcntdq = 1u << 14;
+  features.avx2 = os_saves_avx && (ebx & kCpuid7EbxAvx2) != 0u;
+  features.avx512_vpopcntdq = os_saves_avx512 && (ebx & kCpuid7EbxAvx512F) != 0u &&
+      (ebx & kCpuid7EbxAvx512Bw) != 0u && (ecx & kCpuid7EcxAvx512Vpopcntdq) != 0u;
+  return features;
+}
+
+const CpuFeatures& getCpuFeatures() {
+  static const CpuFeatures kCpuFeatures = detectCpuFeatures();
+  return kCpuFeatures;
+}
+#endif  // ASLAM_HAMMING_X86
+
+#ifdef __ARM_NEON
+uint32_t popcntOfXORedNeon(
+    const unsigned char* signature1, const unsigned char* signature2, int size_bytes) {
+  uint64x2_t accumulator = vdupq_n_u64(0u);
+  int byte_idx = 0;
+  for (; byte_idx + 16 <= size_bytes; byte_idx += 16) {
+    const uint8x16_t counts = vcntq_u8(
+        veorq_u8(vld1q_u8(signature1 + byte_idx), vld1q_u8(signature2 + byte_idx)));
+    accumulator = vaddq_u64(accumulator, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(counts))));
+  }
+  const uint32_t result = static_cast<uint32_t>(
+      vgetq_lane_u64(accumulator, 0) + vgetq_lane_u64(accumulator, 1));
+  return result + popcntOfXORedScalar(
+      signature1 + byte_idx, signature2 + byte_idx, size_bytes - byte_idx);
+}
+#endif  // __ARM_NEON
+
+struct KernelFunctions {
+  internal::PopcntofXORedFunction popcnt_of_xored;
+  internal::PopcntsofXORedOneToManyFunction popcnts_of_xored_one_to_many;
+};
+
+KernelFunctions getKernelFunctions(HammingKernel kernel) {
+  switch (kernel) {
+    case HammingKernel::kScalar:
+      return {&popcntOfXORedScalar, &popcntsOfXORedPairwise<popcntOfXORedScalar>};
+#ifdef ASLAM_HAMMING_X86
+    case HammingKernel::kSsse3:
+      return {&popcntOfXORedSsse3, &popcntsOfXORedOneToManySsse3};
+    case HammingKernel::kAvx2:
+      return {&popcntOfXORedAvx2, &popcntsOfXORedOneToManyAvx2};
+    case HammingKernel::kAvx512Vpopcntdq:
+      return {&popcntOfXORedAvx512Vpopcntdq, &popcntsOfXORedOneToManyAvx512Vpopcntdq};
+#endif  // ASLAM_HAMMING_X86
+#ifdef __ARM_NEON
+    case HammingKernel::kNeon:
+      return {&popcntOfXORedNeon, &popcntsOfXORedPairwise<popcntOfXORedNeon>};
+#endif  // __ARM_NEON
+    default:
+      return {nullptr, nullptr};
+  }
+}
+
+void storeKernelFunctions(HammingKernel kernel) {
+  const KernelFunctions functions = getKernelFunctions(kernel);
+  internal::popcnts_of_xored_one_to_many.store(
+      functions.popcnts_of_xored_one_to_many, std::memory_order_relaxed);
+  internal::popcnt_of_xored.store(functions.popcnt_of_xored, std::memory_order_relaxed);
+}
+
+HammingKernel selectFastestKernel() {
+  for (const HammingKernel kernel :
+       {HammingKernel::kAvx512Vpopcntdq, HammingKernel::kAvx2, HammingKernel::kSsse3,
+        HammingKernel::kNeon}) {
+    if (isHammingKernelSupported(kernel)) {
+      return kernel;
+    }
+  }
+  return HammingKernel::kScalar;
+}
+
+uint32_t selectKernelAndPopcntOfXORed(
+    const unsigned char* signature1, const unsigned char* signature2, int size_bytes) {
+  // Concurrent first calls all select the same kernel.
+  const HammingKernel kernel = selectFastestKernel();
+  storeKernelFunctions(kernel);
+  return getKernelFunctions(kernel).popcnt_of_xored(signature1, signature2, size_bytes);
+}
+
+void selectKernelAndPopcntsOfXORedOneToMany(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, uint32_t* distances) {
+  const HammingKernel kernel = selectFastestKernel();
+  storeKernelFunctions(kernel);
+  getKernelFunctions(kernel).popcnts_of_xored_one_to_many(
+      query, descriptors, size_bytes, column_indices, num_descriptors, distances);
+}
+
+void getTwoSmallestHammingDistancesImpl(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_descriptors, TwoSmallestHammingDistances* result) {
+  CHECK_NOTNULL(result);
+  *result = TwoSmallestHammingDistances();
+  // The distances are computed in chunks that stay in the L1 cache.
+  constexpr int kChunkSize = 256;
+  uint32_t distances[kChunkSize];
+  for (int chunk_begin = 0; chunk_begin < num_descriptors; chunk_begin += kChunkSize) {
+    const int chunk_size = std::min(kChunkSize, num_descriptors - chunk_begin);
+    internal::popcnts_of_xored_one_to_many.load(std::memory_order_relaxed)(
+        query, (column_indices == nullptr) ?
+            descriptors + static_cast<ptrdiff_t>(chunk_begin) * size_bytes : descriptors,
+        size_bytes, (column_indices == nullptr) ? nullptr : column_indices + chunk_begin,
+        chunk_size, distances);
+    for (int idx = 0; idx < chunk_size; ++idx) {
+      if (distances[idx] < result->best_distance) {
+        result->second_best_distance = result->best_distance;
+        result->best_distance = distances[idx];
+        result->best_index = chunk_begin + idx;
+      } else if (distances[idx] < result->second_best_distance) {
+        result->second_best_distance = distances[idx];
+      }
+    }
+  }
+}
+}  // namespace
+
+namespace internal {
+// Constant initialized, so the kernel is selected correctly even from static initializers.
+std::atomic<PopcntofXORedFunction> popcnt_of_xored(&selectKernelAndPopcntOfXORed);
+std::atomic<PopcntsofXORedOneToManyFunction> popcnts_of_xored_one_to_many(
+    &selectKernelAndPopcntsOfXORedOneToMany);
+}  // namespace internal
+
+constexpr uint32_t TwoSmallestHammingDistances::kNoDistance;
+
+void getTwoSmallestHammingDistances(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    int num_descriptors, TwoSmallestHammingDistances* result) {
+  getTwoSmallestHammingDistancesImpl(
+      query, descriptors, size_bytes, nullptr, num_descriptors, result);
+}
+
+void getTwoSmallestHammingDistances(
+    const unsigned char* query, const unsigned char* descriptors, int size_bytes,
+    const int* column_indices, int num_column_indices, TwoSmallestHammingDistances* result) {
+  CHECK_NOTNULL(column_indices);
+  getTwoSmallestHammingDistancesImpl(
+      query, descriptors, size_bytes, column_indices, num_column_indices, result);
+}
+
+bool isHammingKernelSupported(HammingKernel kernel) {
+  switch (kernel) {
+    case HammingKernel::kScalar:
+      return true;
+#ifdef ASLAM_HAMMING_X86
+    case HammingKernel::kSsse3:
+      return getCpuFeatures().ssse3;
+    case HammingKernel::kAvx2:
+      return getCpuFeatures().avx2;
+    case HammingKernel::kAvx512Vpopcntdq:
+      return getCpuFeatures().avx512_vpopcntdq;
+#endif  // ASLAM_HAMMING_X86
+#ifdef __ARM_NEON
+    case HammingKernel::kNeon:
+      return true;
+#endif  // __ARM_NEON
+    default:
+      return false;
+  }
+}
+
+HammingKernel getHammingKernel() {
+  const internal::PopcntofXORedFunction function =
+      internal::popcnt_of_xored.load(std::memory_order_relaxed);
+  for (const HammingKernel kernel :
+       {HammingKernel::kScalar, HammingKernel::kSsse3, HammingKernel::kAvx2,
+        HammingKernel::kAvx512Vpopcntdq, HammingKernel::kNeon}) {
+    if (function == getKernelFunctions(kernel).popcnt_of_xored) {
+      return kernel;
+    }
+  }
+  // No distance was computed yet.
+  return selectFastestKernel();
+}
+
+bool setHammingKernel(HammingKernel kernel) {
+  if (!isHammingKernelSupported(kernel)) {
+    LOG(WARNING) << "The CPU does not support the Hamming kernel "
+                 << hammingKernelToString(kernel) << ".";
+    return false;
+  }
+  storeKernelFunctions(kernel);
+  return true;
+}
+
+std::string hammingKernelToString(HammingKernel kernel) {
+  switch (kernel) {
+    case HammingKernel::kScalar:
+      return "scalar";
+    case HammingKernel::kSsse3:
+      return "SSSE3";
+    case HammingKernel::kAvx2:
+      return "AVX2";
+    case HammingKernel::kAvx512Vpopcntdq:
+      return "AVX-512 VPOPCNTDQ";
+    case HammingKernel::kNeon:
+      return "NEON";
+    default:
+      LOG(FATAL) << "Unknown Hamming kernel " << static_cast<int>(kernel) << ".";
+  }
+  return "";
+}
+
+}  // namespace common
+}  // namespace aslam
@@ -0,0 +1,94 @@
+#include "aslam/common/keypoint-grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace common {
+
+namespace {
+inline size_t getNumCellsForCellSize(double image_size, double cell_size) {
+  CHECK_GT(cell_size, 0.0);
+  return std::max(static_cast<size_t>(image_size / cell_size), static_cast<size_t>(1u));
+}
+}  // namespace
+
+KeypointGrid::KeypointGrid(double image_width, double image_height, size_t num_cells_x,
+                           size_t num_cells_y)
+    : num_cells_x_(num_cells_x),
+      num_cells_y_(num_cells_y),
+      cell_width_(image_width / static_cast<double>(num_cells_x)),
+      cell_height_(image_height / static_cast<double>(num_cells_y)),
+      cell_begin_(num_cells_x * num_cells_y + 1u, 0u) {
+  CHECK_GT(image_width, 0.0);
+  CHECK_GT(image_height, 0.0);
+  CHECK_GT(num_cells_x, 0u);
+  CHECK_GT(num_cells_y, 0u);
+}
+
+KeypointGrid::KeypointGrid(double image_width, double image_height, double cell_size)
+    : KeypointGrid(image_width, image_height, getNumCellsForCellSize(image_width, cell_size),
+                   getNumCellsForCellSize(image_height, cell_size)) {}
+
+void KeypointGrid::build(const Eigen::Matrix2Xd& keypoints) {
+  build(keypoints, std::vector<bool>(keypoints.cols(), true));
+}
+
+void KeypointGrid::build(const Eigen::Matrix2Xd& keypoints, const std::vector<bool>& is_valid) {
+  CHECK_EQ(static_cast<int>(is_valid.size()), keypoints.cols());
+
+  // Counting sort of the keypoints by cell. Keypoints of the same cell stay ordered by index.
+  std::vector<uint32_t> cell_indices(keypoints.cols());
+  std::fill(cell_begin_.begin(), cell_begin_.end(), 0u);
+  for (int keypoint_idx = 0; keypoint_idx < keypoints.cols(); ++keypoint_idx) {
+    if (!is_valid[keypoint_idx]) {
+      continue;
+    }
+    cell_indices[keypoint_idx] = static_cast<uint32_t>(getCellIndex(keypoints.col(keypoint_idx)));
+    ++cell_begin_[cell_indices[keypoint_idx] + 1u];
+  }
+  for (size_t cell_idx = 1u; cell_idx < cell_begin_.size(); ++cell_idx) {
+    cell_begin_[cell_idx] += cell_begin_[cell_idx - 1u];
+  }
+
+  const size_t num_indexed_keypoints = cell_begin_.back();
+  keypoint_indices_.resize(num_indexed_keypoints);
+  sorted_keypoints_.resize(Eigen::NoChange, num_indexed_keypoints);
+  std::vector<uint32_t> cell_end(cell_begin_.begin(), cell_begin_.end() - 1);
+  for (int keypoint_idx = 0; keypoint_idx < keypoints.cols(); ++keypoint_idx) {
+    if (is_valid[keypoint_idx]) {
+      const uint32_t sorted_idx = cell_end[cell_indices[keypoint_idx]]++;
+      keypoint_indices_[sorted_idx] = keypoint_idx;
+      sorted_keypoints_.col(sorted_idx) = keypoints.col(keypoint_idx);
+    }
+  }
+}
+
+void KeypointGrid::getKeypointsInRectangle(
+    double x_min, double x_max, double y_min, double y_max,
+    std::vector<int>* keypoint_indices) const {
+  CHECK_NOTNULL(keypoint_indices)->clear();
+  if (!(x_min <= x_max && y_min <= y_max) || keypoint_indices_.empty()) {
+    return;
+  }
+  const size_t cell_x_min = getCellX(x_min);
+  const size_t cell_x_max = getCellX(x_max);
+  const size_t cell_y_max = getCellY(y_max);
+  for (size_t cell_y = getCellY(y_min); cell_y <= cell_y_max; ++cell_y) {
+    // The cells of a row are contiguous in the index.
+    const uint32_t row_begin = cell_begin_[cell_y * num_cells_x_ + cell_x_min];
+    const uint32_t row_end = cell_begin_[cell_y * num_cells_x_ + cell_x_max + 1u];
+    for (uint32_t sorted_idx = row_begin; sorted_idx < row_end; ++sorted_idx) {
+      const double x = sorted_keypoints_(0, sorted_idx);
+      const double y = sorted_keypoints_(1, sorted_idx);
+      if (x >= x_min && x <= x_max && y >= y_min && y <= y_max) {
+        keypoint_indices->push_back(keypoint_indices_[sorted_idx]);
+      }
+    }
+  }
+}
+
+}  // namespace common
+}  // namespace aslam
@@ -1,5 +1,10 @@
 #include <algorithm>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include <aslam/common/thread-pool.h>
 
 namespace aslam {
@@ -121,11 +126,45 @@ void ThreadPool::run() {
   }
 }
 
+size_t ThreadPool::numQueuedTasks() const {
+  std::unique_lock<std::mutex> lock(this->tasks_mutex_);
+  return numQueuedTasksImpl();
+}
+
+size_t ThreadPool::numQueuedTasksImpl() const {
+  return groupid_tasks_.size();
+}
+
 size_t ThreadPool::numActiveThreads() const {
   std::unique_lock<std::mutex> lock(this->tasks_mutex_);
   return active_threads_;
 }
 
+bool ThreadPool::pinThreadsToCores(const std::vector<int>& core_ids) {
+  CHECK(!core_ids.empty());
+#ifdef __linux__
+  bool success = true;
+  for (size_t i = 0u; i < workers_.size(); ++i) {
+    const int core_id = core_ids[i % core_ids.size()];
+    CHECK_GE(core_id, 0);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(core_id, &cpu_set);
+    const int result = pthread_setaffinity_np(
+        workers_[i].native_handle(), sizeof(cpu_set_t), &cpu_set);
+    if (result != 0) {
+      LOG(WARNING) << "Could not pin worker thread " << i << " to core " << core_id
+                   << " (error " << result << ").";
+      success = false;
+    }
+  }
+  return success;
+#else
+  LOG(WARNING) << "Pinning threads to cores is only supported on Linux.";
+  return false;
+#endif
+}
+
 void ThreadPool::waitForEmptyQueue() const {
   std::unique_lock<std::mutex> lock(this->tasks_mutex_);
   // Only exit if all tasks are complete by tracking the number of
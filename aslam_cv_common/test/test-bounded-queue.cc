@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <aslam/common/bounded-queue.h>
+#include <aslam/common/entrypoint.h>
+
+TEST(BoundedQueueTests, TestFifoOrderAndShutdown) {
+  aslam::common::BoundedQueue<int> queue(2u);
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_TRUE(queue.push(2));
+  EXPECT_EQ(2u, queue.size());
+  int value = -1;
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(1, value);
+
+  queue.shutdown();
+  EXPECT_FALSE(queue.push(3));
+  // The remaining values can still be popped.
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(2, value);
+  EXPECT_FALSE(queue.pop(&value));
+}
+
+TEST(BoundedQueueTests, TestProducerBlocksWhileFull) {
+  constexpr int kNumValues = 10000;
+  constexpr size_t kMaxSize = 4u;
+  aslam::common::BoundedQueue<int> queue(kMaxSize);
+  size_t max_observed_size = 0u;
+  std::thread producer([&queue]() {
+    for (int i = 0; i < kNumValues; ++i) {
+      EXPECT_TRUE(queue.push(i));
+    }
+    queue.shutdown();
+  });
+  int expected = 0;
+  int value = -1;
+  while (queue.pop(&value)) {
+    EXPECT_EQ(expected, value);
+    ++expected;
+    max_observed_size = std::max(max_observed_size, queue.size());
+  }
+  producer.join();
+  EXPECT_EQ(kNumValues, expected);
+  EXPECT_LE(max_observed_size, kMaxSize);
+}
+
+TEST(BoundedQueueTests, TestPushDroppingOldest) {
+  aslam::common::BoundedQueue<int> queue(2u);
+  int dropped_value = -1;
+  bool is_value_dropped = true;
+  EXPECT_TRUE(queue.pushDroppingOldest(1, &dropped_value, &is_value_dropped));
+  EXPECT_FALSE(is_value_dropped);
+  EXPECT_TRUE(queue.pushDroppingOldest(2, &dropped_value, &is_value_dropped));
+  EXPECT_FALSE(is_value_dropped);
+  // The queue is full, so the oldest value makes room instead of blocking.
+  EXPECT_TRUE(queue.pushDroppingOldest(3, &dropped_value, &is_value_dropped));
+  EXPECT_TRUE(is_value_dropped);
+  EXPECT_EQ(1, dropped_value);
+  EXPECT_EQ(2u, queue.size());
+
+  queue.shutdown();
+  EXPECT_FALSE(queue.pushDroppingOldest(4, &dropped_value, &is_value_dropped));
+  EXPECT_FALSE(is_value_dropped);
+  int value = -1;
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(2, value);
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(3, value);
+  EXPECT_FALSE(queue.pop(&value));
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -226,4 +226,53 @@ TEST(SimpleSerializationTest, SerializeDeserializeSimpleTypes) {
   SimpleTypeTestHarness<long long> long_long_test(65465461321487);
 }
 
+TEST(ChannelSerialization, SerializeDeserializeImagePyramid) {
+  // Levels that are views into padded images, as returned by cv::buildOpticalFlowPyramid.
+  cv::Mat padded_level_0(24, 32, CV_8UC1);
+  cv::randu(padded_level_0, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::Mat padded_level_1(16, 20, CV_16SC2);
+  cv::randu(padded_level_1, cv::Scalar::all(-100), cv::Scalar::all(100));
+
+  aslam::channels::IMAGE_PYRAMID pyramid_a;
+  pyramid_a.value_.push_back(padded_level_0(cv::Rect(4, 4, 24, 16)));
+  pyramid_a.value_.push_back(padded_level_1(cv::Rect(2, 2, 12, 8)));
+  ASSERT_FALSE(pyramid_a.value_[0].isContinuous());
+
+  std::string serialized_value;
+  EXPECT_TRUE(pyramid_a.serializeToString(&serialized_value));
+  aslam::channels::IMAGE_PYRAMID pyramid_b;
+  EXPECT_FALSE(pyramid_a == pyramid_b);
+  EXPECT_TRUE(pyramid_b.deSerializeFromString(serialized_value));
+  ASSERT_EQ(pyramid_b.value_.size(), 2u);
+  EXPECT_TRUE(pyramid_a == pyramid_b);
+
+  char* buffer;
+  size_t size;
+  EXPECT_TRUE(pyramid_a.serializeToBuffer(&buffer, &size));
+  EXPECT_EQ(size, serialized_value.size());
+  aslam::channels::IMAGE_PYRAMID pyramid_c;
+  EXPECT_TRUE(pyramid_c.deSerializeFromBuffer(buffer, size));
+  EXPECT_TRUE(pyramid_a == pyramid_c);
+  delete[] buffer;
+
+  // A truncated buffer is rejected.
+  EXPECT_FALSE(pyramid_c.deSerializeFromBuffer(serialized_value.data(), 10u));
+  // So are trailing bytes, an image count beyond the buffer and an inconsistent image header.
+  std::string corrupted_value = serialized_value + "x";
+  EXPECT_FALSE(pyramid_c.deSerializeFromString(corrupted_value));
+  corrupted_value = serialized_value;
+  const uint32_t num_images = 0xffffffffu;
+  corrupted_value.replace(0u, sizeof(num_images),
+                          reinterpret_cast<const char*>(&num_images), sizeof(num_images));
+  EXPECT_FALSE(pyramid_c.deSerializeFromString(corrupted_value));
+  corrupted_value = serialized_value;
+  // The row count of the first image, after the image count and the image size.
+  corrupted_value[sizeof(uint32_t) + sizeof(uint64_t)] += 1;
+  EXPECT_FALSE(pyramid_c.deSerializeFromString(corrupted_value));
+  EXPECT_TRUE(pyramid_a == pyramid_c);
+
+  pyramid_c.value_[1].at<cv::Vec2s>(3, 3)[1] += 1;
+  EXPECT_FALSE(pyramid_a == pyramid_c);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
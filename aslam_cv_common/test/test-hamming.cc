@@ -0,0 +1,210 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/feature-descriptor-ref.h>
+#include <aslam/common/hamming.h>
+#include <gtest/gtest.h>
+
+namespace aslam {
+namespace common {
+
+namespace {
+const std::vector<HammingKernel> kAllKernels = {
+    HammingKernel::kScalar, HammingKernel::kSsse3, HammingKernel::kAvx2,
+    HammingKernel::kAvx512Vpopcntdq, HammingKernel::kNeon};
+
+int countBitsDifferent(const unsigned char* a, const unsigned char* b, int size_bytes) {
+  int num_bits = 0;
+  for (int byte_idx = 0; byte_idx < size_bytes; ++byte_idx) {
+    for (int bit = 0; bit < 8; ++bit) {
+      num_bits += ((a[byte_idx] ^ b[byte_idx]) >> bit) & 1;
+    }
+  }
+  return num_bits;
+}
+}  // namespace
+
+class HammingTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    initial_kernel_ = getHammingKernel();
+  }
+
+  virtual void TearDown() {
+    EXPECT_TRUE(setHammingKernel(initial_kernel_));
+  }
+
+  HammingKernel initial_kernel_;
+};
+
+TEST_F(HammingTest, ScalarAlwaysSupported) {
+  EXPECT_TRUE(isHammingKernelSupported(HammingKernel::kScalar));
+  EXPECT_TRUE(isHammingKernelSupported(getHammingKernel()));
+}
+
+TEST_F(HammingTest, AllKernelsAgreeForAllSizesAndAlignments) {
+  constexpr int kMaxSizeBytes = 200;
+  constexpr int kMaxOffsetBytes = 16;
+  std::mt19937 random_engine(42);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  std::vector<unsigned char> buffer1(kMaxSizeBytes + kMaxOffsetBytes);
+  std::vector<unsigned char> buffer2(kMaxSizeBytes + kMaxOffsetBytes);
+  for (size_t idx = 0u; idx < buffer1.size(); ++idx) {
+    buffer1[idx] = static_cast<unsigned char>(byte_distribution(random_engine));
+    buffer2[idx] = static_cast<unsigned char>(byte_distribution(random_engine));
+  }
+  // All bits different in the first bytes, so the counters of a kernel have to hold more
+  // than a byte.
+  for (int idx = 0; idx < kMaxSizeBytes / 2; ++idx) {
+    buffer1[idx] = 0xff;
+    buffer2[idx] = 0x00;
+  }
+
+  for (const HammingKernel kernel : kAllKernels) {
+    if (!isHammingKernelSupported(kernel)) {
+      continue;
+    }
+    ASSERT_TRUE(setHammingKernel(kernel));
+    EXPECT_EQ(kernel, getHammingKernel());
+    for (int offset = 0; offset < kMaxOffsetBytes; offset += 3) {
+      for (int size_bytes = 0; size_bytes <= kMaxSizeBytes; ++size_bytes) {
+        const unsigned char* a = buffer1.data() + offset;
+        const unsigned char* b = buffer2.data() + offset;
+        EXPECT_EQ(countBitsDifferent(a, b, size_bytes), Hamming::evaluate(a, b, size_bytes))
+            << "Kernel " << hammingKernelToString(kernel) << ", size " << size_bytes
+            << ", offset " << offset;
+      }
+    }
+  }
+}
+
+TEST_F(HammingTest, GetNumBitsDifferentUsesSelectedKernel) {
+  for (const HammingKernel kernel : kAllKernels) {
+    if (!isHammingKernelSupported(kernel)) {
+      continue;
+    }
+    ASSERT_TRUE(setHammingKernel(kernel));
+    for (const uint32_t size_bytes : {32u, 48u, 64u}) {
+      FeatureDescriptorRef descriptor1(size_bytes);
+      FeatureDescriptorRef descriptor2(size_bytes);
+      descriptor1.SetZero();
+      descriptor2.SetZero();
+      constexpr size_t kNumBitsToFlip = 17u;
+      FlipNRandomBits(kNumBitsToFlip, &descriptor2);
+      EXPECT_EQ(kNumBitsToFlip, GetNumBitsDifferent(descriptor1, descriptor2));
+    }
+  }
+}
+
+TEST_F(HammingTest, OneToManyAgreesWithPairwiseForAllKernels) {
+  constexpr int kMaxSizeBytes = 100;
+  constexpr int kNumDescriptors = 37;
+  std::mt19937 random_engine(42);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  std::uniform_int_distribution<int> column_distribution(0, kNumDescriptors - 1);
+  std::vector<int> column_indices(2 * kNumDescriptors);
+  for (int& column_index : column_indices) {
+    column_index = column_distribution(random_engine);
+  }
+
+  for (const HammingKernel kernel : kAllKernels) {
+    if (!isHammingKernelSupported(kernel)) {
+      continue;
+    }
+    ASSERT_TRUE(setHammingKernel(kernel));
+    for (int size_bytes = 0; size_bytes <= kMaxSizeBytes; ++size_bytes) {
+      // The descriptors are exactly as large as needed, so reading beyond the last one would
+      // be caught by the address sanitizer.
+      std::vector<unsigned char> query(size_bytes);
+      std::vector<unsigned char> descriptors(size_bytes * kNumDescriptors);
+      for (unsigned char& byte : query) {
+        byte = static_cast<unsigned char>(byte_distribution(random_engine));
+      }
+      for (unsigned char& byte : descriptors) {
+        byte = static_cast<unsigned char>(byte_distribution(random_engine));
+      }
+
+      std::vector<uint32_t> distances(kNumDescriptors);
+      getHammingDistancesOneToMany(
+          query.data(), descriptors.data(), size_bytes, kNumDescriptors, distances.data());
+      for (int idx = 0; idx < kNumDescriptors; ++idx) {
+        EXPECT_EQ(countBitsDifferent(query.data(), &descriptors[idx * size_bytes], size_bytes),
+                  static_cast<int>(distances[idx]))
+            << "Kernel " << hammingKernelToString(kernel) << ", size " << size_bytes
+            << ", descriptor " << idx;
+      }
+
+      std::vector<uint32_t> indexed_distances(column_indices.size());
+      getHammingDistancesOneToMany(
+          query.data(), descriptors.data(), size_bytes, column_indices.data(),
+          static_cast<int>(column_indices.size()), indexed_distances.data());
+      for (size_t idx = 0u; idx < column_indices.size(); ++idx) {
+        EXPECT_EQ(distances[column_indices[idx]], indexed_distances[idx])
+            << "Kernel " << hammingKernelToString(kernel) << ", size " << size_bytes
+            << ", index " << idx;
+      }
+    }
+  }
+}
+
+TEST_F(HammingTest, TwoSmallestDistances) {
+  constexpr int kSizeBytes = 48;
+  constexpr int kNumDescriptors = 1000;
+  FeatureDescriptorRef query(kSizeBytes);
+  query.SetRandom(0);
+  std::vector<unsigned char> descriptors(kSizeBytes * kNumDescriptors);
+  for (int idx = 0; idx < kNumDescriptors; ++idx) {
+    FeatureDescriptorRef descriptor(kSizeBytes);
+    descriptor.SetRandom(kNumDescriptors + idx);
+    memcpy(&descriptors[idx * kSizeBytes], descriptor.data(), kSizeBytes);
+  }
+  const auto setDistanceToQuery = [&](int idx, size_t distance) {
+    FeatureDescriptorRef descriptor(query);
+    FlipNRandomBits(distance, &descriptor);
+    memcpy(&descriptors[idx * kSizeBytes], descriptor.data(), kSizeBytes);
+  };
+  // Beyond the chunk size of the implementation.
+  setDistanceToQuery(700, 10u);
+  setDistanceToQuery(3, 12u);
+
+  TwoSmallestHammingDistances result;
+  getTwoSmallestHammingDistances(
+      query.data(), descriptors.data(), kSizeBytes, kNumDescriptors, &result);
+  EXPECT_EQ(700, result.best_index);
+  EXPECT_EQ(10u, result.best_distance);
+  EXPECT_EQ(12u, result.second_best_distance);
+
+  // A tie is resolved in favor of the first descriptor.
+  setDistanceToQuery(900, 10u);
+  getTwoSmallestHammingDistances(
+      query.data(), descriptors.data(), kSizeBytes, kNumDescriptors, &result);
+  EXPECT_EQ(700, result.best_index);
+  EXPECT_EQ(10u, result.best_distance);
+  EXPECT_EQ(10u, result.second_best_distance);
+
+  // The best index is a position in the column indices.
+  const std::vector<int> column_indices = {5, 3, 900, 8};
+  getTwoSmallestHammingDistances(
+      query.data(), descriptors.data(), kSizeBytes, column_indices.data(),
+      static_cast<int>(column_indices.size()), &result);
+  EXPECT_EQ(2, result.best_index);
+  EXPECT_EQ(10u, result.best_distance);
+  EXPECT_EQ(12u, result.second_best_distance);
+
+  getTwoSmallestHammingDistances(
+      query.data(), descriptors.data(), kSizeBytes, column_indices.data(), 1, &result);
+  EXPECT_EQ(0, result.best_index);
+  EXPECT_EQ(TwoSmallestHammingDistances::kNoDistance, result.second_best_distance);
+
+  getTwoSmallestHammingDistances(query.data(), descriptors.data(), kSizeBytes, 0, &result);
+  EXPECT_EQ(-1, result.best_index);
+  EXPECT_EQ(TwoSmallestHammingDistances::kNoDistance, result.best_distance);
+  EXPECT_EQ(TwoSmallestHammingDistances::kNoDistance, result.second_best_distance);
+}
+
+}  // namespace common
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/keypoint-grid.h>
+
+namespace aslam {
+namespace common {
+
+namespace {
+constexpr double kImageWidth = 752.0;
+constexpr double kImageHeight = 480.0;
+}  // namespace
+
+class KeypointGridTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    random_engine_.seed(42);
+    std::uniform_real_distribution<double> x_distribution(0.0, kImageWidth);
+    std::uniform_real_distribution<double> y_distribution(0.0, kImageHeight);
+    // Few distinct rows and columns, such that keypoints lie on the query and cell borders.
+    std::uniform_int_distribution<int> row_distribution(0, 48);
+    keypoints_.resize(Eigen::NoChange, 3000);
+    for (int idx = 0; idx < keypoints_.cols(); ++idx) {
+      if (idx % 3 == 0) {
+        keypoints_(0, idx) = 10.0 * row_distribution(random_engine_);
+        keypoints_(1, idx) = 10.0 * row_distribution(random_engine_);
+      } else {
+        keypoints_(0, idx) = x_distribution(random_engine_);
+        keypoints_(1, idx) = y_distribution(random_engine_);
+      }
+    }
+    // Keypoints on and beyond the image border.
+    keypoints_.col(1) << kImageWidth, kImageHeight;
+    keypoints_.col(2) << -0.5, 3.0;
+    keypoints_.col(4) << 5.0, kImageHeight + 2.0;
+
+    is_valid_.resize(keypoints_.cols(), true);
+    for (size_t idx = 0u; idx < is_valid_.size(); idx += 7u) {
+      is_valid_[idx] = false;
+    }
+  }
+
+  void expectSameAsBruteForce(const KeypointGrid& grid) {
+    std::uniform_real_distribution<double> x_distribution(-20.0, kImageWidth + 20.0);
+    std::uniform_real_distribution<double> y_distribution(-20.0, kImageHeight + 20.0);
+    std::uniform_real_distribution<double> size_distribution(0.0, 60.0);
+    size_t num_found = 0u;
+    for (int query_idx = 0; query_idx < 2000; ++query_idx) {
+      Eigen::Vector2d center(x_distribution(random_engine_), y_distribution(random_engine_));
+      if (query_idx % 2 == 0) {
+        center = keypoints_.col(query_idx);
+      }
+      const double half_width = size_distribution(random_engine_);
+      const double half_height = size_distribution(random_engine_);
+      const double x_min = center(0) - half_width;
+      const double x_max = center(0) + half_width;
+      const double y_min = center(1) - half_height;
+      const double y_max = center(1) + half_height;
+
+      std::vector<int> expected_in_rectangle;
+      for (int idx = 0; idx < keypoints_.cols(); ++idx) {
+        if (!is_valid_[idx]) {
+          continue;
+        }
+        const Eigen::Vector2d keypoint = keypoints_.col(idx);
+        if (keypoint(0) >= x_min && keypoint(0) <= x_max && keypoint(1) >= y_min &&
+            keypoint(1) <= y_max) {
+          expected_in_rectangle.push_back(idx);
+        }
+      }
+
+      std::vector<int> in_rectangle;
+      grid.getKeypointsInRectangle(x_min, x_max, y_min, y_max, &in_rectangle);
+      std::sort(in_rectangle.begin(), in_rectangle.end());
+      EXPECT_EQ(expected_in_rectangle, in_rectangle) << "Query " << query_idx;
+      num_found += in_rectangle.size();
+    }
+    // Make sure the test is not trivially passing.
+    EXPECT_GT(num_found, 2000u);
+  }
+
+  std::mt19937 random_engine_;
+  Eigen::Matrix2Xd keypoints_;
+  std::vector<bool> is_valid_;
+};
+
+TEST_F(KeypointGridTest, SameAsBruteForce) {
+  KeypointGrid grid(kImageWidth, kImageHeight, 25.0);
+  grid.build(keypoints_, is_valid_);
+  EXPECT_EQ(30u, grid.getNumCellsX());
+  EXPECT_EQ(19u, grid.getNumCellsY());
+  EXPECT_EQ(static_cast<size_t>(std::count(is_valid_.begin(), is_valid_.end(), true)),
+            grid.getNumIndexedKeypoints());
+  expectSameAsBruteForce(grid);
+}
+
+TEST_F(KeypointGridTest, SameAsBruteForceSingleCell) {
+  KeypointGrid grid(kImageWidth, kImageHeight, 1u, 1u);
+  grid.build(keypoints_, is_valid_);
+  expectSameAsBruteForce(grid);
+}
+
+TEST_F(KeypointGridTest, SameAsBruteForceSmallCells) {
+  KeypointGrid grid(kImageWidth, kImageHeight, 3.0);
+  grid.build(keypoints_, is_valid_);
+  expectSameAsBruteForce(grid);
+}
+
+TEST_F(KeypointGridTest, Cells) {
+  KeypointGrid grid(kImageWidth, kImageHeight, 4u, 3u);
+  grid.build(keypoints_);
+  EXPECT_EQ(12u, grid.getNumCells());
+  EXPECT_EQ(static_cast<size_t>(keypoints_.cols()), grid.getNumIndexedKeypoints());
+
+  // Keypoints outside of the image belong to the nearest border cell.
+  EXPECT_EQ(0u, grid.getCellIndex(Eigen::Vector2d(-10.0, -10.0)));
+  EXPECT_EQ(11u, grid.getCellIndex(Eigen::Vector2d(kImageWidth, kImageHeight)));
+  EXPECT_EQ(4u, grid.getCellIndex(Eigen::Vector2d(-1.0, kImageHeight / 3.0)));
+  EXPECT_EQ(6u, grid.getCellIndex(Eigen::Vector2d(kImageWidth / 2.0, kImageHeight / 2.0)));
+
+  // Every keypoint is in its cell, ordered by index.
+  size_t num_keypoints_in_cells = 0u;
+  for (size_t cell_idx = 0u; cell_idx < grid.getNumCells(); ++cell_idx) {
+    EXPECT_TRUE(std::is_sorted(grid.cellBegin(cell_idx), grid.cellEnd(cell_idx)));
+    for (const int* it = grid.cellBegin(cell_idx); it != grid.cellEnd(cell_idx); ++it) {
+      EXPECT_EQ(cell_idx, grid.getCellIndex(keypoints_.col(*it)));
+    }
+    num_keypoints_in_cells += grid.getNumKeypointsInCell(cell_idx);
+  }
+  EXPECT_EQ(static_cast<size_t>(keypoints_.cols()), num_keypoints_in_cells);
+}
+
+TEST_F(KeypointGridTest, Empty) {
+  KeypointGrid grid(kImageWidth, kImageHeight, 10.0);
+  std::vector<int> found;
+  grid.getKeypointsInRectangle(0.0, 50.0, 0.0, 50.0, &found);
+  EXPECT_TRUE(found.empty());
+
+  grid.build(keypoints_, std::vector<bool>(keypoints_.cols(), false));
+  EXPECT_EQ(0u, grid.getNumIndexedKeypoints());
+  grid.getKeypointsInRectangle(0.0, kImageWidth, 0.0, kImageHeight, &found);
+  EXPECT_TRUE(found.empty());
+
+  // Empty rectangles find nothing.
+  grid.build(keypoints_);
+  grid.getKeypointsInRectangle(10.0, 5.0, 0.0, kImageHeight, &found);
+  EXPECT_TRUE(found.empty());
+  grid.getKeypointsInRectangle(0.0, kImageWidth, 10.0, 5.0, &found);
+  EXPECT_TRUE(found.empty());
+}
+
+}  // namespace common
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
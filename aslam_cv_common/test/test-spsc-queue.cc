@@ -0,0 +1,47 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/spsc-queue.h>
+
+TEST(SpscQueueTests, TestFifoOrder) {
+  aslam::common::SpscQueue<int> queue;
+  int value = -1;
+  EXPECT_FALSE(queue.pop(&value));
+  queue.push(1);
+  queue.push(2);
+  EXPECT_EQ(2u, queue.size());
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(1, value);
+  queue.push(3);
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(2, value);
+  ASSERT_TRUE(queue.pop(&value));
+  EXPECT_EQ(3, value);
+  EXPECT_FALSE(queue.pop(&value));
+  EXPECT_EQ(0u, queue.size());
+}
+
+TEST(SpscQueueTests, TestConcurrentProducerAndConsumer) {
+  constexpr int kNumValues = 100000;
+  aslam::common::SpscQueue<int> queue;
+  std::thread producer([&queue]() {
+    for (int i = 0; i < kNumValues; ++i) {
+      queue.push(i);
+    }
+  });
+
+  int expected_value = 0;
+  while (expected_value < kNumValues) {
+    int value;
+    if (queue.pop(&value)) {
+      ASSERT_EQ(expected_value, value);
+      ++expected_value;
+    }
+  }
+  producer.join();
+  EXPECT_EQ(0u, queue.size());
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
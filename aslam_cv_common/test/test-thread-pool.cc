@@ -1,3 +1,7 @@
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #include <gtest/gtest.h>
 
 #include <aslam/common/entrypoint.h>
@@ -81,4 +85,22 @@ TEST(ThreadPoolTests, ExecutionOrdering) {
   }
 }
 
+#ifdef __linux__
+TEST(ThreadPoolTests, PinThreadsToCores) {
+  constexpr size_t kNumThreads = 4u;
+  aslam::ThreadPool pool(kNumThreads);
+  EXPECT_EQ(kNumThreads, pool.numThreads());
+  ASSERT_TRUE(pool.pinThreadsToCores({0}));
+
+  std::vector<std::future<int>> cpus;
+  for (size_t i = 0u; i < 2u * kNumThreads; ++i) {
+    cpus.emplace_back(pool.enqueue([]() { return sched_getcpu(); }));
+  }
+  pool.waitForEmptyQueue();
+  for (std::future<int>& cpu : cpus) {
+    EXPECT_EQ(0, cpu.get());
+  }
+}
+#endif
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <cstdint>
 
 #include <aslam/cameras/camera.h>
@@ -87,6 +88,9 @@ class VisualFrame  {
   /// Is there a raw image stored in this frame?
   bool hasRawImage() const;
 
+  /// Is there an image pyramid stored in this frame?
+  bool hasImagePyramid() const;
+
   /// Is a certain channel stored in this frame?
   bool hasChannel(const std::string& channel) const {
     return aslam::channels::hasChannel(channel, channels_);
@@ -128,6 +132,13 @@ class VisualFrame  {
   /// Release the raw image. Only if the cv::Mat reference count is 1 the memory will be freed.
   void releaseRawImage();
 
+  /// The image pyramid stored in a frame. The layout is the one of cv::buildOpticalFlowPyramid,
+  /// so the pyramid can directly be passed to cv::calcOpticalFlowPyrLK.
+  const std::vector<cv::Mat>& getImagePyramid() const;
+
+  /// Release the image pyramid.
+  void releaseImagePyramid();
+
   template<typename CHANNEL_DATA_TYPE>
   const CHANNEL_DATA_TYPE& getChannelData(const std::string& channel) const {
     return aslam::channels::getChannelData<CHANNEL_DATA_TYPE>(channel, channels_);
@@ -157,6 +168,9 @@ class VisualFrame  {
   /// A pointer to the raw image, can be used to swap in new data.
   cv::Mat* getRawImageMutable();
 
+  /// A pointer to the image pyramid, can be used to swap in new data.
+  std::vector<cv::Mat>* getImagePyramidMutable();
+
   template<typename CHANNEL_DATA_TYPE>
   CHANNEL_DATA_TYPE* getChannelDataMutable(const std::string& channel) const {
     CHANNEL_DATA_TYPE& data =
@@ -216,6 +230,9 @@ class VisualFrame  {
   ///        should be owned by the VisualFrame.
   void setRawImage(const cv::Mat& image);
 
+  /// Replace (copy) the internal image pyramid by the passed one. The levels are shallow copies.
+  void setImagePyramid(const std::vector<cv::Mat>& image_pyramid);
+
   template<typename CHANNEL_DATA_TYPE>
   void setChannelData(const std::string& channel,
                       const CHANNEL_DATA_TYPE& data_new) {
@@ -351,7 +368,16 @@ class VisualFrame  {
 
   void discardUntrackedObservations(std::vector<size_t>* discarded_indices);
 
+  /// \brief Removes the keypoints with the given indices from all keypoint channels and the
+  ///        descriptors.
+  /// @param[in]  ordered_indices   Indices of the keypoints to remove in ascending order.
+  void discardKeypoints(const std::vector<size_t>& ordered_indices);
+
  private:
+  /// Removes the keypoints with the given indices, out of original_count keypoints, from all
+  /// present keypoint channels and the descriptors.
+  void discardKeypoints(const std::vector<size_t>& ordered_indices, size_t original_count);
+
   /// Timestamp in nanoseconds.
   int64_t timestamp_nanoseconds_;
 
@@ -71,6 +71,9 @@ bool VisualFrame::hasTrackIds() const {
 bool VisualFrame::hasRawImage() const {
   return aslam::channels::has_RAW_IMAGE_Channel(channels_);
 }
+bool VisualFrame::hasImagePyramid() const {
+  return aslam::channels::has_IMAGE_PYRAMID_Channel(channels_);
+}
 
 const Eigen::Matrix2Xd& VisualFrame::getKeypointMeasurements() const {
   return aslam::channels::get_VISUAL_KEYPOINT_MEASUREMENTS_Data(channels_);
@@ -100,6 +103,12 @@ const cv::Mat& VisualFrame::getRawImage() const {
 void VisualFrame::releaseRawImage() {
   aslam::channels::remove_RAW_IMAGE_Channel(&channels_);
 }
+const std::vector<cv::Mat>& VisualFrame::getImagePyramid() const {
+  return aslam::channels::get_IMAGE_PYRAMID_Data(channels_);
+}
+void VisualFrame::releaseImagePyramid() {
+  aslam::channels::remove_IMAGE_PYRAMID_Channel(&channels_);
+}
 
 Eigen::Matrix2Xd* VisualFrame::getKeypointMeasurementsMutable() {
   Eigen::Matrix2Xd& keypoints =
@@ -141,6 +150,11 @@ cv::Mat* VisualFrame::getRawImageMutable() {
       aslam::channels::get_RAW_IMAGE_Data(channels_);
   return &image;
 }
+std::vector<cv::Mat>* VisualFrame::getImagePyramidMutable() {
+  std::vector<cv::Mat>& image_pyramid =
+      aslam::channels::get_IMAGE_PYRAMID_Data(channels_);
+  return &image_pyramid;
+}
 
 const Eigen::Block<Eigen::Matrix2Xd, 2, 1>
 VisualFrame::getKeypointMeasurement(size_t index) const {
@@ -267,6 +281,15 @@ void VisualFrame::setRawImage(const cv::Mat& image_new) {
   image = image_new;
 }
 
+void VisualFrame::setImagePyramid(const std::vector<cv::Mat>& image_pyramid_new) {
+  if (!aslam::channels::has_IMAGE_PYRAMID_Channel(channels_)) {
+    aslam::channels::add_IMAGE_PYRAMID_Channel(&channels_);
+  }
+  std::vector<cv::Mat>& image_pyramid =
+      aslam::channels::get_IMAGE_PYRAMID_Data(channels_);
+  image_pyramid = image_pyramid_new;
+}
+
 void VisualFrame::swapKeypointMeasurements(Eigen::Matrix2Xd* keypoints_new) {
   if (!aslam::channels::has_VISUAL_KEYPOINT_MEASUREMENTS_Channel(channels_)) {
     aslam::channels::add_VISUAL_KEYPOINT_MEASUREMENTS_Channel(&channels_);
@@ -466,39 +489,59 @@ void VisualFrame::discardUntrackedObservations(
       discarded_indices->emplace_back(i);
     }
   }
-  if (discarded_indices->empty()) {
+  discardKeypoints(*discarded_indices, original_count);
+}
+
+void VisualFrame::discardKeypoints(const std::vector<size_t>& ordered_indices) {
+  // The keypoint count is taken from whichever keypoint channel is present.
+  size_t original_count = 0u;
+  if (hasKeypointMeasurements()) {
+    original_count = getNumKeypointMeasurements();
+  } else if (hasTrackIds()) {
+    original_count = getTrackIds().rows();
+  } else if (hasDescriptors()) {
+    original_count = getDescriptors().cols();
+  }
+  discardKeypoints(ordered_indices, original_count);
+}
+
+void VisualFrame::discardKeypoints(
+    const std::vector<size_t>& ordered_indices, const size_t original_count) {
+  if (ordered_indices.empty()) {
     return;
   }
 
   if (hasKeypointMeasurements()) {
     common::stl_helpers::eraseIndicesFromContainer(
-        *discarded_indices, original_count, getKeypointMeasurementsMutable());
+        ordered_indices, original_count, getKeypointMeasurementsMutable());
   }
   if (hasKeypointMeasurementUncertainties()) {
     common::stl_helpers::eraseIndicesFromContainer(
-        *discarded_indices, original_count,
+        ordered_indices, original_count,
         getKeypointMeasurementUncertaintiesMutable());
   }
   if (hasKeypointOrientations()) {
     common::stl_helpers::eraseIndicesFromContainer(
-        *discarded_indices, original_count, getKeypointOrientationsMutable());
+        ordered_indices, original_count, getKeypointOrientationsMutable());
   }
   if (hasKeypointScores()) {
     common::stl_helpers::eraseIndicesFromContainer(
-        *discarded_indices, original_count, getKeypointScoresMutable());
+        ordered_indices, original_count, getKeypointScoresMutable());
   }
   if (hasKeypointScales()) {
     common::stl_helpers::eraseIndicesFromContainer(
-        *discarded_indices, original_count, getKeypointScalesMutable());
+        ordered_indices, original_count, getKeypointScalesMutable());
   }
   if (hasDescriptors()) {
     common::stl_helpers::OneDimensionAdapter<unsigned char,
     common::stl_helpers::kColumns> adapter(getDescriptorsMutable());
     common::stl_helpers::eraseIndicesFromContainer(
-        *discarded_indices, original_count, &adapter);
+        ordered_indices, original_count, &adapter);
+  }
+  if (hasTrackIds()) {
+    common::stl_helpers::eraseIndicesFromContainer(
+        ordered_indices, original_count, getTrackIdsMutable());
   }
-  common::stl_helpers::eraseIndicesFromContainer(
-      *discarded_indices, original_count, getTrackIdsMutable());
 }
 
 }  // namespace aslam
@@ -1,3 +1,5 @@
+#include <vector>
+
 #include <eigen-checks/gtest.h>
 #include <gtest/gtest.h>
 
@@ -150,6 +152,30 @@ TEST(Frame, SetGetImage) {
   EXPECT_TRUE(gtest_catkin::ImagesEqual(data, data_2));
 }
 
+TEST(Frame, SetGetImagePyramid) {
+  aslam::VisualFrame frame;
+  EXPECT_FALSE(frame.hasImagePyramid());
+  std::vector<cv::Mat> image_pyramid;
+  image_pyramid.emplace_back(10, 10, CV_8UC1, uint8_t(7));
+  image_pyramid.emplace_back(5, 5, CV_8UC1, uint8_t(3));
+
+  frame.setImagePyramid(image_pyramid);
+  ASSERT_TRUE(frame.hasImagePyramid());
+  const std::vector<cv::Mat>& image_pyramid_2 = frame.getImagePyramid();
+  ASSERT_EQ(image_pyramid_2.size(), image_pyramid.size());
+  for (size_t level = 0u; level < image_pyramid.size(); ++level) {
+    EXPECT_TRUE(gtest_catkin::ImagesEqual(image_pyramid[level], image_pyramid_2[level]));
+    // The levels are not copied.
+    EXPECT_EQ(image_pyramid[level].data, image_pyramid_2[level].data);
+  }
+
+  aslam::VisualFrame frame_cloned(frame);
+  EXPECT_TRUE(frame == frame_cloned);
+
+  frame.releaseImagePyramid();
+  EXPECT_FALSE(frame.hasImagePyramid());
+}
+
 TEST(Frame, CopyConstructor) {
   aslam::Camera::Ptr camera = aslam::PinholeCamera::createTestCamera();
   aslam::VisualFrame frame;
@@ -245,4 +271,28 @@ TEST(Frame, getNormalizedBearingVectors) {
   }
 }
 
+TEST(Frame, DiscardUntrackedObservationsWithoutKeypointMeasurements) {
+  aslam::VisualFrame frame;
+  Eigen::VectorXi track_ids(5);
+  track_ids << 3, -1, 4, -1, 5;
+  frame.setTrackIds(track_ids);
+  aslam::VisualFrame::DescriptorsT descriptors(2, 5);
+  descriptors << 0, 1, 2, 3, 4,
+                 5, 6, 7, 8, 9;
+  frame.setDescriptors(descriptors);
+  ASSERT_FALSE(frame.hasKeypointMeasurements());
+
+  std::vector<size_t> discarded_indices;
+  frame.discardUntrackedObservations(&discarded_indices);
+  EXPECT_EQ(std::vector<size_t>({1u, 3u}), discarded_indices);
+
+  Eigen::VectorXi expected_track_ids(3);
+  expected_track_ids << 3, 4, 5;
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(expected_track_ids, frame.getTrackIds()));
+  aslam::VisualFrame::DescriptorsT expected_descriptors(2, 3);
+  expected_descriptors << 0, 2, 4,
+                          5, 7, 9;
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(expected_descriptors, frame.getDescriptors()));
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <vector>
 
+#include <aslam/common/keypoint-grid.h>
 #include <aslam/common/pose-types.h>
 #include <aslam/common/feature-descriptor-ref.h>
 #include <aslam/frames/visual-frame.h>
@@ -22,6 +23,7 @@ namespace aslam {
 /// in frame (k+1). This is done by predicting the keypoint location by
 /// using an interframe rotation matrix. Then a rectangular search window around
 /// that location is searched for the best match greater than a threshold.
+/// The keypoints in the window are looked up in a grid over frame (k+1).
 /// If the initial search was not successful, the search window is increased once.
 /// The initial matcher is allowed to discard a previous match if the new one
 /// has a higher score. The discarded matches are called inferior matches and
@@ -32,6 +34,11 @@ namespace aslam {
 /// The second matcher is executed several times because it is also allowed
 /// to discard inferior matches of the current iteration.
 /// The matches are exclusive.
+///
+/// The candidate search of the initial matcher runs in parallel over the
+/// keypoints of frame k if gyro_matcher_num_threads is not 1, on a thread
+/// pool shared by all matchers. The matches are assigned afterwards in the
+/// order of the keypoints, so they do not depend on the number of threads.
 class GyroTwoFrameMatcher {
  public:
   ASLAM_DISALLOW_EVIL_CONSTRUCTORS(GyroTwoFrameMatcher);
@@ -62,48 +69,89 @@ class GyroTwoFrameMatcher {
   void match();
 
  private:
-  struct KeypointData {
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-    KeypointData(const Eigen::Vector2d& measurement, const int index)
-      : measurement(measurement), channel_index(index) {}
-    Eigen::Vector2d measurement;
-    int channel_index;
-  };
-
-  typedef typename Aligned<std::vector, KeypointData>::const_iterator KeyPointIterator;
   typedef typename FrameToFrameMatchesWithScore::iterator MatchesIterator;
 
   struct MatchData {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     MatchData() = default;
     void addCandidate(
-        const KeyPointIterator keypoint_iterator_kp1, const double matching_score) {
+        const int keypoint_idx_kp1, const double matching_score) {
       CHECK_GT(matching_score, 0.0);
       CHECK_LE(matching_score, 1.0);
-      keypoint_match_candidates_kp1.push_back(keypoint_iterator_kp1);
+      keypoint_match_candidates_kp1.push_back(keypoint_idx_kp1);
       match_candidate_matching_scores.push_back(matching_score);
     }
-    // Iterators of keypoints of frame (k+1) that were candidates for the match
+    // Indices of keypoints of frame (k+1) that were candidates for the match
     // together with their scores.
-    std::vector<KeyPointIterator> keypoint_match_candidates_kp1;
+    std::vector<int> keypoint_match_candidates_kp1;
     std::vector<double> match_candidate_matching_scores;
   };
 
+  // The best candidate of frame (k+1) for a keypoint of frame k.
+  struct CandidateSearchResult {
+    bool passed_ratio_test = false;
+    int best_match_keypoint_idx_kp1 = -1;
+    int best_score = 0;
+    int n_processed_corners = 0;
+    MatchData match_data;
+  };
+
+  // A search window holds the keypoints of frame (k+1) with
+  // left <= x <= right and top <= y < bottom.
+  struct SearchWindow {
+    bool contains(const Eigen::Vector2d& keypoint) const {
+      return keypoint(0) >= left && keypoint(0) <= right &&
+          keypoint(1) >= top && keypoint(1) < bottom;
+    }
+    int left;
+    int right;
+    int top;
+    int bottom;
+  };
+
+  // The indices of the keypoints of frame (k+1) in a search window together
+  // with their descriptor distances. Every thread reuses its own instance for
+  // all of its keypoints of frame k.
+  struct WindowCandidates {
+    std::vector<int> keypoints_kp1;
+    std::vector<uint32_t> distances_kp1;
+  };
+
   /// \brief Initialize data the matcher relies on.
   void initialize();
 
+  /// \brief Search the candidates of all keypoints of frame k, in parallel if
+  ///        more than one thread is configured.
+  void searchCandidatesOfAllKeypoints(
+      std::vector<CandidateSearchResult>* search_results) const;
+
+  /// \brief Search the best candidate of frame (k+1) for a keypoint of frame k.
+  ///
+  /// Only reads the state of the matcher, so it can run concurrently for
+  /// different keypoints.
+  void searchCandidates(const int idx_k, WindowCandidates* window_candidates,
+                        CandidateSearchResult* search_result) const;
+
   /// \brief Match a keypoint of frame k with one of frame (k+1) if possible.
   ///
   /// Initial matcher that tries to match a keypoint of frame k with
   /// a keypoint of frame (k+1) once. It is allowed to discard an
   /// already existing match.
-  void matchKeypoint(const int idx_k);
+  void matchKeypoint(const int idx_k, CandidateSearchResult* search_result);
 
-  void getKeypointIteratorsInWindow(
+  /// \brief Compute the descriptor distances of a keypoint of frame k to the keypoints
+  ///        of frame (k+1) in the window.
+  void computeDistancesToWindowKeypoints(
+      const int idx_k, WindowCandidates* window_candidates) const;
+
+  SearchWindow getSearchWindow(
       const Eigen::Vector2d& predicted_keypoint_position,
-      const int window_half_side_length_px,
-      KeyPointIterator* it_keypoints_begin,
-      KeyPointIterator* it_keypoints_end) const;
+      const int window_half_side_length_px) const;
+
+  /// \brief Get the keypoints of frame (k+1) in the window, sorted by their
+  ///        y coordinate and then by index.
+  void getKeypointsInWindow(
+      const SearchWindow& window, std::vector<int>* keypoints_kp1) const;
 
   /// \brief Try to match inferior matches without modifying initial matches.
   ///
@@ -150,23 +198,14 @@ class GyroTwoFrameMatcher {
   // to the ordering of the keypoint/descriptors in
   // the respective channels.
   FrameToFrameMatchesWithScore* const matches_kp1_k_;
-  // Descriptors of frame (k+1).
-  std::vector<common::FeatureDescriptorConstRef> descriptors_kp1_wrapped_;
-  // Descriptors of frame k.
-  std::vector<common::FeatureDescriptorConstRef> descriptors_k_wrapped_;
-  // Keypoints of frame (k+1) sorted from small to large y coordinates.
-  Aligned<std::vector, KeypointData> keypoints_kp1_sorted_by_y_;
-  // corner_row_LUT[i] is the number of keypoints that has y position
-  // lower than i in the image.
-  std::vector<int> corner_row_LUT_;
+  // Grid of the keypoints of frame (k+1). Its cells are at least as large as
+  // the small search distance, so the small window overlaps at most 3 x 3 cells.
+  common::KeypointGrid keypoint_grid_kp1_;
   // Remember matched keypoints of frame (k+1).
   std::vector<bool> is_keypoint_kp1_matched_;
   // Map from keypoint indices of frame (k+1) to
   // the corresponding match iterator.
   std::unordered_map<int, MatchesIterator> kp1_idx_to_matches_iterator_map_;
-  // Keep track of processed keypoints s.t. we don't process them again in the
-  // large window. Set every element to false for each keypoint (of frame k) iteration!
-  std::vector<bool> iteration_processed_keypoints_kp1_;
   // The queried keypoints in frame (k+1) and the corresponding
   // matching score are stored for each attempted match.
   // A map from the keypoint in frame k to the corresponding
@@ -189,35 +228,14 @@ class GyroTwoFrameMatcher {
   // Large image space distances for keypoint matches.
   // Only used if small search was unsuccessful.
   const int large_search_distance_px_;
+  // Number of threads searching the candidates of the keypoints of frame k.
+  const size_t num_threads_;
+  // Number of consecutive keypoints of frame k a thread searches at once.
+  static constexpr int kNumKeypointsPerBlock = 64;
   // Number of iterations to match inferior matches.
   static constexpr size_t kMaxNumInferiorIterations = 3u;
 };
 
-void GyroTwoFrameMatcher::getKeypointIteratorsInWindow(
-    const Eigen::Vector2d& predicted_keypoint_position,
-    const int window_half_side_length_px,
-    KeyPointIterator* it_keypoints_begin,
-    KeyPointIterator* it_keypoints_end) const {
-  CHECK_NOTNULL(it_keypoints_begin);
-  CHECK_NOTNULL(it_keypoints_end);
-CHECK_GT(window_half_side_length_px, 0);
-
-  // Compute search area for LUT iterators row-wise.
-  int LUT_index_top = clamp(0, kImageHeight - 1, static_cast<int>(
-      predicted_keypoint_position(1) + 0.5 - window_half_side_length_px));
-  int LUT_index_bottom = clamp(0, kImageHeight - 1, static_cast<int>(
-      predicted_keypoint_position(1) + 0.5 + window_half_side_length_px));
-
-  *it_keypoints_begin = keypoints_kp1_sorted_by_y_.begin() + corner_row_LUT_[LUT_index_top];
-  *it_keypoints_end = keypoints_kp1_sorted_by_y_.begin() + corner_row_LUT_[LUT_index_bottom];
-
-  CHECK_LE(LUT_index_top, LUT_index_bottom);
-  CHECK_GE(LUT_index_bottom, 0);
-  CHECK_GE(LUT_index_top, 0);
-  CHECK_LT(LUT_index_top, static_cast<int>(kImageHeight));
-  CHECK_LT(LUT_index_bottom, static_cast<int>(kImageHeight));
-}
-
 inline int GyroTwoFrameMatcher::clamp(
     const int lower, const int upper, const int in) const {
   return std::min<int>(std::max<int>(in, lower), upper);
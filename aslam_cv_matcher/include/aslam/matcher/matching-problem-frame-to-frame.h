@@ -6,8 +6,8 @@
 ///
 /// @}
 
-#include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <aslam/common/macros.h>
@@ -18,6 +18,7 @@
 
 #include "aslam/matcher/match.h"
 #include "aslam/matcher/matching-problem.h"
+#include "aslam/matcher/multi-index-hashing.h"
 
 namespace aslam {
 class VisualFrame;
@@ -52,11 +53,19 @@ public:
   ///                                                         candidates.
   /// @param[in]  hamming_distance_threshold                  Max hamming distance for two pairs
   ///                                                         to become candidates.
+  /// @param[in]  use_multi_index_hashing                     Look up the apples within the
+  ///                                                         hamming distance threshold in a
+  ///                                                         multi-index hash table before
+  ///                                                         applying the image space gate.
+  ///                                                         Faster for wide search bands and
+  ///                                                         many keypoints, the candidates are
+  ///                                                         the same.
   MatchingProblemFrameToFrame(const VisualFrame& apple_frame,
                               const VisualFrame& banana_frame,
                               const aslam::Quaternion& q_A_B,
                               double image_space_distance_threshold_pixels,
-                              int hamming_distance_threshold);
+                              int hamming_distance_threshold,
+                              bool use_multi_index_hashing = false);
   virtual ~MatchingProblemFrameToFrame() {};
 
   virtual size_t numApples() const;
@@ -73,43 +82,25 @@ public:
     return static_cast<double>(384 - hamming_distance) / 384.0;
   }
 
-  inline int computeHammingDistance(int banana_index, int apple_index) {
-    CHECK_LT(apple_index, static_cast<int>(apple_descriptors_.size()))
-        << "No descriptor for this apple.";
-    CHECK_LT(banana_index, static_cast<int>(banana_descriptors_.size()))
-        << "No descriptor for this banana.";
-    CHECK_LT(apple_index, static_cast<int>(valid_apples_.size()))
-        << "No valid flag for this apple.";
-    CHECK_LT(banana_index, static_cast<int>(valid_bananas_.size()))
-        << "No valid flag for this apple.";
-    CHECK(valid_apples_[apple_index]) << "The given apple is not valid.";
-    CHECK(valid_bananas_[banana_index]) << "The given banana is not valid.";
-
-    const common::FeatureDescriptorConstRef& apple_descriptor =
-        apple_descriptors_[apple_index];
-    const common::FeatureDescriptorConstRef& banana_descriptor =
-        banana_descriptors_[banana_index];
-
-    CHECK_NOTNULL(apple_descriptor.data());
-    CHECK_NOTNULL(banana_descriptor.data());
-
-    return common::GetNumBitsDifferent(banana_descriptor, apple_descriptor);
-  }
-
   /// \brief Gets called at the beginning of the matching problem.
   /// Creates a y-coordinate LUT for all apple keypoints and projects all banana keypoints into the
-  /// apple frame.
+  /// apple frame. Builds the multi-index hash table of the apple descriptors if enabled.
   virtual bool doSetup();
 
 private:
+  /// Appends a candidate, prioritizing apples that are part of a track.
+  void addCandidate(size_t apple_index, int banana_index, int hamming_distance,
+                    const Eigen::VectorXi* apple_track_ids, Candidates* candidates);
+
   /// The apple frame.
   const VisualFrame& apple_frame_;
   /// The banana frame.
   const VisualFrame& banana_frame_;
   /// Rotation matrix taking vectors from the banana frame into the apple frame.
   aslam::Quaternion q_A_B_;
-  /// Map mapping y coordinates in the image plane onto keypoint indices of apple keypoints.
-  std::multimap<size_t, size_t> y_coordinate_to_apple_keypoint_index_map_;
+  /// Pairs of y coordinates in the image plane and keypoint indices of the valid apple keypoints,
+  /// sorted by y coordinate and then by index.
+  std::vector<std::pair<size_t, size_t>> y_coordinates_and_apple_indices_;
 
   /// Index marking apples as valid or invalid.
   std::vector<bool> valid_apples_;
@@ -141,6 +132,11 @@ private:
 
   /// The heigh of the apple frame.
   size_t image_height_apple_frame_;
+
+  /// Look up the candidates in apple_descriptor_index_ instead of the vertical band.
+  bool use_multi_index_hashing_;
+  /// Multi-index hash table of the valid apple descriptors.
+  MultiIndexHashing apple_descriptor_index_;
 };
 }
 #endif //ASLAM_CV_MATCHING_PROBLEM_FRAME_TO_FRAME_H_
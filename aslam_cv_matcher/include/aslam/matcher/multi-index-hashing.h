@@ -0,0 +1,80 @@
+#ifndef ASLAM_CV_MATCHER_MULTI_INDEX_HASHING_H_
+#define ASLAM_CV_MATCHER_MULTI_INDEX_HASHING_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <aslam/common/feature-descriptor-ref.h>
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+/// \class MultiIndexHashing
+/// \brief Finds all binary descriptors within a Hamming distance of a query descriptor
+///        without comparing the query against every descriptor.
+///
+/// The descriptors are split into m disjoint substrings and every substring is indexed in its
+/// own hash table. If two descriptors differ in at most r bits, at least one of their substrings
+/// differs in at most floor(r / m) bits. A query therefore only looks up the buckets within that
+/// radius of each of its substrings and verifies the full distance of the descriptors it finds.
+/// See Norouzi et al., "Fast Search in Hamming Space with Multi-Index Hashing", CVPR 2012.
+///
+/// The substring length is chosen from the number of indexed descriptors such that the buckets
+/// hold about one descriptor each. The index keeps references to the descriptors, so the
+/// descriptor memory has to outlive it.
+class MultiIndexHashing {
+ public:
+  ASLAM_POINTER_TYPEDEFS(MultiIndexHashing);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(MultiIndexHashing);
+
+  typedef std::vector<std::pair<size_t, int>> IndicesAndDistances;
+
+  MultiIndexHashing();
+  ~MultiIndexHashing() {}
+
+  /// \brief Index the descriptors.
+  /// @param[in] descriptors          The descriptors, all of the same size.
+  /// @param[in] is_valid             Only descriptors flagged as valid are indexed.
+  /// @param[in] max_hamming_distance The maximum distance queries will search for.
+  void build(const std::vector<common::FeatureDescriptorConstRef>& descriptors,
+             const std::vector<bool>& is_valid, int max_hamming_distance);
+
+  /// \brief Get all indexed descriptors whose Hamming distance to the query is at most the
+  ///        maximum distance passed to build().
+  /// @param[in]  query                  The query descriptor.
+  /// @param[out] indices_and_distances  The indices of the found descriptors with their
+  ///                                    distance to the query, sorted by index.
+  void getDescriptorsWithinDistance(const common::FeatureDescriptorConstRef& query,
+                                    IndicesAndDistances* indices_and_distances) const;
+
+  size_t getNumIndexedDescriptors() const { return num_indexed_descriptors_; }
+  size_t getNumSubstrings() const { return substring_tables_.size(); }
+  size_t getSubstringSizeBits() const { return substring_size_bits_; }
+
+ private:
+  struct SubstringTable {
+    size_t bit_offset;
+    size_t num_bits;
+    /// The descriptors of bucket k are descriptor_indices[bucket_begin[k], bucket_begin[k+1]).
+    std::vector<uint32_t> bucket_begin;
+    std::vector<uint32_t> descriptor_indices;
+  };
+
+  static uint32_t getSubstring(const unsigned char* descriptor, size_t descriptor_size_bytes,
+                               size_t bit_offset, size_t num_bits);
+
+  std::vector<common::FeatureDescriptorConstRef> descriptors_;
+  std::vector<SubstringTable> substring_tables_;
+  /// All bit masks of substring_size_bits_ bits with at most the substring search radius bits
+  /// set, in increasing order.
+  std::vector<uint32_t> substring_flip_masks_;
+  size_t descriptor_size_bytes_;
+  size_t substring_size_bits_;
+  size_t num_indexed_descriptors_;
+  int max_hamming_distance_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CV_MATCHER_MULTI_INDEX_HASHING_H_
@@ -1,6 +1,16 @@
 #include "aslam/matcher/gyro-two-frame-matcher.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <aslam/common/hamming.h>
 #include <aslam/common/statistics/statistics.h>
+#include <aslam/common/thread-pool.h>
 #include <glog/logging.h>
 
 DEFINE_int32(gyro_matcher_small_search_distance_px, 10,
@@ -8,8 +18,30 @@ DEFINE_int32(gyro_matcher_small_search_distance_px, 10,
 DEFINE_int32(gyro_matcher_large_search_distance_px, 20,
     "Large search rectangle size for keypoint matches."
     " Only used if small search was unsuccessful.");
+DEFINE_int32(gyro_matcher_num_threads, 1,
+    "Number of threads searching the match candidates of the keypoints."
+    " 0 uses one thread per core. The matches do not depend on it.");
 
 namespace aslam {
+namespace {
+// The matchers share the workers of the candidate search, such that they are not started for
+// every frame pair. The pool is only replaced if the number of threads changes.
+std::shared_ptr<ThreadPool> getCandidateSearchThreadPool(const size_t num_workers) {
+  static std::mutex mutex;
+  static std::shared_ptr<ThreadPool> thread_pool;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!thread_pool || thread_pool->numThreads() != num_workers) {
+    thread_pool = std::make_shared<ThreadPool>(num_workers);
+  }
+  return thread_pool;
+}
+
+// The grid only has to cover the keypoints horizontally, keypoints beyond it belong to the
+// border cells.
+double getKeypointGridWidth(const Eigen::Matrix2Xd& keypoints) {
+  return keypoints.cols() > 0 ? std::max(keypoints.row(0).maxCoeff() + 1.0, 1.0) : 1.0;
+}
+}  // namespace
 
 GyroTwoFrameMatcher::GyroTwoFrameMatcher(
     const Quaternion& q_Ckp1_Ck,
@@ -27,10 +59,14 @@ GyroTwoFrameMatcher::GyroTwoFrameMatcher(
     kNumPointsK(frame_k.getKeypointMeasurements().cols()),
     kImageHeight(image_height),
     matches_kp1_k_(matches_with_score_kp1_k),
+    keypoint_grid_kp1_(getKeypointGridWidth(frame_kp1.getKeypointMeasurements()), image_height,
+        static_cast<double>(FLAGS_gyro_matcher_small_search_distance_px)),
     is_keypoint_kp1_matched_(kNumPointsKp1, false),
-    iteration_processed_keypoints_kp1_(kNumPointsKp1, false),
     small_search_distance_px_(FLAGS_gyro_matcher_small_search_distance_px),
-    large_search_distance_px_(FLAGS_gyro_matcher_large_search_distance_px) {
+    large_search_distance_px_(FLAGS_gyro_matcher_large_search_distance_px),
+    num_threads_(FLAGS_gyro_matcher_num_threads > 0 ?
+        static_cast<size_t>(FLAGS_gyro_matcher_num_threads) :
+        std::max(std::thread::hardware_concurrency(), 1u)) {
   CHECK(frame_kp1.isValid());
   CHECK(frame_k.isValid());
   CHECK(frame_kp1.hasDescriptors());
@@ -47,61 +83,18 @@ GyroTwoFrameMatcher::GyroTwoFrameMatcher(
       "is less or equal to 512 bits. Adapt the following check if this "
       "framework uses larger binary descriptors.";
   CHECK_GT(kImageHeight, 0u);
-  CHECK_EQ(static_cast<int>(iteration_processed_keypoints_kp1_.size()), kNumPointsKp1);
   CHECK_EQ(static_cast<int>(is_keypoint_kp1_matched_.size()), kNumPointsKp1);
   CHECK_EQ(static_cast<int>(prediction_success_.size()), predicted_keypoint_positions_kp1_.cols());
   CHECK_GT(small_search_distance_px_, 0);
   CHECK_GT(large_search_distance_px_, 0);
   CHECK_GE(large_search_distance_px_, small_search_distance_px_);
+  CHECK_GE(FLAGS_gyro_matcher_num_threads, 0);
 
-  descriptors_kp1_wrapped_.reserve(kNumPointsKp1);
-  keypoints_kp1_sorted_by_y_.reserve(kNumPointsKp1);
-  descriptors_k_wrapped_.reserve(kNumPointsK);
   matches_kp1_k_->reserve(kNumPointsK);
-  corner_row_LUT_.reserve(kImageHeight);
 }
 
 void GyroTwoFrameMatcher::initialize() {
-  // Prepare descriptors for efficient matching.
-  const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_kp1 =
-      frame_kp1_.getDescriptors();
-  const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_k =
-      frame_k_.getDescriptors();
-
-  for (int descriptor_kp1_idx = 0; descriptor_kp1_idx < kNumPointsKp1;
-      ++descriptor_kp1_idx) {
-    descriptors_kp1_wrapped_.emplace_back(
-        &(descriptors_kp1.coeffRef(0, descriptor_kp1_idx)), kDescriptorSizeBytes);
-  }
-
-  for (int descriptor_k_idx = 0; descriptor_k_idx < kNumPointsK;
-      ++descriptor_k_idx) {
-    descriptors_k_wrapped_.emplace_back(
-        &(descriptors_k.coeffRef(0, descriptor_k_idx)), kDescriptorSizeBytes);
-  }
-
-  // Sort keypoints of frame (k+1) from small to large y coordinates.
-  for (int i = 0; i < kNumPointsKp1; ++i) {
-    keypoints_kp1_sorted_by_y_.emplace_back(frame_kp1_.getKeypointMeasurement(i), i);
-  }
-
-  std::sort(keypoints_kp1_sorted_by_y_.begin(), keypoints_kp1_sorted_by_y_.end(),
-            [](const KeypointData& lhs, const KeypointData& rhs)-> bool {
-              return lhs.measurement(1) < rhs.measurement(1);
-            });
-
-  // Lookup table construction.
-  // TODO(magehrig):  Sort by y if image height >= image width,
-  //                  otherwise sort by x.
-  int v = 0;
-  for (size_t y = 0u; y < kImageHeight; ++y) {
-    while (v < kNumPointsKp1 &&
-        y > static_cast<size_t>(keypoints_kp1_sorted_by_y_[v].measurement(1))) {
-      ++v;
-    }
-    corner_row_LUT_.push_back(v);
-  }
-  CHECK_EQ(corner_row_LUT_.size(), kImageHeight);
+  keypoint_grid_kp1_.build(frame_kp1_.getKeypointMeasurements());
 }
 
 void GyroTwoFrameMatcher::match() {
@@ -111,8 +104,12 @@ void GyroTwoFrameMatcher::match() {
     return;
   }
 
+  // The candidate search only reads the state of the matcher. The exclusive
+  // assignment of the matches runs sequentially in the order of the keypoints.
+  std::vector<CandidateSearchResult> search_results(kNumPointsK);
+  searchCandidatesOfAllKeypoints(&search_results);
   for (int i = 0; i < kNumPointsK; ++i) {
-    matchKeypoint(i);
+    matchKeypoint(i, &search_results[i]);
   }
 
   std::vector<bool> is_inferior_keypoint_kp1_matched(
@@ -122,102 +119,81 @@ void GyroTwoFrameMatcher::match() {
   }
 }
 
-void GyroTwoFrameMatcher::matchKeypoint(const int idx_k) {
-  if (!prediction_success_[idx_k]) {
+void GyroTwoFrameMatcher::searchCandidatesOfAllKeypoints(
+    std::vector<CandidateSearchResult>* search_results) const {
+  CHECK_NOTNULL(search_results);
+  CHECK_EQ(static_cast<int>(search_results->size()), kNumPointsK);
+  const int num_blocks = (kNumPointsK + kNumKeypointsPerBlock - 1) / kNumKeypointsPerBlock;
+  const size_t num_threads = std::min(num_threads_, static_cast<size_t>(num_blocks));
+
+  // The blocks are handed out one at a time, as the number of candidates varies
+  // over the image.
+  std::atomic<int> next_block(0);
+  auto search_blocks = [&]() {
+    WindowCandidates window_candidates;
+    for (int block = next_block++; block < num_blocks; block = next_block++) {
+      const int idx_k_begin = block * kNumKeypointsPerBlock;
+      const int idx_k_end = std::min(idx_k_begin + kNumKeypointsPerBlock, kNumPointsK);
+      for (int idx_k = idx_k_begin; idx_k < idx_k_end; ++idx_k) {
+        searchCandidates(idx_k, &window_candidates, &(*search_results)[idx_k]);
+      }
+    }
+  };
+
+  if (num_threads <= 1u) {
+    search_blocks();
     return;
   }
+  // The calling thread searches as well. If the workers are busy with the search of another
+  // matcher, it takes over their blocks.
+  const std::shared_ptr<ThreadPool> thread_pool =
+      getCandidateSearchThreadPool(num_threads_ - 1u);
+  std::vector<std::future<void>> workers_done;
+  for (size_t i = 1u; i < num_threads; ++i) {
+    workers_done.emplace_back(thread_pool->enqueue(search_blocks));
+  }
+  search_blocks();
+  for (std::future<void>& worker_done : workers_done) {
+    worker_done.wait();
+  }
+}
 
-  std::fill(iteration_processed_keypoints_kp1_.begin(),
-            iteration_processed_keypoints_kp1_.end(),
-            false);
+void GyroTwoFrameMatcher::searchCandidates(
+    const int idx_k, WindowCandidates* window_candidates,
+    CandidateSearchResult* search_result) const {
+  CHECK_NOTNULL(window_candidates);
+  CHECK_NOTNULL(search_result);
+  if (!prediction_success_[idx_k]) {
+    return;
+  }
 
   bool found = false;
-  bool passed_ratio_test = false;
   int n_processed_corners = 0;
-  KeyPointIterator it_best;
-  const static unsigned int kDescriptorSizeBits = 8 * kDescriptorSizeBytes;
+  int best_match_keypoint_idx_kp1 = -1;
+  const unsigned int kDescriptorSizeBits = 8 * kDescriptorSizeBytes;
   int best_score = static_cast<int>(
       kDescriptorSizeBits * kMatchingThresholdBitsRatioRelaxed);
   unsigned int distance_best = kDescriptorSizeBits + 1;
   unsigned int distance_second_best = kDescriptorSizeBits + 1;
-  const common::FeatureDescriptorConstRef& descriptor_k =
-      descriptors_k_wrapped_[idx_k];
 
   Eigen::Vector2d predicted_keypoint_position_kp1 =
       predicted_keypoint_positions_kp1_.block<2, 1>(0, idx_k);
-  KeyPointIterator nearest_corners_begin, nearest_corners_end;
-  getKeypointIteratorsInWindow(
-      predicted_keypoint_position_kp1, small_search_distance_px_, &nearest_corners_begin, &nearest_corners_end);
+  const SearchWindow small_window =
+      getSearchWindow(predicted_keypoint_position_kp1, small_search_distance_px_);
 
-  const int bound_left_nearest =
-      predicted_keypoint_position_kp1(0) - small_search_distance_px_;
-  const int bound_right_nearest =
-      predicted_keypoint_position_kp1(0) + small_search_distance_px_;
+  MatchData& current_match_data = search_result->match_data;
 
-  MatchData current_match_data;
-
-  // First search small window.
-  for (KeyPointIterator it = nearest_corners_begin; it != nearest_corners_end; ++it) {
-    if (it->measurement(0) < bound_left_nearest ||
-        it->measurement(0) > bound_right_nearest) {
-      continue;
-    }
-
-    CHECK_LT(it->channel_index, kNumPointsKp1);
-    CHECK_GE(it->channel_index, 0);
-    const common::FeatureDescriptorConstRef& descriptor_kp1 =
-        descriptors_kp1_wrapped_[it->channel_index];
-    unsigned int distance = common::GetNumBitsDifferent(descriptor_k, descriptor_kp1);
-    int current_score = kDescriptorSizeBits - distance;
-    if (current_score > best_score) {
-      best_score = current_score;
-      distance_second_best = distance_best;
-      distance_best = distance;
-      it_best = it;
-      found = true;
-    } else if (distance < distance_second_best) {
-      // The second best distance can also belong
-      // to two descriptors that do not qualify as match.
-      distance_second_best = distance;
-    }
-    iteration_processed_keypoints_kp1_[it->channel_index] = true;
-    ++n_processed_corners;
-    const double current_matching_score =
-        computeMatchingScore(current_score, kDescriptorSizeBits);
-    current_match_data.addCandidate(it, current_matching_score);
-  }
-
-  // If no match in small window, increase window and search again.
-  if (!found) {
-    const int bound_left_near =
-        predicted_keypoint_position_kp1(0) - large_search_distance_px_;
-    const int bound_right_near =
-        predicted_keypoint_position_kp1(0) + large_search_distance_px_;
-
-    KeyPointIterator near_corners_begin, near_corners_end;
-    getKeypointIteratorsInWindow(
-        predicted_keypoint_position_kp1, large_search_distance_px_, &near_corners_begin, &near_corners_end);
-
-    for (KeyPointIterator it = near_corners_begin; it != near_corners_end; ++it) {
-      if (iteration_processed_keypoints_kp1_[it->channel_index]) {
-        continue;
-      }
-      if (it->measurement(0) < bound_left_near ||
-          it->measurement(0) > bound_right_near) {
-        continue;
-      }
-      CHECK_LT(it->channel_index, kNumPointsKp1);
-      CHECK_GE(it->channel_index, 0);
-      const common::FeatureDescriptorConstRef& descriptor_kp1 =
-          descriptors_kp1_wrapped_[it->channel_index];
-      unsigned int distance =
-          common::GetNumBitsDifferent(descriptor_k, descriptor_kp1);
+  const auto process_candidates = [&]() {
+    computeDistancesToWindowKeypoints(idx_k, window_candidates);
+    for (size_t i = 0u; i < window_candidates->keypoints_kp1.size(); ++i) {
+      const int keypoint_idx_kp1 = window_candidates->keypoints_kp1[i];
+      const unsigned int distance = window_candidates->distances_kp1[i];
       int current_score = kDescriptorSizeBits - distance;
       if (current_score > best_score) {
         best_score = current_score;
         distance_second_best = distance_best;
         distance_best = distance;
-        it_best = it;
+        best_match_keypoint_idx_kp1 = keypoint_idx_kp1;
         found = true;
       } else if (distance < distance_second_best) {
         // The second best distance can also belong
@@ -227,19 +203,57 @@ void GyroTwoFrameMatcher::matchKeypoint(const int idx_k) {
       ++n_processed_corners;
       const double current_matching_score =
           computeMatchingScore(current_score, kDescriptorSizeBits);
-      current_match_data.addCandidate(it, current_matching_score);
+      current_match_data.addCandidate(keypoint_idx_kp1, current_matching_score);
     }
+  };
+
+  // First search small window.
+  getKeypointsInWindow(small_window, &window_candidates->keypoints_kp1);
+  process_candidates();
+
+  // If no match in small window, increase window and search again.
+  if (!found) {
+    const SearchWindow large_window =
+        getSearchWindow(predicted_keypoint_position_kp1, large_search_distance_px_);
+    getKeypointsInWindow(large_window, &window_candidates->keypoints_kp1);
+
+    // The small window is a subset of the large window. Skip the keypoints
+    // processed in the small window.
+    const Eigen::Matrix2Xd& keypoints_kp1 = frame_kp1_.getKeypointMeasurements();
+    window_candidates->keypoints_kp1.erase(std::remove_if(
+        window_candidates->keypoints_kp1.begin(), window_candidates->keypoints_kp1.end(),
+        [&](const int keypoint_idx_kp1) -> bool {
+          return small_window.contains(keypoints_kp1.col(keypoint_idx_kp1));
+        }), window_candidates->keypoints_kp1.end());
+    process_candidates();
   }
 
+  search_result->n_processed_corners = n_processed_corners;
   if (found) {
-    passed_ratio_test = ratioTest(kDescriptorSizeBits, distance_best,
-                                  distance_second_best);
+    search_result->passed_ratio_test = ratioTest(
+        kDescriptorSizeBits, distance_best, distance_second_best);
+    search_result->best_match_keypoint_idx_kp1 = best_match_keypoint_idx_kp1;
+    search_result->best_score = best_score;
   }
+}
+
+void GyroTwoFrameMatcher::matchKeypoint(
+    const int idx_k, CandidateSearchResult* search_result) {
+  CHECK_NOTNULL(search_result);
+  if (!prediction_success_[idx_k]) {
+    return;
+  }
+
+  const unsigned int kDescriptorSizeBits = 8 * kDescriptorSizeBytes;
+  const bool passed_ratio_test = search_result->passed_ratio_test;
+  const int best_match_keypoint_idx_kp1 = search_result->best_match_keypoint_idx_kp1;
+  const int best_score = search_result->best_score;
+  const int n_processed_corners = search_result->n_processed_corners;
 
   if (passed_ratio_test) {
     CHECK(idx_k_to_attempted_match_data_map_.insert(
-        std::make_pair(idx_k, current_match_data)).second);
-    const int best_match_keypoint_idx_kp1 = it_best->channel_index;
+        std::make_pair(idx_k, std::move(search_result->match_data))).second);
+    CHECK_GE(best_match_keypoint_idx_kp1, 0);
     const double matching_score = computeMatchingScore(
         best_score, kDescriptorSizeBits);
     if (is_keypoint_kp1_matched_[best_match_keypoint_idx_kp1]) {
@@ -284,6 +298,57 @@ void GyroTwoFrameMatcher::matchKeypoint(const int idx_k) {
   stats_count_processed.AddSample(n_processed_corners);
 }
 
+void GyroTwoFrameMatcher::computeDistancesToWindowKeypoints(
+    const int idx_k, WindowCandidates* window_candidates) const {
+  CHECK_NOTNULL(window_candidates);
+  window_candidates->distances_kp1.resize(window_candidates->keypoints_kp1.size());
+  common::getHammingDistancesOneToMany(
+      &frame_k_.getDescriptors().coeffRef(0, idx_k), frame_kp1_.getDescriptors().data(),
+      static_cast<int>(kDescriptorSizeBytes), window_candidates->keypoints_kp1.data(),
+      static_cast<int>(window_candidates->keypoints_kp1.size()),
+      window_candidates->distances_kp1.data());
+}
+
+GyroTwoFrameMatcher::SearchWindow GyroTwoFrameMatcher::getSearchWindow(
+    const Eigen::Vector2d& predicted_keypoint_position,
+    const int window_half_side_length_px) const {
+  CHECK_GT(window_half_side_length_px, 0);
+  SearchWindow window;
+  window.left = static_cast<int>(
+      predicted_keypoint_position(0) - window_half_side_length_px);
+  window.right = static_cast<int>(
+      predicted_keypoint_position(0) + window_half_side_length_px);
+  window.top = clamp(0, kImageHeight - 1, static_cast<int>(
+      predicted_keypoint_position(1) + 0.5 - window_half_side_length_px));
+  window.bottom = clamp(0, kImageHeight - 1, static_cast<int>(
+      predicted_keypoint_position(1) + 0.5 + window_half_side_length_px));
+  CHECK_LE(window.top, window.bottom);
+  return window;
+}
+
+void GyroTwoFrameMatcher::getKeypointsInWindow(
+    const SearchWindow& window, std::vector<int>* keypoints_kp1) const {
+  CHECK_NOTNULL(keypoints_kp1);
+  keypoint_grid_kp1_.getKeypointsInRectangle(
+      window.left, window.right, window.top, window.bottom, keypoints_kp1);
+
+  // The rectangle of the grid includes the bottom row, the window does not.
+  const Eigen::Matrix2Xd& measurements_kp1 = frame_kp1_.getKeypointMeasurements();
+  keypoints_kp1->erase(std::remove_if(
+      keypoints_kp1->begin(), keypoints_kp1->end(),
+      [&](const int keypoint_idx_kp1) -> bool {
+        return !window.contains(measurements_kp1.col(keypoint_idx_kp1));
+      }), keypoints_kp1->end());
+
+  // The first of several candidates with the same score wins, so process them
+  // in an order that does not depend on the grid cells.
+  std::sort(keypoints_kp1->begin(), keypoints_kp1->end(),
+            [&](const int lhs, const int rhs) -> bool {
+              return measurements_kp1(1, lhs) < measurements_kp1(1, rhs) ||
+                  (measurements_kp1(1, lhs) == measurements_kp1(1, rhs) && lhs < rhs);
+            });
+}
+
 bool GyroTwoFrameMatcher::matchInferiorMatches(
     std::vector<bool>* is_inferior_keypoint_kp1_matched) {
   CHECK_NOTNULL(is_inferior_keypoint_kp1_matched);
@@ -297,16 +362,16 @@ bool GyroTwoFrameMatcher::matchInferiorMatches(
         idx_k_to_attempted_match_data_map_[inferior_keypoint_idx_k];
     bool found = false;
     double best_matching_score = static_cast<double>(kMatchingThresholdBitsRatioStrict);
-    KeyPointIterator it_best;
+    int best_match_keypoint_idx_kp1 = -1;
 
     for (size_t i = 0u; i < match_data.keypoint_match_candidates_kp1.size(); ++i) {
-      const KeyPointIterator& keypoint_kp1 = match_data.keypoint_match_candidates_kp1[i];
+      const int keypoint_idx_kp1 = match_data.keypoint_match_candidates_kp1[i];
       const double matching_score = match_data.match_candidate_matching_scores[i];
       // Make sure that we don't try to match with already matched keypoints
       // of frame (k+1) (also previous inferior matches).
-      if (is_keypoint_kp1_matched_[keypoint_kp1->channel_index]) continue;
+      if (is_keypoint_kp1_matched_[keypoint_idx_kp1]) continue;
       if (matching_score > best_matching_score) {
-        it_best = keypoint_kp1;
+        best_match_keypoint_idx_kp1 = keypoint_idx_kp1;
         best_matching_score = matching_score;
         found = true;
       }
@@ -314,7 +379,6 @@ bool GyroTwoFrameMatcher::matchInferiorMatches(
 
     if (found) {
       found_inferior_match = true;
-      const int best_match_keypoint_idx_kp1 = it_best->channel_index;
       if ((*is_inferior_keypoint_kp1_matched)[best_match_keypoint_idx_kp1]) {
         if (best_matching_score > kp1_idx_to_matches_iterator_map_
             [best_match_keypoint_idx_kp1]->getScore()) {
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <aslam/common/hamming.h>
 #include <aslam/frames/visual-frame.h>
 #include <aslam/frames/visual-nframe.h>
 #include <glog/logging.h>
@@ -10,13 +15,15 @@ MatchingProblemFrameToFrame::MatchingProblemFrameToFrame(const VisualFrame& appl
                                                          const VisualFrame& banana_frame,
                                                          const aslam::Quaternion& q_A_B,
                                                          double image_space_distance_threshold,
-                                                         int hamming_distance_threshold)
+                                                         int hamming_distance_threshold,
+                                                         bool use_multi_index_hashing)
   : apple_frame_(apple_frame),
     banana_frame_(banana_frame),
     q_A_B_(q_A_B),
     squared_image_space_distance_threshold_px_sq_(image_space_distance_threshold *
                                                   image_space_distance_threshold),
-    hamming_distance_threshold_(hamming_distance_threshold) {
+    hamming_distance_threshold_(hamming_distance_threshold),
+    use_multi_index_hashing_(use_multi_index_hashing) {
   CHECK_GE(hamming_distance_threshold, 0) << "Descriptor distance needs to be positive.";
   CHECK_GE(image_space_distance_threshold, 0.0) << "Image space distance needs to be positive.";
 
@@ -94,12 +101,22 @@ bool MatchingProblemFrameToFrame::doSetup() {
       CHECK_LT(y_coordinate, image_height_apple_frame_) << "The y coordinate for apple keypoint "
           << apple_idx << " is bigger than or equal to the number of rows in the image.";
 
-      y_coordinate_to_apple_keypoint_index_map_.insert(std::make_pair(y_coordinate, apple_idx));
+      y_coordinates_and_apple_indices_.emplace_back(y_coordinate, apple_idx);
       valid_apples_[apple_idx] = true;
     }
   }
+  // Sorted by y coordinate and then by index, as a multimap filled in the order of the indices.
+  std::sort(y_coordinates_and_apple_indices_.begin(), y_coordinates_and_apple_indices_.end());
   VLOG(20) << "Built LUT for valid apples.";
 
+  if (use_multi_index_hashing_) {
+    // Candidates need a hamming distance strictly below the threshold.
+    apple_descriptor_index_.build(apple_descriptors_, valid_apples_,
+                                  hamming_distance_threshold_ - 1);
+    VLOG(20) << "Built multi-index hash table for valid apples with "
+             << apple_descriptor_index_.getNumSubstrings() << " substrings.";
+  }
+
   // Then, project all banana keypoints into the apple frame.
   const Eigen::Matrix2Xd& banana_keypoints = banana_frame_.getKeypointMeasurements();
   CHECK_EQ(static_cast<int>(num_banana_keypoints), banana_keypoints.cols()) << "The number of "
@@ -154,7 +171,7 @@ void MatchingProblemFrameToFrame::getAppleCandidatesForBanana(int banana_index,
                                                               Candidates* candidates) {
   // Get list of apple keypoint indices within some defined distance around the projected banana
   // keypoint and within some defined descriptor distance.
-  CHECK_EQ(numApples(), y_coordinate_to_apple_keypoint_index_map_.size()) << "The number of apples"
+  CHECK_EQ(numApples(), y_coordinates_and_apple_indices_.size()) << "The number of apples"
     << " and the number of apples in the apple LUT differs. This can happen if 1. the apple frame "
     << "was altered between calling setup() and getAppleCandidatesForBanana(...) or 2. if the "
     << "setup() function did not build a valid LUT for apple keypoints.";
@@ -201,19 +218,64 @@ void MatchingProblemFrameToFrame::getAppleCandidatesForBanana(int banana_index,
     CHECK_GE(y_upper, 0u);
     CHECK_GT(y_upper, y_lower);
 
-    auto it_lower = y_coordinate_to_apple_keypoint_index_map_.lower_bound(y_lower);
-    if (it_lower == y_coordinate_to_apple_keypoint_index_map_.end()) {
+    auto it_lower = std::lower_bound(
+        y_coordinates_and_apple_indices_.begin(), y_coordinates_and_apple_indices_.end(),
+        std::make_pair(y_lower, size_t{0u}));
+    if (it_lower == y_coordinates_and_apple_indices_.end()) {
       // All keypoints in the apple frame lie below the image band -> zero candiates!
       return;
     }
 
-    auto it_upper = y_coordinate_to_apple_keypoint_index_map_.lower_bound(y_upper);
-    if (it_upper != y_coordinate_to_apple_keypoint_index_map_.end()) {
+    auto it_upper = std::lower_bound(
+        it_lower, y_coordinates_and_apple_indices_.end(), std::make_pair(y_upper, size_t{0u}));
+    const auto it_upper_unincremented = it_upper;
+    if (it_upper != y_coordinates_and_apple_indices_.end()) {
       // Pointing to a valid keypoint -> need to increment this because this needs to go one
       // beyond the border (i.e. == end() in normal for loop over a vector).
       ++it_upper;
     }
 
+    if (use_multi_index_hashing_) {
+      // The band holds the apples with a y coordinate in [y_lower, y_upper) and the first apple
+      // of the LUT at or beyond y_upper.
+      const size_t first_apple_beyond_band = (it_upper_unincremented ==
+          y_coordinates_and_apple_indices_.end()) ? numApples() :
+          it_upper_unincremented->second;
+
+      MultiIndexHashing::IndicesAndDistances apples_and_distances;
+      apple_descriptor_index_.getDescriptorsWithinDistance(
+          banana_descriptors_[banana_index], &apples_and_distances);
+
+      // Sort the apples within the band as the LUT does, by y coordinate and then by index.
+      std::vector<std::pair<size_t, std::pair<size_t, int>>> y_coordinates_and_apples;
+      for (const std::pair<size_t, int>& apple_and_distance : apples_and_distances) {
+        const size_t apple_index = apple_and_distance.first;
+        CHECK_LT(static_cast<int>(apple_index), A_keypoints_apple.cols());
+        const size_t y_coordinate =
+            static_cast<size_t>(std::floor(A_keypoints_apple(1, apple_index)));
+        if ((y_coordinate >= y_lower && y_coordinate < y_upper) ||
+            apple_index == first_apple_beyond_band) {
+          y_coordinates_and_apples.emplace_back(y_coordinate, apple_and_distance);
+        }
+      }
+      std::sort(y_coordinates_and_apples.begin(), y_coordinates_and_apples.end());
+
+      for (const std::pair<size_t, std::pair<size_t, int>>& y_coordinate_and_apple :
+           y_coordinates_and_apples) {
+        const size_t apple_index = y_coordinate_and_apple.second.first;
+        const Eigen::Vector2d& apple_keypoint = A_keypoints_apple.col(apple_index);
+        if ((apple_keypoint - A_keypoint_banana).squaredNorm() <
+            squared_image_space_distance_threshold_px_sq_) {
+          addCandidate(apple_index, banana_index, y_coordinate_and_apple.second.second,
+                       apple_track_ids, candidates);
+        }
+      }
+      return;
+    }
+
+    // Collect the apples within the image space distance and compute their descriptor distances
+    // to the banana at once.
+    std::vector<int> apple_indices_in_radius;
     for (auto it = it_lower; it != it_upper; ++it) {
       // Go over all the apple keyponts and compute image space distance to the projected banana
       // keypoint.
@@ -224,21 +286,21 @@ void MatchingProblemFrameToFrame::getAppleCandidatesForBanana(int banana_index,
       double squared_image_space_distance = (apple_keypoint - A_keypoint_banana).squaredNorm();
 
       if (squared_image_space_distance < squared_image_space_distance_threshold_px_sq_) {
-        // This one is within the radius. Compute the descriptor distance.
-        int hamming_distance = computeHammingDistance(banana_index, apple_index);
-
-        if (hamming_distance < hamming_distance_threshold_) {
-          CHECK_GE(hamming_distance, 0);
-          int priority = 0;
-          if (apple_track_ids != nullptr) {
-            CHECK_LT(static_cast<int>(apple_index), apple_track_ids->rows());
-            if ((*apple_track_ids)(apple_index) >= 0) priority = 1;
-          }
-          candidates->emplace_back(apple_index,
-                                   banana_index,
-                                   computeMatchScore(hamming_distance),
-                                   priority);
-        }
+        // This one is within the radius.
+        apple_indices_in_radius.push_back(static_cast<int>(apple_index));
+      }
+    }
+
+    std::vector<uint32_t> hamming_distances(apple_indices_in_radius.size());
+    common::getHammingDistancesOneToMany(
+        banana_descriptors_[banana_index].data(), apple_frame_.getDescriptors().data(),
+        static_cast<int>(descriptor_size_bytes_), apple_indices_in_radius.data(),
+        static_cast<int>(apple_indices_in_radius.size()), hamming_distances.data());
+    for (size_t idx = 0u; idx < apple_indices_in_radius.size(); ++idx) {
+      const int hamming_distance = static_cast<int>(hamming_distances[idx]);
+      if (hamming_distance < hamming_distance_threshold_) {
+        addCandidate(apple_indices_in_radius[idx], banana_index, hamming_distance,
+                     apple_track_ids, candidates);
       }
     }
   } else {
@@ -246,6 +308,22 @@ void MatchingProblemFrameToFrame::getAppleCandidatesForBanana(int banana_index,
   }
 }
 
+void MatchingProblemFrameToFrame::addCandidate(
+    size_t apple_index, int banana_index, int hamming_distance,
+    const Eigen::VectorXi* apple_track_ids, Candidates* candidates) {
+  CHECK_NOTNULL(candidates);
+  CHECK_GE(hamming_distance, 0);
+  int priority = 0;
+  if (apple_track_ids != nullptr) {
+    CHECK_LT(static_cast<int>(apple_index), apple_track_ids->rows());
+    if ((*apple_track_ids)(apple_index) >= 0) priority = 1;
+  }
+  candidates->emplace_back(apple_index,
+                           banana_index,
+                           computeMatchScore(hamming_distance),
+                           priority);
+}
+
 size_t MatchingProblemFrameToFrame::numApples() const {
   return static_cast<size_t>(apple_frame_.getNumKeypointMeasurements());
 }
@@ -0,0 +1,154 @@
+#include "aslam/matcher/multi-index-hashing.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace aslam {
+
+namespace {
+// Bounds of the substring length. The upper bound limits the bucket array of a table to
+// 2^16 entries.
+constexpr size_t kMinSubstringSizeBits = 8u;
+constexpr size_t kMaxSubstringSizeBits = 16u;
+
+inline size_t countBits(uint32_t value) {
+  size_t num_bits = 0u;
+  for (; value != 0u; value &= value - 1u) {
+    ++num_bits;
+  }
+  return num_bits;
+}
+}  // namespace
+
+MultiIndexHashing::MultiIndexHashing()
+    : descriptor_size_bytes_(0u),
+      substring_size_bits_(0u),
+      num_indexed_descriptors_(0u),
+      max_hamming_distance_(-1) {}
+
+void MultiIndexHashing::build(
+    const std::vector<common::FeatureDescriptorConstRef>& descriptors,
+    const std::vector<bool>& is_valid, int max_hamming_distance) {
+  CHECK_EQ(descriptors.size(), is_valid.size());
+  descriptors_ = descriptors;
+  substring_tables_.clear();
+  substring_flip_masks_.clear();
+  max_hamming_distance_ = max_hamming_distance;
+  num_indexed_descriptors_ = std::count(is_valid.begin(), is_valid.end(), true);
+  descriptor_size_bytes_ = descriptors.empty() ? 0u : descriptors.front().size();
+  if (num_indexed_descriptors_ == 0u || descriptor_size_bytes_ == 0u ||
+      max_hamming_distance_ < 0) {
+    return;
+  }
+
+  // Buckets with about one descriptor each keep both the lookups and the verifications cheap.
+  const size_t descriptor_size_bits = 8u * descriptor_size_bytes_;
+  substring_size_bits_ = static_cast<size_t>(
+      std::round(std::log2(static_cast<double>(num_indexed_descriptors_))));
+  substring_size_bits_ = std::min(
+      std::max(substring_size_bits_, kMinSubstringSizeBits), kMaxSubstringSizeBits);
+  substring_size_bits_ = std::min(substring_size_bits_, descriptor_size_bits);
+  const size_t num_substrings =
+      (descriptor_size_bits + substring_size_bits_ - 1u) / substring_size_bits_;
+
+  // Pigeonhole principle: one of the substrings differs in at most this many bits.
+  const size_t substring_radius = static_cast<size_t>(max_hamming_distance_) / num_substrings;
+  const uint32_t num_substring_values = 1u << substring_size_bits_;
+  for (uint32_t mask = 0u; mask < num_substring_values; ++mask) {
+    if (countBits(mask) <= substring_radius) {
+      substring_flip_masks_.push_back(mask);
+    }
+  }
+
+  substring_tables_.resize(num_substrings);
+  for (size_t substring_idx = 0u; substring_idx < num_substrings; ++substring_idx) {
+    SubstringTable& table = substring_tables_[substring_idx];
+    table.bit_offset = substring_idx * substring_size_bits_;
+    table.num_bits = std::min(substring_size_bits_, descriptor_size_bits - table.bit_offset);
+
+    // Counting sort of the descriptors by substring value.
+    std::vector<uint32_t> substrings(descriptors_.size());
+    table.bucket_begin.assign((1u << table.num_bits) + 1u, 0u);
+    for (size_t descriptor_idx = 0u; descriptor_idx < descriptors_.size(); ++descriptor_idx) {
+      if (!is_valid[descriptor_idx]) {
+        continue;
+      }
+      CHECK_EQ(descriptors_[descriptor_idx].size(), descriptor_size_bytes_);
+      substrings[descriptor_idx] = getSubstring(
+          descriptors_[descriptor_idx].data(), descriptor_size_bytes_, table.bit_offset,
+          table.num_bits);
+      ++table.bucket_begin[substrings[descriptor_idx] + 1u];
+    }
+    for (size_t bucket_idx = 1u; bucket_idx < table.bucket_begin.size(); ++bucket_idx) {
+      table.bucket_begin[bucket_idx] += table.bucket_begin[bucket_idx - 1u];
+    }
+    table.descriptor_indices.resize(num_indexed_descriptors_);
+    std::vector<uint32_t> bucket_end(table.bucket_begin.begin(), table.bucket_begin.end() - 1);
+    for (size_t descriptor_idx = 0u; descriptor_idx < descriptors_.size(); ++descriptor_idx) {
+      if (is_valid[descriptor_idx]) {
+        table.descriptor_indices[bucket_end[substrings[descriptor_idx]]++] =
+            static_cast<uint32_t>(descriptor_idx);
+      }
+    }
+  }
+}
+
+void MultiIndexHashing::getDescriptorsWithinDistance(
+    const common::FeatureDescriptorConstRef& query,
+    IndicesAndDistances* indices_and_distances) const {
+  CHECK_NOTNULL(indices_and_distances)->clear();
+  if (substring_tables_.empty()) {
+    return;
+  }
+  CHECK_EQ(query.size(), descriptor_size_bytes_);
+
+  std::vector<uint32_t> candidate_indices;
+  for (const SubstringTable& table : substring_tables_) {
+    const uint32_t query_substring =
+        getSubstring(query.data(), descriptor_size_bytes_, table.bit_offset, table.num_bits);
+    const uint32_t num_table_values = 1u << table.num_bits;
+    for (const uint32_t mask : substring_flip_masks_) {
+      // The masks are sorted, so the remaining ones flip bits beyond a shorter last substring.
+      if (mask >= num_table_values) {
+        break;
+      }
+      const uint32_t bucket = query_substring ^ mask;
+      candidate_indices.insert(
+          candidate_indices.end(),
+          table.descriptor_indices.begin() + table.bucket_begin[bucket],
+          table.descriptor_indices.begin() + table.bucket_begin[bucket + 1u]);
+    }
+  }
+
+  // A descriptor is found once per close substring.
+  std::sort(candidate_indices.begin(), candidate_indices.end());
+  candidate_indices.erase(
+      std::unique(candidate_indices.begin(), candidate_indices.end()), candidate_indices.end());
+  for (const uint32_t descriptor_idx : candidate_indices) {
+    const int distance =
+        static_cast<int>(common::GetNumBitsDifferent(query, descriptors_[descriptor_idx]));
+    if (distance <= max_hamming_distance_) {
+      indices_and_distances->emplace_back(descriptor_idx, distance);
+    }
+  }
+}
+
+uint32_t MultiIndexHashing::getSubstring(
+    const unsigned char* descriptor, size_t descriptor_size_bytes, size_t bit_offset,
+    size_t num_bits) {
+  CHECK_NOTNULL(descriptor);
+  DCHECK_LE(num_bits, kMaxSubstringSizeBits);
+  // A substring of at most 16 bits starting at any bit spans at most three bytes. The bits are
+  // numbered as in common::GetBit().
+  const size_t first_byte = bit_offset / 8u;
+  uint32_t word = 0u;
+  for (size_t byte_idx = 0u; byte_idx < 3u && first_byte + byte_idx < descriptor_size_bytes;
+       ++byte_idx) {
+    word |= static_cast<uint32_t>(descriptor[first_byte + byte_idx]) << (8u * byte_idx);
+  }
+  return (word >> (bit_offset % 8u)) & ((1u << num_bits) - 1u);
+}
+
+}  // namespace aslam
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/pose-types.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/matcher/gyro-two-frame-matcher.h>
+#include <aslam/matcher/match.h>
+
+DECLARE_int32(gyro_matcher_num_threads);
+
+namespace aslam {
+
+class GyroTwoFrameMatcherTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    num_threads_backup_ = FLAGS_gyro_matcher_num_threads;
+    camera_ = PinholeCamera::createTestCamera();
+    frame_k_ = VisualFrame::createEmptyTestVisualFrame(camera_, 0);
+    frame_kp1_ = VisualFrame::createEmptyTestVisualFrame(camera_, 1);
+
+    // The keypoints of frame (k+1) are shuffled, slightly moved copies of the keypoints of
+    // frame k with a few flipped descriptor bits.
+    constexpr int kNumKeypoints = 1500;
+    constexpr int kDescriptorSizeBytes = 48;
+    std::mt19937 random_engine(42);
+    std::uniform_real_distribution<double> x_distribution(0.0, camera_->imageWidth() - 1.0);
+    std::uniform_real_distribution<double> y_distribution(0.0, camera_->imageHeight() - 1.0);
+    std::uniform_real_distribution<double> noise_distribution(-3.0, 3.0);
+    std::uniform_int_distribution<int> byte_distribution(0, 255);
+    std::uniform_int_distribution<int> bit_distribution(0, 8 * kDescriptorSizeBytes - 1);
+    std::uniform_int_distribution<int> num_flips_distribution(0, 120);
+
+    Eigen::Matrix2Xd keypoints_k(2, kNumKeypoints);
+    VisualFrame::DescriptorsT descriptors_k(kDescriptorSizeBytes, kNumKeypoints);
+    for (int idx = 0; idx < kNumKeypoints; ++idx) {
+      keypoints_k.col(idx) << x_distribution(random_engine), y_distribution(random_engine);
+      for (int byte = 0; byte < kDescriptorSizeBytes; ++byte) {
+        descriptors_k(byte, idx) = static_cast<unsigned char>(byte_distribution(random_engine));
+      }
+    }
+    std::vector<int> permutation(kNumKeypoints);
+    for (int idx = 0; idx < kNumKeypoints; ++idx) {
+      permutation[idx] = idx;
+    }
+    std::shuffle(permutation.begin(), permutation.end(), random_engine);
+    Eigen::Matrix2Xd keypoints_kp1(2, kNumKeypoints);
+    VisualFrame::DescriptorsT descriptors_kp1(kDescriptorSizeBytes, kNumKeypoints);
+    for (int idx = 0; idx < kNumKeypoints; ++idx) {
+      const int idx_kp1 = permutation[idx];
+      keypoints_kp1(0, idx_kp1) = std::min(
+          camera_->imageWidth() - 1.0,
+          std::max(0.0, keypoints_k(0, idx) + noise_distribution(random_engine)));
+      keypoints_kp1(1, idx_kp1) = std::min(
+          camera_->imageHeight() - 1.0,
+          std::max(0.0, keypoints_k(1, idx) + noise_distribution(random_engine)));
+      descriptors_kp1.col(idx_kp1) = descriptors_k.col(idx);
+      const int num_flips = num_flips_distribution(random_engine);
+      for (int flip = 0; flip < num_flips; ++flip) {
+        const int bit = bit_distribution(random_engine);
+        descriptors_kp1(bit / 8, idx_kp1) ^= static_cast<unsigned char>(1 << (bit % 8));
+      }
+    }
+    frame_k_->setKeypointMeasurements(keypoints_k);
+    frame_k_->setDescriptors(descriptors_k);
+    frame_kp1_->setKeypointMeasurements(keypoints_kp1);
+    frame_kp1_->setDescriptors(descriptors_kp1);
+
+    predicted_keypoint_positions_kp1_ = keypoints_k;
+    prediction_success_.resize(kNumKeypoints, 1u);
+    for (int idx = 0; idx < kNumKeypoints; idx += 17) {
+      prediction_success_[idx] = 0u;
+    }
+  }
+
+  virtual void TearDown() {
+    FLAGS_gyro_matcher_num_threads = num_threads_backup_;
+  }
+
+  void match(int num_threads, FrameToFrameMatchesWithScore* matches_kp1_k) const {
+    FLAGS_gyro_matcher_num_threads = num_threads;
+    match(matches_kp1_k);
+  }
+
+  void match(FrameToFrameMatchesWithScore* matches_kp1_k) const {
+    CHECK_NOTNULL(matches_kp1_k);
+    Quaternion q_Ckp1_Ck;
+    q_Ckp1_Ck.setIdentity();
+    GyroTwoFrameMatcher matcher(
+        q_Ckp1_Ck, *frame_kp1_, *frame_k_, camera_->imageHeight(),
+        predicted_keypoint_positions_kp1_, prediction_success_, matches_kp1_k);
+    matcher.match();
+  }
+
+  static void expectSameMatches(
+      const FrameToFrameMatchesWithScore& expected_matches,
+      const FrameToFrameMatchesWithScore& matches) {
+    ASSERT_EQ(expected_matches.size(), matches.size());
+    for (size_t idx = 0u; idx < matches.size(); ++idx) {
+      EXPECT_EQ(expected_matches[idx].getKeypointIndexAppleFrame(),
+                matches[idx].getKeypointIndexAppleFrame());
+      EXPECT_EQ(expected_matches[idx].getKeypointIndexBananaFrame(),
+                matches[idx].getKeypointIndexBananaFrame());
+      EXPECT_EQ(expected_matches[idx].getScore(), matches[idx].getScore());
+    }
+  }
+
+  int num_threads_backup_;
+  PinholeCamera::Ptr camera_;
+  VisualFrame::Ptr frame_k_;
+  VisualFrame::Ptr frame_kp1_;
+  Eigen::Matrix2Xd predicted_keypoint_positions_kp1_;
+  std::vector<unsigned char> prediction_success_;
+};
+
+TEST_F(GyroTwoFrameMatcherTest, SameMatchesForAnyNumberOfThreads) {
+  FrameToFrameMatchesWithScore expected_matches;
+  match(1, &expected_matches);
+  // Make sure the test is not trivially passing.
+  EXPECT_GT(expected_matches.size(), 500u);
+
+  for (const int num_threads : {2, 3, 8, 0}) {
+    FrameToFrameMatchesWithScore matches;
+    match(num_threads, &matches);
+    expectSameMatches(expected_matches, matches);
+  }
+}
+
+TEST_F(GyroTwoFrameMatcherTest, ConcurrentMatchersShareTheThreads) {
+  FrameToFrameMatchesWithScore expected_matches;
+  match(1, &expected_matches);
+
+  FLAGS_gyro_matcher_num_threads = 4;
+  constexpr size_t kNumMatchers = 3u;
+  std::vector<FrameToFrameMatchesWithScore> matches(kNumMatchers);
+  std::vector<std::thread> matcher_threads;
+  for (size_t matcher_idx = 0u; matcher_idx < kNumMatchers; ++matcher_idx) {
+    matcher_threads.emplace_back([this, &matches, matcher_idx]() {
+      for (int repetition = 0; repetition < 5; ++repetition) {
+        match(&matches[matcher_idx]);
+      }
+    });
+  }
+  for (std::thread& matcher_thread : matcher_threads) {
+    matcher_thread.join();
+  }
+  for (const FrameToFrameMatchesWithScore& matches_of_matcher : matches) {
+    expectSameMatches(expected_matches, matches_of_matcher);
+  }
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cmath>
+#include <random>
 #include <vector>
 
 #include <glog/logging.h>
@@ -280,4 +281,82 @@ TEST_F(MatcherTest, TestComplex) {
   }
 }
 
+TEST_F(MatcherTest, MultiIndexHashingCandidatesEqualBandSearch) {
+  constexpr size_t kNumKeypoints = 2000u;
+  constexpr size_t kDescriptorSizeBytes = 48u;
+  const double image_width = static_cast<double>(camera_->imageWidth());
+  const double image_height = static_cast<double>(camera_->imageHeight());
+
+  std::mt19937 random_engine(42);
+  std::uniform_real_distribution<double> x_distribution(0.0, image_width - 1.0);
+  // Few distinct rows, such that many apples share a row of the y coordinate LUT.
+  std::uniform_int_distribution<int> row_distribution(0, 50);
+  std::uniform_real_distribution<double> offset_distribution(-15.0, 15.0);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  std::uniform_int_distribution<int> bit_distribution(0, 8 * kDescriptorSizeBytes - 1);
+  std::uniform_int_distribution<int> num_flips_distribution(0, 90);
+
+  Eigen::Matrix2Xd apple_keypoints(2, kNumKeypoints);
+  Eigen::Matrix2Xd banana_keypoints(2, kNumKeypoints);
+  Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> apple_descriptors(
+      kDescriptorSizeBytes, kNumKeypoints);
+  for (size_t idx = 0u; idx < kNumKeypoints; ++idx) {
+    apple_keypoints(0, idx) = x_distribution(random_engine);
+    apple_keypoints(1, idx) = (image_height - 1.0) / 50.0 * row_distribution(random_engine);
+    banana_keypoints(0, idx) = std::min(std::max(
+        apple_keypoints(0, idx) + offset_distribution(random_engine), 0.0), image_width - 1.0);
+    banana_keypoints(1, idx) = std::min(std::max(
+        apple_keypoints(1, idx) + offset_distribution(random_engine), 0.0), image_height - 1.0);
+    for (size_t byte_idx = 0u; byte_idx < kDescriptorSizeBytes; ++byte_idx) {
+      apple_descriptors(byte_idx, idx) =
+          static_cast<unsigned char>(byte_distribution(random_engine));
+    }
+  }
+  // Every banana descriptor is a perturbed copy of the apple descriptor with the same index.
+  Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> banana_descriptors =
+      apple_descriptors;
+  for (size_t idx = 0u; idx < kNumKeypoints; ++idx) {
+    const int num_flips = num_flips_distribution(random_engine);
+    for (int flip_idx = 0; flip_idx < num_flips; ++flip_idx) {
+      const int bit = bit_distribution(random_engine);
+      banana_descriptors(bit / 8, idx) ^= static_cast<unsigned char>(1 << (bit % 8));
+    }
+  }
+
+  apple_frame_->setKeypointMeasurements(apple_keypoints);
+  apple_frame_->setDescriptors(apple_descriptors);
+  banana_frame_->setKeypointMeasurements(banana_keypoints);
+  banana_frame_->setDescriptors(banana_descriptors);
+
+  aslam::Quaternion q_A_B;
+  q_A_B.setIdentity();
+  aslam::MatchingProblemFrameToFrame band_search_problem(
+      *apple_frame_, *banana_frame_, q_A_B, image_space_distance_threshold_,
+      hamming_distance_threshold_);
+  constexpr bool kUseMultiIndexHashing = true;
+  aslam::MatchingProblemFrameToFrame multi_index_hashing_problem(
+      *apple_frame_, *banana_frame_, q_A_B, image_space_distance_threshold_,
+      hamming_distance_threshold_, kUseMultiIndexHashing);
+  ASSERT_TRUE(band_search_problem.doSetup());
+  ASSERT_TRUE(multi_index_hashing_problem.doSetup());
+
+  size_t num_candidates = 0u;
+  for (size_t banana_idx = 0u; banana_idx < kNumKeypoints; ++banana_idx) {
+    aslam::MatchingProblem::Candidates band_search_candidates;
+    aslam::MatchingProblem::Candidates multi_index_hashing_candidates;
+    band_search_problem.getAppleCandidatesForBanana(banana_idx, &band_search_candidates);
+    multi_index_hashing_problem.getAppleCandidatesForBanana(
+        banana_idx, &multi_index_hashing_candidates);
+    ASSERT_EQ(band_search_candidates.size(), multi_index_hashing_candidates.size());
+    for (size_t candidate_idx = 0u; candidate_idx < band_search_candidates.size();
+         ++candidate_idx) {
+      EXPECT_EQ(band_search_candidates[candidate_idx],
+                multi_index_hashing_candidates[candidate_idx]);
+    }
+    num_candidates += band_search_candidates.size();
+  }
+  // Make sure the comparison is not trivial.
+  EXPECT_GT(num_candidates, kNumKeypoints / 2u);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/feature-descriptor-ref.h>
+#include <aslam/matcher/multi-index-hashing.h>
+
+namespace aslam {
+
+class MultiIndexHashingTest : public ::testing::Test {
+ protected:
+  typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsType;
+
+  virtual void SetUp() {
+    random_engine_.seed(42);
+  }
+
+  // Random descriptors where every second one is a slightly perturbed copy of its predecessor,
+  // such that queries have close neighbors.
+  void createDescriptors(size_t num_descriptors, size_t descriptor_size_bytes,
+                         DescriptorsType* descriptors) {
+    CHECK_NOTNULL(descriptors)->resize(descriptor_size_bytes, num_descriptors);
+    std::uniform_int_distribution<int> byte_distribution(0, 255);
+    std::uniform_int_distribution<size_t> bit_distribution(0u, 8u * descriptor_size_bytes - 1u);
+    std::uniform_int_distribution<int> num_flips_distribution(0, 80);
+    for (size_t col = 0u; col < num_descriptors; ++col) {
+      if (col % 2u == 1u) {
+        descriptors->col(col) = descriptors->col(col - 1u);
+        const int num_flips = num_flips_distribution(random_engine_);
+        for (int flip_idx = 0; flip_idx < num_flips; ++flip_idx) {
+          const size_t bit = bit_distribution(random_engine_);
+          (*descriptors)(bit / 8u, col) ^= static_cast<unsigned char>(1u << (bit % 8u));
+        }
+      } else {
+        for (size_t row = 0u; row < descriptor_size_bytes; ++row) {
+          (*descriptors)(row, col) = static_cast<unsigned char>(byte_distribution(random_engine_));
+        }
+      }
+    }
+  }
+
+  std::vector<common::FeatureDescriptorConstRef> getDescriptorRefs(
+      const DescriptorsType& descriptors) {
+    std::vector<common::FeatureDescriptorConstRef> refs;
+    for (int col = 0; col < descriptors.cols(); ++col) {
+      refs.emplace_back(&descriptors.coeffRef(0, col), descriptors.rows());
+    }
+    return refs;
+  }
+
+  void expectSameAsBruteForce(size_t num_descriptors, size_t descriptor_size_bytes,
+                              int max_hamming_distance) {
+    DescriptorsType descriptors;
+    createDescriptors(num_descriptors, descriptor_size_bytes, &descriptors);
+    const std::vector<common::FeatureDescriptorConstRef> refs = getDescriptorRefs(descriptors);
+    std::vector<bool> is_valid(num_descriptors, true);
+    for (size_t idx = 0u; idx < num_descriptors; idx += 7u) {
+      is_valid[idx] = false;
+    }
+
+    MultiIndexHashing index;
+    index.build(refs, is_valid, max_hamming_distance);
+    EXPECT_EQ(index.getNumIndexedDescriptors(),
+              static_cast<size_t>(std::count(is_valid.begin(), is_valid.end(), true)));
+
+    size_t num_found = 0u;
+    for (size_t query_idx = 0u; query_idx < num_descriptors; ++query_idx) {
+      MultiIndexHashing::IndicesAndDistances expected;
+      for (size_t idx = 0u; idx < num_descriptors; ++idx) {
+        const int distance =
+            static_cast<int>(common::GetNumBitsDifferent(refs[query_idx], refs[idx]));
+        if (is_valid[idx] && distance <= max_hamming_distance) {
+          expected.emplace_back(idx, distance);
+        }
+      }
+      MultiIndexHashing::IndicesAndDistances found;
+      index.getDescriptorsWithinDistance(refs[query_idx], &found);
+      EXPECT_EQ(expected, found) << "Query " << query_idx;
+      num_found += found.size();
+    }
+    // Make sure the test is not trivially passing.
+    EXPECT_GT(num_found, num_descriptors / 2u);
+  }
+
+  std::mt19937 random_engine_;
+};
+
+TEST_F(MultiIndexHashingTest, SameAsBruteForceBrisk) {
+  expectSameAsBruteForce(1000u, 48u, 59);
+}
+
+TEST_F(MultiIndexHashingTest, SameAsBruteForceSmallThreshold) {
+  expectSameAsBruteForce(3000u, 48u, 10);
+}
+
+TEST_F(MultiIndexHashingTest, SameAsBruteForceLargeThreshold) {
+  expectSameAsBruteForce(200u, 48u, 150);
+}
+
+TEST_F(MultiIndexHashingTest, SameAsBruteForceShortLastSubstring) {
+  // The 512 bits of a FREAK descriptor do not split into substrings of equal length for the
+  // 12 bit substrings of this index size.
+  expectSameAsBruteForce(5000u, 64u, 40);
+}
+
+TEST_F(MultiIndexHashingTest, Empty) {
+  DescriptorsType descriptors;
+  createDescriptors(10u, 48u, &descriptors);
+  const std::vector<common::FeatureDescriptorConstRef> refs = getDescriptorRefs(descriptors);
+
+  MultiIndexHashing index;
+  index.build(refs, std::vector<bool>(refs.size(), false), 60);
+  EXPECT_EQ(0u, index.getNumIndexedDescriptors());
+  MultiIndexHashing::IndicesAndDistances found;
+  index.getDescriptorsWithinDistance(refs[0], &found);
+  EXPECT_TRUE(found.empty());
+
+  // A negative distance matches nothing.
+  index.build(refs, std::vector<bool>(refs.size(), true), -1);
+  index.getDescriptorsWithinDistance(refs[0], &found);
+  EXPECT_TRUE(found.empty());
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
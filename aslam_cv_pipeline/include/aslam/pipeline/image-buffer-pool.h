@@ -0,0 +1,64 @@
+#ifndef ASLAM_PIPELINE_IMAGE_BUFFER_POOL_H_
+#define ASLAM_PIPELINE_IMAGE_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+/// \class ImageBufferPool
+/// \brief A bounded pool of image buffers that are reused instead of allocating a new image for
+///        every frame. The pool hands out shallow copies of its buffers. A buffer is free again
+///        as soon as all handed out copies are gone, e.g. when the RAW_IMAGE channel of the
+///        VisualFrame holding it is released. There is no need to return buffers explicitly.
+///        If all buffers are in use and the pool is full, a plain image outside of the pool is
+///        allocated. The pool is thread-safe.
+class ImageBufferPool {
+ public:
+  ASLAM_POINTER_TYPEDEFS(ImageBufferPool);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(ImageBufferPool);
+
+  struct Statistics {
+    /// Maximum number of buffers owned by the pool.
+    size_t max_num_buffers;
+    /// Number of buffers currently owned by the pool.
+    size_t num_buffers;
+    /// Number of owned buffers that are currently handed out.
+    size_t num_buffers_in_use;
+    /// Number of requests served by reusing a free buffer.
+    size_t num_reused;
+    /// Number of requests that allocated (or reallocated) a buffer of the pool.
+    size_t num_allocated;
+    /// Number of requests served by an image outside of the pool, as the pool was exhausted.
+    size_t num_unpooled;
+  };
+
+  /// \brief Creates an empty pool.
+  /// \param[in] max_num_buffers Maximum number of buffers the pool owns.
+  explicit ImageBufferPool(size_t max_num_buffers);
+
+  /// \brief Get an image of the given size and type. The content is undefined.
+  cv::Mat acquire(const cv::Size& size, int type);
+
+  Statistics getStatistics() const;
+
+ private:
+  /// Is the buffer referenced by nobody but the pool?
+  static bool isFree(const cv::Mat& buffer);
+
+  const size_t max_num_buffers_;
+  std::vector<cv::Mat> buffers_;
+  size_t num_reused_;
+  size_t num_allocated_;
+  size_t num_unpooled_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_IMAGE_BUFFER_POOL_H_
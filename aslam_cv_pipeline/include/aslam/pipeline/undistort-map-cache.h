@@ -0,0 +1,54 @@
+#ifndef ASLAM_PIPELINE_UNDISTORT_MAP_CACHE_H_
+#define ASLAM_PIPELINE_UNDISTORT_MAP_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/common/macros.h>
+
+// Forward declarations.
+namespace cv { class Mat; }
+
+namespace aslam {
+
+/// \class UndistortMapCache
+/// \brief Persistent cache of undistortion maps. Each pair of maps is stored as a raw binary file
+///        in the cache directory. The file name is a hash of everything the maps depend on, i.e.
+///        the type, intrinsics, distortion and image size of both cameras and the map type.
+///        Changing any of them leads to a different file, stale files are never read.
+///        Files are written to a temporary file first and renamed afterwards, so several
+///        processes can share the same directory.
+class UndistortMapCache {
+ public:
+  ASLAM_POINTER_TYPEDEFS(UndistortMapCache);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(UndistortMapCache);
+
+  /// \brief Creates a cache in the given directory. The directory must exist.
+  explicit UndistortMapCache(const std::string& directory);
+
+  /// \brief Computes the cache key of the maps between the two camera geometries.
+  static uint64_t computeKey(
+      const aslam::Camera& input_camera, const aslam::Camera& output_camera, int map_type);
+
+  /// \brief Loads the maps stored for the key.
+  /// @param[in]  key   Key of the maps, see computeKey(..).
+  /// @param[out] map_u Map of the u-coordinates, see common::buildUndistortMap.
+  /// @param[out] map_v Map of the v-coordinates, see common::buildUndistortMap.
+  /// @return False if there are no maps for the key or the file is damaged.
+  bool load(uint64_t key, cv::Mat* map_u, cv::Mat* map_v) const;
+
+  /// \brief Stores the maps under the key. Existing maps for the key are replaced.
+  /// @return False if the file could not be written.
+  bool store(uint64_t key, const cv::Mat& map_u, const cv::Mat& map_v) const;
+
+  /// \brief Path of the file holding the maps for the key.
+  std::string getFilePath(uint64_t key) const;
+
+ private:
+  const std::string directory_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_UNDISTORT_MAP_CACHE_H_
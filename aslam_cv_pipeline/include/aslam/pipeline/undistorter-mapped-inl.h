@@ -85,8 +85,8 @@ inline std::unique_ptr<MappedUndistorter> createMappedUndistorter(
   }
 
   cv::Mat map_u, map_v;
-  common::buildUndistortMap(
-      *input_camera, *output_camera, CV_16SC2, map_u, map_v);
+  internal::buildOrLoadUndistortMap(
+      *input_camera, *output_camera, &map_u, &map_v);
 
   return std::unique_ptr<MappedUndistorter>(new MappedUndistorter(
       input_camera, output_camera, map_u, map_v, interpolation_type));
@@ -1,6 +1,8 @@
 #ifndef ASLAM_PIPELINE_MAPPED_UNDISTORTER_H_
 #define ASLAM_PIPELINE_MAPPED_UNDISTORTER_H_
 
+#include <memory>
+
 #include <opencv2/core/core.hpp>
 
 #include <aslam/common/types.h>
@@ -10,6 +12,7 @@
 #include <aslam/pipeline/undistorter.h>
 
 namespace aslam {
+class ThreadPool;
 
 /// \brief Factory method to create a mapped undistorter for this camera geometry.
 ///        NOTE: The undistorter stores a copy of this camera and changes to the original geometry
@@ -43,6 +46,31 @@ std::unique_ptr<MappedUndistorter> createMappedUndistorterToPinhole(
     const aslam::UnifiedProjectionCamera& unified_proj_camera,
     float alpha, float scale, aslam::InterpolationMethod interpolation_type);
 
+namespace internal {
+/// \brief Builds the CV_16SC2 undistortion maps with common::buildUndistortMap on
+///        --undistort_map_num_threads threads, but reuses the maps stored in the directory given
+///        by --undistort_map_cache_directory if there are any for these camera geometries. Newly
+///        built maps are stored there. Without the flag the maps are always built.
+void buildOrLoadUndistortMap(
+    const aslam::Camera& input_camera, const aslam::Camera& output_camera, cv::Mat* map_u,
+    cv::Mat* map_v);
+
+/// \brief Bilinear remap of the output rows [row_begin, row_end) of a CV_8UC1 image with the
+///        fixed-point maps of cv::convertMaps (CV_16SC2 integer coordinates and CV_16UC1
+///        interpolation table indices). Pixels outside of the input image are 0, like with
+///        cv::BORDER_CONSTANT. The weights are the same as the ones of cv::remap, but the
+///        function runs entirely on the calling thread.
+/// @param[in]  input_image  The CV_8UC1 input image.
+/// @param[in]  map_xy       CV_16SC2 map with the integer part of the input coordinates.
+/// @param[in]  map_fraction CV_16UC1 map with the interpolation table indices.
+/// @param[in]  row_begin    First output row to compute.
+/// @param[in]  row_end      One past the last output row to compute.
+/// @param[out] output_image CV_8UC1 image of the size of the maps. Must be allocated.
+void remapBilinearFixedPoint(
+    const cv::Mat& input_image, const cv::Mat& map_xy, const cv::Mat& map_fraction,
+    int row_begin, int row_end, cv::Mat* output_image);
+}  // namespace internal
+
 /// \class MappedUndistorter
 /// \brief A class that encapsulates image undistortion for building frames from images.
 ///
@@ -71,11 +99,20 @@ public:
   MappedUndistorter(aslam::Camera::Ptr input_camera, aslam::Camera::Ptr output_camera,
                     const cv::Mat& map_u, const cv::Mat& map_v, InterpolationMethod interpolation);
 
-  virtual ~MappedUndistorter() = default;
+  virtual ~MappedUndistorter();
 
   /// \brief Produce an undistorted image from an input image.
   virtual void processImage(const cv::Mat& input_image, cv::Mat* output_image) const;
 
+  /// \brief Split the output image into horizontal tiles that are remapped in parallel on a
+  ///        thread pool owned by the undistorter. The calling thread processes a tile as well.
+  ///        CV_8UC1 images with the default CV_16SC2 maps and linear interpolation are
+  ///        remapped with internal::remapBilinearFixedPoint, so the result does not depend on
+  ///        the threading configuration of OpenCV.
+  /// \param[in] num_threads Number of threads remapping tiles including the calling thread.
+  ///                        1 restores the plain cv::remap call.
+  void enableParallelRemap(size_t num_threads);
+
   /// Get the undistorter map for the u-coordinate.
   const cv::Mat& getUndistortMapU() const { return map_u_; };
 
@@ -89,6 +126,11 @@ private:
   const cv::Mat map_v_;
   /// \brief Interpolation strategy
   InterpolationMethod interpolation_method_;
+
+  /// \brief Number of tiles processed in parallel.
+  size_t num_remap_threads_;
+  /// \brief Workers for all but the calling thread. Null if the remap is not parallel.
+  std::unique_ptr<ThreadPool> remap_thread_pool_;
 };
 
 }  // namespace aslam
@@ -0,0 +1,154 @@
+#ifndef ASLAM_PIPELINE_VISUAL_NFRAME_SYNCHRONIZER_H_
+#define ASLAM_PIPELINE_VISUAL_NFRAME_SYNCHRONIZER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/common/macros.h>
+#include <aslam/common/spsc-queue.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-npipeline-statistics.h>
+
+namespace aslam {
+
+/// \class VisualNFrameSynchronizer
+/// \brief Assembles the frames of all cameras of a rig into VisualNFrames.
+///
+/// A frame joins the pending nframe whose timestamp is closest to its own, if they are at most
+/// the timestamp tolerance apart. Otherwise it starts a new nframe with its timestamp. The
+/// pending nframes live in a fixed array of slots, each covering the timestamps within the
+/// tolerance around its nframe. Joining an nframe is lock-free: the slots are scanned with
+/// atomic loads and the cameras of an nframe are marked in atomic bit masks. Only starting a
+/// new nframe and sequencing completed nframes take a short lock, i.e. about twice per nframe
+/// instead of once per camera frame. The work under the lock is bounded by the number of
+/// slots and independent of the number of completed nframes waiting for the consumer.
+///
+/// Completed nframes are released in chronological order through a single-producer/
+/// single-consumer queue. If two consecutive nframes are complete, all older incomplete
+/// nframes are considered dropped by a camera and are discarded. If all slots are taken, the
+/// oldest pending nframe is discarded to make room.
+class VisualNFrameSynchronizer {
+ public:
+  ASLAM_POINTER_TYPEDEFS(VisualNFrameSynchronizer);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualNFrameSynchronizer);
+
+  static constexpr size_t kDefaultNumSlots = 64u;
+  static constexpr size_t kNumRememberedSkippedNFrames = 16u;
+
+  struct CompletedNFrame {
+    int64_t timestamp_nanoseconds;
+    std::shared_ptr<VisualNFrame> nframe;
+    /// The stage times of the frames, indexed by camera. The completion time is set.
+    std::vector<FrameStageTimes> frame_stage_times;
+  };
+
+  /// \param[in] camera_system          The camera system of the frames.
+  /// \param[in] timestamp_tolerance_ns Maximum timestamp difference of frames in one nframe.
+  /// \param[in] num_slots              Maximum number of pending nframes.
+  VisualNFrameSynchronizer(
+      const NCamera::Ptr& camera_system, int64_t timestamp_tolerance_ns,
+      size_t num_slots = kDefaultNumSlots);
+
+  /// \brief Adds the frame of a camera. Can be called concurrently from any number of threads.
+  /// \param[in] frame_stage_times The stage times of the frame, handed out with the completed
+  ///                              nframe.
+  /// @return Number of nframes this call released to the completed queue.
+  size_t addFrame(
+      size_t camera_index, const VisualFrame::Ptr& frame,
+      const FrameStageTimes& frame_stage_times = FrameStageTimes());
+
+  /// \brief Get the oldest completed nframe. There must be at most one consumer at a time.
+  /// @return False if there are no completed nframes.
+  bool popCompleted(CompletedNFrame* completed);
+
+  /// \brief Discards all pending nframes that are not newer than the given timestamp.
+  void discardPendingUpTo(int64_t timestamp_nanoseconds);
+
+  /// \brief Discards the nframe at the timestamp, including the frames of it that are added
+  ///        later. The most recent kNumRememberedSkippedNFrames skipped nframes are remembered.
+  /// \param[out] newly_skipped False if the nframe was already skipped.
+  /// @return Number of nframes released because the skipped nframe no longer blocks them.
+  size_t skipNFrame(int64_t timestamp_nanoseconds, bool* newly_skipped);
+
+  /// \brief Is the timestamp within the tolerance of a skipped nframe? Lock-free.
+  bool isNFrameSkipped(int64_t timestamp_nanoseconds) const;
+
+  /// Number of nframes that are waiting for frames.
+  size_t getNumPending() const;
+
+  /// Number of completed nframes that were not popped yet.
+  size_t getNumCompleted() const { return completed_.size(); }
+
+  /// Number of incomplete nframes discarded because a camera dropped a frame.
+  size_t getNumDroppedNFrames() const { return num_dropped_nframes_.load(); }
+
+  /// Number of pending nframes discarded because all slots were taken.
+  size_t getNumOverflowedNFrames() const { return num_overflowed_nframes_.load(); }
+
+ private:
+  struct PendingNFrame {
+    PendingNFrame(int64_t timestamp_nanoseconds_, const NCamera::Ptr& camera_system)
+        : timestamp_nanoseconds(timestamp_nanoseconds_),
+          nframe(new VisualNFrame(camera_system)),
+          frame_stage_times(camera_system->numCameras()),
+          claimed_cameras(0u),
+          set_cameras(0u) {}
+    /// Timestamp of the frame that started the nframe.
+    const int64_t timestamp_nanoseconds;
+    const std::shared_ptr<VisualNFrame> nframe;
+    /// Written by the thread claiming the camera, like the frame.
+    std::vector<FrameStageTimes> frame_stage_times;
+    /// Cameras that have a frame assigned to this nframe.
+    std::atomic<uint64_t> claimed_cameras;
+    /// Cameras whose frame is stored in the nframe.
+    std::atomic<uint64_t> set_cameras;
+  };
+  typedef std::shared_ptr<PendingNFrame> PendingNFramePtr;
+
+  /// Lock-free search for the pending nframe closest to the timestamp within the tolerance.
+  PendingNFramePtr findClosestPending(int64_t timestamp_nanoseconds) const;
+
+  /// Creates a pending nframe in a free slot. The lock must be held.
+  PendingNFramePtr createPendingLocked(int64_t timestamp_nanoseconds);
+
+  /// Releases completed nframes in chronological order and discards the pending nframes that
+  /// will never complete. The lock must be held.
+  /// @return Number of released nframes.
+  size_t sequenceLocked();
+
+  const NCamera::Ptr camera_system_;
+  const int64_t timestamp_tolerance_ns_;
+  const uint64_t all_cameras_mask_;
+
+  /// The slots of the pending nframes. Empty slots are null. The slots are read and written
+  /// with the atomic shared_ptr accessors.
+  std::vector<PendingNFramePtr> slots_;
+  /// Serializes the creation of pending nframes and the sequencing.
+  mutable std::mutex slots_mutex_;
+  /// Timestamps and slot indices of the pending nframes, reused by the sequencing.
+  std::vector<std::pair<int64_t, size_t>> sequencing_order_;
+
+  /// Timestamps of the recently skipped nframes, invalid times mark unused entries. Written
+  /// under slots_mutex_ in round-robin order.
+  std::array<std::atomic<int64_t>, kNumRememberedSkippedNFrames> skipped_timestamps_;
+  size_t next_skipped_timestamp_idx_;
+
+  /// The producer is the thread holding slots_mutex_.
+  common::SpscQueue<CompletedNFrame> completed_;
+
+  std::atomic<size_t> num_dropped_nframes_;
+  std::atomic<size_t> num_overflowed_nframes_;
+  statistics::StatsCollector dropped_nframes_stats_;
+  statistics::StatsCollector overflowed_nframes_stats_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_VISUAL_NFRAME_SYNCHRONIZER_H_
@@ -0,0 +1,160 @@
+#ifndef ASLAM_PIPELINE_VISUAL_NPIPELINE_STATISTICS_H_
+#define ASLAM_PIPELINE_VISUAL_NPIPELINE_STATISTICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <aslam/common/macros.h>
+#include <aslam/common/statistics/statistics.h>
+
+namespace aslam {
+
+/// Monotonic times (see time::monotonicNanoSeconds()) at which a frame passed the stages of
+/// the VisualNPipeline.
+struct FrameStageTimes {
+  /// The image was handed to the pipeline.
+  int64_t enqueued_ns = 0;
+  /// A worker thread started processing the image.
+  int64_t dequeued_ns = 0;
+  /// VisualPipeline::processFrameImpl() started.
+  int64_t process_frame_start_ns = 0;
+  /// VisualPipeline::processFrameImpl() finished.
+  int64_t process_frame_end_ns = 0;
+  /// The nframe holding the frame was complete and released to the output queue.
+  int64_t nframe_completed_ns = 0;
+};
+
+/// \class VisualNPipelineStatistics
+/// \brief Collects the latencies of the stages and the queue depths of a VisualNPipeline.
+///
+/// The latencies are kept per camera in a window of the most recent frames from which the
+/// percentiles are computed on request. All samples are also added to the aslam statistics
+/// with the tags "VisualNPipeline camera <index>: <stage> latency [s]". Thread-safe.
+class VisualNPipelineStatistics {
+ public:
+  ASLAM_POINTER_TYPEDEFS(VisualNPipelineStatistics);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualNPipelineStatistics);
+
+  /// The latencies measured for every frame.
+  enum class Stage {
+    /// From handing the image to the pipeline until a worker picks it up.
+    kQueue,
+    /// From the worker picking the image up until processFrameImpl() starts, i.e. the image
+    /// copies and the undistortion.
+    kPreprocessing,
+    /// The duration of processFrameImpl(), e.g. the detection and description.
+    kProcessFrame,
+    /// From the end of processFrameImpl() until the nframe is complete, i.e. the time the
+    /// frame waited for the frames of the other cameras.
+    kSynchronization,
+    /// From handing the image to the pipeline until the nframe is complete.
+    kTotal
+  };
+  static constexpr size_t kNumStages = 5u;
+  static constexpr size_t kDefaultWindowSize = 1000u;
+
+  struct LatencySummary {
+    /// Number of samples since the start, the percentiles only cover the recent window.
+    size_t num_samples = 0u;
+    double mean_seconds = 0.0;
+    double p50_seconds = 0.0;
+    double p90_seconds = 0.0;
+    double p99_seconds = 0.0;
+    double max_seconds = 0.0;
+  };
+
+  struct QueueDepths {
+    /// Images waiting for a worker thread.
+    size_t num_queued_images = 0u;
+    /// Nframes waiting for the frames of some cameras.
+    size_t num_processing_nframes = 0u;
+    /// Completed nframes waiting for the consumer.
+    size_t num_completed_nframes = 0u;
+  };
+
+  /// \param[in] num_cameras  The number of cameras of the pipeline.
+  /// \param[in] window_size  The number of recent samples per camera and stage the
+  ///                         percentiles are computed from.
+  explicit VisualNPipelineStatistics(
+      size_t num_cameras, size_t window_size = kDefaultWindowSize);
+
+  /// Adds the latencies of a frame that is part of a completed nframe.
+  void addFrame(size_t camera_index, const FrameStageTimes& times);
+
+  /// Adds a sample of the queue depths.
+  void addQueueDepths(const QueueDepths& queue_depths);
+
+  /// Counts an nframe that was removed from a full output queue.
+  void incrementNumEvictedNFrames();
+
+  /// Counts an image that was not processed because its nframe was skipped.
+  void incrementNumSkippedFrames();
+
+  /// Counts an nframe that was skipped because it exceeded the latency budget.
+  void incrementNumSkippedNFrames();
+
+  /// Latency statistics of a stage for the frames of a camera.
+  LatencySummary getLatencySummary(size_t camera_index, Stage stage) const;
+
+  /// The most recent queue depths sample.
+  QueueDepths getQueueDepths() const;
+
+  /// The maximum of every queue depth over all samples.
+  QueueDepths getMaxQueueDepths() const;
+
+  size_t getNumEvictedNFrames() const { return num_evicted_nframes_.load(); }
+
+  size_t getNumSkippedFrames() const { return num_skipped_frames_.load(); }
+
+  size_t getNumSkippedNFrames() const { return num_skipped_nframes_.load(); }
+
+  size_t getNumCameras() const { return num_cameras_; }
+
+  /// A printable table of the latencies of all cameras and stages in milliseconds.
+  std::string print() const;
+
+  static std::string stageToString(Stage stage);
+
+ private:
+  struct LatencyWindow {
+    std::vector<double> samples_seconds;
+    size_t next_sample_idx = 0u;
+    size_t num_samples = 0u;
+    double sum_seconds = 0.0;
+    double max_seconds = 0.0;
+  };
+
+  void addLatencyLocked(size_t camera_index, Stage stage, int64_t latency_ns);
+
+  size_t windowIndex(size_t camera_index, Stage stage) const {
+    return camera_index * kNumStages + static_cast<size_t>(stage);
+  }
+
+  const size_t num_cameras_;
+  const size_t window_size_;
+
+  mutable std::mutex mutex_;
+  /// One window per camera and stage, indexed with windowIndex().
+  std::vector<LatencyWindow> windows_;
+  std::vector<statistics::StatsCollector> stats_collectors_;
+
+  QueueDepths queue_depths_;
+  QueueDepths max_queue_depths_;
+  statistics::StatsCollector queued_images_stats_;
+  statistics::StatsCollector processing_nframes_stats_;
+  statistics::StatsCollector completed_nframes_stats_;
+
+  std::atomic<size_t> num_evicted_nframes_;
+  statistics::StatsCollector evicted_nframes_stats_;
+  std::atomic<size_t> num_skipped_frames_;
+  statistics::StatsCollector skipped_frames_stats_;
+  std::atomic<size_t> num_skipped_nframes_;
+  statistics::StatsCollector skipped_nframes_stats_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_VISUAL_NPIPELINE_STATISTICS_H_
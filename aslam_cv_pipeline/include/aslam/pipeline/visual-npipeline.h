@@ -1,10 +1,12 @@
 #ifndef VISUAL_NPIPELINE_H_
 #define VISUAL_NPIPELINE_H_
 
+#include <atomic>
 #include <condition_variable>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
@@ -14,7 +16,10 @@
 #include <aslam/common/thread-pool.h>
 #include <aslam/frames/visual-frame.h>
 #include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-nframe-synchronizer.h>
+#include <aslam/pipeline/visual-npipeline-statistics.h>
 #include <aslam/pipeline/visual-pipeline.h>
+#include <aslam/pipeline/visual-pipeline-stage-runner.h>
 
 namespace aslam {
 
@@ -48,6 +53,17 @@ class VisualNPipeline final {
   ASLAM_POINTER_TYPEDEFS(VisualNPipeline);
   ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualNPipeline);
 
+  /// How the images are distributed to the processing threads.
+  enum class SchedulingMode {
+    /// Any thread processes the next image, so the images of a camera are processed
+    /// concurrently and may finish out of order.
+    kAnyThread,
+    /// The images of a camera are processed one after the other in the order they were
+    /// added, i.e. at most one thread works on a camera at a time. Up to one thread per
+    /// camera is busy.
+    kCameraAffine
+  };
+
   /// \brief Initialize a working pipeline.
   ///
   /// \param[in] num_threads            The number of processing threads.
@@ -105,7 +121,9 @@ class VisualNPipeline final {
   ///            once this limit has been reached. As the frames are processed
   ///            in a thread pool it is possible that the real queue size will
   ///            exceed the defined size by the number of currently processed
-  ///            nframes.
+  ///            nframes. With the staged processing, the oldest image waiting in the
+  ///            full first stage queue of the camera is dropped as well and its nframe
+  ///            is skipped.
   /// @return    Returns true if oldest nframe has been dropped.
   bool processImageNonBlockingDroppingOldestNFrameIfFull(
       size_t camera_index, const cv::Mat &image, int64_t timestamp,
@@ -152,6 +170,68 @@ class VisualNPipeline final {
   /// Blocks until all waiting frames are processed.
   void waitForAllWorkToComplete() const;
 
+  /// \brief Set how the images are distributed to the processing threads. Applies to the
+  ///        images added afterwards. The default is SchedulingMode::kAnyThread.
+  void setSchedulingMode(SchedulingMode scheduling_mode);
+  SchedulingMode getSchedulingMode() const;
+
+  /// \brief Process the images of every camera with a VisualPipelineStageRunner instead of
+  ///        the thread pool, i.e. with one thread per camera and processing stage.
+  ///
+  /// The undistortion, detection and description of consecutive images of a camera then
+  /// overlap, which uses more cores if there are few cameras. The images of a camera are
+  /// processed in order. Adding an image blocks while the first stage queue of its camera is
+  /// full, except with processImageNonBlockingDroppingOldestNFrameIfFull(). Must be called
+  /// before the first image is added.
+  /// \param[in] max_stage_queue_size The maximum number of images waiting in front of a stage.
+  void enableStagedProcessing(size_t max_stage_queue_size);
+
+  /// \brief Skip the processing of images that are too old.
+  ///
+  /// An image whose timestamp is more than the latency budget older than the newest timestamp
+  /// added to the pipeline is not processed when a thread picks it up. Its whole nframe is
+  /// skipped: the frames of the other cameras at this timestamp are not processed either and
+  /// the frames that were already processed are discarded.
+  /// \param[in] latency_budget_ns The latency budget in nanoseconds of the image timestamps.
+  void setLatencyBudget(int64_t latency_budget_ns);
+
+  /// Process all images again, the default.
+  void disableLatencyBudget();
+
+  /// Number of images that were not processed because their nframe was skipped.
+  size_t getNumSkippedFrames() const;
+
+  /// Number of nframes that were skipped because they exceeded the latency budget.
+  size_t getNumSkippedNFrames() const;
+
+  /// \brief Pin the processing threads to CPU cores, thread i to core
+  ///        core_ids[i % core_ids.size()]. Only supported on Linux.
+  /// @return False if any thread could not be pinned.
+  bool pinProcessingThreadsToCores(const std::vector<int>& core_ids);
+
+  /// \brief Get the latency statistics of a processing stage for the frames of a camera.
+  ///
+  /// The latencies of a frame are recorded once its nframe has been moved to the output
+  /// queue, i.e. by any of the getNext*(), getLatestAndClear*() or processImage*() calls.
+  VisualNPipelineStatistics::LatencySummary getLatencySummary(
+      size_t camera_index, VisualNPipelineStatistics::Stage stage);
+
+  /// Get the most recent queue depths. They are sampled whenever the output queue is accessed.
+  VisualNPipelineStatistics::QueueDepths getQueueDepths() const;
+
+  /// Get the maximum of the sampled queue depths.
+  VisualNPipelineStatistics::QueueDepths getMaxQueueDepths() const;
+
+  /// Number of incomplete nframes that were discarded because a camera dropped a frame.
+  size_t getNumDroppedNFrames() const;
+
+  /// Number of completed nframes that were erased from a full output queue by
+  /// processImageNonBlockingDroppingOldestNFrameIfFull().
+  size_t getNumEvictedNFrames() const;
+
+  /// A printable table of all latencies and queue statistics.
+  std::string printStatistics();
+
   /// \brief  Create a test visual npipeline.
   ///
   /// @param[in]  num_cameras   The number of cameras in the pipeline (determines the number of
@@ -169,17 +249,42 @@ class VisualNPipeline final {
   /// \param[in] camera_index The index of the camera that this image corresponds to.
   /// \param[in] image The image data.
   /// \param[in] timestamp_nanoseconds The time in integer nanoseconds.
-  void work(size_t camera_index, const cv::Mat& image, int64_t timestamp_nanoseconds);
+  /// \param[in] enqueued_ns The monotonic time at which the image was added.
+  void work(size_t camera_index, const cv::Mat& image, int64_t timestamp_nanoseconds,
+            int64_t enqueued_ns);
+
+  /// Decides whether an image is processed given the latency budget and skips its nframe if
+  /// not.
+  bool admitImage(size_t camera_index, int64_t timestamp_nanoseconds);
+
+  /// Skip the nframe of an image that is not processed and count it in the statistics.
+  void skipNFrameOfImage(int64_t timestamp_nanoseconds);
+
+  /// Wake up the consumers after the synchronizer released nframes.
+  void notifyReleasedNFrames(size_t num_released);
+
+  /// Hand a processed frame to the synchronizer and wake up the consumers if any nframes
+  /// were completed.
+  void addProcessedFrame(
+      size_t camera_index, const VisualFrame::Ptr& frame,
+      const FrameStageTimes& frame_stage_times);
 
   std::shared_ptr<VisualNFrame> getNextImpl();
 
   void processImageImpl(size_t camera_index, const cv::Mat& image,
                         int64_t timestamp);
 
+  /// Raise the newest timestamp used by the latency budget.
+  void updateNewestTimestamp(int64_t timestamp);
+
+  /// Move the nframes released by the synchronizer to the output queue, record the
+  /// latencies of their frames and sample the queue depths. The mutex must be held.
+  void fetchCompletedLocked();
+
   /// One visual pipeline for each camera.
   std::vector<std::shared_ptr<VisualPipeline>> pipelines_;
 
-  /// A mutex to protect the processing and completed queues.
+  /// A mutex to protect the completed queue. The workers do not take it to add frames.
   mutable std::mutex mutex_;
   /// Condition variable signaling that the output queue is not full.
   std::condition_variable condition_not_full_;
@@ -187,15 +292,28 @@ class VisualNPipeline final {
   std::condition_variable condition_not_empty_;
   /// A flag indicating a system shutdown.
   std::atomic<bool> shutdown_;
+  std::atomic<SchedulingMode> scheduling_mode_;
+
+  static constexpr int64_t kLatencyBudgetDisabled = -1;
+  std::atomic<int64_t> latency_budget_ns_;
+  /// The newest image timestamp added to the pipeline.
+  std::atomic<int64_t> newest_timestamp_ns_;
 
   typedef std::map<int64_t, std::shared_ptr<VisualNFrame>> TimestampVisualNFrameMap;
-  /// The frames that are in progress.
-  TimestampVisualNFrameMap processing_;
-  /// The output queue of completed frames.
+  /// Assembles the frames that are in progress.
+  std::unique_ptr<VisualNFrameSynchronizer> synchronizer_;
+  /// The output queue of completed frames that were fetched from the synchronizer.
   TimestampVisualNFrameMap completed_;
 
+  /// Latencies and queue depths.
+  VisualNPipelineStatistics statistics_;
+
   /// A thread pool for processing.
   std::shared_ptr<aslam::ThreadPool> thread_pool_;
+  /// One stage runner per camera if the staged processing is enabled, otherwise empty.
+  /// Declared after the synchronizer and statistics as the runners use them until they are
+  /// destroyed.
+  std::vector<std::unique_ptr<VisualPipelineStageRunner>> stage_runners_;
 
   /// The camera system of the raw images.
   std::shared_ptr<NCamera> input_camera_system_;
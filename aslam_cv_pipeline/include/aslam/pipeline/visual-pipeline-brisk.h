@@ -83,6 +83,14 @@ protected:
   /// \param[in/out] frame The visual frame. This will be constructed before calling.
   virtual void processFrameImpl(const cv::Mat& image,
                                 VisualFrame* frame) const;
+
+  /// \brief Detect the keypoints in the image.
+  virtual void detectImpl(const cv::Mat& image, VisualFrame* frame,
+                          std::vector<cv::KeyPoint>* keypoints) const;
+
+  /// \brief Extract the descriptors and store the keypoints and descriptors in the frame.
+  virtual void describeImpl(const cv::Mat& image, std::vector<cv::KeyPoint>* keypoints,
+                            VisualFrame* frame) const;
 private:
   std::shared_ptr<cv::Feature2D> detector_;
   std::shared_ptr<cv::Feature2D> extractor_;
@@ -0,0 +1,116 @@
+#ifndef ASLAM_PIPELINE_VISUAL_PIPELINE_STAGE_RUNNER_H_
+#define ASLAM_PIPELINE_VISUAL_PIPELINE_STAGE_RUNNER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <aslam/common/bounded-queue.h>
+#include <aslam/common/macros.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/visual-npipeline-statistics.h>
+#include <aslam/pipeline/visual-pipeline.h>
+
+namespace aslam {
+
+/// \class VisualPipelineStageRunner
+/// \brief Runs the stages of a VisualPipeline (preprocess, detect, describe, postprocess) on
+///        one thread per stage, such that the stages of consecutive images overlap.
+///
+/// While an image is described, the next one can already be detected and the one after that
+/// undistorted. The stages are connected by bounded queues, so at most about
+/// (number of stages) * (queue size) images are in flight and processImage() blocks once the
+/// first queue is full, while processImageDroppingOldestIfFull() drops the oldest image waiting
+/// in it. The images are processed and handed to the callback in the order they
+/// were added.
+class VisualPipelineStageRunner {
+ public:
+  ASLAM_POINTER_TYPEDEFS(VisualPipelineStageRunner);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualPipelineStageRunner);
+
+  /// Called on the postprocessing thread with every processed frame and its stage times.
+  typedef std::function<void(const VisualFrame::Ptr&, const FrameStageTimes&)> FrameCallback;
+  /// Called on the preprocessing thread with the timestamp of every image before it is
+  /// processed. Images for which it returns false are skipped.
+  typedef std::function<bool(int64_t)> AdmissionCallback;
+
+  /// \param[in] pipeline       The pipeline whose stages are run.
+  /// \param[in] max_queue_size The maximum number of images waiting in front of each stage.
+  /// \param[in] callback       Receives the processed frames.
+  /// \param[in] admission_callback Decides whether an image is processed. Can be empty.
+  VisualPipelineStageRunner(
+      const VisualPipeline::Ptr& pipeline, size_t max_queue_size,
+      const FrameCallback& callback,
+      const AdmissionCallback& admission_callback = AdmissionCallback());
+
+  /// Processes the remaining images and joins the stage threads.
+  ~VisualPipelineStageRunner();
+
+  /// \brief Add an image. Blocks while the queue of the first stage is full.
+  /// \param[in] enqueued_ns The monotonic time at which the image was received, used for the
+  ///                        stage times.
+  /// @return False if the runner is shut down and the image was not added.
+  bool processImage(const cv::Mat& image, int64_t timestamp_nanoseconds, int64_t enqueued_ns);
+
+  /// \brief Add an image without blocking. If the queue of the first stage is full, its
+  ///        oldest image is removed without being processed.
+  /// \param[out] dropped_timestamp_nanoseconds Receives the timestamp of the removed image.
+  /// @return True if an image was removed. The added image is lost if the runner is shut down.
+  bool processImageDroppingOldestIfFull(
+      const cv::Mat& image, int64_t timestamp_nanoseconds, int64_t enqueued_ns,
+      int64_t* dropped_timestamp_nanoseconds);
+
+  /// Stop accepting images. The images that were already added are still processed.
+  void shutdown();
+
+  /// Blocks until all added images have been handed to the callback or were skipped.
+  void waitForAllWorkToComplete() const;
+
+  /// Number of images that were added but not handed to the callback yet.
+  size_t getNumImagesInFlight() const;
+
+ private:
+  struct Task {
+    cv::Mat raw_image;
+    int64_t timestamp_nanoseconds;
+    VisualPipeline::StageData data;
+    FrameStageTimes stage_times;
+  };
+  typedef common::BoundedQueue<Task> TaskQueue;
+
+  void runPreprocessing();
+  void runDetection();
+  void runDescription();
+  void runPostprocessing();
+
+  static Task makeTask(const cv::Mat& image, int64_t timestamp_nanoseconds, int64_t enqueued_ns);
+
+  /// Marks an image as in flight.
+  void startImage();
+  /// Marks an image as no longer in flight.
+  void finishImage();
+
+  const VisualPipeline::Ptr pipeline_;
+  const FrameCallback callback_;
+  const AdmissionCallback admission_callback_;
+
+  TaskQueue preprocessing_queue_;
+  TaskQueue detection_queue_;
+  TaskQueue description_queue_;
+  TaskQueue postprocessing_queue_;
+
+  mutable std::mutex in_flight_mutex_;
+  mutable std::condition_variable condition_all_done_;
+  size_t num_images_in_flight_;
+
+  std::vector<std::thread> stage_threads_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_VISUAL_PIPELINE_STAGE_RUNNER_H_
@@ -2,11 +2,13 @@
 #define VISUAL_PROCESSOR_H
 
 #include <memory>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
 
 #include <aslam/cameras/camera.h>
 #include <aslam/common/macros.h>
+#include <aslam/pipeline/image-buffer-pool.h>
 #include <aslam/pipeline/undistorter.h>
 #include <aslam/frames/visual-frame.h>
 
@@ -32,8 +34,19 @@ public:
   ASLAM_POINTER_TYPEDEFS(VisualPipeline);
   ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualPipeline);
 
+  /// \brief Where the preprocessing is applied.
+  enum class UndistortionMode {
+    /// The whole image is undistorted and the keypoints are detected in the undistorted image.
+    kImage,
+    /// The keypoints are detected in the raw image and only the keypoints are mapped into the
+    /// output camera geometry. The full-image undistortion is skipped.
+    kKeypoints
+  };
+
 protected:
-  VisualPipeline() : copy_images_(false) {};
+  VisualPipeline()
+      : copy_images_(false), undistortion_mode_(UndistortionMode::kImage),
+        image_pyramid_max_level_(kImagePyramidDisabled) {};
 
 public:
   /// \brief Construct a visual pipeline from the input and output cameras
@@ -63,6 +76,50 @@ public:
   /// \returns                  The visual frame built from the image data.
   VisualFrame::Ptr processImage(const cv::Mat& image, int64_t timestamp) const;
 
+  /// Monotonic times (see time::monotonicNanoSeconds()) at which processFrameImpl() started
+  /// and finished for an image.
+  struct ProcessingTimes {
+    int64_t process_frame_start_ns = 0;
+    int64_t process_frame_end_ns = 0;
+  };
+
+  /// \brief Same as \ref processImage but also returns when processFrameImpl() ran.
+  ///
+  /// \param[in]  image            The image data.
+  /// \param[in]  timestamp        The time in integer nanoseconds.
+  /// \param[out] processing_times The start and end time of processFrameImpl(). May be null.
+  /// \returns                     The visual frame built from the image data.
+  VisualFrame::Ptr processImage(
+      const cv::Mat& image, int64_t timestamp, ProcessingTimes* processing_times) const;
+
+  /// The intermediate results of an image that is passed through the processing stages.
+  struct StageData {
+    VisualFrame::Ptr frame;
+    /// The preprocessed image the keypoints are detected in.
+    cv::Mat image;
+    /// The detected keypoints, consumed by the description stage.
+    std::vector<cv::KeyPoint> keypoints;
+    /// Are the keypoints mapped to the output camera in the postprocessing stage?
+    bool undistort_keypoints = false;
+  };
+
+  /// \name Processing stages
+  /// processImage() runs the stages preprocess, detect, describe and postprocess in order on
+  /// the calling thread. Calling them one by one allows running the stages of consecutive
+  /// images concurrently, e.g. describing an image while the next one is being undistorted.
+  /// The stages of different images may run concurrently, but the stages of one image must
+  /// run in order.
+  /// @{
+  /// \brief Create the frame, copy the raw image, undistort it and build the image pyramid.
+  void preprocessStage(const cv::Mat& raw_image, int64_t timestamp, StageData* data) const;
+  /// \brief Detect the keypoints, see detectImpl().
+  void detectStage(StageData* data) const;
+  /// \brief Compute the descriptors and store the keypoints in the frame, see describeImpl().
+  void describeStage(StageData* data) const;
+  /// \brief Map the keypoints to the output camera if only the keypoints are undistorted.
+  void postprocessStage(StageData* data) const;
+  /// @}
+
   /// \brief Get the input camera that corresponds to the image
   ///        passed in to processImage().
   ///
@@ -91,6 +148,41 @@ public:
   /// rectification, the input and output camera may not be the same.
   Camera::ConstPtr getOutputCameraShared() const { return output_camera_; }
 
+  /// \brief Build the image pyramid of every processed image once and store it in the
+  ///        frame (see VisualFrame::getImagePyramid()), such that later stages like the optical
+  ///        flow tracking reuse it instead of building their own.
+  ///
+  /// The pyramid is built from the raw image of the frame (VisualFrame::getRawImage()), the
+  /// image the optical flow tracks on without a pyramid, with cv::buildOpticalFlowPyramid
+  /// including the derivatives.
+  /// \param[in] window_size The optical flow window size the pyramid is built for.
+  /// \param[in] max_level   0-based index of the coarsest pyramid level.
+  void enableImagePyramid(const cv::Size& window_size, int max_level);
+
+  /// \brief Choose whether the whole image or only the keypoints are undistorted.
+  ///
+  /// In both modes the frames have the same layout: The raw image is the image passed to
+  /// processImage() and belongs to the input camera (VisualFrame::getRawCameraGeometry()), the
+  /// keypoints belong to the output camera (VisualFrame::getCameraGeometry()). Hence
+  /// VisualFrame::getKeypointInRawImageCoordinates() works the same in both modes.
+  /// In UndistortionMode::kKeypoints the keypoints that do not map into the output image are
+  /// removed from the frame. Keypoint scales and uncertainties stay in raw image pixels. No
+  /// image pyramid (see enableImagePyramid()) is stored, as the pyramid of the raw image does
+  /// not match the mapped keypoints. The keypoints are only mapped if the input and output
+  /// cameras differ in their geometry.
+  void setUndistortionMode(UndistortionMode mode) { undistortion_mode_ = mode; }
+
+  UndistortionMode getUndistortionMode() const { return undistortion_mode_; }
+
+  /// \brief Draw the copies of the raw images (if copy_images is set) and the preprocessed
+  ///        images from a pool of at most max_num_buffers reused buffers instead of allocating
+  ///        new images for every frame. A raw image buffer returns to the pool once the
+  ///        RAW_IMAGE channel of its frame is released and all other copies are gone.
+  void enableImageBufferPool(size_t max_num_buffers);
+
+  /// \brief Occupancy statistics of the image buffer pool. The pool must be enabled.
+  ImageBufferPool::Statistics getImageBufferPoolStatistics() const;
+
 protected:
   /// \brief Process the frame and fill the results into the frame variable.
   ///
@@ -101,6 +193,29 @@ protected:
   virtual void processFrameImpl(const cv::Mat& image,
                                 VisualFrame* frame) const = 0;
 
+  /// \brief The detection part of processFrameImpl(). Pipelines that can be split into a
+  ///        detection and a description override this function and describeImpl(). The
+  ///        default runs all of processFrameImpl() and leaves the keypoints empty.
+  ///
+  /// \param[in]     image     The image data.
+  /// \param[in/out] frame     The visual frame.
+  /// \param[out]    keypoints The detected keypoints that are passed to describeImpl().
+  virtual void detectImpl(const cv::Mat& image, VisualFrame* frame,
+                          std::vector<cv::KeyPoint>* keypoints) const;
+
+  /// \brief The description part of processFrameImpl(). Computes the descriptors of the
+  ///        keypoints and stores both in the frame. The default does nothing.
+  ///
+  /// \param[in]     image     The image data.
+  /// \param[in/out] keypoints The keypoints from detectImpl(). The extractor may remove some.
+  /// \param[in/out] frame     The visual frame.
+  virtual void describeImpl(const cv::Mat& image, std::vector<cv::KeyPoint>* keypoints,
+                            VisualFrame* frame) const;
+
+  /// \brief Map the keypoints of the frame from the input to the output camera geometry and
+  ///        remove the keypoints that are not visible in the output camera.
+  void undistortKeypoints(VisualFrame* frame) const;
+
   /// \brief Preprocessing for the image. Can be null.
   const std::unique_ptr<Undistorter> preprocessing_;
   /// \brief The intrinsics of the raw image.
@@ -109,6 +224,15 @@ protected:
   std::shared_ptr<const Camera> output_camera_;
   /// \brief Should we copy the image before storing it in the frame?
   bool copy_images_;
+  /// \brief Is the image or only the keypoints undistorted?
+  UndistortionMode undistortion_mode_;
+  /// \brief Pool for the image copies. Can be null.
+  std::unique_ptr<ImageBufferPool> image_buffer_pool_;
+
+  /// \brief Parameters of the image pyramid stored in the frames.
+  static constexpr int kImagePyramidDisabled = -1;
+  cv::Size image_pyramid_window_size_;
+  int image_pyramid_max_level_;
 };
 }  // namespace aslam
 
@@ -0,0 +1,429 @@
+// Replays an image sequence through a VisualNPipeline and reports the throughput, the stage
+// latencies, the drop counts and the peak memory usage as JSON. The throughput counts the
+// nframes that reached the consumer, and the memory usage is reported on top of the preloaded
+// sequence.
+//
+// The images are either loaded from --replay_image_directory, which has to contain one
+// subdirectory per camera (cam0, cam1, ...) with the images of that camera, or synthesized
+// for a rig of --replay_num_cameras cameras. Files named after a timestamp in nanoseconds
+// (e.g. 1403636579763555584.png) keep their timestamps, otherwise the images are
+// timestamped at --replay_rate_hz.
+//
+// Example:
+//   npipeline-replay-benchmark --replay_pipeline=brisk --replay_num_cameras=4 \
+//       --replay_rate_hz=20 --replay_output_file=/tmp/replay.json
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/memory.h>
+#include <aslam/common/time.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-npipeline.h>
+#include <aslam/pipeline/visual-pipeline-brisk.h>
+#include <aslam/pipeline/visual-pipeline-freak.h>
+#include <aslam/pipeline/visual-pipeline-null.h>
+
+DEFINE_string(
+    replay_image_directory, "",
+    "Directory with one subdirectory per camera (cam0, cam1, ...) holding the images to "
+    "replay. Synthetic images are used if empty.");
+DEFINE_int32(
+    replay_num_cameras, 2,
+    "Number of cameras of the rig. Only used for synthetic images.");
+DEFINE_int32(
+    replay_num_nframes, 500,
+    "Number of nframes to replay. For loaded sequences, 0 replays the whole sequence.");
+DEFINE_string(replay_pipeline, "brisk", "The visual pipeline to run: null, brisk or freak.");
+DEFINE_double(
+    replay_rate_hz, 0.0,
+    "Rate at which the nframes are fed to the pipeline. 0 feeds them as fast as possible.");
+DEFINE_int32(replay_num_threads, 4, "Number of processing threads of the pipeline.");
+DEFINE_int32(
+    replay_max_output_queue_size, 10,
+    "Maximum number of completed nframes waiting for the consumer.");
+DEFINE_bool(
+    replay_drop_if_full, false,
+    "Drop the oldest completed nframe if the output queue is full instead of blocking.");
+DEFINE_bool(
+    replay_camera_affine, false, "Process all images of a camera on the same thread.");
+DEFINE_int32(
+    replay_staged_queue_size, 0,
+    "If positive, run the pipeline stages concurrently with queues of this size.");
+DEFINE_double(
+    replay_latency_budget_ms, -1.0,
+    "If non-negative, skip nframes older than the newest one minus this budget.");
+DEFINE_string(
+    replay_output_file, "", "File the JSON report is written to. Printed to stdout if empty.");
+
+namespace aslam {
+namespace {
+constexpr int64_t kTimestampToleranceNs = 100;
+
+struct ImageSequence {
+  NCamera::Ptr ncamera;
+  /// Images indexed by [nframe][camera].
+  std::vector<std::vector<cv::Mat>> images;
+  std::vector<int64_t> timestamps_ns;
+};
+
+int64_t getNFramePeriodNs() {
+  // Without a rate the timestamps only need to be distinct.
+  return FLAGS_replay_rate_hz > 0.0 ?
+      time::from_seconds(1.0 / FLAGS_replay_rate_hz) : time::milliseconds(50);
+}
+
+bool isImageFile(const std::string& filename) {
+  const size_t extension_pos = filename.find_last_of('.');
+  if (extension_pos == std::string::npos) {
+    return false;
+  }
+  std::string extension = filename.substr(extension_pos + 1u);
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  return extension == "png" || extension == "jpg" || extension == "jpeg" ||
+      extension == "pgm" || extension == "bmp";
+}
+
+std::vector<std::string> listImages(const std::string& directory) {
+  std::vector<std::string> filenames;
+  DIR* dir = opendir(directory.c_str());
+  CHECK_NOTNULL(dir);
+  while (const dirent* entry = readdir(dir)) {
+    const std::string filename(entry->d_name);
+    if (isImageFile(filename)) {
+      filenames.push_back(filename);
+    }
+  }
+  closedir(dir);
+  std::sort(filenames.begin(), filenames.end());
+  return filenames;
+}
+
+// Returns the timestamp encoded in the filename or time::getInvalidTime().
+int64_t getTimestampFromFilename(const std::string& filename) {
+  const std::string stem = filename.substr(0u, filename.find_last_of('.'));
+  if (stem.empty() || !std::all_of(stem.begin(), stem.end(), ::isdigit)) {
+    return time::getInvalidTime();
+  }
+  return std::strtoll(stem.c_str(), nullptr, 10);
+}
+
+ImageSequence loadSequence(const std::string& directory) {
+  std::vector<std::vector<std::string>> filenames;
+  while (true) {
+    const std::string camera_directory =
+        directory + "/cam" + std::to_string(filenames.size());
+    DIR* dir = opendir(camera_directory.c_str());
+    if (dir == nullptr) {
+      break;
+    }
+    closedir(dir);
+    filenames.push_back(listImages(camera_directory));
+  }
+  CHECK(!filenames.empty()) << "No camera directories cam0, cam1, ... in " << directory << ".";
+
+  size_t num_nframes = filenames[0].size();
+  for (const std::vector<std::string>& camera_filenames : filenames) {
+    num_nframes = std::min(num_nframes, camera_filenames.size());
+  }
+  if (FLAGS_replay_num_nframes > 0) {
+    num_nframes = std::min<size_t>(num_nframes, FLAGS_replay_num_nframes);
+  }
+  CHECK_GT(num_nframes, 0u) << "No images in " << directory << ".";
+
+  ImageSequence sequence;
+  sequence.images.resize(num_nframes);
+  sequence.timestamps_ns.resize(num_nframes);
+  bool use_filename_timestamps = true;
+  for (size_t nframe_idx = 0u; nframe_idx < num_nframes; ++nframe_idx) {
+    for (size_t camera_idx = 0u; camera_idx < filenames.size(); ++camera_idx) {
+      const std::string& filename = filenames[camera_idx][nframe_idx];
+      cv::Mat image = cv::imread(
+          directory + "/cam" + std::to_string(camera_idx) + "/" + filename,
+          cv::IMREAD_GRAYSCALE);
+      CHECK(!image.empty()) << "Could not load " << filename << ".";
+      sequence.images[nframe_idx].push_back(image);
+    }
+    sequence.timestamps_ns[nframe_idx] = getTimestampFromFilename(filenames[0][nframe_idx]);
+    use_filename_timestamps &= time::isValidTime(sequence.timestamps_ns[nframe_idx]);
+  }
+  if (!use_filename_timestamps) {
+    for (size_t nframe_idx = 0u; nframe_idx < num_nframes; ++nframe_idx) {
+      sequence.timestamps_ns[nframe_idx] = nframe_idx * getNFramePeriodNs();
+    }
+  }
+
+  // The rig is only used for the image sizes, the pipelines do not undistort.
+  sequence.ncamera = createTestNCamera(filenames.size());
+  for (size_t camera_idx = 0u; camera_idx < filenames.size(); ++camera_idx) {
+    const cv::Mat& image = sequence.images[0][camera_idx];
+    Camera& camera = sequence.ncamera->getCameraMutable(camera_idx);
+    camera.setImageWidth(image.cols);
+    camera.setImageHeight(image.rows);
+  }
+  return sequence;
+}
+
+ImageSequence synthesizeSequence() {
+  CHECK_GT(FLAGS_replay_num_cameras, 0);
+  CHECK_GT(FLAGS_replay_num_nframes, 0);
+  ImageSequence sequence;
+  sequence.ncamera = createTestNCamera(FLAGS_replay_num_cameras);
+
+  // One base image per camera whose crop is shifted over time, so that consecutive frames
+  // differ but look alike as in a real sequence.
+  constexpr int kMaxShiftPx = 8;
+  std::vector<cv::Mat> base_images;
+  for (size_t camera_idx = 0u; camera_idx < sequence.ncamera->numCameras(); ++camera_idx) {
+    const Camera& camera = sequence.ncamera->getCamera(camera_idx);
+    cv::Mat image(
+        camera.imageHeight() + kMaxShiftPx, camera.imageWidth() + kMaxShiftPx, CV_8UC1);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+    // Blur the noise to get blobs and corners that the detectors find.
+    cv::GaussianBlur(image, image, cv::Size(5, 5), 2.0);
+    base_images.push_back(image);
+  }
+
+  sequence.images.resize(FLAGS_replay_num_nframes);
+  sequence.timestamps_ns.resize(FLAGS_replay_num_nframes);
+  for (int nframe_idx = 0; nframe_idx < FLAGS_replay_num_nframes; ++nframe_idx) {
+    const int shift_px = nframe_idx % kMaxShiftPx;
+    for (size_t camera_idx = 0u; camera_idx < sequence.ncamera->numCameras(); ++camera_idx) {
+      const Camera& camera = sequence.ncamera->getCamera(camera_idx);
+      const cv::Rect roi(shift_px, shift_px, camera.imageWidth(), camera.imageHeight());
+      // Share the pixels between nframes with the same shift to bound the memory usage.
+      sequence.images[nframe_idx].push_back(base_images[camera_idx](roi));
+    }
+    sequence.timestamps_ns[nframe_idx] = nframe_idx * getNFramePeriodNs();
+  }
+  return sequence;
+}
+
+VisualPipeline::Ptr createPipeline(const Camera::ConstPtr& camera) {
+  constexpr bool kCopyImages = false;
+  constexpr bool kRotationInvariant = true;
+  constexpr bool kScaleInvariant = true;
+  if (FLAGS_replay_pipeline == "null") {
+    return VisualPipeline::Ptr(new NullVisualPipeline(camera, kCopyImages));
+  } else if (FLAGS_replay_pipeline == "brisk") {
+    constexpr size_t kOctaves = 3u;
+    constexpr double kUniformityRadius = 0.0;
+    constexpr double kAbsoluteThreshold = 40.0;
+    constexpr size_t kMaxNumKeypoints = 500u;
+    return VisualPipeline::Ptr(
+        new BriskVisualPipeline(
+            camera, kCopyImages, kOctaves, kUniformityRadius, kAbsoluteThreshold,
+            kMaxNumKeypoints, kRotationInvariant, kScaleInvariant));
+  } else if (FLAGS_replay_pipeline == "freak") {
+    constexpr size_t kNumOctaves = 3u;
+    constexpr int kHessianThreshold = 400;
+    constexpr int kNumOctaveLayers = 3;
+    constexpr float kPatternScale = 22.0f;
+    return VisualPipeline::Ptr(
+        new FreakVisualPipeline(
+            camera, kCopyImages, kNumOctaves, kHessianThreshold, kNumOctaveLayers,
+            kRotationInvariant, kScaleInvariant, kPatternScale));
+  }
+  LOG(FATAL) << "Unknown pipeline " << FLAGS_replay_pipeline
+             << ", expected null, brisk or freak.";
+  return VisualPipeline::Ptr();
+}
+
+// Value of a field of /proc/self/status in kilobytes, e.g. of "VmRSS", or -1 if unavailable.
+long readProcessStatusKb(const std::string& field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0u, field.size() + 1u, field + ":") == 0) {
+      return std::strtol(line.c_str() + field.size() + 1u, nullptr, 10);
+    }
+  }
+  return -1;
+}
+
+// Resets the peak resident set size to the current one. Only supported on Linux, elsewhere
+// the peak includes the preloading.
+void resetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs.is_open()) {
+    clear_refs << "5";
+  }
+}
+
+// Peak resident set size of the process in kilobytes.
+long getPeakRssKb() {
+  const long peak_rss_kb = readProcessStatusKb("VmHWM");
+  if (peak_rss_kb >= 0) {
+    return peak_rss_kb;
+  }
+  rusage usage;
+  CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  return usage.ru_maxrss;
+}
+
+// Current resident set size of the process in kilobytes.
+long getRssKb() {
+  const long rss_kb = readProcessStatusKb("VmRSS");
+  return rss_kb >= 0 ? rss_kb : getPeakRssKb();
+}
+
+std::string replay(const ImageSequence& sequence) {
+  // The sequence is preloaded, only the memory on top of it is used by the pipeline.
+  resetPeakRss();
+  const long preloaded_rss_kb = getRssKb();
+
+  const NCamera::Ptr& ncamera = sequence.ncamera;
+  const size_t num_cameras = ncamera->numCameras();
+  std::vector<VisualPipeline::Ptr> pipelines;
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    pipelines.push_back(createPipeline(ncamera->getCameraShared(camera_idx)));
+  }
+  VisualNPipeline::Ptr npipeline = aligned_shared<VisualNPipeline>(
+      FLAGS_replay_num_threads, pipelines, ncamera, ncamera, kTimestampToleranceNs);
+  if (FLAGS_replay_camera_affine) {
+    npipeline->setSchedulingMode(VisualNPipeline::SchedulingMode::kCameraAffine);
+  }
+  if (FLAGS_replay_staged_queue_size > 0) {
+    npipeline->enableStagedProcessing(FLAGS_replay_staged_queue_size);
+  }
+  if (FLAGS_replay_latency_budget_ms >= 0.0) {
+    npipeline->setLatencyBudget(time::from_milliseconds(FLAGS_replay_latency_budget_ms));
+  }
+
+  size_t num_received_nframes = 0u;
+  std::thread consumer([&npipeline, &num_received_nframes]() {
+    std::shared_ptr<VisualNFrame> nframe;
+    while (npipeline->getNextBlocking(&nframe)) {
+      ++num_received_nframes;
+    }
+  });
+
+  const size_t num_nframes = sequence.images.size();
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t nframe_idx = 0u; nframe_idx < num_nframes; ++nframe_idx) {
+    if (FLAGS_replay_rate_hz > 0.0) {
+      std::this_thread::sleep_until(
+          start + std::chrono::nanoseconds(
+              sequence.timestamps_ns[nframe_idx] - sequence.timestamps_ns[0]));
+    }
+    for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+      const cv::Mat& image = sequence.images[nframe_idx][camera_idx];
+      const int64_t timestamp_ns = sequence.timestamps_ns[nframe_idx];
+      if (FLAGS_replay_drop_if_full) {
+        npipeline->processImageNonBlockingDroppingOldestNFrameIfFull(
+            camera_idx, image, timestamp_ns, FLAGS_replay_max_output_queue_size);
+      } else {
+        npipeline->processImageBlockingIfFull(
+            camera_idx, image, timestamp_ns, FLAGS_replay_max_output_queue_size);
+      }
+    }
+  }
+  npipeline->waitForAllWorkToComplete();
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Collect the statistics before the shutdown releases the remaining nframes.
+  std::vector<std::vector<VisualNPipelineStatistics::LatencySummary>> latencies(num_cameras);
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    for (size_t stage_idx = 0u; stage_idx < VisualNPipelineStatistics::kNumStages;
+         ++stage_idx) {
+      latencies[camera_idx].push_back(
+          npipeline->getLatencySummary(
+              camera_idx, static_cast<VisualNPipelineStatistics::Stage>(stage_idx)));
+    }
+  }
+  const VisualNPipelineStatistics::QueueDepths max_queue_depths =
+      npipeline->getMaxQueueDepths();
+  const size_t num_dropped_nframes = npipeline->getNumDroppedNFrames();
+  const size_t num_evicted_nframes = npipeline->getNumEvictedNFrames();
+  const size_t num_skipped_nframes = npipeline->getNumSkippedNFrames();
+  const size_t num_skipped_frames = npipeline->getNumSkippedFrames();
+
+  npipeline->shutdown();
+  consumer.join();
+  const long peak_rss_kb = getPeakRssKb();
+
+  std::stringstream json;
+  json << "{\n"
+       << "  \"pipeline\": \"" << FLAGS_replay_pipeline << "\",\n"
+       << "  \"num_cameras\": " << num_cameras << ",\n"
+       << "  \"num_threads\": " << FLAGS_replay_num_threads << ",\n"
+       << "  \"rate_hz\": " << FLAGS_replay_rate_hz << ",\n"
+       << "  \"num_nframes\": " << num_nframes << ",\n"
+       << "  \"num_received_nframes\": " << num_received_nframes << ",\n"
+       << "  \"duration_seconds\": " << seconds << ",\n"
+       << "  \"nframes_per_second\": " << num_received_nframes / seconds << ",\n"
+       << "  \"frames_per_second\": " << num_received_nframes * num_cameras / seconds << ",\n"
+       << "  \"num_dropped_nframes\": " << num_dropped_nframes << ",\n"
+       << "  \"num_evicted_nframes\": " << num_evicted_nframes << ",\n"
+       << "  \"num_skipped_nframes\": " << num_skipped_nframes << ",\n"
+       << "  \"num_skipped_frames\": " << num_skipped_frames << ",\n"
+       << "  \"max_queued_images\": " << max_queue_depths.num_queued_images << ",\n"
+       << "  \"max_processing_nframes\": " << max_queue_depths.num_processing_nframes << ",\n"
+       << "  \"max_completed_nframes\": " << max_queue_depths.num_completed_nframes << ",\n"
+       << "  \"preloaded_rss_kb\": " << preloaded_rss_kb << ",\n"
+       << "  \"peak_rss_kb\": " << peak_rss_kb << ",\n"
+       << "  \"peak_rss_above_preloaded_kb\": " << peak_rss_kb - preloaded_rss_kb << ",\n"
+       << "  \"latencies_ms\": [\n";
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    json << "    {\"camera\": " << camera_idx;
+    for (size_t stage_idx = 0u; stage_idx < VisualNPipelineStatistics::kNumStages;
+         ++stage_idx) {
+      const VisualNPipelineStatistics::LatencySummary& summary =
+          latencies[camera_idx][stage_idx];
+      std::string stage_name = VisualNPipelineStatistics::stageToString(
+          static_cast<VisualNPipelineStatistics::Stage>(stage_idx));
+      std::replace(stage_name.begin(), stage_name.end(), ' ', '_');
+      json << ", \"" << stage_name << "\": {\"samples\": " << summary.num_samples
+           << ", \"mean\": " << summary.mean_seconds * 1e3
+           << ", \"p50\": " << summary.p50_seconds * 1e3
+           << ", \"p90\": " << summary.p90_seconds * 1e3
+           << ", \"p99\": " << summary.p99_seconds * 1e3
+           << ", \"max\": " << summary.max_seconds * 1e3 << "}";
+    }
+    json << "}" << (camera_idx + 1u < num_cameras ? ",\n" : "\n");
+  }
+  json << "  ]\n}\n";
+  return json.str();
+}
+}  // namespace
+}  // namespace aslam
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InstallFailureSignalHandler();
+  FLAGS_alsologtostderr = true;
+
+  const aslam::ImageSequence sequence = FLAGS_replay_image_directory.empty() ?
+      aslam::synthesizeSequence() : aslam::loadSequence(FLAGS_replay_image_directory);
+  const std::string report = aslam::replay(sequence);
+
+  if (FLAGS_replay_output_file.empty()) {
+    std::cout << report;
+  } else {
+    std::ofstream output_file(FLAGS_replay_output_file);
+    CHECK(output_file.is_open()) << "Could not open " << FLAGS_replay_output_file << ".";
+    output_file << report;
+  }
+  return 0;
+}
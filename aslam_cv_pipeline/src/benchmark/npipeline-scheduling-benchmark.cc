@@ -0,0 +1,127 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/memory.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-npipeline.h>
+#include <aslam/pipeline/visual-pipeline-brisk.h>
+
+DEFINE_int32(
+    scheduling_benchmark_num_nframes, 200,
+    "Number of nframes processed per benchmark configuration.");
+DEFINE_int32(
+    scheduling_benchmark_num_cameras, 4, "Number of cameras of the benchmark rig.");
+DEFINE_int32(
+    scheduling_benchmark_num_threads, 4, "Number of processing threads of the pipeline.");
+
+namespace aslam {
+namespace {
+constexpr size_t kMaxOutputQueueSize = 10u;
+
+VisualNPipeline::Ptr createBriskNPipeline(const NCamera::Ptr& ncamera) {
+  constexpr bool kCopyImages = false;
+  constexpr size_t kOctaves = 3u;
+  constexpr double kUniformityRadius = 0.0;
+  constexpr double kAbsoluteThreshold = 40.0;
+  constexpr size_t kMaxNumKeypoints = 500u;
+  constexpr bool kRotationInvariant = true;
+  constexpr bool kScaleInvariant = true;
+  std::vector<VisualPipeline::Ptr> pipelines;
+  for (size_t camera_idx = 0u; camera_idx < ncamera->numCameras(); ++camera_idx) {
+    pipelines.emplace_back(
+        new BriskVisualPipeline(
+            ncamera->getCameraShared(camera_idx), kCopyImages, kOctaves, kUniformityRadius,
+            kAbsoluteThreshold, kMaxNumKeypoints, kRotationInvariant, kScaleInvariant));
+  }
+  constexpr int64_t kTimestampToleranceNs = 100;
+  return aligned_shared<VisualNPipeline>(
+      FLAGS_scheduling_benchmark_num_threads, pipelines, ncamera, ncamera,
+      kTimestampToleranceNs);
+}
+
+void benchmarkScheduling(
+    VisualNPipeline::SchedulingMode scheduling_mode, bool pin_threads,
+    const std::string& name) {
+  const NCamera::Ptr ncamera = createTestNCamera(FLAGS_scheduling_benchmark_num_cameras);
+  std::vector<cv::Mat> images;
+  for (size_t camera_idx = 0u; camera_idx < ncamera->numCameras(); ++camera_idx) {
+    const Camera& camera = ncamera->getCamera(camera_idx);
+    cv::Mat image(camera.imageHeight(), camera.imageWidth(), CV_8UC1);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+    // Blur the noise to get blobs and corners that the detector finds.
+    cv::GaussianBlur(image, image, cv::Size(5, 5), 2.0);
+    images.push_back(image);
+  }
+
+  VisualNPipeline::Ptr npipeline = createBriskNPipeline(ncamera);
+  npipeline->setSchedulingMode(scheduling_mode);
+  if (pin_threads) {
+    std::vector<int> core_ids(std::thread::hardware_concurrency());
+    for (size_t core_idx = 0u; core_idx < core_ids.size(); ++core_idx) {
+      core_ids[core_idx] = static_cast<int>(core_idx);
+    }
+    CHECK(!core_ids.empty());
+    EXPECT_TRUE(npipeline->pinProcessingThreadsToCores(core_ids));
+  }
+
+  std::thread consumer([&npipeline]() {
+    std::shared_ptr<VisualNFrame> nframe;
+    while (npipeline->getNextBlocking(&nframe)) {}
+  });
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int nframe_idx = 0; nframe_idx < FLAGS_scheduling_benchmark_num_nframes; ++nframe_idx) {
+    for (size_t camera_idx = 0u; camera_idx < ncamera->numCameras(); ++camera_idx) {
+      npipeline->processImageBlockingIfFull(
+          camera_idx, images[camera_idx], nframe_idx * 1000000, kMaxOutputQueueSize);
+    }
+  }
+  npipeline->waitForAllWorkToComplete();
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::string latencies;
+  for (size_t camera_idx = 0u; camera_idx < ncamera->numCameras(); ++camera_idx) {
+    const VisualNPipelineStatistics::LatencySummary summary =
+        npipeline->getLatencySummary(camera_idx, VisualNPipelineStatistics::Stage::kTotal);
+    latencies += "\n  camera " + std::to_string(camera_idx) + ": p50 " +
+        std::to_string(summary.p50_seconds * 1e3) + " ms, p99 " +
+        std::to_string(summary.p99_seconds * 1e3) + " ms, max " +
+        std::to_string(summary.max_seconds * 1e3) + " ms";
+  }
+  LOG(INFO) << name << ": " << FLAGS_scheduling_benchmark_num_nframes / seconds
+            << " nframes/s, " << npipeline->getNumDroppedNFrames()
+            << " dropped nframes, total latency:" << latencies;
+
+  npipeline->shutdown();
+  consumer.join();
+}
+}  // namespace
+
+TEST(NPipelineSchedulingBenchmark, AnyThread) {
+  benchmarkScheduling(VisualNPipeline::SchedulingMode::kAnyThread, false, "Any thread");
+}
+
+TEST(NPipelineSchedulingBenchmark, CameraAffine) {
+  benchmarkScheduling(VisualNPipeline::SchedulingMode::kCameraAffine, false, "Camera affine");
+}
+
+TEST(NPipelineSchedulingBenchmark, CameraAffinePinned) {
+  benchmarkScheduling(
+      VisualNPipeline::SchedulingMode::kCameraAffine, true, "Camera affine, pinned threads");
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/pipeline/undistorter-mapped.h>
+
+DEFINE_int32(
+    remap_benchmark_num_iterations, 200,
+    "Number of remapped images per benchmark iteration.");
+
+namespace aslam {
+namespace {
+template <typename Function>
+double measureImagesPerSecond(const Function& function) {
+  // Warm up the caches once.
+  function();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_remap_benchmark_num_iterations; ++i) {
+    function();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  return FLAGS_remap_benchmark_num_iterations / seconds;
+}
+
+void benchmarkRemap(const Camera& camera, const std::string& name) {
+  std::unique_ptr<MappedUndistorter> undistorter =
+      createMappedUndistorter(camera, 1.0, 1.0, InterpolationMethod::Linear);
+  cv::Mat input_image(camera.imageHeight(), camera.imageWidth(), CV_8UC1);
+  cv::randu(input_image, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::Mat output_image;
+
+  const int num_cv_threads = cv::getNumThreads();
+  for (const int num_threads : {1, 2, 4}) {
+    cv::setNumThreads(num_threads);
+    const double remap_images_per_second = measureImagesPerSecond([&]() {
+      cv::remap(input_image, output_image, undistorter->getUndistortMapU(),
+                undistorter->getUndistortMapV(), cv::INTER_LINEAR);
+    });
+
+    // OpenCV must not spawn threads of its own for the tiles.
+    cv::setNumThreads(0);
+    double tiled_images_per_second;
+    if (num_threads == 1) {
+      // A single thread makes the undistorter fall back to cv::remap, so the fixed-point remap
+      // of the whole image is called directly.
+      output_image.create(undistorter->getUndistortMapU().size(), input_image.type());
+      tiled_images_per_second = measureImagesPerSecond([&]() {
+        internal::remapBilinearFixedPoint(
+            input_image, undistorter->getUndistortMapU(), undistorter->getUndistortMapV(), 0,
+            output_image.rows, &output_image);
+      });
+    } else {
+      undistorter->enableParallelRemap(num_threads);
+      tiled_images_per_second = measureImagesPerSecond([&]() {
+        undistorter->processImage(input_image, &output_image);
+      });
+    }
+
+    LOG(INFO) << name << " " << camera.imageWidth() << "x" << camera.imageHeight()
+              << ", " << num_threads << " thread(s): cv::remap "
+              << remap_images_per_second << " images/s, tiled fixed-point "
+              << tiled_images_per_second << " images/s (speedup "
+              << tiled_images_per_second / remap_images_per_second << "x)";
+  }
+  cv::setNumThreads(num_cv_threads);
+}
+}  // namespace
+
+TEST(RemapBenchmark, PinholeCamera) {
+  benchmarkRemap(
+      *PinholeCamera::createTestCamera<RadTanDistortion>(),
+      "PinholeCamera RadTanDistortion");
+}
+
+TEST(RemapBenchmark, UnifiedProjectionCamera) {
+  benchmarkRemap(
+      *UnifiedProjectionCamera::createTestCamera<EquidistantDistortion>(),
+      "UnifiedProjectionCamera EquidistantDistortion");
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
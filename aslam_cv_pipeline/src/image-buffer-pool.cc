@@ -0,0 +1,66 @@
+#include "aslam/pipeline/image-buffer-pool.h"
+
+#include <glog/logging.h>
+
+namespace aslam {
+
+ImageBufferPool::ImageBufferPool(size_t max_num_buffers)
+    : max_num_buffers_(max_num_buffers), num_reused_(0u), num_allocated_(0u),
+      num_unpooled_(0u) {
+  CHECK_GT(max_num_buffers_, 0u);
+  buffers_.reserve(max_num_buffers_);
+}
+
+cv::Mat ImageBufferPool::acquire(const cv::Size& size, int type) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Only the pool can add references to a free buffer, so it stays free until it is returned.
+  cv::Mat* free_buffer = nullptr;
+  for (cv::Mat& buffer : buffers_) {
+    if (!isFree(buffer)) {
+      continue;
+    }
+    if (buffer.size() == size && buffer.type() == type) {
+      ++num_reused_;
+      return buffer;
+    }
+    free_buffer = &buffer;
+  }
+
+  if (buffers_.size() < max_num_buffers_) {
+    buffers_.emplace_back(size, type);
+    ++num_allocated_;
+    return buffers_.back();
+  }
+  if (free_buffer != nullptr) {
+    // Replace a free buffer of another size or type, e.g. after a change of the image size.
+    *free_buffer = cv::Mat(size, type);
+    ++num_allocated_;
+    return *free_buffer;
+  }
+  ++num_unpooled_;
+  return cv::Mat(size, type);
+}
+
+ImageBufferPool::Statistics ImageBufferPool::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Statistics statistics;
+  statistics.max_num_buffers = max_num_buffers_;
+  statistics.num_buffers = buffers_.size();
+  statistics.num_buffers_in_use = 0u;
+  for (const cv::Mat& buffer : buffers_) {
+    if (!isFree(buffer)) {
+      ++statistics.num_buffers_in_use;
+    }
+  }
+  statistics.num_reused = num_reused_;
+  statistics.num_allocated = num_allocated_;
+  statistics.num_unpooled = num_unpooled_;
+  return statistics;
+}
+
+bool ImageBufferPool::isFree(const cv::Mat& buffer) {
+  CHECK_NOTNULL(buffer.u);
+  return CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+}  // namespace aslam
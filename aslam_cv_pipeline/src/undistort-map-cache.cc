@@ -0,0 +1,191 @@
+#include "aslam/pipeline/undistort-map-cache.h"
+
+#include <cstdio>
+#include <fstream>  // NOLINT
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include <glog/logging.h>
+#include <opencv2/core/core.hpp>
+#include <unistd.h>
+
+namespace aslam {
+namespace {
+// Bump the version if the file layout or the map computation changes.
+constexpr uint32_t kFormatVersion = 1u;
+constexpr char kMagic[8] = {'A', 'S', 'L', 'A', 'M', 'U', 'D', 'M'};
+// Maps larger than this are considered damaged.
+constexpr int32_t kMaxMapDimension = 1 << 15;
+
+// 64 bit FNV-1a hash. Unlike std::hash it is stable between builds and platforms with the same
+// endianness, which is required for a persistent cache.
+class Fnv1aHash {
+ public:
+  Fnv1aHash() : hash_(14695981039346656037ull) {}
+
+  template <typename Type>
+  void add(const Type& value) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0u; i < sizeof(Type); ++i) {
+      hash_ ^= bytes[i];
+      hash_ *= 1099511628211ull;
+    }
+  }
+
+  void add(const Eigen::VectorXd& vector) {
+    add(static_cast<int64_t>(vector.size()));
+    for (int i = 0; i < vector.size(); ++i) {
+      add(vector[i]);
+    }
+  }
+
+  uint64_t get() const {
+    return hash_;
+  }
+
+ private:
+  uint64_t hash_;
+};
+
+void addCameraToHash(const aslam::Camera& camera, Fnv1aHash* hash) {
+  CHECK_NOTNULL(hash);
+  hash->add(static_cast<int32_t>(camera.getType()));
+  hash->add(static_cast<uint32_t>(camera.imageWidth()));
+  hash->add(static_cast<uint32_t>(camera.imageHeight()));
+  hash->add(camera.getParameters());
+  hash->add(static_cast<int32_t>(camera.getDistortion().getType()));
+  hash->add(camera.getDistortion().getParameters());
+}
+
+bool writeMap(const cv::Mat& map, std::ofstream* stream) {
+  CHECK_NOTNULL(stream);
+  const int32_t header[3] = {map.rows, map.cols, map.type()};
+  stream->write(reinterpret_cast<const char*>(header), sizeof(header));
+  const size_t row_size = map.cols * map.elemSize();
+  for (int row = 0; row < map.rows; ++row) {
+    stream->write(reinterpret_cast<const char*>(map.ptr(row)), row_size);
+  }
+  return stream->good();
+}
+
+bool readMap(std::ifstream* stream, cv::Mat* map) {
+  CHECK_NOTNULL(stream);
+  CHECK_NOTNULL(map);
+  int32_t header[3];
+  if (!stream->read(reinterpret_cast<char*>(header), sizeof(header))) {
+    return false;
+  }
+  const int32_t rows = header[0];
+  const int32_t cols = header[1];
+  const int32_t type = header[2];
+  if (rows == 0 && cols == 0) {
+    map->release();
+    return true;
+  }
+  if (rows <= 0 || cols <= 0 || rows > kMaxMapDimension || cols > kMaxMapDimension ||
+      (type != CV_16SC2 && type != CV_16UC1 && type != CV_32FC1 && type != CV_32FC2)) {
+    return false;
+  }
+  map->create(rows, cols, type);
+  const size_t row_size = map->cols * map->elemSize();
+  for (int row = 0; row < rows; ++row) {
+    if (!stream->read(reinterpret_cast<char*>(map->ptr(row)), row_size)) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+UndistortMapCache::UndistortMapCache(const std::string& directory) : directory_(directory) {
+  CHECK(!directory_.empty());
+}
+
+uint64_t UndistortMapCache::computeKey(
+    const aslam::Camera& input_camera, const aslam::Camera& output_camera, int map_type) {
+  Fnv1aHash hash;
+  hash.add(kFormatVersion);
+  addCameraToHash(input_camera, &hash);
+  addCameraToHash(output_camera, &hash);
+  hash.add(static_cast<int32_t>(map_type));
+  return hash.get();
+}
+
+bool UndistortMapCache::load(uint64_t key, cv::Mat* map_u, cv::Mat* map_v) const {
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  const std::string path = getFilePath(key);
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(kMagic)];
+  uint32_t format_version;
+  uint64_t stored_key;
+  stream.read(magic, sizeof(magic));
+  stream.read(reinterpret_cast<char*>(&format_version), sizeof(format_version));
+  stream.read(reinterpret_cast<char*>(&stored_key), sizeof(stored_key));
+  if (!stream || !std::equal(magic, magic + sizeof(kMagic), kMagic) ||
+      format_version != kFormatVersion || stored_key != key) {
+    LOG(WARNING) << "Ignoring the undistortion map cache file " << path
+                 << " with an invalid header.";
+    return false;
+  }
+
+  cv::Mat loaded_map_u, loaded_map_v;
+  if (!readMap(&stream, &loaded_map_u) || !readMap(&stream, &loaded_map_v) ||
+      loaded_map_u.empty() || stream.peek() != std::ifstream::traits_type::eof()) {
+    LOG(WARNING) << "Ignoring the damaged undistortion map cache file " << path << ".";
+    return false;
+  }
+  *map_u = loaded_map_u;
+  *map_v = loaded_map_v;
+  VLOG(3) << "Loaded the undistortion maps from " << path << ".";
+  return true;
+}
+
+bool UndistortMapCache::store(uint64_t key, const cv::Mat& map_u, const cv::Mat& map_v) const {
+  CHECK(!map_u.empty());
+  const std::string path = getFilePath(key);
+  // Write to a file unique to this process and thread and move it in place once it is complete,
+  // such that concurrent readers never see partially written maps and concurrent writers do not
+  // write to the same file.
+  std::ostringstream temporary_path_stream;
+  temporary_path_stream << path << ".tmp" << getpid() << "-" << std::this_thread::get_id();
+  const std::string temporary_path = temporary_path_stream.str();
+  {
+    std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open()) {
+      LOG(WARNING) << "Could not open " << temporary_path
+                   << " to store the undistortion maps.";
+      return false;
+    }
+    stream.write(kMagic, sizeof(kMagic));
+    stream.write(reinterpret_cast<const char*>(&kFormatVersion), sizeof(kFormatVersion));
+    stream.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    if (!writeMap(map_u, &stream) || !writeMap(map_v, &stream)) {
+      LOG(WARNING) << "Failed to write the undistortion maps to " << temporary_path << ".";
+      stream.close();
+      std::remove(temporary_path.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to move the undistortion maps to " << path << ".";
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  VLOG(3) << "Stored the undistortion maps in " << path << ".";
+  return true;
+}
+
+std::string UndistortMapCache::getFilePath(uint64_t key) const {
+  std::ostringstream path;
+  path << directory_ << "/undistort-map-" << std::hex << std::setw(16) << std::setfill('0')
+       << key << ".bin";
+  return path.str();
+}
+
+}  // namespace aslam
@@ -1,13 +1,119 @@
 #include "aslam/pipeline/undistorter-mapped.h"
 
+#include <future>
+#include <vector>
+
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/common/thread-pool.h>
 #include <aslam/common/undistort-helpers.h>
 #include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/undistort-map-cache.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <opencv2/imgproc/imgproc.hpp> // cv::remap
 
+DEFINE_string(
+    undistort_map_cache_directory, "",
+    "Directory in which the undistortion maps are cached between runs. Disabled if empty.");
+DEFINE_int32(
+    undistort_map_num_threads, 1,
+    "Number of threads used to build the undistortion maps. 0 uses one thread per hardware "
+    "thread.");
+
 namespace aslam {
 
+namespace internal {
+void buildOrLoadUndistortMap(
+    const aslam::Camera& input_camera, const aslam::Camera& output_camera, cv::Mat* map_u,
+    cv::Mat* map_v) {
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  CHECK_GE(FLAGS_undistort_map_num_threads, 0);
+  const size_t num_threads = static_cast<size_t>(FLAGS_undistort_map_num_threads);
+  if (FLAGS_undistort_map_cache_directory.empty()) {
+    common::buildUndistortMap(
+        input_camera, output_camera, CV_16SC2, *map_u, *map_v, num_threads);
+    return;
+  }
+
+  const UndistortMapCache cache(FLAGS_undistort_map_cache_directory);
+  const uint64_t key = UndistortMapCache::computeKey(input_camera, output_camera, CV_16SC2);
+  if (cache.load(key, map_u, map_v)) {
+    return;
+  }
+  common::buildUndistortMap(
+      input_camera, output_camera, CV_16SC2, *map_u, *map_v, num_threads);
+  cache.store(key, *map_u, *map_v);
+}
+
+void remapBilinearFixedPoint(
+    const cv::Mat& input_image, const cv::Mat& map_xy, const cv::Mat& map_fraction,
+    int row_begin, int row_end, cv::Mat* output_image) {
+  CHECK_NOTNULL(output_image);
+  CHECK_EQ(input_image.type(), CV_8UC1);
+  CHECK_EQ(map_xy.type(), CV_16SC2);
+  CHECK_EQ(map_fraction.type(), CV_16UC1);
+  CHECK_EQ(output_image->type(), CV_8UC1);
+  CHECK(map_xy.size() == map_fraction.size());
+  CHECK(map_xy.size() == output_image->size());
+  CHECK_GE(row_begin, 0);
+  CHECK_LE(row_end, output_image->rows);
+
+  // The fractions are stored in 1/INTER_TAB_SIZE steps, i.e. the weights of the four
+  // neighbors sum up to kWeightScale. These are the weights of cv::remap, which scales them
+  // by a further power of two that cancels out.
+  constexpr int kTableBits = 5;
+  static_assert((1 << kTableBits) == cv::INTER_TAB_SIZE, "Unexpected table size.");
+  constexpr int kTableMask = cv::INTER_TAB_SIZE - 1;
+  constexpr int kWeightBits = 2 * kTableBits;
+  constexpr int kRoundingOffset = 1 << (kWeightBits - 1);
+
+  const int input_cols = input_image.cols;
+  const int input_rows = input_image.rows;
+  // Fetches a pixel with a zero border for the tap of the neighbors outside of the image.
+  auto pixel_or_zero = [&input_image, input_cols, input_rows](int x, int y) -> int {
+    if (x < 0 || y < 0 || x >= input_cols || y >= input_rows) {
+      return 0;
+    }
+    return input_image.ptr<uint8_t>(y)[x];
+  };
+
+  for (int row = row_begin; row < row_end; ++row) {
+    const int16_t* xy = map_xy.ptr<int16_t>(row);
+    const uint16_t* fraction = map_fraction.ptr<uint16_t>(row);
+    uint8_t* output = output_image->ptr<uint8_t>(row);
+    for (int col = 0; col < output_image->cols; ++col) {
+      const int x = xy[2 * col];
+      const int y = xy[2 * col + 1];
+      const int fraction_x = fraction[col] & kTableMask;
+      const int fraction_y = (fraction[col] >> kTableBits) & kTableMask;
+      const int weight_00 = (cv::INTER_TAB_SIZE - fraction_x) * (cv::INTER_TAB_SIZE - fraction_y);
+      const int weight_01 = fraction_x * (cv::INTER_TAB_SIZE - fraction_y);
+      const int weight_10 = (cv::INTER_TAB_SIZE - fraction_x) * fraction_y;
+      const int weight_11 = fraction_x * fraction_y;
+
+      int p00, p01, p10, p11;
+      if (x >= 0 && y >= 0 && x + 1 < input_cols && y + 1 < input_rows) {
+        const uint8_t* input_top = input_image.ptr<uint8_t>(y) + x;
+        const uint8_t* input_bottom = input_top + input_image.step[0];
+        p00 = input_top[0];
+        p01 = input_top[1];
+        p10 = input_bottom[0];
+        p11 = input_bottom[1];
+      } else {
+        p00 = pixel_or_zero(x, y);
+        p01 = pixel_or_zero(x + 1, y);
+        p10 = pixel_or_zero(x, y + 1);
+        p11 = pixel_or_zero(x + 1, y + 1);
+      }
+      output[col] = static_cast<uint8_t>(
+          (weight_00 * p00 + weight_01 * p01 + weight_10 * p10 + weight_11 * p11 +
+           kRoundingOffset) >> kWeightBits);
+    }
+  }
+}
+}  // namespace internal
+
 std::unique_ptr<MappedUndistorter> createMappedUndistorterToPinhole(
     const aslam::UnifiedProjectionCamera& unified_proj_camera, float alpha,
     float scale, aslam::InterpolationMethod interpolation_type) {
@@ -36,31 +142,83 @@ std::unique_ptr<MappedUndistorter> createMappedUndistorterToPinhole(
   CHECK(output_camera);
 
   cv::Mat map_u, map_v;
-  common::buildUndistortMap(*input_camera, *output_camera, CV_16SC2, map_u, map_v);
+  internal::buildOrLoadUndistortMap(*input_camera, *output_camera, &map_u, &map_v);
 
   return std::unique_ptr<MappedUndistorter>(
       new MappedUndistorter(input_camera, output_camera, map_u, map_v, interpolation_type));
 }
 
 MappedUndistorter::MappedUndistorter()
-    : interpolation_method_(aslam::InterpolationMethod::Linear) {}
+    : interpolation_method_(aslam::InterpolationMethod::Linear), num_remap_threads_(1u) {}
 
 MappedUndistorter::MappedUndistorter(Camera::Ptr input_camera, Camera::Ptr output_camera,
                                      const cv::Mat& map_u, const cv::Mat& map_v,
                                      aslam::InterpolationMethod interpolation)
 : Undistorter(input_camera, output_camera), map_u_(map_u), map_v_(map_v),
-  interpolation_method_(interpolation) {
+  interpolation_method_(interpolation), num_remap_threads_(1u) {
   CHECK_EQ(static_cast<size_t>(map_u_.rows), output_camera->imageHeight());
   CHECK_EQ(static_cast<size_t>(map_u_.cols), output_camera->imageWidth());
   CHECK_EQ(static_cast<size_t>(map_v_.rows), output_camera->imageHeight());
   CHECK_EQ(static_cast<size_t>(map_v_.cols), output_camera->imageWidth());
 }
 
+MappedUndistorter::~MappedUndistorter() {}
+
+void MappedUndistorter::enableParallelRemap(size_t num_threads) {
+  CHECK_GT(num_threads, 0u);
+  num_remap_threads_ = num_threads;
+  if (num_threads > 1u) {
+    remap_thread_pool_.reset(new ThreadPool(num_threads - 1u));
+  } else {
+    remap_thread_pool_.reset();
+  }
+}
+
 void MappedUndistorter::processImage(const cv::Mat& input_image, cv::Mat* output_image) const {
   CHECK_EQ(input_camera_->imageWidth(), static_cast<size_t>(input_image.cols));
   CHECK_EQ(input_camera_->imageHeight(), static_cast<size_t>(input_image.rows));
   CHECK_NOTNULL(output_image);
-  cv::remap(input_image, *output_image, map_u_, map_v_, static_cast<int>(interpolation_method_));
+  if (!remap_thread_pool_) {
+    cv::remap(input_image, *output_image, map_u_, map_v_,
+              static_cast<int>(interpolation_method_));
+    return;
+  }
+
+  output_image->create(map_u_.size(), input_image.type());
+  // The output must not alias the input, as the tiles are written while others are read.
+  CHECK(output_image->data != input_image.data);
+  const bool use_fixed_point_bilinear =
+      interpolation_method_ == InterpolationMethod::Linear &&
+      input_image.type() == CV_8UC1 && map_u_.type() == CV_16SC2 &&
+      map_v_.type() == CV_16UC1;
+
+  auto remap_rows = [&](int row_begin, int row_end) {
+    if (use_fixed_point_bilinear) {
+      internal::remapBilinearFixedPoint(
+          input_image, map_u_, map_v_, row_begin, row_end, output_image);
+    } else {
+      cv::Mat output_tile = output_image->rowRange(row_begin, row_end);
+      cv::remap(input_image, output_tile, map_u_.rowRange(row_begin, row_end),
+                map_v_.empty() ? map_v_ : map_v_.rowRange(row_begin, row_end),
+                static_cast<int>(interpolation_method_));
+    }
+  };
+
+  const int num_rows = output_image->rows;
+  const int num_tiles = static_cast<int>(num_remap_threads_);
+  auto tile_begin = [num_rows, num_tiles](int tile) {
+    return static_cast<int>(static_cast<int64_t>(num_rows) * tile / num_tiles);
+  };
+  std::vector<std::future<void>> tiles_done;
+  tiles_done.reserve(num_tiles - 1);
+  for (int tile = 1; tile < num_tiles; ++tile) {
+    tiles_done.emplace_back(
+        remap_thread_pool_->enqueue(remap_rows, tile_begin(tile), tile_begin(tile + 1)));
+  }
+  remap_rows(tile_begin(0), tile_begin(1));
+  for (std::future<void>& tile_done : tiles_done) {
+    tile_done.wait();
+  }
 }
 
 }  // namespace aslam
@@ -0,0 +1,272 @@
+#include "aslam/pipeline/visual-nframe-synchronizer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include <aslam/common/time.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+VisualNFrameSynchronizer::VisualNFrameSynchronizer(
+    const NCamera::Ptr& camera_system, int64_t timestamp_tolerance_ns, size_t num_slots)
+    : camera_system_(camera_system),
+      timestamp_tolerance_ns_(timestamp_tolerance_ns),
+      all_cameras_mask_(
+          CHECK_NOTNULL(camera_system.get())->numCameras() == 64u ?
+              std::numeric_limits<uint64_t>::max() :
+              (uint64_t{1} << camera_system->numCameras()) - 1u),
+      slots_(num_slots),
+      next_skipped_timestamp_idx_(0u),
+      num_dropped_nframes_(0u),
+      num_overflowed_nframes_(0u),
+      dropped_nframes_stats_("VisualNPipeline: dropped nframes"),
+      overflowed_nframes_stats_("VisualNPipeline: overflowed nframes") {
+  CHECK_GT(camera_system_->numCameras(), 0u);
+  CHECK_LE(camera_system_->numCameras(), 64u) << "The camera masks hold at most 64 cameras.";
+  CHECK_GE(timestamp_tolerance_ns_, 0);
+  CHECK_GT(num_slots, 0u);
+  sequencing_order_.reserve(num_slots);
+  for (std::atomic<int64_t>& skipped_timestamp : skipped_timestamps_) {
+    skipped_timestamp = time::getInvalidTime();
+  }
+}
+
+size_t VisualNFrameSynchronizer::addFrame(
+    size_t camera_index, const VisualFrame::Ptr& frame,
+    const FrameStageTimes& frame_stage_times) {
+  CHECK(frame);
+  CHECK_LT(camera_index, camera_system_->numCameras());
+  // Use the timestamp of the frame because there may be a timestamp corrector used in the
+  // pipeline.
+  const int64_t timestamp_nanoseconds = frame->getTimestampNanoseconds();
+  const uint64_t camera_bit = uint64_t{1} << camera_index;
+  if (isNFrameSkipped(timestamp_nanoseconds)) {
+    VLOG(3) << "Dropping the frame of camera " << camera_index << " at "
+            << timestamp_nanoseconds << " as its nframe was skipped.";
+    return 0u;
+  }
+
+  std::unique_lock<std::mutex> lock(slots_mutex_, std::defer_lock);
+  bool created_pending = false;
+  PendingNFramePtr pending = findClosestPending(timestamp_nanoseconds);
+  if (!pending) {
+    lock.lock();
+    // The nframe may have been skipped since the check above.
+    if (isNFrameSkipped(timestamp_nanoseconds)) {
+      return 0u;
+    }
+    // Another thread may have started a matching nframe since the search.
+    pending = findClosestPending(timestamp_nanoseconds);
+    if (!pending) {
+      pending = createPendingLocked(timestamp_nanoseconds);
+      created_pending = true;
+    }
+  }
+
+  // Only the thread claiming the camera writes its frame, so completed nframes are never
+  // modified afterwards.
+  if ((pending->claimed_cameras.fetch_or(camera_bit) & camera_bit) != 0u) {
+    LOG(ERROR) << "Dropping a frame at index " << camera_index << ":" << std::endl
+               << *frame << std::endl << "because the nframe at "
+               << pending->timestamp_nanoseconds
+               << " already has a frame of this camera within the timestamp tolerance.";
+    return 0u;
+  }
+  pending->nframe->setFrame(camera_index, frame);
+  pending->frame_stage_times[camera_index] = frame_stage_times;
+  const uint64_t set_cameras = pending->set_cameras.fetch_or(camera_bit) | camera_bit;
+
+  // Only new and completed nframes can change the outcome of the sequencing.
+  if (!created_pending && set_cameras != all_cameras_mask_) {
+    return 0u;
+  }
+  if (!lock.owns_lock()) {
+    lock.lock();
+  }
+  return sequenceLocked();
+}
+
+bool VisualNFrameSynchronizer::popCompleted(CompletedNFrame* completed) {
+  CHECK_NOTNULL(completed);
+  return completed_.pop(completed);
+}
+
+void VisualNFrameSynchronizer::discardPendingUpTo(int64_t timestamp_nanoseconds) {
+  std::lock_guard<std::mutex> lock(slots_mutex_);
+  for (PendingNFramePtr& slot : slots_) {
+    const PendingNFramePtr pending = std::atomic_load(&slot);
+    if (pending && pending->timestamp_nanoseconds <= timestamp_nanoseconds) {
+      std::atomic_store(&slot, PendingNFramePtr());
+    }
+  }
+}
+
+size_t VisualNFrameSynchronizer::skipNFrame(
+    int64_t timestamp_nanoseconds, bool* newly_skipped) {
+  CHECK_NOTNULL(newly_skipped);
+  std::lock_guard<std::mutex> lock(slots_mutex_);
+  *newly_skipped = !isNFrameSkipped(timestamp_nanoseconds);
+  if (!*newly_skipped) {
+    return 0u;
+  }
+  skipped_timestamps_[next_skipped_timestamp_idx_] = timestamp_nanoseconds;
+  next_skipped_timestamp_idx_ = (next_skipped_timestamp_idx_ + 1u) % skipped_timestamps_.size();
+
+  const PendingNFramePtr pending = findClosestPending(timestamp_nanoseconds);
+  if (!pending) {
+    return 0u;
+  }
+  for (PendingNFramePtr& slot : slots_) {
+    if (slot == pending) {
+      std::atomic_store(&slot, PendingNFramePtr());
+    }
+  }
+  // The skipped nframe may have been the oldest incomplete one.
+  return sequenceLocked();
+}
+
+bool VisualNFrameSynchronizer::isNFrameSkipped(int64_t timestamp_nanoseconds) const {
+  for (const std::atomic<int64_t>& skipped_timestamp : skipped_timestamps_) {
+    const int64_t skipped_timestamp_nanoseconds = skipped_timestamp.load();
+    if (time::isValidTime(skipped_timestamp_nanoseconds) &&
+        std::abs(skipped_timestamp_nanoseconds - timestamp_nanoseconds) <=
+            timestamp_tolerance_ns_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t VisualNFrameSynchronizer::getNumPending() const {
+  size_t num_pending = 0u;
+  for (const PendingNFramePtr& slot : slots_) {
+    if (std::atomic_load(&slot)) {
+      ++num_pending;
+    }
+  }
+  return num_pending;
+}
+
+VisualNFrameSynchronizer::PendingNFramePtr VisualNFrameSynchronizer::findClosestPending(
+    int64_t timestamp_nanoseconds) const {
+  PendingNFramePtr closest;
+  int64_t min_time_diff = std::numeric_limits<int64_t>::max();
+  for (const PendingNFramePtr& slot : slots_) {
+    const PendingNFramePtr pending = std::atomic_load(&slot);
+    if (!pending) {
+      continue;
+    }
+    const int64_t time_diff =
+        std::abs(pending->timestamp_nanoseconds - timestamp_nanoseconds);
+    // On a tie the older nframe wins.
+    if (time_diff < min_time_diff ||
+        (time_diff == min_time_diff &&
+         pending->timestamp_nanoseconds < closest->timestamp_nanoseconds)) {
+      closest = pending;
+      min_time_diff = time_diff;
+    }
+  }
+  if (min_time_diff > timestamp_tolerance_ns_) {
+    return PendingNFramePtr();
+  }
+  return closest;
+}
+
+VisualNFrameSynchronizer::PendingNFramePtr VisualNFrameSynchronizer::createPendingLocked(
+    int64_t timestamp_nanoseconds) {
+  PendingNFramePtr* free_slot = nullptr;
+  PendingNFramePtr* oldest_slot = nullptr;
+  for (PendingNFramePtr& slot : slots_) {
+    // Only threads holding the lock write the slots.
+    if (!slot) {
+      free_slot = &slot;
+      break;
+    }
+    if (oldest_slot == nullptr ||
+        slot->timestamp_nanoseconds < (*oldest_slot)->timestamp_nanoseconds) {
+      oldest_slot = &slot;
+    }
+  }
+  if (free_slot == nullptr) {
+    CHECK_NOTNULL(oldest_slot);
+    LOG(WARNING) << "All " << slots_.size() << " nframe slots are taken: removing the nframe at "
+                 << (*oldest_slot)->timestamp_nanoseconds << " from the queue.";
+    ++num_overflowed_nframes_;
+    overflowed_nframes_stats_.IncrementOne();
+    free_slot = oldest_slot;
+  }
+  PendingNFramePtr pending =
+      std::make_shared<PendingNFrame>(timestamp_nanoseconds, camera_system_);
+  std::atomic_store(free_slot, pending);
+  return pending;
+}
+
+size_t VisualNFrameSynchronizer::sequenceLocked() {
+  sequencing_order_.clear();
+  for (size_t slot_idx = 0u; slot_idx < slots_.size(); ++slot_idx) {
+    if (slots_[slot_idx]) {
+      sequencing_order_.emplace_back(slots_[slot_idx]->timestamp_nanoseconds, slot_idx);
+    }
+  }
+  std::sort(sequencing_order_.begin(), sequencing_order_.end());
+  auto is_complete = [this](size_t order_idx) {
+    return slots_[sequencing_order_[order_idx].second]->set_cameras.load() ==
+        all_cameras_mask_;
+  };
+
+  // Find the first index that has N consecutive complete nframes following in chronological
+  // ordering.
+  // E.g. N=3    I I C I C C C C C   (I: incomplete, C: complete)
+  //      idx    0 1 2 3 4 5 6 7 8
+  //                     # --> first index with N complete = 4
+  const size_t kNumMinConsecutiveCompleteThreshold = 2u;
+  int delete_upto_including_index = -1;
+  if (sequencing_order_.size() > kNumMinConsecutiveCompleteThreshold + 1) {
+    size_t num_consecutive_complete = 0u;
+    for (size_t idx = 0u; idx < sequencing_order_.size(); ++idx) {
+      if (is_complete(idx)) {
+        ++num_consecutive_complete;
+      } else {
+        num_consecutive_complete = 0u;
+      }
+      if (num_consecutive_complete >= kNumMinConsecutiveCompleteThreshold) {
+        delete_upto_including_index = static_cast<int>(idx) -
+            static_cast<int>(kNumMinConsecutiveCompleteThreshold);
+        break;
+      }
+    }
+  }
+
+  // Now drop all incomplete nframes up to delete_upto_including_index. All frames below this
+  // index will probably never complete as one camera in the rig dropped an image.
+  size_t idx = 0u;
+  if (delete_upto_including_index >= 0) {
+    for (; static_cast<int>(idx) <= delete_upto_including_index; ++idx) {
+      std::atomic_store(&slots_[sequencing_order_[idx].second], PendingNFramePtr());
+    }
+    num_dropped_nframes_ += idx;
+    dropped_nframes_stats_.AddSample(idx);
+    LOG(WARNING) << "Detected frame drop: removing " << delete_upto_including_index + 1
+                 << " nframes from the queue.";
+  }
+
+  // Release the completed nframes chronologically. Stop at the first incomplete nframe to keep
+  // the chronological ordering in the completed queue.
+  size_t num_released = 0u;
+  const int64_t completed_ns = time::monotonicNanoSeconds();
+  for (; idx < sequencing_order_.size() && is_complete(idx); ++idx) {
+    PendingNFramePtr& slot = slots_[sequencing_order_[idx].second];
+    for (FrameStageTimes& frame_stage_times : slot->frame_stage_times) {
+      frame_stage_times.nframe_completed_ns = completed_ns;
+    }
+    completed_.push(CompletedNFrame{
+        slot->timestamp_nanoseconds, slot->nframe, std::move(slot->frame_stage_times)});
+    std::atomic_store(&slot, PendingNFramePtr());
+    ++num_released;
+  }
+  return num_released;
+}
+
+}  // namespace aslam
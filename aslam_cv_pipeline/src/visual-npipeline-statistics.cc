@@ -0,0 +1,194 @@
+#include "aslam/pipeline/visual-npipeline-statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include <aslam/common/time.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+namespace {
+// Nearest-rank percentile of sorted samples.
+double getPercentile(const std::vector<double>& sorted_samples, double percentile) {
+  CHECK(!sorted_samples.empty());
+  const size_t rank = static_cast<size_t>(
+      std::ceil(percentile / 100.0 * static_cast<double>(sorted_samples.size())));
+  return sorted_samples[std::max<size_t>(rank, 1u) - 1u];
+}
+}  // namespace
+
+VisualNPipelineStatistics::VisualNPipelineStatistics(size_t num_cameras, size_t window_size)
+    : num_cameras_(num_cameras),
+      window_size_(window_size),
+      windows_(num_cameras * kNumStages),
+      queued_images_stats_("VisualNPipeline: queued images"),
+      processing_nframes_stats_("VisualNPipeline: processing nframes"),
+      completed_nframes_stats_("VisualNPipeline: completed nframes"),
+      num_evicted_nframes_(0u),
+      evicted_nframes_stats_("VisualNPipeline: evicted nframes"),
+      num_skipped_frames_(0u),
+      skipped_frames_stats_("VisualNPipeline: skipped frames"),
+      num_skipped_nframes_(0u),
+      skipped_nframes_stats_("VisualNPipeline: skipped nframes") {
+  CHECK_GT(num_cameras_, 0u);
+  CHECK_GT(window_size_, 0u);
+  stats_collectors_.reserve(windows_.size());
+  for (size_t camera_idx = 0u; camera_idx < num_cameras_; ++camera_idx) {
+    for (size_t stage_idx = 0u; stage_idx < kNumStages; ++stage_idx) {
+      windows_[windowIndex(camera_idx, static_cast<Stage>(stage_idx))].samples_seconds.reserve(
+          window_size_);
+      stats_collectors_.emplace_back(
+          "VisualNPipeline camera " + std::to_string(camera_idx) + ": " +
+          stageToString(static_cast<Stage>(stage_idx)) + " latency [s]");
+    }
+  }
+}
+
+void VisualNPipelineStatistics::addFrame(size_t camera_index, const FrameStageTimes& times) {
+  CHECK_LT(camera_index, num_cameras_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  addLatencyLocked(camera_index, Stage::kQueue, times.dequeued_ns - times.enqueued_ns);
+  addLatencyLocked(
+      camera_index, Stage::kPreprocessing, times.process_frame_start_ns - times.dequeued_ns);
+  addLatencyLocked(
+      camera_index, Stage::kProcessFrame,
+      times.process_frame_end_ns - times.process_frame_start_ns);
+  addLatencyLocked(
+      camera_index, Stage::kSynchronization,
+      times.nframe_completed_ns - times.process_frame_end_ns);
+  addLatencyLocked(camera_index, Stage::kTotal, times.nframe_completed_ns - times.enqueued_ns);
+}
+
+void VisualNPipelineStatistics::addLatencyLocked(
+    size_t camera_index, Stage stage, int64_t latency_ns) {
+  const size_t window_idx = windowIndex(camera_index, stage);
+  LatencyWindow& window = windows_[window_idx];
+  const double latency_seconds = time::to_seconds(std::max<int64_t>(latency_ns, 0));
+  if (window.samples_seconds.size() < window_size_) {
+    window.samples_seconds.push_back(latency_seconds);
+  } else {
+    window.samples_seconds[window.next_sample_idx] = latency_seconds;
+  }
+  window.next_sample_idx = (window.next_sample_idx + 1u) % window_size_;
+  ++window.num_samples;
+  window.sum_seconds += latency_seconds;
+  window.max_seconds = std::max(window.max_seconds, latency_seconds);
+  stats_collectors_[window_idx].AddSample(latency_seconds);
+}
+
+void VisualNPipelineStatistics::addQueueDepths(const QueueDepths& queue_depths) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_depths_ = queue_depths;
+    max_queue_depths_.num_queued_images =
+        std::max(max_queue_depths_.num_queued_images, queue_depths.num_queued_images);
+    max_queue_depths_.num_processing_nframes =
+        std::max(max_queue_depths_.num_processing_nframes, queue_depths.num_processing_nframes);
+    max_queue_depths_.num_completed_nframes =
+        std::max(max_queue_depths_.num_completed_nframes, queue_depths.num_completed_nframes);
+  }
+  queued_images_stats_.AddSample(queue_depths.num_queued_images);
+  processing_nframes_stats_.AddSample(queue_depths.num_processing_nframes);
+  completed_nframes_stats_.AddSample(queue_depths.num_completed_nframes);
+}
+
+void VisualNPipelineStatistics::incrementNumEvictedNFrames() {
+  ++num_evicted_nframes_;
+  evicted_nframes_stats_.IncrementOne();
+}
+
+void VisualNPipelineStatistics::incrementNumSkippedFrames() {
+  ++num_skipped_frames_;
+  skipped_frames_stats_.IncrementOne();
+}
+
+void VisualNPipelineStatistics::incrementNumSkippedNFrames() {
+  ++num_skipped_nframes_;
+  skipped_nframes_stats_.IncrementOne();
+}
+
+VisualNPipelineStatistics::LatencySummary VisualNPipelineStatistics::getLatencySummary(
+    size_t camera_index, Stage stage) const {
+  CHECK_LT(camera_index, num_cameras_);
+  std::vector<double> sorted_samples;
+  LatencySummary summary;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const LatencyWindow& window = windows_[windowIndex(camera_index, stage)];
+    if (window.num_samples == 0u) {
+      return summary;
+    }
+    sorted_samples = window.samples_seconds;
+    summary.num_samples = window.num_samples;
+    summary.mean_seconds = window.sum_seconds / static_cast<double>(window.num_samples);
+    summary.max_seconds = window.max_seconds;
+  }
+  std::sort(sorted_samples.begin(), sorted_samples.end());
+  summary.p50_seconds = getPercentile(sorted_samples, 50.0);
+  summary.p90_seconds = getPercentile(sorted_samples, 90.0);
+  summary.p99_seconds = getPercentile(sorted_samples, 99.0);
+  return summary;
+}
+
+VisualNPipelineStatistics::QueueDepths VisualNPipelineStatistics::getQueueDepths() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_depths_;
+}
+
+VisualNPipelineStatistics::QueueDepths VisualNPipelineStatistics::getMaxQueueDepths() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_queue_depths_;
+}
+
+std::string VisualNPipelineStatistics::print() const {
+  std::stringstream ss;
+  ss << "VisualNPipeline latencies [ms]\n";
+  ss << std::setw(8) << "camera" << std::setw(17) << "stage" << std::setw(10) << "samples"
+     << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+     << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+  ss << std::fixed << std::setprecision(3);
+  for (size_t camera_idx = 0u; camera_idx < num_cameras_; ++camera_idx) {
+    for (size_t stage_idx = 0u; stage_idx < kNumStages; ++stage_idx) {
+      const Stage stage = static_cast<Stage>(stage_idx);
+      const LatencySummary summary = getLatencySummary(camera_idx, stage);
+      ss << std::setw(8) << camera_idx << std::setw(17) << stageToString(stage)
+         << std::setw(10) << summary.num_samples
+         << std::setw(10) << summary.mean_seconds * 1e3
+         << std::setw(10) << summary.p50_seconds * 1e3
+         << std::setw(10) << summary.p90_seconds * 1e3
+         << std::setw(10) << summary.p99_seconds * 1e3
+         << std::setw(10) << summary.max_seconds * 1e3 << "\n";
+    }
+  }
+  const QueueDepths max_queue_depths = getMaxQueueDepths();
+  ss << "Max. queued images: " << max_queue_depths.num_queued_images
+     << ", max. processing nframes: " << max_queue_depths.num_processing_nframes
+     << ", max. completed nframes: " << max_queue_depths.num_completed_nframes
+     << ", evicted nframes: " << getNumEvictedNFrames()
+     << ", skipped nframes: " << getNumSkippedNFrames()
+     << ", skipped frames: " << getNumSkippedFrames() << "\n";
+  return ss.str();
+}
+
+std::string VisualNPipelineStatistics::stageToString(Stage stage) {
+  switch (stage) {
+    case Stage::kQueue:
+      return "queue";
+    case Stage::kPreprocessing:
+      return "preprocessing";
+    case Stage::kProcessFrame:
+      return "process frame";
+    case Stage::kSynchronization:
+      return "synchronization";
+    case Stage::kTotal:
+      return "total";
+    default:
+      LOG(FATAL) << "Unknown stage " << static_cast<int>(stage) << ".";
+  }
+  return "";
+}
+
+}  // namespace aslam
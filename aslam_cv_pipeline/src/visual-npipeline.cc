@@ -1,5 +1,7 @@
 #include <aslam/pipeline/visual-npipeline.h>
 
+#include <sstream>
+
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/ncamera.h>
 #include <aslam/cameras/random-camera-generator.h>
@@ -22,6 +24,10 @@ VisualNPipeline::VisualNPipeline(
     int64_t timestamp_tolerance_ns) :
       pipelines_(pipelines),
       shutdown_(false),
+      scheduling_mode_(SchedulingMode::kAnyThread),
+      latency_budget_ns_(kLatencyBudgetDisabled),
+      newest_timestamp_ns_(time::getInvalidTime()),
+      statistics_(CHECK_NOTNULL(input_camera_system.get())->numCameras()),
       input_camera_system_(input_camera_system),
       output_camera_system_(output_camera_system),
       timestamp_tolerance_ns_(timestamp_tolerance_ns)  {
@@ -45,6 +51,8 @@ VisualNPipeline::VisualNPipeline(
   }
   CHECK_GT(num_threads, 0u);
   thread_pool_.reset(new ThreadPool(num_threads));
+  synchronizer_.reset(
+      new VisualNFrameSynchronizer(output_camera_system_, timestamp_tolerance_ns_));
 }
 
 VisualNPipeline::~VisualNPipeline() {
@@ -57,6 +65,9 @@ void VisualNPipeline::shutdown() {
   condition_not_empty_.notify_all();
   condition_not_full_.notify_all();
   thread_pool_->stop();
+  for (const std::unique_ptr<VisualPipelineStageRunner>& stage_runner : stage_runners_) {
+    stage_runner->shutdown();
+  }
 }
 
 bool VisualNPipeline::processImageBlockingIfFull(
@@ -64,12 +75,16 @@ bool VisualNPipeline::processImageBlockingIfFull(
     size_t max_queue_size) {
   std::unique_lock<std::mutex> lock(mutex_);
   while (!shutdown_) {
+    fetchCompletedLocked();
     if (completed_.size() >= max_queue_size) {
       condition_not_full_.wait(lock);
+      fetchCompletedLocked();
       if (completed_.size() >= max_queue_size) {
         continue;
       }
     }
+    // Adding the image may block in the staged processing, whose threads take the mutex.
+    lock.unlock();
     processImageImpl(camera_index, image, timestamp);
     return true;
   }
@@ -82,13 +97,32 @@ bool VisualNPipeline::processImageNonBlockingDroppingOldestNFrameIfFull(
   CHECK_GE(max_output_queue_size, 1u);
 
   bool oldest_dropped = false;
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (completed_.size() >= max_output_queue_size) {
-    completed_.erase(completed_.begin());
-    condition_not_full_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fetchCompletedLocked();
+    if (completed_.size() >= max_output_queue_size) {
+      completed_.erase(completed_.begin());
+      statistics_.incrementNumEvictedNFrames();
+      condition_not_full_.notify_all();
+      oldest_dropped = true;
+    }
+  }
+  if (stage_runners_.empty()) {
+    processImageImpl(camera_index, image, timestamp);
+    return oldest_dropped;
+  }
+  // The staged processing must not block either, so it drops the oldest image waiting in
+  // the first stage queue of the camera instead. Its nframe can not be completed anymore.
+  CHECK_LT(camera_index, stage_runners_.size());
+  updateNewestTimestamp(timestamp);
+  int64_t dropped_timestamp_ns;
+  if (stage_runners_[camera_index]->processImageDroppingOldestIfFull(
+      image, timestamp, time::monotonicNanoSeconds(), &dropped_timestamp_ns)) {
+    VLOG(3) << "Skipping the nframe at " << dropped_timestamp_ns << " of camera "
+            << camera_index << " as its image was dropped from the full stage queue.";
+    skipNFrameOfImage(dropped_timestamp_ns);
     oldest_dropped = true;
   }
-  processImageImpl(camera_index, image, timestamp);
   return oldest_dropped;
 }
 
@@ -97,8 +131,10 @@ bool VisualNPipeline::getNextBlocking(std::shared_ptr<VisualNFrame>* nframe) {
 
   std::unique_lock<std::mutex> lock(mutex_);
   while (!shutdown_) {
+    fetchCompletedLocked();
     if (completed_.empty()) {
       condition_not_empty_.wait(lock);
+      fetchCompletedLocked();
       if (completed_.empty()) {
         continue;
       }
@@ -113,13 +149,12 @@ bool VisualNPipeline::getNextBlocking(std::shared_ptr<VisualNFrame>* nframe) {
 
 void VisualNPipeline::processImage(
     size_t camera_index, const cv::Mat& image, int64_t timestamp) {
-  thread_pool_->enqueue(&VisualNPipeline::work, this, camera_index, image,
-                        timestamp);
+  processImageImpl(camera_index, image, timestamp);
 }
 
 size_t VisualNPipeline::getNumFramesComplete() const {
   std::lock_guard<std::mutex> lock(mutex_);
-  return completed_.size();
+  return completed_.size() + synchronizer_->getNumCompleted();
 }
 
 std::shared_ptr<VisualNFrame> VisualNPipeline::getNext() {
@@ -128,6 +163,7 @@ std::shared_ptr<VisualNFrame> VisualNPipeline::getNext() {
 }
 
 std::shared_ptr<VisualNFrame> VisualNPipeline::getNextImpl() {
+  fetchCompletedLocked();
   // Initialize the return value as null
   std::shared_ptr<VisualNFrame> nframe;
   if (completed_.empty()) {
@@ -143,13 +179,31 @@ std::shared_ptr<VisualNFrame> VisualNPipeline::getNextImpl() {
 
 void VisualNPipeline::processImageImpl(
     size_t camera_index, const cv::Mat& image, int64_t timestamp) {
-  thread_pool_->enqueue(&VisualNPipeline::work, this, camera_index, image,
-                        timestamp);
+  updateNewestTimestamp(timestamp);
+  if (!stage_runners_.empty()) {
+    CHECK_LT(camera_index, stage_runners_.size());
+    stage_runners_[camera_index]->processImage(image, timestamp, time::monotonicNanoSeconds());
+    return;
+  }
+  // In the camera-affine mode every camera is an exclusivity group of its own.
+  const size_t exclusivity_group_id =
+      scheduling_mode_.load() == SchedulingMode::kCameraAffine ?
+          camera_index : ThreadPool::kGroupdIdNonExclusiveTask;
+  thread_pool_->enqueueOrdered(exclusivity_group_id, &VisualNPipeline::work, this,
+                               camera_index, image, timestamp,
+                               time::monotonicNanoSeconds());
+}
+
+void VisualNPipeline::updateNewestTimestamp(int64_t timestamp) {
+  int64_t newest_timestamp_ns = newest_timestamp_ns_.load();
+  while (newest_timestamp_ns < timestamp &&
+         !newest_timestamp_ns_.compare_exchange_weak(newest_timestamp_ns, timestamp)) {}
 }
 
 std::shared_ptr<VisualNFrame> VisualNPipeline::getLatestAndClear() {
   std::shared_ptr<VisualNFrame> nframe;
   std::lock_guard<std::mutex> lock(mutex_);
+  fetchCompletedLocked();
   if (completed_.empty()) {
     return nframe;
   }
@@ -159,11 +213,7 @@ std::shared_ptr<VisualNFrame> VisualNPipeline::getLatestAndClear() {
   completed_.clear();
   condition_not_full_.notify_all();
   // Clear any processing frames older than this one.
-  auto it_processing = processing_.begin();
-  while (it_processing != processing_.end()
-      && it_processing->first <= timestamp_nanoseconds) {
-    it_processing = processing_.erase(it_processing);
-  }
+  synchronizer_->discardPendingUpTo(timestamp_nanoseconds);
   return nframe;
 }
 
@@ -173,8 +223,10 @@ bool VisualNPipeline::getLatestAndClearBlocking(
 
   std::unique_lock<std::mutex> lock(mutex_);
   while (!shutdown_) {
+    fetchCompletedLocked();
     if (completed_.empty()) {
       condition_not_empty_.wait(lock);
+      fetchCompletedLocked();
       if (completed_.empty()) {
         continue;
       }
@@ -188,12 +240,7 @@ bool VisualNPipeline::getLatestAndClearBlocking(
     completed_.clear();
     condition_not_full_.notify_all();
     // Clear any processing frames older than this one.
-    TimestampVisualNFrameMap::iterator processing_iterator =
-        processing_.begin();
-    while (processing_iterator != processing_.end() &&
-        processing_iterator->first <= timestamp_nanoseconds) {
-      processing_iterator = processing_.erase(processing_iterator);
-    }
+    synchronizer_->discardPendingUpTo(timestamp_nanoseconds);
     return true;
   }
   return false;
@@ -208,131 +255,170 @@ std::shared_ptr<const NCamera> VisualNPipeline::getOutputNCameras() const {
 }
 
 size_t VisualNPipeline::getNumFramesProcessing() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return processing_.size();
+  return synchronizer_->getNumPending();
+}
+
+void VisualNPipeline::fetchCompletedLocked() {
+  VisualNFrameSynchronizer::CompletedNFrame completed;
+  while (synchronizer_->popCompleted(&completed)) {
+    completed_.emplace(completed.timestamp_nanoseconds, completed.nframe);
+    for (size_t camera_idx = 0u; camera_idx < completed.frame_stage_times.size(); ++camera_idx) {
+      statistics_.addFrame(camera_idx, completed.frame_stage_times[camera_idx]);
+    }
+  }
+  VisualNPipelineStatistics::QueueDepths queue_depths;
+  queue_depths.num_queued_images = thread_pool_->numQueuedTasks();
+  queue_depths.num_processing_nframes = synchronizer_->getNumPending();
+  queue_depths.num_completed_nframes = completed_.size();
+  statistics_.addQueueDepths(queue_depths);
 }
 
 void VisualNPipeline::work(size_t camera_index, const cv::Mat& image,
-                           int64_t timestamp_nanoseconds) {
+                           int64_t timestamp_nanoseconds, int64_t enqueued_ns) {
   CHECK_LE(camera_index, pipelines_.size());
+  if (!admitImage(camera_index, timestamp_nanoseconds)) {
+    return;
+  }
+  FrameStageTimes frame_stage_times;
+  frame_stage_times.enqueued_ns = enqueued_ns;
+  frame_stage_times.dequeued_ns = time::monotonicNanoSeconds();
+  VisualPipeline::ProcessingTimes processing_times;
   std::shared_ptr<VisualFrame> frame;
-  frame = pipelines_[camera_index]->processImage(image, timestamp_nanoseconds);
+  frame = pipelines_[camera_index]->processImage(
+      image, timestamp_nanoseconds, &processing_times);
+  frame_stage_times.process_frame_start_ns = processing_times.process_frame_start_ns;
+  frame_stage_times.process_frame_end_ns = processing_times.process_frame_end_ns;
+  addProcessedFrame(camera_index, frame, frame_stage_times);
+}
 
-  /// Create an iterator into the processing queue.
-  std::map<int64_t, std::shared_ptr<VisualNFrame>>::iterator proc_it;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    bool create_new_nframes = false;
-    if (processing_.empty()) {
-      create_new_nframes = true;
-    } else {
-      // Try to find an existing NFrame in the processing list.
-      // Use the timestamp of the frame because there may be a timestamp
-      // corrector used in the pipeline.
-      auto it_processing = processing_.lower_bound(
-          frame->getTimestampNanoseconds());
-      // Lower bound returns the first element that is not less than the value
-      // (i.e. greater than or equal to the value).
-      if (it_processing != processing_.begin()) { --it_processing; }
-      // Now it_processing points to the first element that is less than the
-      // value. Check both this value, and the one >=.
-      int64_t min_time_diff = std::abs(
-          it_processing->first - frame->getTimestampNanoseconds());
-      proc_it = it_processing;
-      if (++it_processing != processing_.end()) {
-        const int64_t time_diff = std::abs(
-            it_processing->first - frame->getTimestampNanoseconds());
-        if (time_diff < min_time_diff) {
-          proc_it = it_processing;
-          min_time_diff = time_diff;
-        }
-      }
-      // Now proc_it points to the closest nframes element.
-      if (min_time_diff > timestamp_tolerance_ns_) {
-       create_new_nframes = true;
-      }
-    }
+void VisualNPipeline::addProcessedFrame(
+    size_t camera_index, const VisualFrame::Ptr& frame,
+    const FrameStageTimes& frame_stage_times) {
+  notifyReleasedNFrames(synchronizer_->addFrame(camera_index, frame, frame_stage_times));
+}
 
-    if (create_new_nframes) {
-      std::shared_ptr<VisualNFrame> nframes(
-          new VisualNFrame(output_camera_system_));
-      bool not_replaced;
-      std::tie(proc_it, not_replaced) = processing_.insert(
-          std::make_pair(frame->getTimestampNanoseconds(), nframes)
-      );
-      CHECK(not_replaced);
-    }
-    // Now proc_it points to the correct place in the processing_ list and
-    // the NFrame has been created if necessary.
-    VisualFrame::Ptr existing_frame = proc_it->second->getFrameShared(
-        camera_index);
-    if (existing_frame) {
-      LOG(ERROR) << "Overwriting a frame at index " << camera_index
-          << ":" << std::endl
-          << *existing_frame << std::endl << "with a new frame: "
-          << *frame << std::endl << "because the timestamp was the same.";
-    }
-    proc_it->second->setFrame(camera_index, frame);
-
-    // Find the first index that has N consecutive complete nframes following in chronological
-    // ordering.
-    // E.g. N=3    I I C I C C C C C   (I: incomplete, C: complete)
-    //      idx    0 1 2 3 4 5 6 7 8
-    //                     # --> first index with N complete = 4
-    const size_t kNumMinConsecutiveCompleteThreshold = 2u;
-    int delete_upto_including_index = -1;
-    if (processing_.size() > kNumMinConsecutiveCompleteThreshold + 1) {
-      size_t num_consecutive_complete = 0u;
-      size_t idx = 0u;
-      auto it_processing = processing_.begin();
-      while (it_processing != processing_.end()) {
-        bool is_complete = CHECK_NOTNULL(it_processing->second.get())->areAllFramesSet();
-        if (is_complete) {
-          ++num_consecutive_complete;
-        } else {
-          num_consecutive_complete = 0u;
-        }
-        if (num_consecutive_complete >= kNumMinConsecutiveCompleteThreshold) {
-          delete_upto_including_index = static_cast<int>(idx) -
-              static_cast<int>(kNumMinConsecutiveCompleteThreshold);
-          break;
-        }
-        ++it_processing;
-        ++idx;
-      }
-    }
+bool VisualNPipeline::admitImage(size_t camera_index, int64_t timestamp_nanoseconds) {
+  if (synchronizer_->isNFrameSkipped(timestamp_nanoseconds)) {
+    statistics_.incrementNumSkippedFrames();
+    return false;
+  }
+  const int64_t latency_budget_ns = latency_budget_ns_.load();
+  if (latency_budget_ns == kLatencyBudgetDisabled ||
+      newest_timestamp_ns_.load() - timestamp_nanoseconds <= latency_budget_ns) {
+    return true;
+  }
+  VLOG(3) << "Skipping the nframe at " << timestamp_nanoseconds << " of camera "
+          << camera_index << " as it exceeds the latency budget.";
+  skipNFrameOfImage(timestamp_nanoseconds);
+  return false;
+}
 
-    // Now drop all incomplete nframes up to delete_upto_including_index. All frames below this
-    // index will probably never complete as one camera in the rig dropped an image.
-    if (delete_upto_including_index >= 0) {
-      int num_nframes_to_delete = delete_upto_including_index + 1;
-      auto it_processing = processing_.begin();
-      while (it_processing != processing_.end() && num_nframes_to_delete-- > 0) {
-        it_processing = processing_.erase(it_processing);
-      }
-      LOG(WARNING) << "Detected frame drop: removing " << delete_upto_including_index + 1
-                   << " nframes from the queue.";
-    }
+void VisualNPipeline::skipNFrameOfImage(int64_t timestamp_nanoseconds) {
+  bool newly_skipped = false;
+  notifyReleasedNFrames(synchronizer_->skipNFrame(timestamp_nanoseconds, &newly_skipped));
+  if (newly_skipped) {
+    statistics_.incrementNumSkippedNFrames();
+  }
+  statistics_.incrementNumSkippedFrames();
+}
 
-    // Move all completed nframes from the processed_ queue to the completed_ queue chronologically.
-    auto it_processing = processing_.begin();
-    while (it_processing != processing_.end()) {
-      // Check if all images have been received.
-      if (it_processing->second->areAllFramesSet()) {
-        completed_.insert(*it_processing);
-        it_processing = processing_.erase(it_processing);
-        condition_not_empty_.notify_all();
-      } else {
-        // As we are iterating over the map in chronological order we have to abort once an nframe
-        // is not yet finished processing to keep chronological ordering in the destination queue.
-        break;
-      }
-    }
+void VisualNPipeline::notifyReleasedNFrames(size_t num_released) {
+  if (num_released > 0u) {
+    // Taking the mutex makes sure that no consumer is between checking the queue and waiting.
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    condition_not_empty_.notify_all();
   }
 }
 
 void VisualNPipeline::waitForAllWorkToComplete() const {
   thread_pool_->waitForEmptyQueue();
+  for (const std::unique_ptr<VisualPipelineStageRunner>& stage_runner : stage_runners_) {
+    stage_runner->waitForAllWorkToComplete();
+  }
+}
+
+void VisualNPipeline::enableStagedProcessing(size_t max_stage_queue_size) {
+  CHECK(stage_runners_.empty()) << "The staged processing is already enabled.";
+  CHECK_EQ(thread_pool_->numQueuedTasks(), 0u)
+      << "The staged processing must be enabled before adding images.";
+  for (size_t camera_idx = 0u; camera_idx < pipelines_.size(); ++camera_idx) {
+    stage_runners_.emplace_back(
+        new VisualPipelineStageRunner(
+            pipelines_[camera_idx], max_stage_queue_size,
+            [this, camera_idx](
+                const VisualFrame::Ptr& frame, const FrameStageTimes& frame_stage_times) {
+              addProcessedFrame(camera_idx, frame, frame_stage_times);
+            },
+            [this, camera_idx](int64_t timestamp_nanoseconds) {
+              return admitImage(camera_idx, timestamp_nanoseconds);
+            }));
+  }
+}
+
+void VisualNPipeline::setLatencyBudget(int64_t latency_budget_ns) {
+  CHECK_GE(latency_budget_ns, 0);
+  latency_budget_ns_ = latency_budget_ns;
+}
+
+void VisualNPipeline::disableLatencyBudget() {
+  latency_budget_ns_ = kLatencyBudgetDisabled;
+}
+
+size_t VisualNPipeline::getNumSkippedFrames() const {
+  return statistics_.getNumSkippedFrames();
+}
+
+size_t VisualNPipeline::getNumSkippedNFrames() const {
+  return statistics_.getNumSkippedNFrames();
+}
+
+void VisualNPipeline::setSchedulingMode(SchedulingMode scheduling_mode) {
+  scheduling_mode_ = scheduling_mode;
+}
+
+VisualNPipeline::SchedulingMode VisualNPipeline::getSchedulingMode() const {
+  return scheduling_mode_.load();
+}
+
+bool VisualNPipeline::pinProcessingThreadsToCores(const std::vector<int>& core_ids) {
+  return thread_pool_->pinThreadsToCores(core_ids);
+}
+
+VisualNPipelineStatistics::LatencySummary VisualNPipeline::getLatencySummary(
+    size_t camera_index, VisualNPipelineStatistics::Stage stage) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fetchCompletedLocked();
+  }
+  return statistics_.getLatencySummary(camera_index, stage);
+}
+
+VisualNPipelineStatistics::QueueDepths VisualNPipeline::getQueueDepths() const {
+  return statistics_.getQueueDepths();
+}
+
+VisualNPipelineStatistics::QueueDepths VisualNPipeline::getMaxQueueDepths() const {
+  return statistics_.getMaxQueueDepths();
+}
+
+size_t VisualNPipeline::getNumDroppedNFrames() const {
+  return synchronizer_->getNumDroppedNFrames();
+}
+
+size_t VisualNPipeline::getNumEvictedNFrames() const {
+  return statistics_.getNumEvictedNFrames();
+}
+
+std::string VisualNPipeline::printStatistics() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fetchCompletedLocked();
+  }
+  std::stringstream ss;
+  ss << statistics_.print();
+  ss << "Dropped nframes: " << synchronizer_->getNumDroppedNFrames()
+     << ", overflowed nframes: " << synchronizer_->getNumOverflowedNFrames() << "\n";
+  return ss.str();
 }
 
 VisualNPipeline::Ptr VisualNPipeline::createTestVisualNPipeline(
@@ -59,10 +59,23 @@ void BriskVisualPipeline::initializeBrisk(size_t octaves,
 
 void BriskVisualPipeline::processFrameImpl(const cv::Mat& image, VisualFrame* frame) const {
   CHECK_NOTNULL(frame);
-  // Now we use the image from the frame. It might be undistorted.
   std::vector<cv::KeyPoint> keypoints;
-  detector_->detect(image, keypoints);
+  detectImpl(image, frame, &keypoints);
+  describeImpl(image, &keypoints, frame);
+}
 
+void BriskVisualPipeline::detectImpl(
+    const cv::Mat& image, VisualFrame* frame, std::vector<cv::KeyPoint>* keypoints) const {
+  CHECK_NOTNULL(frame);
+  CHECK_NOTNULL(keypoints);
+  // Now we use the image from the frame. It might be undistorted.
+  detector_->detect(image, *keypoints);
+}
+
+void BriskVisualPipeline::describeImpl(
+    const cv::Mat& image, std::vector<cv::KeyPoint>* keypoints_ptr, VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  std::vector<cv::KeyPoint>& keypoints = *CHECK_NOTNULL(keypoints_ptr);
   cv::Mat descriptors;
   if(!keypoints.empty()) {
     extractor_->compute(image, keypoints, descriptors);
@@ -62,10 +62,23 @@ void FreakVisualPipeline::initializeFreak(size_t num_octaves,
 
 void FreakVisualPipeline::processFrameImpl(const cv::Mat& image, VisualFrame* frame) const {
   CHECK_NOTNULL(frame);
-  // Now we use the image from the frame. It might be undistorted.
   std::vector<cv::KeyPoint> keypoints;
-  detector_->detect(image, keypoints);
+  detectImpl(image, frame, &keypoints);
+  describeImpl(image, &keypoints, frame);
+}
 
+void FreakVisualPipeline::detectImpl(
+    const cv::Mat& image, VisualFrame* frame, std::vector<cv::KeyPoint>* keypoints) const {
+  CHECK_NOTNULL(frame);
+  CHECK_NOTNULL(keypoints);
+  // Now we use the image from the frame. It might be undistorted.
+  detector_->detect(image, *keypoints);
+}
+
+void FreakVisualPipeline::describeImpl(
+    const cv::Mat& image, std::vector<cv::KeyPoint>* keypoints_ptr, VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  std::vector<cv::KeyPoint>& keypoints = *CHECK_NOTNULL(keypoints_ptr);
   cv::Mat descriptors;
   if(!keypoints.empty()) {
     extractor_->compute(image, keypoints, descriptors);
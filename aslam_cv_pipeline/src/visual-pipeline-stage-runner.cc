@@ -0,0 +1,153 @@
+#include "aslam/pipeline/visual-pipeline-stage-runner.h"
+
+#include <utility>
+
+#include <aslam/common/time.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+VisualPipelineStageRunner::VisualPipelineStageRunner(
+    const VisualPipeline::Ptr& pipeline, size_t max_queue_size,
+    const FrameCallback& callback, const AdmissionCallback& admission_callback)
+    : pipeline_(pipeline),
+      callback_(callback),
+      admission_callback_(admission_callback),
+      preprocessing_queue_(max_queue_size),
+      detection_queue_(max_queue_size),
+      description_queue_(max_queue_size),
+      postprocessing_queue_(max_queue_size),
+      num_images_in_flight_(0u) {
+  CHECK(pipeline_);
+  CHECK(callback_);
+  stage_threads_.emplace_back(&VisualPipelineStageRunner::runPreprocessing, this);
+  stage_threads_.emplace_back(&VisualPipelineStageRunner::runDetection, this);
+  stage_threads_.emplace_back(&VisualPipelineStageRunner::runDescription, this);
+  stage_threads_.emplace_back(&VisualPipelineStageRunner::runPostprocessing, this);
+}
+
+VisualPipelineStageRunner::~VisualPipelineStageRunner() {
+  shutdown();
+  for (std::thread& stage_thread : stage_threads_) {
+    stage_thread.join();
+  }
+}
+
+bool VisualPipelineStageRunner::processImage(
+    const cv::Mat& image, int64_t timestamp_nanoseconds, int64_t enqueued_ns) {
+  startImage();
+  if (!preprocessing_queue_.push(makeTask(image, timestamp_nanoseconds, enqueued_ns))) {
+    LOG(ERROR) << "processImage() called on a stopped VisualPipelineStageRunner.";
+    finishImage();
+    return false;
+  }
+  return true;
+}
+
+bool VisualPipelineStageRunner::processImageDroppingOldestIfFull(
+    const cv::Mat& image, int64_t timestamp_nanoseconds, int64_t enqueued_ns,
+    int64_t* dropped_timestamp_nanoseconds) {
+  CHECK_NOTNULL(dropped_timestamp_nanoseconds);
+  startImage();
+  Task dropped_task;
+  bool is_task_dropped = false;
+  if (!preprocessing_queue_.pushDroppingOldest(
+      makeTask(image, timestamp_nanoseconds, enqueued_ns), &dropped_task, &is_task_dropped)) {
+    LOG(ERROR) << "processImageDroppingOldestIfFull() called on a stopped "
+               << "VisualPipelineStageRunner.";
+    finishImage();
+    return false;
+  }
+  if (!is_task_dropped) {
+    return false;
+  }
+  *dropped_timestamp_nanoseconds = dropped_task.timestamp_nanoseconds;
+  finishImage();
+  return true;
+}
+
+void VisualPipelineStageRunner::shutdown() {
+  // The stages shut down the next queue once their own queue is drained.
+  preprocessing_queue_.shutdown();
+}
+
+void VisualPipelineStageRunner::waitForAllWorkToComplete() const {
+  std::unique_lock<std::mutex> lock(in_flight_mutex_);
+  condition_all_done_.wait(lock, [this]() { return num_images_in_flight_ == 0u; });
+}
+
+size_t VisualPipelineStageRunner::getNumImagesInFlight() const {
+  std::lock_guard<std::mutex> lock(in_flight_mutex_);
+  return num_images_in_flight_;
+}
+
+void VisualPipelineStageRunner::runPreprocessing() {
+  Task task;
+  while (preprocessing_queue_.pop(&task)) {
+    if (admission_callback_ && !admission_callback_(task.timestamp_nanoseconds)) {
+      task.raw_image.release();
+      finishImage();
+      continue;
+    }
+    task.stage_times.dequeued_ns = time::monotonicNanoSeconds();
+    pipeline_->preprocessStage(task.raw_image, task.timestamp_nanoseconds, &task.data);
+    task.raw_image.release();
+    CHECK(detection_queue_.push(std::move(task)));
+  }
+  detection_queue_.shutdown();
+}
+
+void VisualPipelineStageRunner::runDetection() {
+  Task task;
+  while (detection_queue_.pop(&task)) {
+    task.stage_times.process_frame_start_ns = time::monotonicNanoSeconds();
+    pipeline_->detectStage(&task.data);
+    CHECK(description_queue_.push(std::move(task)));
+  }
+  description_queue_.shutdown();
+}
+
+void VisualPipelineStageRunner::runDescription() {
+  Task task;
+  while (description_queue_.pop(&task)) {
+    pipeline_->describeStage(&task.data);
+    task.stage_times.process_frame_end_ns = time::monotonicNanoSeconds();
+    CHECK(postprocessing_queue_.push(std::move(task)));
+  }
+  postprocessing_queue_.shutdown();
+}
+
+void VisualPipelineStageRunner::runPostprocessing() {
+  Task task;
+  while (postprocessing_queue_.pop(&task)) {
+    pipeline_->postprocessStage(&task.data);
+    callback_(task.data.frame, task.stage_times);
+    task.data.frame.reset();
+    finishImage();
+  }
+}
+
+VisualPipelineStageRunner::Task VisualPipelineStageRunner::makeTask(
+    const cv::Mat& image, int64_t timestamp_nanoseconds, int64_t enqueued_ns) {
+  Task task;
+  task.raw_image = image;
+  task.timestamp_nanoseconds = timestamp_nanoseconds;
+  task.stage_times.enqueued_ns = enqueued_ns;
+  return task;
+}
+
+void VisualPipelineStageRunner::startImage() {
+  std::lock_guard<std::mutex> lock(in_flight_mutex_);
+  ++num_images_in_flight_;
+}
+
+void VisualPipelineStageRunner::finishImage() {
+  std::lock_guard<std::mutex> lock(in_flight_mutex_);
+  CHECK_GT(num_images_in_flight_, 0u);
+  --num_images_in_flight_;
+  if (num_images_in_flight_ == 0u) {
+    condition_all_done_.notify_all();
+  }
+}
+
+}  // namespace aslam
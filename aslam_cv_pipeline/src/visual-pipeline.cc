@@ -1,17 +1,33 @@
 #include <aslam/pipeline/visual-pipeline.h>
 
+#include <vector>
+
 #include <aslam/cameras/camera.h>
+#include <aslam/common/time.h>
 #include <aslam/frames/visual-frame.h>
 #include <aslam/pipeline/undistorter.h>
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/video/tracking.hpp>
 
 namespace aslam {
+namespace {
+// Compares the projection of the cameras, but not their sensor ids.
+bool haveSameGeometry(const Camera& camera_a, const Camera& camera_b) {
+  return &camera_a == &camera_b ||
+         (camera_a.getType() == camera_b.getType() &&
+          camera_a.imageWidth() == camera_b.imageWidth() &&
+          camera_a.imageHeight() == camera_b.imageHeight() &&
+          camera_a.getParameters() == camera_b.getParameters() &&
+          camera_a.getDistortion() == camera_b.getDistortion());
+}
+}  // namespace
 
 VisualPipeline::VisualPipeline(const Camera::ConstPtr& input_camera,
                                const Camera::ConstPtr& output_camera, bool copy_images)
 : input_camera_(input_camera), output_camera_(output_camera),
-  copy_images_(copy_images) {
+  copy_images_(copy_images), undistortion_mode_(UndistortionMode::kImage),
+  image_pyramid_max_level_(kImagePyramidDisabled) {
   CHECK(input_camera);
   CHECK(output_camera);
 }
@@ -19,7 +35,8 @@ VisualPipeline::VisualPipeline(const Camera::ConstPtr& input_camera,
 
 VisualPipeline::VisualPipeline(std::unique_ptr<Undistorter>& preprocessing, bool copy_images)
 : preprocessing_(std::move(preprocessing)),
-  copy_images_(copy_images) {
+  copy_images_(copy_images), undistortion_mode_(UndistortionMode::kImage),
+  image_pyramid_max_level_(kImagePyramidDisabled) {
   CHECK_NOTNULL(preprocessing_.get());
   input_camera_ = preprocessing_->getInputCameraShared();
   output_camera_ = preprocessing_->getOutputCameraShared();
@@ -27,6 +44,29 @@ VisualPipeline::VisualPipeline(std::unique_ptr<Undistorter>& preprocessing, bool
 
 std::shared_ptr<VisualFrame> VisualPipeline::processImage(const cv::Mat& raw_image,
                                                           int64_t timestamp) const {
+  return processImage(raw_image, timestamp, nullptr);
+}
+
+std::shared_ptr<VisualFrame> VisualPipeline::processImage(
+    const cv::Mat& raw_image, int64_t timestamp, ProcessingTimes* processing_times) const {
+  StageData data;
+  preprocessStage(raw_image, timestamp, &data);
+  /// Send the image to the derived class for processing
+  if (processing_times != nullptr) {
+    processing_times->process_frame_start_ns = time::monotonicNanoSeconds();
+  }
+  detectStage(&data);
+  describeStage(&data);
+  if (processing_times != nullptr) {
+    processing_times->process_frame_end_ns = time::monotonicNanoSeconds();
+  }
+  postprocessStage(&data);
+  return data.frame;
+}
+
+void VisualPipeline::preprocessStage(
+    const cv::Mat& raw_image, int64_t timestamp, StageData* data) const {
+  CHECK_NOTNULL(data);
   CHECK_EQ(input_camera_->imageWidth(), static_cast<size_t>(raw_image.cols));
   CHECK_EQ(input_camera_->imageHeight(), static_cast<size_t>(raw_image.rows));
 
@@ -39,21 +79,127 @@ std::shared_ptr<VisualFrame> VisualPipeline::processImage(const cv::Mat& raw_ima
   generateId(&id);
   frame->setId(id);
   if(copy_images_) {
-    frame->setRawImage(raw_image.clone());
+    if (image_buffer_pool_) {
+      cv::Mat raw_image_copy = image_buffer_pool_->acquire(raw_image.size(), raw_image.type());
+      raw_image.copyTo(raw_image_copy);
+      frame->setRawImage(raw_image_copy);
+    } else {
+      frame->setRawImage(raw_image.clone());
+    }
   } else {
     frame->setRawImage(raw_image);
   }
 
+  // In keypoint mode the detection runs on the raw image and only the keypoints are mapped
+  // into the output camera geometry afterwards. Distinct camera objects may share a geometry.
+  data->undistort_keypoints =
+      undistortion_mode_ == UndistortionMode::kKeypoints &&
+      !haveSameGeometry(*input_camera_, *output_camera_);
+
   cv::Mat image;
-  if(preprocessing_) {
+  if(preprocessing_ && !data->undistort_keypoints) {
+    if (image_buffer_pool_) {
+      // The undistorter writes into the buffer as it already has the output size and type.
+      image = image_buffer_pool_->acquire(
+          cv::Size(output_camera_->imageWidth(), output_camera_->imageHeight()),
+          raw_image.type());
+    }
     preprocessing_->processImage(raw_image, &image);
   } else {
     image = raw_image;
   }
-  /// Send the image to the derived class for processing
-  processFrameImpl(image, frame.get());
 
-  return frame;
+  // The pyramid belongs to the raw image of the frame, which is the image the optical flow
+  // tracks on without a pyramid. Mapped keypoints would not match the raw geometry of the
+  // pyramid, so it is not stored then.
+  if (image_pyramid_max_level_ != kImagePyramidDisabled && !data->undistort_keypoints) {
+    constexpr bool kWithDerivatives = true;
+    std::vector<cv::Mat> image_pyramid;
+    cv::buildOpticalFlowPyramid(
+        frame->getRawImage(), image_pyramid, image_pyramid_window_size_,
+        image_pyramid_max_level_, kWithDerivatives);
+    frame->setImagePyramid(image_pyramid);
+  }
+  data->frame = frame;
+  data->image = image;
+  data->keypoints.clear();
+}
+
+void VisualPipeline::detectStage(StageData* data) const {
+  CHECK_NOTNULL(data);
+  CHECK(data->frame);
+  detectImpl(data->image, data->frame.get(), &data->keypoints);
+}
+
+void VisualPipeline::describeStage(StageData* data) const {
+  CHECK_NOTNULL(data);
+  CHECK(data->frame);
+  describeImpl(data->image, &data->keypoints, data->frame.get());
+}
+
+void VisualPipeline::postprocessStage(StageData* data) const {
+  CHECK_NOTNULL(data);
+  CHECK(data->frame);
+  if (data->undistort_keypoints) {
+    undistortKeypoints(data->frame.get());
+  }
+  // Release the preprocessed image as early as possible, it may come from the buffer pool.
+  data->image.release();
+}
+
+void VisualPipeline::detectImpl(
+    const cv::Mat& image, VisualFrame* frame, std::vector<cv::KeyPoint>* keypoints) const {
+  CHECK_NOTNULL(keypoints)->clear();
+  processFrameImpl(image, frame);
+}
+
+void VisualPipeline::describeImpl(
+    const cv::Mat& /*image*/, std::vector<cv::KeyPoint>* /*keypoints*/,
+    VisualFrame* /*frame*/) const {}
+
+void VisualPipeline::undistortKeypoints(VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  if (!frame->hasKeypointMeasurements() || frame->getNumKeypointMeasurements() == 0u) {
+    return;
+  }
+  const size_t num_keypoints = frame->getNumKeypointMeasurements();
+
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> back_projection_success;
+  input_camera_->backProject3Vectorized(
+      frame->getKeypointMeasurements(), &bearings, &back_projection_success);
+  CHECK_EQ(back_projection_success.size(), num_keypoints);
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<ProjectionResult> projection_results;
+  output_camera_->project3Vectorized(bearings, &keypoints, &projection_results);
+  CHECK_EQ(projection_results.size(), num_keypoints);
+
+  std::vector<size_t> invisible_indices;
+  for (size_t i = 0u; i < num_keypoints; ++i) {
+    if (!back_projection_success[i] || !projection_results[i].isKeypointVisible()) {
+      invisible_indices.emplace_back(i);
+    }
+  }
+  frame->swapKeypointMeasurements(&keypoints);
+  frame->discardKeypoints(invisible_indices);
+}
+
+void VisualPipeline::enableImageBufferPool(size_t max_num_buffers) {
+  image_buffer_pool_.reset(new ImageBufferPool(max_num_buffers));
+}
+
+ImageBufferPool::Statistics VisualPipeline::getImageBufferPoolStatistics() const {
+  CHECK(image_buffer_pool_) << "The image buffer pool is not enabled.";
+  return image_buffer_pool_->getStatistics();
+}
+
+void VisualPipeline::enableImagePyramid(const cv::Size& window_size, int max_level) {
+  CHECK_GT(window_size.width, 0);
+  CHECK_GT(window_size.height, 0);
+  CHECK_GE(max_level, 0);
+  image_pyramid_window_size_ = window_size;
+  image_pyramid_max_level_ = max_level;
 }
 
 }  // namespace aslam
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/image-buffer-pool.h>
+#include <aslam/pipeline/undistorter-mapped.h>
+#include <aslam/pipeline/visual-pipeline.h>
+
+namespace {
+class PreprocessingNullPipeline : public aslam::VisualPipeline {
+ public:
+  PreprocessingNullPipeline(std::unique_ptr<aslam::Undistorter>& preprocessing, bool copy_images)
+      : aslam::VisualPipeline(preprocessing, copy_images) {}
+
+ protected:
+  virtual void processFrameImpl(const cv::Mat& /* image */,
+                                aslam::VisualFrame* /* frame */) const {}
+};
+}  // namespace
+
+TEST(ImageBufferPool, ReusesReleasedBuffers) {
+  aslam::ImageBufferPool pool(2u);
+  const cv::Size size(64, 48);
+
+  cv::Mat image_a = pool.acquire(size, CV_8UC1);
+  cv::Mat image_b = pool.acquire(size, CV_8UC1);
+  EXPECT_NE(image_a.data, image_b.data);
+  aslam::ImageBufferPool::Statistics statistics = pool.getStatistics();
+  EXPECT_EQ(statistics.num_buffers, 2u);
+  EXPECT_EQ(statistics.num_buffers_in_use, 2u);
+  EXPECT_EQ(statistics.num_allocated, 2u);
+
+  // The pool is exhausted.
+  cv::Mat image_c = pool.acquire(size, CV_8UC1);
+  EXPECT_NE(image_c.data, image_a.data);
+  EXPECT_NE(image_c.data, image_b.data);
+  EXPECT_EQ(pool.getStatistics().num_unpooled, 1u);
+
+  // A buffer is free once all copies are gone.
+  const uchar* data_a = image_a.data;
+  cv::Mat image_a_copy = image_a;
+  image_a.release();
+  EXPECT_EQ(pool.getStatistics().num_buffers_in_use, 2u);
+  image_a_copy.release();
+  EXPECT_EQ(pool.getStatistics().num_buffers_in_use, 1u);
+  cv::Mat image_d = pool.acquire(size, CV_8UC1);
+  EXPECT_EQ(image_d.data, data_a);
+  EXPECT_EQ(pool.getStatistics().num_reused, 1u);
+
+  // Free buffers of another size are replaced.
+  image_d.release();
+  cv::Mat image_e = pool.acquire(cv::Size(32, 32), CV_8UC3);
+  EXPECT_EQ(image_e.size(), cv::Size(32, 32));
+  EXPECT_EQ(image_e.type(), CV_8UC3);
+  statistics = pool.getStatistics();
+  EXPECT_EQ(statistics.num_buffers, 2u);
+  EXPECT_EQ(statistics.num_allocated, 3u);
+  EXPECT_EQ(statistics.num_buffers_in_use, 2u);
+}
+
+TEST(ImageBufferPool, PipelineReturnsRawImagesWithFrames) {
+  aslam::PinholeCamera::Ptr camera =
+      aslam::PinholeCamera::createTestCamera<aslam::RadTanDistortion>();
+  std::unique_ptr<aslam::Undistorter> undistorter = aslam::createMappedUndistorter(
+      *camera, 1.0, 1.0, aslam::InterpolationMethod::Linear);
+  constexpr bool kCopyImages = true;
+  PreprocessingNullPipeline pipeline(undistorter, kCopyImages);
+  pipeline.enableImageBufferPool(4u);
+
+  const cv::Mat raw_image(camera->imageHeight(), camera->imageWidth(), CV_8UC1, cv::Scalar(3));
+  aslam::VisualFrame::Ptr frame_0 = pipeline.processImage(raw_image, 0);
+  ASSERT_TRUE(frame_0->hasRawImage());
+  EXPECT_NE(frame_0->getRawImage().data, raw_image.data);
+  EXPECT_EQ(cv::norm(frame_0->getRawImage(), raw_image, cv::NORM_INF), 0.0);
+  // The raw copy is held by the frame, the preprocessed image returned to the pool.
+  aslam::ImageBufferPool::Statistics statistics = pipeline.getImageBufferPoolStatistics();
+  EXPECT_EQ(statistics.num_buffers, 2u);
+  EXPECT_EQ(statistics.num_buffers_in_use, 1u);
+
+  const uchar* raw_copy_data = frame_0->getRawImage().data;
+  frame_0->releaseRawImage();
+  EXPECT_EQ(pipeline.getImageBufferPoolStatistics().num_buffers_in_use, 0u);
+
+  aslam::VisualFrame::Ptr frame_1 = pipeline.processImage(raw_image, 1);
+  EXPECT_EQ(frame_1->getRawImage().data, raw_copy_data);
+  statistics = pipeline.getImageBufferPoolStatistics();
+  EXPECT_EQ(statistics.num_buffers, 2u);
+  EXPECT_EQ(statistics.num_allocated, 2u);
+  EXPECT_EQ(statistics.num_reused, 2u);
+  EXPECT_EQ(statistics.num_unpooled, 0u);
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
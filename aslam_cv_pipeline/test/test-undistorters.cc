@@ -1,7 +1,14 @@
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>  // NOLINT
+#include <string>
+
+#include <unistd.h>
 
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -15,8 +22,64 @@
 #include <aslam/cameras/distortion-radtan.h>
 #include <aslam/common/entrypoint.h>
 #include <aslam/common/memory.h>
+#include <aslam/common/undistort-helpers.h>
 #include <aslam/pipeline/test/convert-maps-legacy.h>
+#include <aslam/pipeline/undistort-map-cache.h>
 #include <aslam/pipeline/undistorter-mapped.h>
+#include <aslam/pipeline/visual-pipeline.h>
+
+DECLARE_string(undistort_map_cache_directory);
+
+namespace {
+bool areMapsEqual(const cv::Mat& map_a, const cv::Mat& map_b) {
+  if (map_a.rows != map_b.rows || map_a.cols != map_b.cols || map_a.type() != map_b.type()) {
+    return false;
+  }
+  const size_t row_size = map_a.cols * map_a.elemSize();
+  for (int row = 0; row < map_a.rows; ++row) {
+    if (std::memcmp(map_a.ptr(row), map_b.ptr(row), row_size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Eigen::Matrix2Xd getKeypointGrid(const cv::Size& image_size) {
+  constexpr int kStepPx = 20;
+  Eigen::Matrix2Xd keypoints(2, (image_size.width / kStepPx) * (image_size.height / kStepPx));
+  int index = 0;
+  for (int v = 0; v < image_size.height / kStepPx; ++v) {
+    for (int u = 0; u < image_size.width / kStepPx; ++u) {
+      keypoints.col(index++) << u * kStepPx + 0.5, v * kStepPx + 0.5;
+    }
+  }
+  return keypoints;
+}
+
+// Sets a grid of keypoints with their index as score and remembers the image size it ran on.
+class GridKeypointPipeline : public aslam::VisualPipeline {
+ public:
+  GridKeypointPipeline(std::unique_ptr<aslam::Undistorter>& preprocessing)
+      : aslam::VisualPipeline(preprocessing, false) {}
+  GridKeypointPipeline(const aslam::Camera::ConstPtr& input_camera,
+                       const aslam::Camera::ConstPtr& output_camera)
+      : aslam::VisualPipeline(input_camera, output_camera, false) {}
+
+  mutable cv::Size processed_image_size;
+
+ protected:
+  virtual void processFrameImpl(const cv::Mat& image, aslam::VisualFrame* frame) const {
+    processed_image_size = image.size();
+    const Eigen::Matrix2Xd keypoints = getKeypointGrid(image.size());
+    Eigen::VectorXd scores(keypoints.cols());
+    for (int i = 0; i < scores.rows(); ++i) {
+      scores(i) = i;
+    }
+    frame->setKeypointMeasurements(keypoints);
+    frame->setKeypointScores(scores);
+  }
+};
+}  // namespace
 
 ///////////////////////////////////////////////
 // Types to test
@@ -112,6 +175,131 @@ TYPED_TEST(TestUndistorters, TestMappedUndistorter) {
   }
 }
 
+TYPED_TEST(TestUndistorters, BuildUndistortMapIndependentOfThreadCount) {
+  std::unique_ptr<aslam::MappedUndistorter> undistorter =
+      aslam::createMappedUndistorter(*(this->camera_), 1.0, 1.0,
+                                     aslam::InterpolationMethod::Linear);
+  const aslam::Camera& output_camera = undistorter->getOutputCamera();
+
+  for (const int map_type : {CV_16SC2, CV_32FC1, CV_32FC2}) {
+    cv::Mat map_u_single, map_v_single, map_u_multi, map_v_multi;
+    aslam::common::buildUndistortMap(
+        *(this->camera_), output_camera, map_type, map_u_single, map_v_single, 1u);
+    aslam::common::buildUndistortMap(
+        *(this->camera_), output_camera, map_type, map_u_multi, map_v_multi, 4u);
+    EXPECT_TRUE(areMapsEqual(map_u_single, map_u_multi));
+    EXPECT_TRUE(areMapsEqual(map_v_single, map_v_multi));
+
+    if (map_type == CV_16SC2) {
+      // The undistorter builds its maps with all hardware threads.
+      EXPECT_TRUE(areMapsEqual(map_u_single, undistorter->getUndistortMapU()));
+      EXPECT_TRUE(areMapsEqual(map_v_single, undistorter->getUndistortMapV()));
+    }
+  }
+}
+
+TYPED_TEST(TestUndistorters, VisualPipelineUndistortsKeypointsOnly) {
+  std::unique_ptr<aslam::Undistorter> undistorter = aslam::createMappedUndistorter(
+      *(this->camera_), 0.0, 0.8, aslam::InterpolationMethod::Linear);
+  GridKeypointPipeline pipeline(undistorter);
+  pipeline.setUndistortionMode(aslam::VisualPipeline::UndistortionMode::kKeypoints);
+  pipeline.enableImagePyramid(cv::Size(21, 21), 2);
+  const aslam::Camera& input_camera = pipeline.getInputCamera();
+  const aslam::Camera& output_camera = pipeline.getOutputCamera();
+
+  const cv::Mat raw_image(input_camera.imageHeight(), input_camera.imageWidth(), CV_8UC1,
+                          cv::Scalar(0));
+  aslam::VisualFrame::Ptr frame = pipeline.processImage(raw_image, 0);
+  // The detection ran on the raw image, the frame layout is the one of the image mode.
+  EXPECT_EQ(pipeline.processed_image_size, raw_image.size());
+  EXPECT_EQ(frame->getRawImage().size(), raw_image.size());
+  EXPECT_EQ(frame->getRawCameraGeometry().get(), &input_camera);
+  EXPECT_EQ(frame->getCameraGeometry().get(), &output_camera);
+  // The pyramid of the raw image does not match the mapped keypoints.
+  EXPECT_FALSE(frame->hasImagePyramid());
+
+  const Eigen::Matrix2Xd raw_keypoints = getKeypointGrid(raw_image.size());
+  const size_t num_keypoints = frame->getNumKeypointMeasurements();
+  ASSERT_GT(num_keypoints, 0u);
+  ASSERT_LE(num_keypoints, static_cast<size_t>(raw_keypoints.cols()));
+  ASSERT_EQ(static_cast<size_t>(frame->getKeypointScores().rows()), num_keypoints);
+  for (size_t i = 0u; i < num_keypoints; ++i) {
+    EXPECT_TRUE(output_camera.isKeypointVisible(frame->getKeypointMeasurement(i)));
+    // The scores identify the raw keypoint, also after invisible keypoints were removed.
+    const int raw_index = static_cast<int>(frame->getKeypointScore(i));
+    Eigen::Vector2d keypoint_raw;
+    ASSERT_TRUE(frame->getKeypointInRawImageCoordinates(i, &keypoint_raw).isKeypointVisible());
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint_raw, raw_keypoints.col(raw_index), 1e-2));
+  }
+}
+
+TYPED_TEST(TestUndistorters, VisualPipelineKeepsKeypointsOfSameGeometry) {
+  // A distinct camera object with the same geometry does not require any mapping.
+  const aslam::Camera::ConstPtr input_camera = this->camera_;
+  const aslam::Camera::ConstPtr output_camera(this->camera_->clone());
+  GridKeypointPipeline pipeline(input_camera, output_camera);
+  pipeline.setUndistortionMode(aslam::VisualPipeline::UndistortionMode::kKeypoints);
+  pipeline.enableImagePyramid(cv::Size(21, 21), 2);
+
+  const cv::Mat raw_image(input_camera->imageHeight(), input_camera->imageWidth(), CV_8UC1,
+                          cv::Scalar(0));
+  aslam::VisualFrame::Ptr frame = pipeline.processImage(raw_image, 0);
+  const Eigen::Matrix2Xd raw_keypoints = getKeypointGrid(raw_image.size());
+  ASSERT_EQ(frame->getNumKeypointMeasurements(), static_cast<size_t>(raw_keypoints.cols()));
+  EXPECT_TRUE(EIGEN_MATRIX_EQUAL(frame->getKeypointMeasurements(), raw_keypoints));
+  EXPECT_TRUE(frame->hasImagePyramid());
+}
+
+TYPED_TEST(TestUndistorters, VisualPipelineBuildsImagePyramidOfRawImage) {
+  // Output image of a different size, such that the pyramid of the undistorted image differs.
+  std::unique_ptr<aslam::Undistorter> undistorter = aslam::createMappedUndistorter(
+      *(this->camera_), 0.0, 0.8, aslam::InterpolationMethod::Linear);
+  GridKeypointPipeline pipeline(undistorter);
+  const int kMaxLevel = 2;
+  pipeline.enableImagePyramid(cv::Size(21, 21), kMaxLevel);
+  const aslam::Camera& input_camera = pipeline.getInputCamera();
+
+  cv::Mat raw_image(input_camera.imageHeight(), input_camera.imageWidth(), CV_8UC1);
+  cv::randu(raw_image, cv::Scalar::all(0), cv::Scalar::all(255));
+  aslam::VisualFrame::Ptr frame = pipeline.processImage(raw_image, 0);
+  EXPECT_NE(pipeline.processed_image_size, raw_image.size());
+
+  // The optical flow tracks on the raw image, so the pyramid must be the one of the raw image.
+  ASSERT_TRUE(frame->hasImagePyramid());
+  const std::vector<cv::Mat>& image_pyramid = frame->getImagePyramid();
+  ASSERT_EQ(image_pyramid.size(), 2u * (kMaxLevel + 1));
+  ASSERT_EQ(image_pyramid[0].size(), raw_image.size());
+  EXPECT_EQ(cv::norm(image_pyramid[0], raw_image, cv::NORM_INF), 0.0);
+}
+
+TYPED_TEST(TestUndistorters, ParallelRemapMatchesRemap) {
+  std::unique_ptr<aslam::MappedUndistorter> undistorter =
+      aslam::createMappedUndistorter(*(this->camera_), 1.0, 1.0,
+                                     aslam::InterpolationMethod::Linear);
+  const aslam::Camera& input_camera = undistorter->getInputCamera();
+
+  cv::Mat input_image_gray(input_camera.imageHeight(), input_camera.imageWidth(), CV_8UC1);
+  cv::randu(input_image_gray, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::Mat input_image_color(input_camera.imageHeight(), input_camera.imageWidth(), CV_8UC3);
+  cv::randu(input_image_color, cv::Scalar::all(0), cv::Scalar::all(255));
+
+  for (const cv::Mat& input_image : {input_image_gray, input_image_color}) {
+    cv::Mat expected_image;
+    cv::remap(input_image, expected_image, undistorter->getUndistortMapU(),
+              undistorter->getUndistortMapV(), cv::INTER_LINEAR);
+    for (const size_t num_threads : {1u, 3u, 4u}) {
+      undistorter->enableParallelRemap(num_threads);
+      cv::Mat output_image;
+      undistorter->processImage(input_image, &output_image);
+      ASSERT_EQ(output_image.size(), expected_image.size());
+      ASSERT_EQ(output_image.type(), expected_image.type());
+      // The fixed-point path uses the interpolation weights of cv::remap.
+      EXPECT_EQ(cv::norm(output_image, expected_image, cv::NORM_INF), 0.0)
+          << "Threads: " << num_threads << ", channels: " << input_image.channels();
+    }
+  }
+}
+
 ////////////////////////////////////
 // Camera model specific test cases
 ////////////////////////////////////
@@ -165,4 +353,52 @@ TEST(TestUndistortersNoPinhole, TestMappedUndistorterUpcToPinhole) {
   }
 }
 
+TEST(TestUndistortMapCache, RoundTrip) {
+  char directory[] = "/tmp/aslam-undistort-map-cache-XXXXXX";
+  ASSERT_NE(mkdtemp(directory), nullptr);
+  FLAGS_undistort_map_cache_directory = directory;
+
+  aslam::PinholeCamera::Ptr camera =
+      aslam::PinholeCamera::createTestCamera<aslam::RadTanDistortion>();
+  std::unique_ptr<aslam::MappedUndistorter> cold_undistorter =
+      aslam::createMappedUndistorter(*camera, 1.0, 1.0, aslam::InterpolationMethod::Linear);
+
+  const aslam::UndistortMapCache cache(directory);
+  const uint64_t key = aslam::UndistortMapCache::computeKey(
+      *camera, cold_undistorter->getOutputCamera(), CV_16SC2);
+  const std::string file_path = cache.getFilePath(key);
+  ASSERT_TRUE(std::ifstream(file_path).good());
+
+  // The warm start loads the maps from the cache.
+  cv::Mat map_u, map_v;
+  ASSERT_TRUE(cache.load(key, &map_u, &map_v));
+  EXPECT_TRUE(areMapsEqual(map_u, cold_undistorter->getUndistortMapU()));
+  EXPECT_TRUE(areMapsEqual(map_v, cold_undistorter->getUndistortMapV()));
+  std::unique_ptr<aslam::MappedUndistorter> warm_undistorter =
+      aslam::createMappedUndistorter(*camera, 1.0, 1.0, aslam::InterpolationMethod::Linear);
+  EXPECT_TRUE(areMapsEqual(
+      warm_undistorter->getUndistortMapU(), cold_undistorter->getUndistortMapU()));
+  EXPECT_TRUE(areMapsEqual(
+      warm_undistorter->getUndistortMapV(), cold_undistorter->getUndistortMapV()));
+
+  // Any change of the geometry or the map type leads to a different key.
+  aslam::Camera::Ptr changed_camera(camera->clone());
+  Eigen::VectorXd distortion_parameters = changed_camera->getDistortion().getParameters();
+  distortion_parameters[0] += 1e-6;
+  changed_camera->getDistortionMutable()->setParameters(distortion_parameters);
+  EXPECT_NE(aslam::UndistortMapCache::computeKey(
+                *changed_camera, cold_undistorter->getOutputCamera(), CV_16SC2), key);
+  EXPECT_NE(aslam::UndistortMapCache::computeKey(
+                *camera, cold_undistorter->getOutputCamera(), CV_32FC2), key);
+
+  // Damaged files are rejected.
+  ASSERT_EQ(truncate(file_path.c_str(), 100), 0);
+  EXPECT_FALSE(cache.load(key, &map_u, &map_v));
+  EXPECT_FALSE(cache.load(key + 1u, &map_u, &map_v));
+
+  FLAGS_undistort_map_cache_directory = "";
+  std::remove(file_path.c_str());
+  rmdir(directory);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
@@ -1,5 +1,8 @@
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/camera-pinhole.h>
@@ -7,6 +10,7 @@
 #include <aslam/cameras/ncamera.h>
 #include <aslam/common/entrypoint.h>
 #include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-pipeline-brisk.h>
 #include <aslam/pipeline/visual-pipeline-null.h>
 #include <aslam/pipeline/visual-pipeline.h>
 #include <aslam/pipeline/visual-npipeline.h>
@@ -20,7 +24,8 @@ class VisualNPipelineTest : public ::testing::Test {
 
   void constructNCamera(unsigned num_cameras,
                         unsigned num_threads,
-                        int64_t timestamp_tolerance_ns) {
+                        int64_t timestamp_tolerance_ns,
+                        bool use_brisk_pipelines = false) {
     NCameraId id;
     generateId(&id);
     Aligned<std::vector, kindr::minimal::QuatTransformation> T_C_B;
@@ -32,7 +37,12 @@ class VisualNPipelineTest : public ::testing::Test {
 
       CameraType::Ptr camera = CameraType::createTestCamera<DistortionType>();
       cameras.push_back(camera);
-      pipelines.push_back(std::shared_ptr<VisualPipeline>(new NullVisualPipeline(camera, false)));
+      if (use_brisk_pipelines) {
+        pipelines.push_back(createBriskPipeline(camera));
+      } else {
+        pipelines.push_back(
+            std::shared_ptr<VisualPipeline>(new NullVisualPipeline(camera, false)));
+      }
     }
     camera_rig_.reset(new NCamera(id, T_C_B, cameras, "Test Camera System"));
 
@@ -50,6 +60,41 @@ class VisualNPipelineTest : public ::testing::Test {
                    CV_8UC1, uint8_t(camera_index));
   }
 
+  static VisualPipeline::Ptr createBriskPipeline(const Camera::ConstPtr& camera) {
+    constexpr bool kCopyImages = false;
+    constexpr size_t kOctaves = 3u;
+    constexpr double kUniformityRadius = 0.0;
+    constexpr double kAbsoluteThreshold = 40.0;
+    constexpr size_t kMaxNumKeypoints = 500u;
+    constexpr bool kRotationInvariant = true;
+    constexpr bool kScaleInvariant = true;
+    return VisualPipeline::Ptr(
+        new BriskVisualPipeline(
+            camera, kCopyImages, kOctaves, kUniformityRadius, kAbsoluteThreshold,
+            kMaxNumKeypoints, kRotationInvariant, kScaleInvariant));
+  }
+
+  cv::Mat getTexturedImageFromCamera(unsigned camera_index) {
+    cv::Mat image = getImageFromCamera(camera_index);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+    // Blur the noise to get blobs and corners that the detector finds.
+    cv::GaussianBlur(image, image, cv::Size(5, 5), 2.0);
+    return image;
+  }
+
+  /// Expect the same keypoints and descriptors as the given pipeline extracts from the image.
+  static void expectSameFeatures(
+      const VisualPipeline& pipeline, const cv::Mat& image, const VisualFrame& frame) {
+    const VisualFrame::Ptr expected_frame =
+        pipeline.processImage(image, frame.getTimestampNanoseconds());
+    ASSERT_TRUE(expected_frame.get() != NULL);
+    EXPECT_GT(expected_frame->getNumKeypointMeasurements(), 0u);
+    ASSERT_EQ(expected_frame->getNumKeypointMeasurements(), frame.getNumKeypointMeasurements());
+    EXPECT_TRUE(expected_frame->getKeypointMeasurements() == frame.getKeypointMeasurements());
+    ASSERT_EQ(expected_frame->getDescriptors().cols(), frame.getDescriptors().cols());
+    EXPECT_TRUE(expected_frame->getDescriptors() == frame.getDescriptors());
+  }
+
   NCamera::Ptr camera_rig_;
   VisualNPipeline::Ptr pipeline_;
 };
@@ -206,4 +251,284 @@ TEST_F(VisualNPipelineTest, testTimestampDiff) {
   ASSERT_TRUE(nframes.get() == NULL);
 }
 
+TEST_F(VisualNPipelineTest, testFrameDrop) {
+  this->constructNCamera(2, 4, 100);
+
+  // Camera 1 drops the image at 0.
+  pipeline_->processImage(0, getImageFromCamera(0), 0);
+  for (const int64_t timestamp : {1000, 2000}) {
+    pipeline_->processImage(0, getImageFromCamera(0), timestamp);
+    pipeline_->processImage(1, getImageFromCamera(1), timestamp);
+  }
+  pipeline_->waitForAllWorkToComplete();
+  // The incomplete nframe at 0 still blocks the chronological output.
+  ASSERT_EQ(3u, pipeline_->getNumFramesProcessing());  // 0, 1000, 2000
+  ASSERT_EQ(0u, pipeline_->getNumFramesComplete());
+
+  // A fourth nframe in the queue reveals the frame drop.
+  pipeline_->processImage(0, getImageFromCamera(0), 3000);
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(1u, pipeline_->getNumFramesProcessing());  // 3000
+  ASSERT_EQ(2u, pipeline_->getNumFramesComplete());    // 1000, 2000
+  EXPECT_EQ(1u, pipeline_->getNumDroppedNFrames());
+
+  std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  EXPECT_EQ(1000, nframes->getFrame(0).getTimestampNanoseconds());
+  nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  EXPECT_EQ(2000, nframes->getFrame(1).getTimestampNanoseconds());
+}
+
+TEST_F(VisualNPipelineTest, testConcurrentFramesOfManyCameras) {
+  constexpr unsigned kNumCameras = 6u;
+  this->constructNCamera(kNumCameras, 8, 100);
+
+  constexpr int64_t kNumNFrames = 100;
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    // The timestamps of the cameras jitter within the tolerance.
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      const int64_t timestamp = nframe_idx * 1000 + ((camera_idx * 37) % 100);
+      pipeline_->processImage(camera_idx, getImageFromCamera(camera_idx), timestamp);
+    }
+    // At most two nframes in flight, so no nframe is mistaken for a frame drop.
+    if (nframe_idx % 2 == 1) {
+      pipeline_->waitForAllWorkToComplete();
+    }
+  }
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(0u, pipeline_->getNumFramesProcessing());
+  ASSERT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+    ASSERT_TRUE(nframes.get() != NULL);
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      EXPECT_EQ(nframe_idx * 1000 + ((camera_idx * 37) % 100),
+                nframes->getFrame(camera_idx).getTimestampNanoseconds());
+    }
+  }
+  EXPECT_TRUE(pipeline_->getNext().get() == NULL);
+}
+
+TEST_F(VisualNPipelineTest, testCameraAffineScheduling) {
+  constexpr unsigned kNumCameras = 4u;
+  this->constructNCamera(kNumCameras, 8, 100);
+  pipeline_->setSchedulingMode(VisualNPipeline::SchedulingMode::kCameraAffine);
+
+  // The frames of each camera are processed in order, so the nframes complete in order and
+  // no nframe is mistaken for a frame drop even without waiting in between.
+  constexpr int64_t kNumNFrames = 50;
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      pipeline_->processImage(camera_idx, getImageFromCamera(camera_idx), nframe_idx * 1000);
+    }
+  }
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(0u, pipeline_->getNumFramesProcessing());
+  ASSERT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+  EXPECT_EQ(0u, pipeline_->getNumDroppedNFrames());
+
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+    ASSERT_TRUE(nframes.get() != NULL);
+    EXPECT_EQ(nframe_idx * 1000, nframes->getMinTimestampNanoseconds());
+  }
+}
+
+TEST_F(VisualNPipelineTest, testStagedProcessing) {
+  constexpr unsigned kNumCameras = 3u;
+  this->constructNCamera(kNumCameras, 1, 100);
+  constexpr size_t kMaxStageQueueSize = 2u;
+  pipeline_->enableStagedProcessing(kMaxStageQueueSize);
+
+  // The stages keep the order of the images of a camera, so the nframes complete in order.
+  constexpr int64_t kNumNFrames = 50;
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      pipeline_->processImage(camera_idx, getImageFromCamera(camera_idx), nframe_idx * 1000);
+    }
+  }
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(0u, pipeline_->getNumFramesProcessing());
+  ASSERT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+  EXPECT_EQ(0u, pipeline_->getNumDroppedNFrames());
+
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+    ASSERT_TRUE(nframes.get() != NULL);
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      EXPECT_EQ(nframe_idx * 1000, nframes->getFrame(camera_idx).getTimestampNanoseconds());
+    }
+  }
+  EXPECT_EQ(
+      static_cast<size_t>(kNumNFrames),
+      pipeline_->getLatencySummary(0u, VisualNPipelineStatistics::Stage::kTotal).num_samples);
+}
+
+TEST_F(VisualNPipelineTest, testStagedProcessingWithBrisk) {
+  constexpr unsigned kNumCameras = 2u;
+  this->constructNCamera(kNumCameras, 1, 100, true);
+  constexpr size_t kMaxStageQueueSize = 2u;
+  pipeline_->enableStagedProcessing(kMaxStageQueueSize);
+
+  // The detection and description run on separate stage threads, which must yield the same
+  // features as processing every image at once.
+  constexpr int64_t kNumNFrames = 8;
+  std::vector<std::vector<cv::Mat>> images(kNumNFrames);
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      images[nframe_idx].push_back(getTexturedImageFromCamera(camera_idx));
+      pipeline_->processImage(camera_idx, images[nframe_idx][camera_idx], nframe_idx * 1000);
+    }
+  }
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+
+  std::vector<VisualPipeline::Ptr> reference_pipelines;
+  for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+    reference_pipelines.push_back(createBriskPipeline(camera_rig_->getCameraShared(camera_idx)));
+  }
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+    ASSERT_TRUE(nframes.get() != NULL);
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      EXPECT_EQ(nframe_idx * 1000, nframes->getFrame(camera_idx).getTimestampNanoseconds());
+      expectSameFeatures(*reference_pipelines[camera_idx], images[nframe_idx][camera_idx],
+                         nframes->getFrame(camera_idx));
+    }
+  }
+}
+
+TEST_F(VisualNPipelineTest, testStagedProcessingDroppingOldestImages) {
+  this->constructNCamera(1, 1, 100, true);
+  constexpr size_t kMaxStageQueueSize = 1u;
+  pipeline_->enableStagedProcessing(kMaxStageQueueSize);
+
+  // Adding the images much faster than they are described fills the first stage queue, whose
+  // oldest image is then dropped instead of blocking.
+  constexpr int64_t kNumImages = 40;
+  constexpr size_t kMaxOutputQueueSize = static_cast<size_t>(kNumImages);
+  const cv::Mat image = getTexturedImageFromCamera(0u);
+  size_t num_dropped = 0u;
+  for (int64_t image_idx = 0; image_idx < kNumImages; ++image_idx) {
+    if (pipeline_->processImageNonBlockingDroppingOldestNFrameIfFull(
+        0u, image, image_idx * 1000, kMaxOutputQueueSize)) {
+      ++num_dropped;
+    }
+  }
+  pipeline_->waitForAllWorkToComplete();
+  EXPECT_GT(num_dropped, 0u);
+  EXPECT_EQ(num_dropped, pipeline_->getNumSkippedNFrames());
+  EXPECT_EQ(num_dropped, pipeline_->getNumSkippedFrames());
+  EXPECT_EQ(0u, pipeline_->getNumEvictedNFrames());
+  EXPECT_EQ(0u, pipeline_->getNumFramesProcessing());
+  ASSERT_EQ(static_cast<size_t>(kNumImages) - num_dropped, pipeline_->getNumFramesComplete());
+
+  // The remaining images are processed in order.
+  const VisualPipeline::Ptr reference_pipeline =
+      createBriskPipeline(camera_rig_->getCameraShared(0u));
+  int64_t previous_timestamp_ns = -1;
+  std::shared_ptr<VisualNFrame> nframes;
+  while ((nframes = pipeline_->getNext())) {
+    const int64_t timestamp_ns = nframes->getFrame(0u).getTimestampNanoseconds();
+    EXPECT_GT(timestamp_ns, previous_timestamp_ns);
+    previous_timestamp_ns = timestamp_ns;
+    expectSameFeatures(*reference_pipeline, image, nframes->getFrame(0u));
+  }
+  // The newest image is never dropped.
+  EXPECT_EQ((kNumImages - 1) * 1000, previous_timestamp_ns);
+}
+
+TEST_F(VisualNPipelineTest, testLatencyBudget) {
+  this->constructNCamera(2, 4, 100);
+  pipeline_->setLatencyBudget(1000);
+
+  pipeline_->processImage(0, getImageFromCamera(0), 5000);
+  pipeline_->waitForAllWorkToComplete();
+  // Both images at 0 are older than the budget relative to the image at 5000.
+  pipeline_->processImage(0, getImageFromCamera(0), 0);
+  pipeline_->processImage(1, getImageFromCamera(1), 0);
+  pipeline_->waitForAllWorkToComplete();
+  EXPECT_EQ(1u, pipeline_->getNumSkippedNFrames());
+  EXPECT_EQ(2u, pipeline_->getNumSkippedFrames());
+  ASSERT_EQ(1u, pipeline_->getNumFramesProcessing());  // 5000
+  ASSERT_EQ(0u, pipeline_->getNumFramesComplete());
+
+  // Images within the budget are processed.
+  pipeline_->processImage(1, getImageFromCamera(1), 5000);
+  pipeline_->processImage(0, getImageFromCamera(0), 4500);
+  pipeline_->processImage(1, getImageFromCamera(1), 4500);
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(2u, pipeline_->getNumFramesComplete());
+  EXPECT_EQ(2u, pipeline_->getNumSkippedFrames());
+
+  // An nframe that is skipped after one camera was processed is discarded completely and
+  // releases the newer nframes it was blocking.
+  pipeline_->processImage(0, getImageFromCamera(0), 6000);
+  pipeline_->waitForAllWorkToComplete();
+  pipeline_->processImage(0, getImageFromCamera(0), 8000);
+  pipeline_->processImage(1, getImageFromCamera(1), 8000);
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(2u, pipeline_->getNumFramesComplete());
+  pipeline_->processImage(1, getImageFromCamera(1), 6000);
+  pipeline_->waitForAllWorkToComplete();
+  EXPECT_EQ(2u, pipeline_->getNumSkippedNFrames());
+  EXPECT_EQ(3u, pipeline_->getNumSkippedFrames());
+  EXPECT_EQ(0u, pipeline_->getNumFramesProcessing());
+  ASSERT_EQ(3u, pipeline_->getNumFramesComplete());
+
+  std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  EXPECT_EQ(4500, nframes->getMinTimestampNanoseconds());
+  nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  EXPECT_EQ(5000, nframes->getMinTimestampNanoseconds());
+  nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  EXPECT_EQ(8000, nframes->getMinTimestampNanoseconds());
+}
+
+TEST_F(VisualNPipelineTest, testLatencyStatistics) {
+  constexpr unsigned kNumCameras = 2u;
+  this->constructNCamera(kNumCameras, 4, 100);
+
+  constexpr int64_t kNumNFrames = 20;
+  for (int64_t nframe_idx = 0; nframe_idx < kNumNFrames; ++nframe_idx) {
+    for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+      pipeline_->processImage(camera_idx, getImageFromCamera(camera_idx), nframe_idx * 1000);
+    }
+    pipeline_->waitForAllWorkToComplete();
+  }
+  ASSERT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+
+  typedef VisualNPipelineStatistics::Stage Stage;
+  for (unsigned camera_idx = 0u; camera_idx < kNumCameras; ++camera_idx) {
+    for (const Stage stage : {Stage::kQueue, Stage::kPreprocessing, Stage::kProcessFrame,
+                              Stage::kSynchronization, Stage::kTotal}) {
+      const VisualNPipelineStatistics::LatencySummary summary =
+          pipeline_->getLatencySummary(camera_idx, stage);
+      EXPECT_EQ(static_cast<size_t>(kNumNFrames), summary.num_samples);
+      EXPECT_GE(summary.p50_seconds, 0.0);
+      EXPECT_LE(summary.p50_seconds, summary.p90_seconds);
+      EXPECT_LE(summary.p90_seconds, summary.p99_seconds);
+      EXPECT_LE(summary.p99_seconds, summary.max_seconds);
+      EXPECT_LE(summary.mean_seconds, summary.max_seconds);
+    }
+    EXPECT_GE(pipeline_->getLatencySummary(camera_idx, Stage::kTotal).max_seconds,
+              pipeline_->getLatencySummary(camera_idx, Stage::kProcessFrame).max_seconds);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getQueueDepths().num_completed_nframes);
+  EXPECT_EQ(0u, pipeline_->getNumDroppedNFrames());
+  EXPECT_EQ(0u, pipeline_->getNumEvictedNFrames());
+
+  // Evict the oldest nframes of a full output queue.
+  constexpr size_t kMaxOutputQueueSize = 5u;
+  EXPECT_TRUE(pipeline_->processImageNonBlockingDroppingOldestNFrameIfFull(
+      0u, getImageFromCamera(0u), kNumNFrames * 1000, kMaxOutputQueueSize));
+  EXPECT_EQ(1u, pipeline_->getNumEvictedNFrames());
+  EXPECT_EQ(static_cast<size_t>(kNumNFrames),
+            pipeline_->getMaxQueueDepths().num_completed_nframes);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
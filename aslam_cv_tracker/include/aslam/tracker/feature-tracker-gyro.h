@@ -43,6 +43,7 @@ class GyroTracker : public FeatureTracker{
  public:
   ASLAM_DISALLOW_EVIL_CONSTRUCTORS(GyroTracker);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  friend class GyroTrackerTest;
 
  public:
   /// \brief Construct the feature tracker.
@@ -95,6 +96,11 @@ class GyroTracker : public FeatureTracker{
       VisualFrame* frame_kp1,
       FrameToFrameMatchesWithScore* matches_kp1_k);
 
+  /// Can the image pyramid of the frame be passed to the optical flow instead of the image?
+  /// This requires a pyramid of the raw image in the tracker's camera geometry with enough
+  /// levels and padding.
+  bool isImagePyramidUsableForLk(const VisualFrame& frame) const;
+
   /// In general, not all unmatched features will be tracked with the optical
   /// flow algorithm. This function computes the candidates that will be tracked.
   virtual void computeLKCandidates(
@@ -208,12 +208,21 @@ void GyroTracker::lkTracking(
   std::vector<unsigned char> lk_tracking_success;
   std::vector<float> lk_tracking_errors;
 
-  cv::calcOpticalFlowPyrLK(
-      frame_k.getRawImage(), frame_kp1->getRawImage(), lk_cv_points_k,
-      lk_cv_points_kp1, lk_tracking_success, lk_tracking_errors,
-      settings_.lk_window_size, settings_.lk_max_pyramid_levels,
-      settings_.lk_termination_criteria, settings_.lk_operation_flag,
-      settings_.lk_min_eigenvalue_threshold);
+  auto track_with_lk = [&](cv::InputArray image_k, cv::InputArray image_kp1) {
+    cv::calcOpticalFlowPyrLK(
+        image_k, image_kp1, lk_cv_points_k,
+        lk_cv_points_kp1, lk_tracking_success, lk_tracking_errors,
+        settings_.lk_window_size, settings_.lk_max_pyramid_levels,
+        settings_.lk_termination_criteria, settings_.lk_operation_flag,
+        settings_.lk_min_eigenvalue_threshold);
+  };
+  // The pyramids stored in the frames by the visual pipeline spare building the pyramids of
+  // both frames on every call.
+  if (isImagePyramidUsableForLk(frame_k) && isImagePyramidUsableForLk(*frame_kp1)) {
+    track_with_lk(frame_k.getImagePyramid(), frame_kp1->getImagePyramid());
+  } else {
+    track_with_lk(frame_k.getRawImage(), frame_kp1->getRawImage());
+  }
 
   CHECK_EQ(lk_tracking_success.size(), lk_definite_indices_k.size());
   CHECK_EQ(lk_cv_points_kp1.size(), lk_tracking_success.size());
@@ -324,6 +333,48 @@ void GyroTracker::computeTrackedMatches(
   }
 }
 
+bool GyroTracker::isImagePyramidUsableForLk(const VisualFrame& frame) const {
+  if (!frame.hasImagePyramid()) {
+    return false;
+  }
+  // The pyramid must be the one of the raw image, which the optical flow uses otherwise.
+  const std::vector<cv::Mat>& image_pyramid = frame.getImagePyramid();
+  if (image_pyramid.empty() || !frame.hasRawImage() ||
+      image_pyramid[0].size() != frame.getRawImage().size() ||
+      static_cast<size_t>(image_pyramid[0].cols) != camera_.imageWidth() ||
+      static_cast<size_t>(image_pyramid[0].rows) != camera_.imageHeight()) {
+    return false;
+  }
+
+  // Same layout detection as in cv::calcOpticalFlowPyrLK: Each level may be followed by its
+  // derivatives.
+  size_t level_step = 1u;
+  if (image_pyramid.size() % 2u == 0u &&
+      image_pyramid[1].channels() == 2 * image_pyramid[0].channels() &&
+      image_pyramid[1].depth() == CV_16S) {
+    level_step = 2u;
+  }
+  const int max_level = static_cast<int>(image_pyramid.size() / level_step) - 1;
+  if (max_level < settings_.lk_max_pyramid_levels) {
+    return false;
+  }
+
+  // The optical flow requires the levels to be padded by the window size.
+  const cv::Size& window_size = settings_.lk_window_size;
+  for (size_t level = 0u; level < image_pyramid.size(); level += level_step) {
+    const cv::Mat& image = image_pyramid[level];
+    cv::Size whole_size;
+    cv::Point offset;
+    image.locateROI(whole_size, offset);
+    if (offset.x < window_size.width || offset.y < window_size.height ||
+        offset.x + image.cols + window_size.width > whole_size.width ||
+        offset.y + image.rows + window_size.height > whole_size.height) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void GyroTracker::computeLKCandidates(
     const FrameToFrameMatchesWithScore& matches_kp1_k,
     const FrameStatusTrackLength& status_track_length_k,
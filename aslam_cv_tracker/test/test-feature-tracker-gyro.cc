@@ -0,0 +1,211 @@
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/matcher/match.h>
+#include <aslam/tracker/feature-tracker-gyro.h>
+#include <eigen-checks/gtest.h>
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+namespace aslam {
+
+namespace {
+constexpr size_t kMinDistanceToImageBorderPx = 40u;
+// Size of the ORB descriptors the tracker extracts.
+constexpr int kDescriptorSizeBytes = 32;
+constexpr double kShiftXPx = 3.0;
+constexpr double kShiftYPx = 2.0;
+constexpr int kKeypointGridMarginPx = 60;
+constexpr int kKeypointGridStepPx = 40;
+}  // namespace
+
+class GyroTrackerTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    camera_ = PinholeCamera::createTestCamera();
+    tracker_.reset(new GyroTracker(*camera_, kMinDistanceToImageBorderPx, cv::ORB::create()));
+
+    // Smooth random texture for frame k. Frame (k+1) sees the same texture, shifted by a few
+    // pixels.
+    const cv::Size image_size(camera_->imageWidth(), camera_->imageHeight());
+    cv::Mat noise(image_size, CV_8UC1);
+    cv::RNG random_number_generator(42);
+    random_number_generator.fill(noise, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat blurred_noise;
+    cv::GaussianBlur(noise, blurred_noise, cv::Size(0, 0), 2.0);
+    cv::normalize(blurred_noise, image_k_, 0, 255, cv::NORM_MINMAX);
+    const cv::Mat shift = (cv::Mat_<double>(2, 3) << 1.0, 0.0, kShiftXPx, 0.0, 1.0, kShiftYPx);
+    cv::warpAffine(image_k_, image_kp1_, shift, image_size);
+
+    // Grid of keypoints in frame k that stays within the image after the shift.
+    const int num_keypoints_x =
+        (image_size.width - 2 * kKeypointGridMarginPx) / kKeypointGridStepPx;
+    const int num_keypoints_y =
+        (image_size.height - 2 * kKeypointGridMarginPx) / kKeypointGridStepPx;
+    keypoints_k_.resize(Eigen::NoChange, num_keypoints_x * num_keypoints_y);
+    for (int idx_y = 0; idx_y < num_keypoints_y; ++idx_y) {
+      for (int idx_x = 0; idx_x < num_keypoints_x; ++idx_x) {
+        keypoints_k_.col(idx_y * num_keypoints_x + idx_x) <<
+            kKeypointGridMarginPx + idx_x * kKeypointGridStepPx + 0.25,
+            kKeypointGridMarginPx + idx_y * kKeypointGridStepPx + 0.5;
+      }
+    }
+    // Frame (k+1) already contains a few detected keypoints.
+    keypoints_kp1_ = keypoints_k_.leftCols(5);
+  }
+
+  VisualFrame::Ptr createFrame(
+      const cv::Mat& image, const Eigen::Matrix2Xd& keypoints, int64_t timestamp) const {
+    VisualFrame::Ptr frame = VisualFrame::createEmptyTestVisualFrame(camera_, timestamp);
+    const int num_keypoints = keypoints.cols();
+    frame->setKeypointMeasurements(keypoints);
+    frame->setKeypointMeasurementUncertainties(
+        Eigen::VectorXd::Constant(num_keypoints, GyroTrackerSettings::kKeypointUncertaintyPx));
+    frame->setKeypointOrientations(Eigen::VectorXd::Zero(num_keypoints));
+    frame->setKeypointScales(Eigen::VectorXd::Constant(num_keypoints, 12.0));
+    frame->setKeypointScores(Eigen::VectorXd::Ones(num_keypoints));
+    frame->setTrackIds(Eigen::VectorXi::Constant(num_keypoints, -1));
+    frame->setDescriptors(VisualFrame::DescriptorsT::Zero(kDescriptorSizeBytes, num_keypoints));
+    frame->setRawImage(image);
+    return frame;
+  }
+
+  void createFrames(VisualFrame::Ptr* frame_k, VisualFrame::Ptr* frame_kp1) const {
+    CHECK_NOTNULL(frame_k);
+    CHECK_NOTNULL(frame_kp1);
+    *frame_k = createFrame(image_k_, keypoints_k_, 0);
+    *frame_kp1 = createFrame(image_kp1_, keypoints_kp1_, 1);
+  }
+
+  // Same as the image pyramid built by the visual pipeline.
+  static void addImagePyramid(const cv::Size& window_size, int max_level, VisualFrame* frame) {
+    CHECK_NOTNULL(frame);
+    constexpr bool kWithDerivatives = true;
+    std::vector<cv::Mat> image_pyramid;
+    cv::buildOpticalFlowPyramid(
+        frame->getRawImage(), image_pyramid, window_size, max_level, kWithDerivatives);
+    frame->setImagePyramid(image_pyramid);
+  }
+
+  bool isImagePyramidUsableForLk(const VisualFrame& frame) const {
+    return tracker_->isImagePyramidUsableForLk(frame);
+  }
+
+  const cv::Size& lkWindowSize() const {
+    return tracker_->settings_.lk_window_size;
+  }
+
+  int lkMaxPyramidLevels() const {
+    return tracker_->settings_.lk_max_pyramid_levels;
+  }
+
+  // Optical flow tracking of all keypoints of frame k, predicted to stay in place.
+  void lkTracking(
+      const VisualFrame& frame_k, VisualFrame* frame_kp1,
+      FrameToFrameMatchesWithScore* matches_kp1_k) const {
+    CHECK_NOTNULL(frame_kp1);
+    CHECK_NOTNULL(matches_kp1_k)->clear();
+    const std::vector<unsigned char> prediction_success(keypoints_k_.cols(), 1u);
+    std::vector<int> lk_candidate_indices_k(keypoints_k_.cols());
+    std::iota(lk_candidate_indices_k.begin(), lk_candidate_indices_k.end(), 0);
+    tracker_->lkTracking(
+        keypoints_k_, prediction_success, lk_candidate_indices_k, frame_k, frame_kp1,
+        matches_kp1_k);
+  }
+
+  static void expectSameLkResults(
+      const FrameToFrameMatchesWithScore& expected_matches_kp1_k,
+      const VisualFrame& expected_frame_kp1,
+      const FrameToFrameMatchesWithScore& matches_kp1_k,
+      const VisualFrame& frame_kp1) {
+    ASSERT_EQ(expected_matches_kp1_k.size(), matches_kp1_k.size());
+    for (size_t idx = 0u; idx < matches_kp1_k.size(); ++idx) {
+      EXPECT_EQ(expected_matches_kp1_k[idx].getKeypointIndexAppleFrame(),
+                matches_kp1_k[idx].getKeypointIndexAppleFrame());
+      EXPECT_EQ(expected_matches_kp1_k[idx].getKeypointIndexBananaFrame(),
+                matches_kp1_k[idx].getKeypointIndexBananaFrame());
+    }
+    EXPECT_TRUE(EIGEN_MATRIX_EQUAL(
+        expected_frame_kp1.getKeypointMeasurements(), frame_kp1.getKeypointMeasurements()));
+    EXPECT_TRUE(EIGEN_MATRIX_EQUAL(
+        expected_frame_kp1.getDescriptors(), frame_kp1.getDescriptors()));
+  }
+
+  PinholeCamera::Ptr camera_;
+  std::unique_ptr<GyroTracker> tracker_;
+  cv::Mat image_k_;
+  cv::Mat image_kp1_;
+  Eigen::Matrix2Xd keypoints_k_;
+  Eigen::Matrix2Xd keypoints_kp1_;
+};
+
+TEST_F(GyroTrackerTest, LkTrackingWithImagePyramidMatchesRawImages) {
+  VisualFrame::Ptr frame_k, frame_kp1;
+  createFrames(&frame_k, &frame_kp1);
+  FrameToFrameMatchesWithScore expected_matches_kp1_k;
+  lkTracking(*frame_k, frame_kp1.get(), &expected_matches_kp1_k);
+
+  // Make sure the test is not trivially passing: Most keypoints are tracked to their shifted
+  // positions.
+  EXPECT_GT(expected_matches_kp1_k.size(), static_cast<size_t>(keypoints_k_.cols() / 2));
+  for (const FrameToFrameMatchWithScore& match : expected_matches_kp1_k) {
+    const Eigen::Vector2d expected_keypoint_kp1 =
+        keypoints_k_.col(match.getKeypointIndexBananaFrame()) +
+        Eigen::Vector2d(kShiftXPx, kShiftYPx);
+    EXPECT_NEAR((frame_kp1->getKeypointMeasurement(match.getKeypointIndexAppleFrame()) -
+                 expected_keypoint_kp1).norm(), 0.0, 0.1);
+  }
+
+  // Pyramids with more levels than the optical flow uses.
+  VisualFrame::Ptr frame_k_pyramid, frame_kp1_pyramid;
+  createFrames(&frame_k_pyramid, &frame_kp1_pyramid);
+  addImagePyramid(lkWindowSize(), lkMaxPyramidLevels() + 1, frame_k_pyramid.get());
+  addImagePyramid(lkWindowSize(), lkMaxPyramidLevels() + 1, frame_kp1_pyramid.get());
+  ASSERT_TRUE(isImagePyramidUsableForLk(*frame_k_pyramid));
+  ASSERT_TRUE(isImagePyramidUsableForLk(*frame_kp1_pyramid));
+
+  FrameToFrameMatchesWithScore matches_kp1_k;
+  lkTracking(*frame_k_pyramid, frame_kp1_pyramid.get(), &matches_kp1_k);
+  expectSameLkResults(expected_matches_kp1_k, *frame_kp1, matches_kp1_k, *frame_kp1_pyramid);
+}
+
+TEST_F(GyroTrackerTest, LkTrackingFallsBackToRawImagesForUnusablePyramids) {
+  VisualFrame::Ptr frame_k, frame_kp1;
+  createFrames(&frame_k, &frame_kp1);
+  FrameToFrameMatchesWithScore expected_matches_kp1_k;
+  lkTracking(*frame_k, frame_kp1.get(), &expected_matches_kp1_k);
+  EXPECT_GT(expected_matches_kp1_k.size(), static_cast<size_t>(keypoints_k_.cols() / 2));
+
+  // The optical flow would silently use fewer levels.
+  const int kShallowMaxLevel = lkMaxPyramidLevels() - 1;
+  ASSERT_GE(kShallowMaxLevel, 0);
+  // The optical flow requires the levels to be padded by its window size.
+  const cv::Size kSmallWindowSize(lkWindowSize().width / 4, lkWindowSize().height / 4);
+
+  const std::vector<std::pair<cv::Size, int>> unusable_pyramid_settings = {
+      {lkWindowSize(), kShallowMaxLevel}, {kSmallWindowSize, lkMaxPyramidLevels() + 1}};
+  for (const std::pair<cv::Size, int>& pyramid_settings : unusable_pyramid_settings) {
+    VisualFrame::Ptr frame_k_pyramid, frame_kp1_pyramid;
+    createFrames(&frame_k_pyramid, &frame_kp1_pyramid);
+    addImagePyramid(pyramid_settings.first, pyramid_settings.second, frame_k_pyramid.get());
+    addImagePyramid(pyramid_settings.first, pyramid_settings.second, frame_kp1_pyramid.get());
+    EXPECT_FALSE(isImagePyramidUsableForLk(*frame_k_pyramid));
+    EXPECT_FALSE(isImagePyramidUsableForLk(*frame_kp1_pyramid));
+
+    FrameToFrameMatchesWithScore matches_kp1_k;
+    lkTracking(*frame_k_pyramid, frame_kp1_pyramid.get(), &matches_kp1_k);
+    expectSameLkResults(expected_matches_kp1_k, *frame_kp1, matches_kp1_k, *frame_kp1_pyramid);
+  }
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT